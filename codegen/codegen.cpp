@@ -14,24 +14,39 @@ CodeGenerator::CodeGenerator(std::ostream& outputStream,
                            const CodeGenConfig& config)
     : output(outputStream), instructions(instructions), config(config) {
     
-    std::cerr << "CodeGenerator构造函数开始\n";
-    std::cerr << "IR指令数量: " << instructions.size() << "\n";
-    std::cerr << "初始化寄存器信息\n";
+    trace("CodeGenerator构造函数开始");
+    trace("IR指令数量: " + std::to_string(instructions.size()));
+    trace("初始化寄存器信息");
 
     initializeRegisters();
-    std::cerr << "寄存器信息初始化完成\n";
-    std::cerr << "输出文件头\n";
+    trace("寄存器信息初始化完成");
+    trace("输出文件头");
 
     emitComment("由ToyC编译器生成");
     emitComment("RISC-V汇编代码");
     emitSection(".text");
+    if (config.emitDebugLineInfo) {
+        output << "\t.file 1 \"" << config.sourceFileName << "\"\n";
+    }
+    
+    if (config.instrumentFunctions) {
+        for (const auto& instr : instructions) {
+            if (auto begin = std::dynamic_pointer_cast<FunctionBeginInstr>(instr)) {
+                profiledFunctionIndex.emplace(begin->funcName, static_cast<int>(profiledFunctionIndex.size()));
+            }
+        }
+    }
+    
+    if (config.saveRestore) {
+        analyzeSaveRestoreCandidates();
+    }
     
     if (config.regAllocStrategy != RegisterAllocStrategy::NAIVE) {
-        std::cerr << "执行寄存器分配\n";
+        trace("执行寄存器分配");
         allocateRegisters();
-        std::cerr << "寄存器分配完成\n";
+        trace("寄存器分配完成");
     }
-    std::cerr << "CodeGenerator构造函数完成\n";
+    trace("CodeGenerator构造函数完成");
 }
 
 CodeGenerator::~CodeGenerator() {
@@ -40,15 +55,14 @@ CodeGenerator::~CodeGenerator() {
 // ==================== 主要生成函数 ====================
 
 void CodeGenerator::generate() {
-    std::cerr << "进入generate方法\n";
+    trace("进入generate方法");
 
-    std::vector<std::string> asmInstructions;
+    // 函数体的汇编先按行缓存，窥孔优化在缓冲区上进行，最后统一输出
+    std::vector<AsmLine> asmLines;
 
-    std::cerr << "开始处理IR指令, 总数: " << instructions.size() << "\n";
+    trace("开始处理IR指令, 总数: " + std::to_string(instructions.size()));
     for (const auto& instr : instructions) {
         std::stringstream tempOutput;
-        std::streampos originalPos = output.tellp();
-        
         processInstructionToStream(instr, tempOutput);
         
         std::string asmCode = tempOutput.str();
@@ -57,30 +71,52 @@ void CodeGenerator::generate() {
         
         while (std::getline(iss, line)) {
             if (!line.empty()) {
-                if (line[0] != '#' && line[0] != '\t' && line.back() != ':') {
-                    asmInstructions.push_back(line);
-                } else {
-                    output << line << "\n";
-                }
+                asmLines.push_back(AsmLine::classify(line));
             }
         }
     }
     
-    std::cerr << "IR指令处理完成\n";
+    trace("IR指令处理完成");
 
     if (config.enablePeepholeOptimizations) {
-        peepholeOptimize(asmInstructions);
+        peepholeOptimize(asmLines);
     }
     
     if (config.optimizeStackLayout) {
         optimizeStackLayout();
     }
+
+    if (config.enableMachineOutliner) {
+        MachineOutliner outliner;
+        outliner.functionSections = config.functionSections;
+        MachineOutliner::Stats stats = outliner.run(asmLines);
+        trace("机器外提: " + std::to_string(stats.functions) + "个子程序, " + std::to_string(stats.callSites) +
+              "处调用, 节省" + std::to_string(stats.savedInstructions) + "条指令");
+    }
+
+    if (config.hotColdSplit) {
+        HotColdSplitter splitter;
+        splitter.functionSections = config.functionSections;
+        splitter.profile = config.hotColdProfile;
+        HotColdSplitter::Stats stats = splitter.run(asmLines);
+        trace("冷热分区: " + std::to_string(stats.functions) + "个函数, " + std::to_string(stats.coldBlocks) +
+              "个冷块(" + std::to_string(stats.coldInstructions) + "条指令), " +
+              std::to_string(stats.longBranches) + "处跨分区分支");
+    }
     
-    for (const auto& instr : asmInstructions) {
-        output << "\t" << instr << "\n";
+    for (const auto& line : asmLines) {
+        output << line.render() << "\n";
     }
 
-    std::cerr << "generate方法执行完成\n";
+    if (!saveRestoreRoutines.empty()) {
+        emitSaveRestoreRoutines();
+    }
+
+    if (needsProfileDump()) {
+        emitProfileRuntime();
+    }
+
+    trace("generate方法执行完成");
 }
 
 // ==================== 指令流处理 ====================
@@ -88,6 +124,9 @@ void CodeGenerator::generate() {
 void CodeGenerator::processInstructionToStream(const std::shared_ptr<IRInstr>& instr, std::ostream& stream) {
     std::streambuf* originalBuf = output.std::ostream::rdbuf();
     output.std::ostream::rdbuf(stream.rdbuf());
+    if (config.emitDebugLineInfo) {
+        emitSourceLocation(instr);
+    }
     processInstruction(instr);
     output.std::ostream::rdbuf(originalBuf);
 }
@@ -152,9 +191,13 @@ void CodeGenerator::processInstruction(const std::shared_ptr<IRInstr>& instr) {
         case OpCode::FUNCTION_END:
             processFunctionEnd(std::dynamic_pointer_cast<FunctionEndInstr>(instr));
             break;
+
+        case OpCode::PROFILE_COUNT:
+            processProfileCounter(std::dynamic_pointer_cast<ProfileCounterInstr>(instr));
+            break;
             
         default:
-            std::cerr << "Error: Unknown instruction type" << std::endl;
+            *config.diagnostics << "Error: Unknown instruction type" << std::endl;
             break;
     }
 }
@@ -240,7 +283,7 @@ void CodeGenerator::processBinaryOp(const std::shared_ptr<BinaryOpInstr>& instr)
                 emitInstruction("snez " + resultReg + ", " + resultReg);
                 break;
             default:
-                std::cerr << "错误: 未知的二元操作" << std::endl;
+                *config.diagnostics << "错误: 未知的二元操作" << std::endl;
                 break;
         }
 
@@ -268,7 +311,7 @@ void CodeGenerator::processUnaryOp(const std::shared_ptr<UnaryOpInstr>& instr) {
             emitInstruction("seqz " + resultReg + ", " + operandReg);
             break;
         default:
-            std::cerr << "错误: 未知的一元操作" << std::endl;
+            *config.diagnostics << "错误: 未知的一元操作" << std::endl;
             break;
     }
     
@@ -307,7 +350,7 @@ void CodeGenerator::processParam(const std::shared_ptr<ParamInstr>& instr) {
 
 void CodeGenerator::processCall(const std::shared_ptr<CallInstr>& instr) {
     if (!instr) {
-        std::cerr << "错误: 空的函数调用指令" << std::endl;
+        *config.diagnostics << "错误: 空的函数调用指令" << std::endl;
         return;
     }
 
@@ -326,12 +369,12 @@ void CodeGenerator::processCall(const std::shared_ptr<CallInstr>& instr) {
                 params.push_back(paramQueue[startIdx + i]);
             }
         } else {
-            std::cerr << "错误: 参数队列大小不匹配, 预期 " << paramCount 
+            *config.diagnostics << "错误: 参数队列大小不匹配, 预期 " << paramCount 
                       << ", 实际 " << paramQueue.size() << std::endl;
             return;
         }
-    } else {
-        std::cerr << "错误: 没有可用的参数" << std::endl;
+    } else if (paramCount > 0) {
+        *config.diagnostics << "错误: 没有可用的参数" << std::endl;
         return;
     }
 
@@ -388,7 +431,7 @@ void CodeGenerator::processLabel(const std::shared_ptr<LabelInstr>& instr) {
 
 void CodeGenerator::processFunctionBegin(const std::shared_ptr<FunctionBeginInstr>& instr) {
     if (!instr) {
-        std::cerr << "错误: 空的函数开始指令" << std::endl;
+        *config.diagnostics << "错误: 空的函数开始指令" << std::endl;
         return;
     }
     
@@ -413,8 +456,7 @@ void CodeGenerator::processFunctionBegin(const std::shared_ptr<FunctionBeginInst
         }
     }
 
-    emitGlobal(instr->funcName);
-    emitLabel(instr->funcName);
+    emitFunctionStart(instr->funcName, true);
     emitPrologue(instr->funcName);
 
     if (currentFunctionParams.empty()) {
@@ -445,6 +487,7 @@ void CodeGenerator::processFunctionBegin(const std::shared_ptr<FunctionBeginInst
 void CodeGenerator::processFunctionEnd(const std::shared_ptr<FunctionEndInstr>& instr) {
     emitLabel(currentFunction + "_epilogue");
     emitEpilogue(currentFunction);
+    emitFunctionEnd(currentFunction);
     output << "\n";
 
     currentFunction = "";
@@ -455,6 +498,37 @@ void CodeGenerator::processFunctionEnd(const std::shared_ptr<FunctionEndInstr>&
     frameInitialized = false;
 }
 
+// 64位计数器加一：低32位回绕为0时向高32位进位
+void CodeGenerator::processProfileCounter(const std::shared_ptr<ProfileCounterInstr>& instr) {
+    emitComment(instr->toString());
+
+    std::string addrReg = allocTempReg();
+    std::string valueReg = allocTempReg();
+    int offset = instr->counterIndex * 8;
+
+    emitInstruction("la " + addrReg + ", __toyc_prof_counters");
+    if (offset + 4 > 2047) {
+        emitInstruction("li " + valueReg + ", " + std::to_string(offset));
+        emitInstruction("add " + addrReg + ", " + addrReg + ", " + valueReg);
+        offset = 0;
+    }
+
+    std::string skipLabel = ".Lprof_nocarry" + std::to_string(instr->counterIndex);
+    std::string low = std::to_string(offset) + "(" + addrReg + ")";
+    std::string high = std::to_string(offset + 4) + "(" + addrReg + ")";
+    emitInstruction("lw " + valueReg + ", " + low);
+    emitInstruction("addi " + valueReg + ", " + valueReg + ", 1");
+    emitInstruction("sw " + valueReg + ", " + low);
+    emitInstruction("bnez " + valueReg + ", " + skipLabel);
+    emitInstruction("lw " + valueReg + ", " + high);
+    emitInstruction("addi " + valueReg + ", " + valueReg + ", 1");
+    emitInstruction("sw " + valueReg + ", " + high);
+    emitLabel(skipLabel);
+
+    freeTempReg(valueReg);
+    freeTempReg(addrReg);
+}
+
 // ==================== 输出辅助函数 ====================
 
 std::string CodeGenerator::genLabel() {
@@ -481,6 +555,35 @@ void CodeGenerator::emitSection(const std::string& section) {
     output << section << "\n";
 }
 
+// 函数符号的开头和结尾：.type/.size让链接器和工具知道函数的范围；
+// -ffunction-sections时每个函数单独成段，链接器可以回收没有被引用的函数（--gc-sections）
+void CodeGenerator::emitFunctionStart(const std::string& name, bool global) {
+    if (config.functionSections) {
+        emitSection(".section .text." + name + ",\"ax\",@progbits");
+    }
+    if (global) {
+        emitGlobal(name);
+    }
+    output << "\t.type " << name << ", @function\n";
+    emitLabel(name);
+}
+
+void CodeGenerator::emitFunctionEnd(const std::string& name) {
+    output << "\t.size " << name << ", .-" << name << "\n";
+}
+
+// 在指令生成的汇编前输出.loc，位置不变时不重复输出；标签不产生代码，跳过
+void CodeGenerator::emitSourceLocation(const std::shared_ptr<IRInstr>& instr) {
+    if (instr->opcode == OpCode::FUNCTION_BEGIN) {
+        lastEmittedLoc = SourceLocation();
+    }
+    if (instr->opcode == OpCode::LABEL || !instr->loc.isValid() || instr->loc == lastEmittedLoc) {
+        return;
+    }
+    output << "\t.loc 1 " << instr->loc.line << " " << instr->loc.column << "\n";
+    lastEmittedLoc = instr->loc;
+}
+
 // ==================== 函数序言和后记 ====================
 
 void CodeGenerator::emitPrologue(const std::string& funcName) {
@@ -488,50 +591,98 @@ void CodeGenerator::emitPrologue(const std::string& funcName) {
     
     resetStackOffset();
 
-    calleeRegsSize = countUsedCalleeSavedRegs() * 4;
+    // 共享例程按固定顺序把s1..sN保存在fp-12、fp-16...，先占住这些槽位
+    saveRestoreCount = -1;
+    if (config.saveRestore && !inlineFrameFunctions.count(funcName)) {
+        saveRestoreCount = 0;
+        for (const auto& reg : usedCalleeSavedRegs) {
+            if (reg == "s0" || reg == "fp") continue;
+            saveRestoreCount = std::max(saveRestoreCount, std::stoi(reg.substr(1)));
+        }
+        for (int k = 1; k <= saveRestoreCount; ++k) {
+            getRegisterStackOffset("s" + std::to_string(k));
+        }
+        saveRestoreRoutines.insert(saveRestoreCount);
+    }
+
+    calleeRegsSize = std::max(countUsedCalleeSavedRegs(), saveRestoreCount) * 4;
     callerRegsSize = countUsedCallerSavedRegs() * 4;
     int localsAndPadding = analyzeTempVars();
     int totalFrameSize = calleeRegsSize + callerRegsSize + localsAndPadding + 8;
     totalFrameSize = (totalFrameSize + 15) & ~15;
     frameSize = totalFrameSize;
 
-    if (totalFrameSize <= 2048) {
-        emitInstruction("addi sp, sp, -" + std::to_string(totalFrameSize));
+    if (saveRestoreCount >= 0) {
+        // 例程分配并填好栈帧顶部的保存区、设置fp，这里只分配剩余部分
+        int saveAreaSize = ((saveRestoreCount + 2) * 4 + 15) & ~15;
+        int remaining = totalFrameSize - saveAreaSize;
+        emitInstruction("jal t0, __toyc_save_" + std::to_string(saveRestoreCount));
+        if (remaining > 0 && remaining <= 2048) {
+            emitInstruction("addi sp, sp, -" + std::to_string(remaining));
+        } else if (remaining > 0) {
+            emitInstruction("li t0, -" + std::to_string(remaining));
+            emitInstruction("add sp, sp, t0");
+        }
     } else {
-        emitInstruction("li t0, -" + std::to_string(totalFrameSize));
-        emitInstruction("add sp, sp, t0");
-    }
+        if (totalFrameSize <= 2048) {
+            emitInstruction("addi sp, sp, -" + std::to_string(totalFrameSize));
+        } else {
+            emitInstruction("li t0, -" + std::to_string(totalFrameSize));
+            emitInstruction("add sp, sp, t0");
+        }
 
-    if (totalFrameSize - 4 <= 2047) {
-        emitInstruction("sw ra, " + std::to_string(totalFrameSize - 4) + "(sp)");
-    } else {
-        emitInstruction("li t0, " + std::to_string(totalFrameSize - 4));
-        emitInstruction("add t0, sp, t0");
-        emitInstruction("sw ra, 0(t0)");
-    }
+        if (totalFrameSize - 4 <= 2047) {
+            emitInstruction("sw ra, " + std::to_string(totalFrameSize - 4) + "(sp)");
+        } else {
+            emitInstruction("li t0, " + std::to_string(totalFrameSize - 4));
+            emitInstruction("add t0, sp, t0");
+            emitInstruction("sw ra, 0(t0)");
+        }
     
-    if (totalFrameSize - 8 <= 2047) {
-        emitInstruction("sw fp, " + std::to_string(totalFrameSize - 8) + "(sp)");
-    } else {
-        emitInstruction("li t0, " + std::to_string(totalFrameSize - 8));
-        emitInstruction("add t0, sp, t0");
-        emitInstruction("sw fp, 0(t0)");
-    }
+        if (totalFrameSize - 8 <= 2047) {
+            emitInstruction("sw fp, " + std::to_string(totalFrameSize - 8) + "(sp)");
+        } else {
+            emitInstruction("li t0, " + std::to_string(totalFrameSize - 8));
+            emitInstruction("add t0, sp, t0");
+            emitInstruction("sw fp, 0(t0)");
+        }
 
-    if (totalFrameSize <= 2048) {
-        emitInstruction("addi fp, sp, " + std::to_string(totalFrameSize));
-    } else {
-        emitInstruction("li t0, " + std::to_string(totalFrameSize));
-        emitInstruction("add fp, sp, t0");
-    }
+        if (totalFrameSize <= 2048) {
+            emitInstruction("addi fp, sp, " + std::to_string(totalFrameSize));
+        } else {
+            emitInstruction("li t0, " + std::to_string(totalFrameSize));
+            emitInstruction("add fp, sp, t0");
+        }
 
-    saveCalleeSavedRegs();
+        saveCalleeSavedRegs();
+    }
     frameInitialized = true;
     this->frameSize = totalFrameSize;
+
+    if (config.instrumentFunctions) {
+        // 只用t寄存器，a0-a7中的实参不受影响
+        emitInstruction("la t1, __toyc_fi_table+" + std::to_string(profiledFunctionIndex[funcName] * 32));
+        emitInstruction("jal t0, __toyc_fi_enter");
+    }
 }
 
 void CodeGenerator::emitEpilogue(const std::string& funcName) {
     emitComment("函数后记");
+
+    if (config.instrumentFunctions) {
+        emitInstruction("la t1, __toyc_fi_table+" + std::to_string(profiledFunctionIndex[funcName] * 32));
+        emitInstruction("jal t0, __toyc_fi_exit");
+    }
+    if (needsProfileDump() && funcName == "main") {
+        // 转储例程保留a0，main的返回值不受影响
+        emitInstruction("call __toyc_prof_dump");
+    }
+
+    if (saveRestoreCount >= 0) {
+        // 尾跳转：例程恢复寄存器、释放整个栈帧后直接返回调用者
+        emitInstruction("j __toyc_restore_" + std::to_string(saveRestoreCount));
+        return;
+    }
     
     restoreCalleeSavedRegs();
     
@@ -561,10 +712,244 @@ void CodeGenerator::emitEpilogue(const std::string& funcName) {
     emitInstruction("ret");
 }
 
+// ==================== 共享的保存/恢复例程（-msave-restore） ====================
+
+// 只在循环中被调用的叶函数保持内联序言/后记：它们调用频繁，
+// 而共享例程每次调用要多执行两次跳转；其余函数都改用共享例程以缩小代码
+void CodeGenerator::analyzeSaveRestoreCandidates() {
+    std::set<std::string> leafFunctions;
+    std::string current;
+    bool hasCall = false;
+    for (const auto& instr : instructions) {
+        if (auto begin = std::dynamic_pointer_cast<FunctionBeginInstr>(instr)) {
+            current = begin->funcName;
+            hasCall = false;
+        } else if (instr->opcode == OpCode::CALL) {
+            hasCall = true;
+        } else if (instr->opcode == OpCode::FUNCTION_END && !hasCall) {
+            leafFunctions.insert(current);
+        }
+    }
+
+    std::vector<int> loopDepths = IRAnalyzer::computeLoopDepths(instructions);
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto call = std::dynamic_pointer_cast<CallInstr>(instructions[i]);
+        if (call && loopDepths[i] > 0 && leafFunctions.count(call->funcName)) {
+            inlineFrameFunctions.insert(call->funcName);
+        }
+    }
+}
+
+// __toyc_save_N：由"jal t0"调用，分配栈帧顶部的保存区，保存ra、fp和s1..sN，令fp指向帧顶
+// __toyc_restore_N：由函数后记尾跳转进入，从fp恢复寄存器并释放整个栈帧后返回
+// 布局与内联序言相同：ra在fp-4，fp在fp-8，s1..sN依次在fp-12、fp-16...
+void CodeGenerator::emitSaveRestoreRoutines() {
+    for (int count : saveRestoreRoutines) {
+        int saveAreaSize = ((count + 2) * 4 + 15) & ~15;
+        std::string suffix = std::to_string(count);
+        std::string savedRegs = count > 0 ? "ra、fp和s1-s" + suffix : "ra、fp";
+
+        output << "\n";
+        emitComment("保存" + savedRegs + "（-msave-restore）");
+        emitFunctionStart("__toyc_save_" + suffix, false);
+        emitInstruction("addi sp, sp, -" + std::to_string(saveAreaSize));
+        emitInstruction("sw ra, " + std::to_string(saveAreaSize - 4) + "(sp)");
+        emitInstruction("sw fp, " + std::to_string(saveAreaSize - 8) + "(sp)");
+        for (int k = 1; k <= count; ++k) {
+            emitInstruction("sw s" + std::to_string(k) + ", " + std::to_string(saveAreaSize - 8 - 4 * k) + "(sp)");
+        }
+        emitInstruction("addi fp, sp, " + std::to_string(saveAreaSize));
+        emitInstruction("jr t0");
+        emitFunctionEnd("__toyc_save_" + suffix);
+
+        emitComment("恢复" + savedRegs + "并返回（-msave-restore）");
+        emitFunctionStart("__toyc_restore_" + suffix, false);
+        for (int k = 1; k <= count; ++k) {
+            emitInstruction("lw s" + std::to_string(k) + ", " + std::to_string(-8 - 4 * k) + "(fp)");
+        }
+        emitInstruction("lw ra, -4(fp)");
+        // 返回时t1已不活跃，用它暂存调用者的fp，避免在释放栈帧后再读取其中的内容
+        emitInstruction("lw t1, -8(fp)");
+        emitInstruction("mv sp, fp");
+        emitInstruction("mv fp, t1");
+        emitInstruction("ret");
+        emitFunctionEnd("__toyc_restore_" + suffix);
+    }
+}
+
+// ==================== 剖析运行时 ====================
+
+// 剖析文件由若干段组成，每段是文本描述（以"data"行结束）加一张.bss中的数据表：
+//   边剖析   TOYCPROF edge 1  + 64位边计数器
+//   函数剖析 TOYCPROF func 1  + 每函数32字节记录
+// 转储例程在main返回前通过Linux系统调用把各段依次写入剖析文件，供toyc_profdata读取。
+void CodeGenerator::emitProfileRuntime() {
+    struct Section {
+        std::string desc;
+        std::string table;
+        int tableBytes;
+    };
+    std::vector<Section> sections;
+
+    if (config.instrumentEdgeProfile) {
+        sections.push_back({config.profileDescriptor, "__toyc_prof_counters", config.profileCounterCount * 8});
+    }
+    if (config.instrumentFunctions) {
+        std::vector<std::string> names(profiledFunctionIndex.size());
+        for (const auto& [name, index] : profiledFunctionIndex) names[index] = name;
+        std::string desc = "TOYCPROF func 1\nfunctions " + std::to_string(names.size()) + "\n";
+        for (size_t i = 0; i < names.size(); ++i) {
+            desc += "f " + std::to_string(i) + " " + names[i] + "\n";
+        }
+        desc += "data\n";
+        sections.push_back({desc, "__toyc_fi_table", static_cast<int>(names.size()) * 32});
+    }
+
+    output << "\n";
+    emitComment("剖析数据表");
+    emitSection(".bss");
+    for (const auto& section : sections) {
+        output << "\t.align 3\n";
+        emitLabel(section.table);
+        output << "\t.zero " << std::max(section.tableBytes, 8) << "\n";
+    }
+
+    emitComment("剖析描述与输出文件名");
+    emitSection(".section .rodata");
+    for (size_t i = 0; i < sections.size(); ++i) {
+        emitLabel("__toyc_prof_desc" + std::to_string(i));
+        emitAsciiData(sections[i].desc);
+    }
+    emitLabel("__toyc_prof_path");
+    emitAsciiData(config.profileOutputFile + std::string(1, '\0'));
+
+    emitSection(".text");
+    if (config.instrumentFunctions) {
+        emitFunctionProfileRoutines();
+    }
+
+    emitComment("剖析数据转储: openat/write/close，保留a0");
+    emitFunctionStart("__toyc_prof_dump", true);
+    emitInstruction("addi sp, sp, -16");
+    emitInstruction("sw ra, 12(sp)");
+    emitInstruction("sw a0, 8(sp)");
+    emitInstruction("sw s1, 4(sp)");
+    emitInstruction("li a0, -100");                 // AT_FDCWD
+    emitInstruction("la a1, __toyc_prof_path");
+    emitInstruction("li a2, 577");                  // O_WRONLY|O_CREAT|O_TRUNC
+    emitInstruction("li a3, 420");                  // 0644
+    emitInstruction("li a7, 56");                   // openat
+    emitInstruction("ecall");
+    emitInstruction("bltz a0, __toyc_prof_dump_done");
+    emitInstruction("mv s1, a0");
+    for (size_t i = 0; i < sections.size(); ++i) {
+        emitInstruction("mv a0, s1");
+        emitInstruction("la a1, __toyc_prof_desc" + std::to_string(i));
+        emitInstruction("li a2, " + std::to_string(sections[i].desc.size()));
+        emitInstruction("li a7, 64");               // write
+        emitInstruction("ecall");
+        emitInstruction("mv a0, s1");
+        emitInstruction("la a1, " + sections[i].table);
+        emitInstruction("li a2, " + std::to_string(sections[i].tableBytes));
+        emitInstruction("li a7, 64");
+        emitInstruction("ecall");
+    }
+    emitInstruction("mv a0, s1");
+    emitInstruction("li a7, 57");                   // close
+    emitInstruction("ecall");
+    emitLabel("__toyc_prof_dump_done");
+    emitInstruction("lw s1, 4(sp)");
+    emitInstruction("lw a0, 8(sp)");
+    emitInstruction("lw ra, 12(sp)");
+    emitInstruction("addi sp, sp, 16");
+    emitInstruction("ret");
+    emitFunctionEnd("__toyc_prof_dump");
+}
+
+// 函数剖析的进入/退出例程：t1指向函数记录，以jal t0调用，只使用t寄存器。
+// 记录布局（32字节）: calls(8) cycles(8) depth(4) pad(4) start(8)。
+// depth记录当前活跃的激活数，只有最外层激活计时，递归调用不会重复累计包含时间。
+void CodeGenerator::emitFunctionProfileRoutines() {
+    // 读取64位cycle计数：高位前后两次一致才有效，hi->t2, lo->t3
+    auto emitReadCycle = [this](const std::string& retryLabel) {
+        emitLabel(retryLabel);
+        emitInstruction("rdcycleh t2");
+        emitInstruction("rdcycle t3");
+        emitInstruction("rdcycleh t4");
+        emitInstruction("bne t2, t4, " + retryLabel);
+    };
+
+    emitComment("函数剖析: 进入");
+    emitFunctionStart("__toyc_fi_enter", false);
+    emitInstruction("lw t2, 0(t1)");
+    emitInstruction("addi t2, t2, 1");
+    emitInstruction("sw t2, 0(t1)");
+    emitInstruction("bnez t2, __toyc_fi_enter_depth");
+    emitInstruction("lw t2, 4(t1)");
+    emitInstruction("addi t2, t2, 1");
+    emitInstruction("sw t2, 4(t1)");
+    emitLabel("__toyc_fi_enter_depth");
+    emitInstruction("lw t2, 16(t1)");
+    emitInstruction("addi t3, t2, 1");
+    emitInstruction("sw t3, 16(t1)");
+    emitInstruction("bnez t2, __toyc_fi_enter_done");
+    emitReadCycle("__toyc_fi_enter_cycle");
+    emitInstruction("sw t3, 24(t1)");
+    emitInstruction("sw t2, 28(t1)");
+    emitLabel("__toyc_fi_enter_done");
+    emitInstruction("jr t0");
+    emitFunctionEnd("__toyc_fi_enter");
+
+    emitComment("函数剖析: 退出");
+    emitFunctionStart("__toyc_fi_exit", false);
+    emitInstruction("lw t2, 16(t1)");
+    emitInstruction("addi t2, t2, -1");
+    emitInstruction("sw t2, 16(t1)");
+    emitInstruction("bnez t2, __toyc_fi_exit_done");
+    emitReadCycle("__toyc_fi_exit_cycle");
+    emitInstruction("lw t4, 24(t1)");
+    emitInstruction("lw t5, 28(t1)");
+    emitInstruction("sub t6, t3, t4");              // 低位差
+    emitInstruction("sltu t4, t3, t4");             // 借位
+    emitInstruction("sub t5, t2, t5");
+    emitInstruction("sub t5, t5, t4");              // 高位差
+    emitInstruction("lw t2, 8(t1)");
+    emitInstruction("lw t3, 12(t1)");
+    emitInstruction("add t2, t2, t6");
+    emitInstruction("sltu t4, t2, t6");             // 进位
+    emitInstruction("add t3, t3, t5");
+    emitInstruction("add t3, t3, t4");
+    emitInstruction("sw t2, 8(t1)");
+    emitInstruction("sw t3, 12(t1)");
+    emitLabel("__toyc_fi_exit_done");
+    emitInstruction("jr t0");
+    emitFunctionEnd("__toyc_fi_exit");
+}
+
+// 以.ascii输出任意字节，每个源行一条指令
+void CodeGenerator::emitAsciiData(const std::string& text) {
+    std::string line;
+    auto flush = [&]() {
+        if (!line.empty()) output << "\t.ascii \"" << line << "\"\n";
+        line.clear();
+    };
+    for (char c : text) {
+        switch (c) {
+            case '\n': line += "\\n"; flush(); break;
+            case '"': line += "\\\""; break;
+            case '\\': line += "\\\\"; break;
+            case '\0': line += "\\000"; break;
+            default: line += c;
+        }
+    }
+    flush();
+}
+
 // ==================== 寄存器管理 ====================
 
-void CodeGenerator::initializeRegisters() {
-    registers = {
+// 寄存器描述表只读，各CodeGenerator实例从这里复制出可变的使用状态
+static const std::vector<Register>& registerTable() {
+    static const std::vector<Register> table = {
         {"zero", false, false, false, true, "常量0", false},
         {"t0", true, false, true, false, "临时寄存器0", false},
         {"t1", true, false, true, false, "临时寄存器1", false},
@@ -599,6 +984,15 @@ void CodeGenerator::initializeRegisters() {
         {"tp", false, false, false, true, "线程指针", false},
         {"fp", false, true, false, true, "帧指针/s0", false}
     };
+    return table;
+}
+
+void CodeGenerator::initializeRegisters() {
+    registers = registerTable();
+}
+
+void CodeGenerator::trace(const std::string& message) {
+    if (config.traceProgress) *config.diagnostics << message << "\n";
 }
 
 std::string CodeGenerator::allocTempReg() {
@@ -612,7 +1006,7 @@ std::string CodeGenerator::allocTempReg() {
     for(Register& reg : registers) {
         if (reg.name == tempRegs[nextTempReg]) {
             if (reg.isUsed) {
-                std::cerr << "错误: 临时寄存器 " << reg.name << " 已经被使用" << std::endl;
+                *config.diagnostics << "错误: 临时寄存器 " << reg.name << " 已经被使用" << std::endl;
                 return "";
             }
             reg.isUsed = true;
@@ -718,11 +1112,11 @@ void CodeGenerator::loadOperand(const std::shared_ptr<Operand>& op, const std::s
             break;
             
         case OperandType::LABEL:
-            std::cerr << "警告: 尝试加载标签操作数" << std::endl;
+            *config.diagnostics << "警告: 尝试加载标签操作数" << std::endl;
             break;
             
         default:
-            std::cerr << "错误: 未知的操作数类型" << std::endl;
+            *config.diagnostics << "错误: 未知的操作数类型" << std::endl;
             break;
     }
 }
@@ -746,7 +1140,7 @@ void CodeGenerator::storeRegister(const std::string& reg, const std::shared_ptr<
             }
         }
     } else {
-        std::cerr << "错误: 无法存储到非变量操作数" << std::endl;
+        *config.diagnostics << "错误: 无法存储到非变量操作数" << std::endl;
     }
 }
 
@@ -759,12 +1153,12 @@ void CodeGenerator::resetStackOffset() {
 
 int CodeGenerator::getOperandOffset(const std::shared_ptr<Operand>& op) {
     if (!op) {
-        std::cerr << "错误: 空操作数" << std::endl;
+        *config.diagnostics << "错误: 空操作数" << std::endl;
         return 0;
     }
 
     if (op->type != OperandType::VARIABLE && op->type != OperandType::TEMP) {
-        std::cerr << "错误: 只有变量和临时变量有栈偏移" << std::endl;
+        *config.diagnostics << "错误: 只有变量和临时变量有栈偏移" << std::endl;
         return 0;
     }
     
@@ -1031,7 +1425,9 @@ void CodeGenerator::addPeepholePattern(const std::string& pattern,
     peepholePatterns[pattern] = handler;
 }
 
-void CodeGenerator::peepholeOptimize(std::vector<std::string>& instructions) {
+// 手写模式作用于连续的指令（窗口最多3条，处理函数只改写自己匹配的前缀）；
+// 之后应用toyc_superopt生成的规则，这些规则会检查被删除的寄存器在窗口后是否还活跃
+void CodeGenerator::peepholeOptimize(std::vector<AsmLine>& lines) {
     if (peepholePatterns.empty()) {
         addPeepholePattern("load_store_same", [](std::vector<std::string>& instrs) -> bool {
             if (instrs.size() < 2) return false;
@@ -1045,55 +1441,15 @@ void CodeGenerator::peepholeOptimize(std::vector<std::string>& instructions) {
                 std::string storeReg = store.substr(3, store.find(",") - 3);
                 std::string storeMem = store.substr(store.find(",") + 1);
                 
+                // 把刚读出的值写回原处：写回是多余的，读取仍然需要
                 if (loadReg == storeReg && loadMem == storeMem) {
-                    instrs.clear();
+                    instrs.erase(instrs.begin() + 1);
                     return true;
                 }
             }
             return false;
         });
         
-        addPeepholePattern("li_compare", [](std::vector<std::string>& instrs) -> bool {
-            if (instrs.size() < 2) return false;
-            
-            std::string li = instrs[0];
-            std::string branch = instrs[1];
-            
-            if (li.find("li ") == 0) {
-                std::string reg = li.substr(3, li.find(",") - 3);
-                std::string imm = li.substr(li.find(",") + 1);
-                imm = imm.substr(imm.find_first_not_of(" \t"));
-                
-                if (imm == "0") {
-                    if (branch.find("beq ") == 0) {
-                        std::string branchParts = branch.substr(4);
-                        size_t commaPos = branchParts.find(",");
-                        std::string reg1 = branchParts.substr(0, commaPos);
-                        reg1 = reg1.substr(reg1.find_first_not_of(" \t"));
-                        
-                        std::string rest = branchParts.substr(commaPos + 1);
-                        size_t nextCommaPos = rest.find(",");
-                        std::string reg2 = rest.substr(0, nextCommaPos);
-                        reg2 = reg2.substr(reg2.find_first_not_of(" \t"));
-                        
-                        std::string label = rest.substr(nextCommaPos + 1);
-                        label = label.substr(label.find_first_not_of(" \t"));
-                        
-                        if (reg2 == reg) {
-                            instrs.clear();
-                            instrs.push_back("beqz " + reg1 + ", " + label);
-                            return true;
-                        } else if (reg1 == reg) {
-                            instrs.clear();
-                            instrs.push_back("beqz " + reg2 + ", " + label);
-                            return true;
-                        }
-                    }
-                }
-            }
-            return false;
-        });
-        
         addPeepholePattern("redundant_move", [](std::vector<std::string>& instrs) -> bool {
             if (instrs.size() < 1) return false;
             
@@ -1104,7 +1460,7 @@ void CodeGenerator::peepholeOptimize(std::vector<std::string>& instructions) {
                 src = src.substr(src.find_first_not_of(" \t"));
                 
                 if (dst == src) {
-                    instrs.clear();
+                    instrs.erase(instrs.begin());
                     return true;
                 }
             }
@@ -1112,37 +1468,54 @@ void CodeGenerator::peepholeOptimize(std::vector<std::string>& instructions) {
         });
     }
     
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        
-        for (size_t i = 0; i < instructions.size(); ) {
-            bool patternApplied = false;
+    std::vector<AsmLine> result;
+    result.reserve(lines.size());
+    std::vector<std::string> run;
+    auto flushRun = [&]() {
+        bool changed = true;
+        while (changed) {
+            changed = false;
             
-            for (auto& [pattern, handler] : peepholePatterns) {
-                size_t windowSize = std::min(size_t(3), instructions.size() - i);
-                std::vector<std::string> window(instructions.begin() + i, 
-                                               instructions.begin() + i + windowSize);
+            for (size_t i = 0; i < run.size(); ) {
+                bool patternApplied = false;
                 
-                if (handler(window)) {
-                    changed = true;
-                    patternApplied = true;
-                    
-                    instructions.erase(instructions.begin() + i, 
-                                      instructions.begin() + i + windowSize);
-                    instructions.insert(instructions.begin() + i, 
-                                       window.begin(), window.end());
+                for (auto& [pattern, handler] : peepholePatterns) {
+                    size_t windowSize = std::min(size_t(3), run.size() - i);
+                    std::vector<std::string> window(run.begin() + i, run.begin() + i + windowSize);
                     
-                    i += window.size();
-                    break;
+                    if (handler(window)) {
+                        changed = true;
+                        patternApplied = true;
+                        
+                        run.erase(run.begin() + i, run.begin() + i + windowSize);
+                        run.insert(run.begin() + i, window.begin(), window.end());
+                        break;
+                    }
+                }
+                
+                if (!patternApplied) {
+                    i++;
                 }
             }
-            
-            if (!patternApplied) {
-                i++;
-            }
+        }
+        for (auto& text : run) {
+            result.push_back({AsmLine::Kind::INSTRUCTION, std::move(text)});
+        }
+        run.clear();
+    };
+    for (auto& line : lines) {
+        if (line.kind == AsmLine::Kind::INSTRUCTION) {
+            run.push_back(std::move(line.text));
+        } else {
+            flushRun();
+            result.push_back(std::move(line));
         }
     }
+    flushRun();
+    lines.swap(result);
+    
+    int rewrites = PeepholeRewriter::generated().run(lines);
+    trace("生成的窥孔规则改写次数: " + std::to_string(rewrites));
 }
 
 // ==================== 辅助函数 ====================
@@ -1160,7 +1533,7 @@ std::string CodeGenerator::getArgRegister(int paramIndex) const {
     if (paramIndex >= 0 && paramIndex < argRegs.size()) {
         return argRegs[paramIndex];
     }
-    std::cerr << "错误: 参数索引超出范围" << std::endl;
+    *config.diagnostics << "错误: 参数索引超出范围" << std::endl;
     return "a0";
 }
 
@@ -1311,31 +1684,52 @@ std::vector<LinearScanRegisterAllocator::LiveInterval> LinearScanRegisterAllocat
 std::map<std::string, std::string> GraphColoringRegisterAllocator::allocate(
     const std::vector<std::shared_ptr<IRInstr>>& instructions,
     const std::vector<Register>& availableRegs) {
-    
+
     std::map<std::string, std::string> allocation;
-    
+
     auto interferenceGraph = buildInterferenceGraph(instructions);
-    
-    if (interferenceGraph.empty()) {
+
+    if (interferenceGraph.nodes.empty()) {
         return allocation;
     }
-    
+
     auto simplifiedOrder = simplify(interferenceGraph);
     allocation = color(simplifiedOrder, interferenceGraph, availableRegs);
-    
+
     return allocation;
 }
 
-std::map<std::string, std::set<std::string>> GraphColoringRegisterAllocator::buildInterferenceGraph(
+GraphColoringRegisterAllocator::InterferenceGraph::InterferenceGraph(std::vector<std::string> names)
+    : nodes(std::move(names)), adjacency(nodes.size()) {
+    std::uint64_t n = nodes.size();
+    matrix.assign((n * (n - 1) / 2 + 63) / 64, 0);
+}
+
+// 下三角存储：a > b 时 (a, b) 位于第 a*(a-1)/2 + b 位
+bool GraphColoringRegisterAllocator::InterferenceGraph::interferes(int a, int b) const {
+    if (a == b) return false;
+    if (a < b) std::swap(a, b);
+    std::uint64_t bit = static_cast<std::uint64_t>(a) * (a - 1) / 2 + b;
+    return (matrix[bit / 64] >> (bit % 64)) & 1;
+}
+
+void GraphColoringRegisterAllocator::InterferenceGraph::addEdge(int a, int b) {
+    if (a == b || interferes(a, b)) return;
+    int high = std::max(a, b), low = std::min(a, b);
+    std::uint64_t bit = static_cast<std::uint64_t>(high) * (high - 1) / 2 + low;
+    matrix[bit / 64] |= std::uint64_t(1) << (bit % 64);
+    adjacency[a].push_back(b);
+    adjacency[b].push_back(a);
+}
+
+GraphColoringRegisterAllocator::InterferenceGraph GraphColoringRegisterAllocator::buildInterferenceGraph(
     const std::vector<std::shared_ptr<IRInstr>>& instructions) {
-    
-    std::map<std::string, std::set<std::string>> graph;
-    
+
     std::map<std::string, std::pair<int, int>> varLifetimes;
-    
+
     for (int i = 0; i < instructions.size(); i++) {
         auto instr = instructions[i];
-        
+
         auto defined = IRAnalyzer::getDefinedVariables(instr);
         for (const auto& var : defined) {
             if (varLifetimes.find(var) == varLifetimes.end()) {
@@ -1344,7 +1738,7 @@ std::map<std::string, std::set<std::string>> GraphColoringRegisterAllocator::bui
                 varLifetimes[var].first = std::min(varLifetimes[var].first, i);
             }
         }
-        
+
         auto used = IRAnalyzer::getUsedVariables(instr);
         for (const auto& var : used) {
             if (varLifetimes.find(var) == varLifetimes.end()) {
@@ -1353,108 +1747,122 @@ std::map<std::string, std::set<std::string>> GraphColoringRegisterAllocator::bui
             varLifetimes[var].second = std::max(varLifetimes[var].second, i);
         }
     }
-    
-    for (const auto& [var, _] : varLifetimes) {
-        graph[var] = std::set<std::string>();
-    }
-    
-    for (const auto& [var1, lifetime1] : varLifetimes) {
-        for (const auto& [var2, lifetime2] : varLifetimes) {
-            if (var1 != var2) {
-                int overlapStart = std::max(lifetime1.first, lifetime2.first);
-                int overlapEnd = std::min(lifetime1.second, lifetime2.second);
-                
-                if (overlapStart <= overlapEnd) {
-                    graph[var1].insert(var2);
-                    graph[var2].insert(var1);
-                }
-            }
+
+    std::vector<std::string> names;
+    std::vector<std::pair<int, int>> lifetimes;
+    for (const auto& [var, lifetime] : varLifetimes) {
+        names.push_back(var);
+        lifetimes.push_back(lifetime);
+    }
+    InterferenceGraph graph(std::move(names));
+
+    // 按生存期起点扫描：新结点与仍然存活（终点不早于新起点）的结点干涉，
+    // 已结束的结点从活跃表中移除，总时间与结点数加边数成正比
+    std::vector<int> byStart(lifetimes.size());
+    for (size_t i = 0; i < byStart.size(); i++) byStart[i] = i;
+    std::stable_sort(byStart.begin(), byStart.end(), [&](int a, int b) {
+        return lifetimes[a].first < lifetimes[b].first;
+    });
+
+    std::vector<int> active;
+    for (int node : byStart) {
+        int start = lifetimes[node].first;
+        size_t kept = 0;
+        for (int other : active) {
+            if (lifetimes[other].second < start) continue;
+            graph.addEdge(node, other);
+            active[kept++] = other;
         }
+        active.resize(kept);
+        active.push_back(node);
     }
-    
+
     return graph;
 }
 
-std::vector<std::string> GraphColoringRegisterAllocator::simplify(
-    std::map<std::string, std::set<std::string>>& graph) {
-    
-    std::vector<std::string> simplifiedOrder;
-    
-    auto workGraph = graph;
-    
-    while (!workGraph.empty()) {
-        std::string nodeToRemove;
-        int minDegree = std::numeric_limits<int>::max();
-        
-        for (const auto& [node, neighbors] : workGraph) {
-            if (neighbors.size() < minDegree) {
-                minDegree = neighbors.size();
-                nodeToRemove = node;
-            }
-        }
-        
-        if (nodeToRemove.empty()) {
-            int maxDegree = -1;
-            for (const auto& [node, neighbors] : workGraph) {
-                if (neighbors.size() > maxDegree) {
-                    maxDegree = neighbors.size();
-                    nodeToRemove = node;
-                }
-            }
-        }
-        
-        for (auto& [_, neighbors] : workGraph) {
-            neighbors.erase(nodeToRemove);
+// 每次移除度最小的结点。结点按当前度挂在双向链表桶中，移除结点只把邻居
+// 移到低一级的桶；最小度每次至多下降1，因此查找最小非空桶是均摊O(1)的
+std::vector<int> GraphColoringRegisterAllocator::simplify(const InterferenceGraph& graph) {
+
+    int n = graph.nodes.size();
+    std::vector<int> degree(n), prev(n, -1), next(n, -1), bucketHead(n, -1);
+    std::vector<bool> removed(n, false);
+
+    auto unlinkNode = [&](int node) {
+        if (prev[node] != -1) next[prev[node]] = next[node];
+        else bucketHead[degree[node]] = next[node];
+        if (next[node] != -1) prev[next[node]] = prev[node];
+    };
+    auto linkNode = [&](int node) {
+        prev[node] = -1;
+        next[node] = bucketHead[degree[node]];
+        if (next[node] != -1) prev[next[node]] = node;
+        bucketHead[degree[node]] = node;
+    };
+
+    // 倒序入桶，使同一度数的桶内按变量名排序
+    for (int node = n - 1; node >= 0; node--) {
+        degree[node] = graph.adjacency[node].size();
+        linkNode(node);
+    }
+
+    std::vector<int> simplifiedOrder;
+    simplifiedOrder.reserve(n);
+
+    int minDegree = 0;
+    while (static_cast<int>(simplifiedOrder.size()) < n) {
+        while (bucketHead[minDegree] == -1) minDegree++;
+        int nodeToRemove = bucketHead[minDegree];
+        unlinkNode(nodeToRemove);
+        removed[nodeToRemove] = true;
+
+        for (int neighbor : graph.adjacency[nodeToRemove]) {
+            if (removed[neighbor]) continue;
+            unlinkNode(neighbor);
+            degree[neighbor]--;
+            linkNode(neighbor);
         }
-        workGraph.erase(nodeToRemove);
-        
+        minDegree = std::max(0, minDegree - 1);
+
         simplifiedOrder.push_back(nodeToRemove);
     }
-    
+
     std::reverse(simplifiedOrder.begin(), simplifiedOrder.end());
     return simplifiedOrder;
 }
 
 std::map<std::string, std::string> GraphColoringRegisterAllocator::color(
-    const std::vector<std::string>& simplifiedOrder,
-    const std::map<std::string, std::set<std::string>>& originalGraph,
+    const std::vector<int>& simplifiedOrder,
+    const InterferenceGraph& graph,
     const std::vector<Register>& availableRegs) {
-    
+
     std::map<std::string, std::string> allocation;
-    
+
     std::vector<std::string> regNames;
     for (const auto& reg : availableRegs) {
         if (reg.isAllocatable && !reg.isReserved) {
             regNames.push_back(reg.name);
         }
     }
-    
-    for (const auto& var : simplifiedOrder) {
-        auto it = originalGraph.find(var);
-        if (it == originalGraph.end()) continue;
-        
-        const auto& neighbors = it->second;
-        
-        std::set<std::string> usedColors;
-        for (const auto& neighbor : neighbors) {
-            auto allocIt = allocation.find(neighbor);
-            if (allocIt != allocation.end()) {
-                usedColors.insert(allocIt->second);
-            }
+
+    // colors[结点]是regNames中的下标，-1表示未分配；
+    // usedBy[颜色]等于当前结点时表示该颜色已被它的某个邻居占用
+    std::vector<int> colors(graph.nodes.size(), -1);
+    std::vector<int> usedBy(regNames.size(), -1);
+
+    for (int node : simplifiedOrder) {
+        for (int neighbor : graph.adjacency[node]) {
+            if (colors[neighbor] != -1) usedBy[colors[neighbor]] = node;
         }
-        
-        std::string selectedReg;
-        for (const auto& reg : regNames) {
-            if (usedColors.find(reg) == usedColors.end()) {
-                selectedReg = reg;
+
+        for (size_t c = 0; c < regNames.size(); c++) {
+            if (usedBy[c] != node) {
+                colors[node] = c;
+                allocation[graph.nodes[node]] = regNames[c];
                 break;
             }
         }
-        
-        if (!selectedReg.empty()) {
-            allocation[var] = selectedReg;
-        }
     }
-    
+
     return allocation;
 }
\ No newline at end of file
@@ -1,11 +1,16 @@
 #pragma once
 #include "parser/ast.h"
 #include "ir/ir.h"
+#include "codegen/hotcold.h"
+#include "codegen/outliner.h"
+#include "codegen/peephole.h"
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <map>
 #include <set>
 #include <fstream>
+#include <iostream>
 #include <memory>
 #include <functional>
 
@@ -21,8 +26,27 @@ struct CodeGenConfig {
     bool optimizeStackLayout = false;
     bool eliminateDeadStores = false;
     bool enablePeepholeOptimizations = false;
+    bool enableMachineOutliner = false;      // 跨函数外提重复的指令序列（-moutline）
+    bool saveRestore = false;                // 序言/后记调用共享的__toyc_save_N/__toyc_restore_N（-msave-restore）
+    bool functionSections = false;           // 每个函数放入单独的.text.<函数名>段（-ffunction-sections）
+    bool hotColdSplit = false;               // 冷块移入.text.unlikely（-freorder-blocks-and-partition）
+    const ProfileData* hotColdProfile = nullptr;  // 冷热分区使用的边剖析数据，nullptr时用静态启发式
     bool enableInlineAsm = false;
     RegisterAllocStrategy regAllocStrategy = RegisterAllocStrategy::NAIVE;
+    bool emitDebugLineInfo = false;          // 输出.file/.loc行号信息（-g）
+    std::string sourceFileName = "<stdin>";  // .file指令中记录的源文件名
+
+    // 边剖析（-fprofile-generate）：输出计数器表、布局描述，并在main返回前转储
+    bool instrumentEdgeProfile = false;
+    int profileCounterCount = 0;
+    std::string profileDescriptor;
+    std::string profileOutputFile = "toyc.profraw";
+
+    // 函数级剖析（-finstrument-functions-lite）：序言/后记中用rdcycle累计调用次数和包含时间
+    bool instrumentFunctions = false;
+
+    std::ostream* diagnostics = &std::cerr;  // 错误与警告输出（不能为nullptr）
+    bool traceProgress = true;               // 在diagnostics中输出各生成阶段的进度
 };
 
 struct Register {
@@ -31,7 +55,7 @@ struct Register {
     bool isCalleeSaved;
     bool isAllocatable;
     bool isReserved;
-    std::string purpose;
+    const char* purpose;
     bool isUsed;
 };
 
@@ -86,15 +110,26 @@ public:
         const std::vector<Register>& availableRegs) override;
     
 private:
-    std::map<std::string, std::set<std::string>> buildInterferenceGraph(
+    // 干涉图：结点按变量名排序编号。下三角位矩阵回答任意两点是否干涉（O(1)），
+    // 邻接表按结点列出邻居供遍历；矩阵占 n*(n-1)/2 位
+    struct InterferenceGraph {
+        std::vector<std::string> nodes;
+        std::vector<std::vector<int>> adjacency;
+        std::vector<std::uint64_t> matrix;
+        
+        explicit InterferenceGraph(std::vector<std::string> names);
+        bool interferes(int a, int b) const;
+        void addEdge(int a, int b);
+    };
+    
+    InterferenceGraph buildInterferenceGraph(
         const std::vector<std::shared_ptr<IRInstr>>& instructions);
     
-    std::vector<std::string> simplify(
-        std::map<std::string, std::set<std::string>>& graph);
+    std::vector<int> simplify(const InterferenceGraph& graph);
     
     std::map<std::string, std::string> color(
-        const std::vector<std::string>& simplifiedOrder,
-        const std::map<std::string, std::set<std::string>>& originalGraph,
+        const std::vector<int>& simplifiedOrder,
+        const InterferenceGraph& graph,
         const std::vector<Register>& availableRegs);
 };
 
@@ -108,8 +143,8 @@ private:
     
     // 寄存器信息
     std::vector<Register> registers;
-    std::vector<std::string> tempRegs = {"t0", "t1", "t2", "t3", "t4", "t5", "t6"};
-    std::vector<std::string> argRegs = {"a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7"};
+    static inline const std::vector<std::string> tempRegs = {"t0", "t1", "t2", "t3", "t4", "t5", "t6"};
+    static inline const std::vector<std::string> argRegs = {"a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7"};
     int nextTempReg = 0;
     
     // 栈和变量管理
@@ -141,6 +176,9 @@ private:
     std::vector<std::string> continueLabels;
     int labelCount = 0;
     
+    // 调试行号信息
+    SourceLocation lastEmittedLoc;
+    
     // 优化
     std::map<std::string, std::function<bool(std::vector<std::string>&)>> peepholePatterns;
 
@@ -163,6 +201,9 @@ private:
     void emitLabel(const std::string& label);
     void emitGlobal(const std::string& name);
     void emitSection(const std::string& section);
+    void emitFunctionStart(const std::string& name, bool global);
+    void emitFunctionEnd(const std::string& name);
+    void emitSourceLocation(const std::shared_ptr<IRInstr>& instr);
     
     // 指令处理
     void processInstruction(const std::shared_ptr<IRInstr>& instr);
@@ -177,6 +218,7 @@ private:
     void processLabel(const std::shared_ptr<LabelInstr>& instr);
     void processFunctionBegin(const std::shared_ptr<FunctionBeginInstr>& instr);
     void processFunctionEnd(const std::shared_ptr<FunctionEndInstr>& instr);
+    void processProfileCounter(const std::shared_ptr<ProfileCounterInstr>& instr);
     
     // 操作数和寄存器处理
     void loadOperand(const std::shared_ptr<Operand>& op, const std::string& reg);
@@ -193,6 +235,7 @@ private:
     
     // 寄存器管理
     void initializeRegisters();
+    void trace(const std::string& message);
     void resetStackOffset();
     void allocateRegisters();
     bool isValidRegister(const std::string& reg) const;
@@ -206,6 +249,20 @@ private:
     // 栈帧管理
     void emitPrologue(const std::string& funcName);
     void emitEpilogue(const std::string& funcName);
+
+    // -msave-restore：N为函数需要保存的s1..sN个数，-1表示序言/后记内联展开
+    std::set<std::string> inlineFrameFunctions;  // 热点叶函数，不使用共享例程
+    std::set<int> saveRestoreRoutines;           // 已被引用、需要输出的例程
+    int saveRestoreCount = -1;
+    void analyzeSaveRestoreCandidates();
+    void emitSaveRestoreRoutines();
+
+    // 剖析运行时
+    std::map<std::string, int> profiledFunctionIndex;
+    bool needsProfileDump() const { return config.instrumentEdgeProfile || config.instrumentFunctions; }
+    void emitProfileRuntime();
+    void emitFunctionProfileRoutines();
+    void emitAsciiData(const std::string& text);
     
     // 大小计算
     int getCallerSavedRegsSize() const { return usedCallerSavedRegs.size() * 4; }
@@ -219,7 +276,7 @@ private:
     
     // 优化方法
     void optimizeStackLayout();
-    void peepholeOptimize(std::vector<std::string>& instructions);
+    void peepholeOptimize(std::vector<AsmLine>& lines);
     void linearScanRegisterAllocation();
     void graphColoringRegisterAllocation();
     
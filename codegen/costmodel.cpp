@@ -0,0 +1,255 @@
+// costmodel.cpp - 生成代码的静态周期估计与冒险报告
+#include "costmodel.h"
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <map>
+
+// ==================== 处理器核 ====================
+
+const std::vector<CoreModel>& CoreModel::presets() {
+    static const std::vector<CoreModel> models = {
+        {"rocket", "5级顺序流水线（Rocket）", 3, 4, 33, 2},
+        {"u74", "双发射顺序流水线（SiFive U74），按单发射估计", 3, 3, 20, 1},
+        {"ibex", "2级流水线微控制器（Ibex）", 2, 3, 37, 2},
+    };
+    return models;
+}
+
+const CoreModel* CoreModel::find(const std::string& name) {
+    for (const auto& model : presets()) {
+        if (model.name == name) return &model;
+    }
+    return nullptr;
+}
+
+const CoreModel& CoreModel::defaultModel() {
+    return presets().front();
+}
+
+// ==================== 分析 ====================
+
+namespace {
+
+bool isLoad(const std::string& m) {
+    return m == "lw" || m == "lh" || m == "lb" || m == "lhu" || m == "lbu";
+}
+
+bool isStore(const std::string& m) {
+    return m == "sw" || m == "sh" || m == "sb";
+}
+
+bool isMultiply(const std::string& m) {
+    return m == "mul" || m == "mulh" || m == "mulhu" || m == "mulhsu";
+}
+
+bool isDivide(const std::string& m) {
+    return m == "div" || m == "divu" || m == "rem" || m == "remu";
+}
+
+// 栈帧访存：fp/sp为基址，或大偏移时先把地址算进t0
+bool isFrameAccess(const AsmInstr& instr) {
+    if (instr.operands.size() != 2) return false;
+    const std::string& mem = instr.operands[1];
+    return mem.find("(fp)") != std::string::npos || mem.find("(sp)") != std::string::npos ||
+           mem.find("(s0)") != std::string::npos || mem == "0(t0)";
+}
+
+} // namespace
+
+long long CostModel::weightOf(int loopDepth) {
+    long long weight = 1;
+    for (int i = 0; i < std::min(loopDepth, 8); ++i) weight *= 10;
+    return weight;
+}
+
+void CostModel::analyze(std::string_view assembly) {
+    lines.clear();
+    functionCosts.clear();
+    blockCosts.clear();
+    hazardList.clear();
+    sourceLines.clear();
+    hasLineInfo = false;
+
+    lines = splitAsmLines(assembly);
+    std::vector<long long> lineCosts;
+    for (const auto& function : splitAsmFunctions(lines)) {
+        analyzeFunction(function, lineCosts);
+    }
+
+    for (size_t line = 1; line < lineCosts.size(); ++line) {
+        if (lineCosts[line] > 0) sourceLines.push_back({static_cast<int>(line), lineCosts[line]});
+    }
+}
+
+void CostModel::analyzeFunction(const AsmFunction& asmFunction, std::vector<long long>& lineCosts) {
+    const std::string& name = asmFunction.name;
+    const std::vector<AsmBlock>& blocks = asmFunction.blocks;
+
+    std::vector<int> loopDepth = asmLoopDepths(lines, asmFunction);
+
+    // ---------- 周期估计 ----------
+    FunctionCost function;
+    function.name = name;
+    int sourceLine = 0;
+    enum class CallerSave { NONE, SAVE, RESTORE } callerSave = CallerSave::NONE;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const AsmBlock& block = blocks[b];
+        long long weight = weightOf(loopDepth[b]);
+        BlockCost cost;
+        cost.function = name;
+        cost.name = block.name;
+        cost.loopDepth = loopDepth[b];
+
+        std::map<std::string, long long> ready;       // 寄存器就绪的周期
+        std::map<std::string, size_t> loadedBy;       // 寄存器最近一次由哪一行的load写入
+        long long cycle = 0;
+        for (size_t i = block.first; i < block.last; ++i) {
+            const AsmLine& line = lines[i];
+            if (line.kind == AsmLine::Kind::COMMENT) {
+                if (line.text.rfind("\t.loc", 0) == 0) {
+                    std::sscanf(line.text.c_str(), " .loc %*d %d", &sourceLine);
+                    hasLineInfo = true;
+                } else if (line.text.find("调用者保存的寄存器") != std::string::npos &&
+                           line.text.find("被调用者") == std::string::npos) {
+                    callerSave = line.text.find("恢复") != std::string::npos ? CallerSave::RESTORE : CallerSave::SAVE;
+                } else {
+                    callerSave = CallerSave::NONE;
+                }
+                continue;
+            }
+            if (line.kind != AsmLine::Kind::INSTRUCTION) continue;
+            AsmInstr instr;
+            if (!AsmInstr::parse(line.text, instr)) continue;
+            AsmEffect effect = AsmEffect::of(instr);
+            const std::string& m = instr.mnemonic;
+
+            // call只在AsmEffect中"读"参数寄存器，流水线里它不等待这些寄存器
+            long long issue = cycle;
+            std::string blocker;
+            std::vector<std::string> uses = effect.kind == AsmEffect::Kind::CALL ? std::vector<std::string>() : effect.uses;
+            for (const auto& reg : uses) {
+                auto it = ready.find(reg);
+                if (it != ready.end() && it->second > issue) {
+                    issue = it->second;
+                    blocker = reg;
+                }
+            }
+            int stall = static_cast<int>(issue - cycle);
+            if (stall > 0 && loadedBy.count(blocker)) {
+                ++function.loadUseHazards;
+                hazardList.push_back({name, i + 1, sourceLine, lines[loadedBy[blocker]].text, line.text, stall,
+                                      loopDepth[b]});
+            }
+
+            int occupancy = isDivide(m) ? core.divLatency : 1;
+            int latency = isLoad(m) ? core.loadLatency : isMultiply(m) ? core.mulLatency : occupancy;
+            int penalty = 0;
+            if (effect.kind == AsmEffect::Kind::JUMP || effect.kind == AsmEffect::Kind::CALL ||
+                effect.kind == AsmEffect::Kind::RETURN || m == "jal" || m == "jalr" || m == "jr" || m == "tail") {
+                penalty = core.takenBranchPenalty;
+            } else if (effect.kind == AsmEffect::Kind::BRANCH) {
+                auto target = asmFunction.blockOf.find(effect.target);
+                if (target != asmFunction.blockOf.end() && target->second <= b) penalty = core.takenBranchPenalty;
+            }
+
+            std::vector<std::string> defs = effect.defs;
+            if (m == "jal" && instr.operands.size() == 2) defs.push_back(instr.operands[0]);
+            for (const auto& reg : defs) {
+                ready[reg] = issue + latency;
+                if (isLoad(m)) loadedBy[reg] = i;
+                else loadedBy.erase(reg);
+            }
+            cycle = issue + occupancy + penalty;
+            long long instrCost = stall + occupancy + penalty;
+
+            // 调用者保存寄存器：保存区到call为止，恢复区到第一条非lw指令为止
+            bool callerSaveOp = false;
+            if (callerSave == CallerSave::SAVE) {
+                if (effect.kind == AsmEffect::Kind::CALL) callerSave = CallerSave::NONE;
+                else callerSaveOp = isStore(m) && instr.operands.size() == 2 && instr.operands[1].find("(sp)") == std::string::npos;
+            } else if (callerSave == CallerSave::RESTORE) {
+                if (isLoad(m)) callerSaveOp = true;
+                else if (m != "li" && m != "add") callerSave = CallerSave::NONE;
+            }
+            if (callerSaveOp) {
+                ++function.callerSaveOps;
+                function.callerSaveWeighted += weight;
+            } else if (loopDepth[b] > 0 && (isLoad(m) || isStore(m)) && isFrameAccess(instr)) {
+                if (isLoad(m)) ++function.loopReloads;
+                else ++function.loopSpills;
+            }
+
+            ++cost.instructions;
+            if (sourceLine > 0) {
+                if (lineCosts.size() <= static_cast<size_t>(sourceLine)) lineCosts.resize(sourceLine + 1, 0);
+                lineCosts[sourceLine] += instrCost * weight;
+            }
+        }
+        cost.cycles = cycle;
+        cost.weighted = cycle * weight;
+        function.instructions += cost.instructions;
+        function.cycles += cost.cycles;
+        function.weighted += cost.weighted;
+        blockCosts.push_back(cost);
+    }
+    functionCosts.push_back(function);
+}
+
+// ==================== 报告 ====================
+
+void CostModel::printReport(std::ostream& out) const {
+    out << "===== 静态代价估计（" << core.name << ": " << core.description << "） =====\n";
+    out << "load " << core.loadLatency << "周期, mul " << core.mulLatency << "周期, div " << core.divLatency
+        << "周期（不流水）, taken分支/跳转 +" << core.takenBranchPenalty
+        << "周期; 循环深度为d的基本块权重10^d\n";
+
+    out << std::left << std::setw(28) << "function" << std::right << std::setw(8) << "instrs" << std::setw(10)
+        << "cycles" << std::setw(14) << "weighted" << std::setw(10) << "load-use" << std::setw(10) << "loop-sw"
+        << std::setw(10) << "loop-lw" << std::setw(13) << "caller-save" << "\n";
+    for (const auto& f : functionCosts) {
+        out << std::left << std::setw(28) << f.name << std::right << std::setw(8) << f.instructions << std::setw(10)
+            << f.cycles << std::setw(14) << f.weighted << std::setw(10) << f.loadUseHazards << std::setw(10)
+            << f.loopSpills << std::setw(10) << f.loopReloads << std::setw(13) << f.callerSaveOps << "\n";
+    }
+
+    std::vector<BlockCost> hotBlocks = blockCosts;
+    std::stable_sort(hotBlocks.begin(), hotBlocks.end(),
+                     [](const BlockCost& a, const BlockCost& b) { return a.weighted > b.weighted; });
+    if (hotBlocks.size() > 10) hotBlocks.resize(10);
+    out << "--- 加权代价最高的基本块 ---\n";
+    out << std::left << std::setw(28) << "function" << std::setw(24) << "block" << std::right << std::setw(6)
+        << "depth" << std::setw(8) << "instrs" << std::setw(10) << "cycles" << std::setw(14) << "weighted" << "\n";
+    for (const auto& b : hotBlocks) {
+        out << std::left << std::setw(28) << b.function << std::setw(24) << b.name << std::right << std::setw(6)
+            << b.loopDepth << std::setw(8) << b.instructions << std::setw(10) << b.cycles << std::setw(14)
+            << b.weighted << "\n";
+    }
+
+    out << "--- 加权代价最高的源代码行 ---\n";
+    if (!hasLineInfo) {
+        out << "(需要-g生成行号信息)\n";
+    } else {
+        std::vector<SourceLineCost> hotLines = sourceLines;
+        std::stable_sort(hotLines.begin(), hotLines.end(),
+                         [](const SourceLineCost& a, const SourceLineCost& b) { return a.weighted > b.weighted; });
+        if (hotLines.size() > 10) hotLines.resize(10);
+        for (const auto& l : hotLines) {
+            out << "  第" << l.line << "行" << std::setw(14) << l.weighted << "\n";
+        }
+    }
+
+    out << "--- load-use冒险（共" << hazardList.size() << "处，按加权停顿列出前20处） ---\n";
+    std::vector<Hazard> hazards = hazardList;
+    std::stable_sort(hazards.begin(), hazards.end(), [](const Hazard& a, const Hazard& b) {
+        return a.stall * weightOf(a.loopDepth) > b.stall * weightOf(b.loopDepth);
+    });
+    if (hazards.size() > 20) hazards.resize(20);
+    for (const auto& h : hazards) {
+        out << "  " << h.function << " 汇编第" << h.asmLine << "行";
+        if (h.sourceLine > 0) out << "（源代码第" << h.sourceLine << "行）";
+        out << ": " << h.producer << " -> " << h.consumer << ", 停顿" << h.stall << "周期";
+        if (h.loopDepth > 0) out << ", 循环深度" << h.loopDepth;
+        out << "\n";
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "codegen/peephole.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ==================== 静态代价估计（--cost-report） ====================
+//
+// 不运行程序，直接在生成的汇编上估计每个函数、基本块和源代码行的周期数：
+// - 单发射顺序核的记分板模型：指令等到源寄存器就绪才发射，load/mul/div的结果
+//   在各自的延迟之后就绪，除法器不流水；跳转、调用、返回和（按BTFN静态预测）
+//   向后的条件分支额外付出taken分支惩罚
+// - 基本块按循环深度加权（10^深度），深度由函数内的回边（跳向不晚于自己的块）求得
+// - 标出load-use冒险、循环中经栈帧的spill/reload，以及processCall在调用前后
+//   保存/恢复调用者保存寄存器的访存
+// 源代码行需要-g生成的.loc指令。
+
+// 一种处理器核的延迟参数（周期，数值为公开资料中的近似值）
+struct CoreModel {
+    std::string name;
+    std::string description;
+    int loadLatency;        // load结果可被使用前的周期数，大于1时紧随其后的使用会停顿
+    int mulLatency;
+    int divLatency;         // 除法器不流水，期间不发射后续指令
+    int takenBranchPenalty; // 跳转、调用、返回及预测为taken的分支
+
+    static const std::vector<CoreModel>& presets();
+    static const CoreModel* find(const std::string& name);  // 未知的核返回nullptr
+    static const CoreModel& defaultModel();
+};
+
+class CostModel {
+public:
+    struct Hazard {
+        std::string function;
+        size_t asmLine;         // 汇编中的行号（从1开始）
+        int sourceLine;         // 0表示没有.loc
+        std::string producer;   // load指令
+        std::string consumer;
+        int stall;
+        int loopDepth;
+    };
+
+    struct BlockCost {
+        std::string function;
+        std::string name;
+        int loopDepth = 0;
+        int instructions = 0;
+        long long cycles = 0;
+        long long weighted = 0;
+    };
+
+    struct FunctionCost {
+        std::string name;
+        int instructions = 0;
+        long long cycles = 0;       // 各块只执行一次时的周期数
+        long long weighted = 0;
+        int loadUseHazards = 0;
+        int loopSpills = 0;         // 循环中的栈帧store
+        int loopReloads = 0;        // 循环中的栈帧load
+        int callerSaveOps = 0;      // 调用前后保存/恢复调用者保存寄存器的访存
+        long long callerSaveWeighted = 0;
+    };
+
+    struct SourceLineCost {
+        int line;
+        long long weighted;
+    };
+
+    explicit CostModel(const CoreModel& core) : core(core) {}
+
+    void analyze(std::string_view assembly);
+    void printReport(std::ostream& out) const;
+
+    const std::vector<FunctionCost>& functions() const { return functionCosts; }
+    const std::vector<BlockCost>& blocks() const { return blockCosts; }
+    const std::vector<Hazard>& hazards() const { return hazardList; }
+
+private:
+    const CoreModel& core;
+    std::vector<AsmLine> lines;
+    std::vector<FunctionCost> functionCosts;
+    std::vector<BlockCost> blockCosts;
+    std::vector<Hazard> hazardList;
+    std::vector<SourceLineCost> sourceLines;
+    bool hasLineInfo = false;
+
+    void analyzeFunction(const AsmFunction& function, std::vector<long long>& lineCosts);
+    static long long weightOf(int loopDepth);
+};
@@ -0,0 +1,264 @@
+// hotcold.cpp - 冷热分区：冷块移入.text.unlikely
+#include "hotcold.h"
+#include <algorithm>
+
+namespace {
+
+const std::map<std::string, std::string>& invertedBranches() {
+    static const std::map<std::string, std::string> ops = {
+        {"beq", "bne"},   {"bne", "beq"},   {"blt", "bge"},   {"bge", "blt"},   {"bltu", "bgeu"},
+        {"bgeu", "bltu"}, {"bgt", "ble"},   {"ble", "bgt"},   {"bgtu", "bleu"}, {"bleu", "bgtu"},
+        {"beqz", "bnez"}, {"bnez", "beqz"}, {"blez", "bgtz"}, {"bgtz", "blez"}, {"bltz", "bgez"},
+        {"bgez", "bltz"}};
+    return ops;
+}
+
+std::string labelName(const AsmLine& line) {
+    return line.text.substr(0, line.text.size() - 1);
+}
+
+// 最后一条指令之后的位置；没有指令时为0
+size_t afterLastInstruction(const std::vector<AsmLine>& body) {
+    for (size_t i = body.size(); i-- > 0;) {
+        if (body[i].kind == AsmLine::Kind::INSTRUCTION) return i + 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+// ==================== 入口 ====================
+
+HotColdSplitter::Stats HotColdSplitter::run(std::vector<AsmLine>& lines) {
+    stats = Stats();
+    labels.clear();
+    for (const auto& line : lines) {
+        if (line.kind == AsmLine::Kind::LABEL) labels.insert(labelName(line));
+    }
+    if (profile) loadProfile();
+
+    // 从后往前替换，前面函数的行号不受影响
+    std::vector<AsmFunction> functions = splitAsmFunctions(lines);
+    for (auto it = functions.rbegin(); it != functions.rend(); ++it) {
+        const AsmFunction& function = *it;
+        if (function.name.rfind("__toyc_", 0) == 0 || !function.blockOf.count(function.name + "_epilogue")) continue;
+        std::vector<bool> cold = classify(lines, function);
+        if (std::none_of(cold.begin(), cold.end(), [](bool c) { return c; })) continue;
+
+        std::vector<AsmLine> replaced = split(lines, function, cold);
+        lines.erase(lines.begin() + function.first, lines.begin() + function.last);
+        lines.insert(lines.begin() + function.first, replaced.begin(), replaced.end());
+        ++stats.functions;
+    }
+    return stats;
+}
+
+// 剖析中的块名是IR的首标签（或entry/bbN），与生成的汇编标签一致
+void HotColdSplitter::loadProfile() {
+    blockCounts.clear();
+    for (ProfiledFunction fn : profile->functions) {
+        fn.reconstruct(profile->counters);
+        ProfiledBlocks& blocks = blockCounts[fn.name];
+        int exit = static_cast<int>(fn.blocks.size()) - 1;
+        for (int b = 0; b < exit; ++b) {
+            blocks.names.push_back(fn.blocks[b]);
+            blocks.counts.push_back(fn.blockCount(b));
+        }
+        blocks.calls = fn.blockCount(exit);
+    }
+}
+
+// ==================== 冷块判定 ====================
+
+std::vector<bool> HotColdSplitter::classify(const std::vector<AsmLine>& lines, const AsmFunction& function) const {
+    const std::vector<AsmBlock>& blocks = function.blocks;
+    size_t epilogue = function.blockOf.at(function.name + "_epilogue");
+    std::vector<bool> cold(blocks.size(), false);
+    auto movable = [&](size_t b) { return b != 0 && b != epilogue; };
+
+    if (profile) {
+        // 从未被调用的函数整体是冷的，由函数排序处理，这里不拆分
+        auto it = blockCounts.find(function.name);
+        if (it == blockCounts.end() || it->second.calls == 0) return cold;
+        const ProfiledBlocks& profiled = it->second;
+        std::map<std::string, size_t> profiledIndex;
+        for (size_t k = 0; k < profiled.names.size(); ++k) profiledIndex[profiled.names[k]] = k;
+
+        // 块的所有标签（连续的多个标签属于同一块）都对应计数为0的剖析块时才是冷块；
+        // 剖析索引npos表示对应不上
+        const size_t unknown = profiled.names.size();
+        std::vector<size_t> match(blocks.size(), unknown);
+        std::vector<bool> executed(blocks.size(), false), labelled(blocks.size(), false);
+        for (const auto& [label, b] : function.blockOf) {
+            labelled[b] = true;
+            auto k = profiledIndex.find(label);
+            if (k == profiledIndex.end()) continue;
+            match[b] = k->second;
+            if (profiled.counts[k->second] > 0) executed[b] = true;
+        }
+        if (!blocks.empty() && !labelled[0]) match[0] = profiledIndex.count("entry") ? profiledIndex["entry"] : unknown;
+        for (size_t b = 1; b < blocks.size(); ++b) {
+            if (labelled[b] || match[b - 1] == unknown || match[b - 1] + 1 >= unknown) continue;
+            if (profiled.names[match[b - 1] + 1].rfind("bb", 0) != 0) continue;
+            match[b] = match[b - 1] + 1;
+            executed[b] = profiled.counts[match[b]] > 0;
+        }
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            cold[b] = movable(b) && match[b] != unknown && !executed[b];
+        }
+    } else {
+        std::vector<int> depth = asmLoopDepths(lines, function);
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            if (!movable(b) || depth[b] == 0) continue;
+            for (size_t i = blocks[b].last; i-- > blocks[b].first;) {
+                if (lines[i].kind != AsmLine::Kind::INSTRUCTION) continue;
+                AsmInstr instr;
+                if (!AsmInstr::parse(lines[i].text, instr)) break;
+                AsmEffect effect = AsmEffect::of(instr);
+                if (effect.kind == AsmEffect::Kind::RETURN) {
+                    cold[b] = true;
+                } else if (effect.kind == AsmEffect::Kind::JUMP) {
+                    // 向前跳到循环深度更小的块：提前返回（跳向后记）或跳出循环
+                    auto target = function.blockOf.find(effect.target);
+                    cold[b] = target != function.blockOf.end() && target->second > b &&
+                              depth[target->second] < depth[b];
+                }
+                break;
+            }
+        }
+    }
+
+    // 所有前驱都是冷块（或没有前驱）的块也是冷块
+    std::vector<std::vector<size_t>> successors = asmBlockSuccessors(lines, function);
+    std::vector<std::vector<size_t>> predecessors(blocks.size());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (size_t s : successors[b]) predecessors[s].push_back(b);
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            if (cold[b] || !movable(b)) continue;
+            if (std::all_of(predecessors[b].begin(), predecessors[b].end(),
+                            [&](size_t p) { return cold[p] || p == b; })) {
+                cold[b] = true;
+                changed = true;
+            }
+        }
+    }
+    return cold;
+}
+
+// ==================== 拆分与修补 ====================
+
+std::string HotColdSplitter::newLabel(const std::string& function) {
+    std::string name;
+    do {
+        name = function + "_split" + std::to_string(nextLabel++);
+    } while (labels.count(name));
+    labels.insert(name);
+    return name;
+}
+
+std::vector<AsmLine> HotColdSplitter::split(const std::vector<AsmLine>& lines, const AsmFunction& function,
+                                            const std::vector<bool>& cold) {
+    const std::vector<AsmBlock>& blocks = function.blocks;
+    const std::string& name = function.name;
+    std::vector<std::vector<AsmLine>> body(blocks.size());
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        body[b].assign(lines.begin() + blocks[b].first, lines.begin() + blocks[b].last);
+    }
+    // 块末尾的注释和.loc属于下一块的第一条语句，随下一块移动
+    for (size_t b = 1; b < blocks.size(); ++b) {
+        std::vector<AsmLine>& prev = body[b - 1];
+        size_t tail = std::max(afterLastInstruction(prev), size_t(1));
+        while (tail < prev.size() && prev[tail].kind == AsmLine::Kind::LABEL) ++tail;
+        if (std::any_of(prev.begin() + tail, prev.end(),
+                        [](const AsmLine& line) { return line.kind != AsmLine::Kind::COMMENT; })) {
+            continue;
+        }
+        body[b].insert(body[b].begin(), prev.begin() + tail, prev.end());
+        prev.erase(prev.begin() + tail, prev.end());
+    }
+
+    // 跨分区的顺序落入改为显式跳转
+    auto labelOf = [&](size_t b) {
+        for (const auto& line : body[b]) {
+            if (line.kind == AsmLine::Kind::LABEL) return labelName(line);
+            if (line.kind == AsmLine::Kind::INSTRUCTION) break;
+        }
+        std::string label = newLabel(name);
+        size_t at = 0;
+        while (at < body[b].size() && body[b][at].kind == AsmLine::Kind::COMMENT) ++at;
+        body[b].insert(body[b].begin() + at, {AsmLine::Kind::LABEL, label + ":"});
+        return label;
+    };
+    for (size_t b = 1; b < blocks.size(); ++b) {
+        if (cold[b] == cold[b - 1] || !asmBlockFallsThrough(lines, blocks[b - 1])) continue;
+        std::string target = labelOf(b);
+        std::vector<AsmLine>& prev = body[b - 1];
+        prev.insert(prev.begin() + afterLastInstruction(prev), {AsmLine::Kind::INSTRUCTION, "j " + target});
+    }
+
+    std::vector<AsmLine> hot(lines.begin() + function.first, lines.begin() + blocks.front().first);
+    std::vector<AsmLine> coldLines;
+    std::set<std::string> hotLabels, coldLabels;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        std::vector<AsmLine>& into = cold[b] ? coldLines : hot;
+        for (const auto& line : body[b]) {
+            if (line.kind == AsmLine::Kind::LABEL) (cold[b] ? coldLabels : hotLabels).insert(labelName(line));
+            if (line.kind == AsmLine::Kind::INSTRUCTION && cold[b]) ++stats.coldInstructions;
+        }
+        into.insert(into.end(), body[b].begin(), body[b].end());
+        if (cold[b]) ++stats.coldBlocks;
+    }
+
+    // 跨分区的条件分支：反转条件跳过一条j
+    auto fixBranches = [&](std::vector<AsmLine>& part, const std::set<std::string>& otherLabels) {
+        std::vector<AsmLine> fixed;
+        for (const auto& line : part) {
+            AsmInstr instr;
+            if (line.kind != AsmLine::Kind::INSTRUCTION || !AsmInstr::parse(line.text, instr)) {
+                fixed.push_back(line);
+                continue;
+            }
+            AsmEffect effect = AsmEffect::of(instr);
+            auto inverted = invertedBranches().find(instr.mnemonic);
+            if (effect.kind != AsmEffect::Kind::BRANCH || !otherLabels.count(effect.target) ||
+                inverted == invertedBranches().end()) {
+                fixed.push_back(line);
+                continue;
+            }
+            std::string skip = newLabel(name);
+            instr.mnemonic = inverted->second;
+            instr.operands.back() = skip;
+            fixed.push_back({AsmLine::Kind::INSTRUCTION, instr.toString()});
+            fixed.push_back({AsmLine::Kind::INSTRUCTION, "j " + effect.target});
+            fixed.push_back({AsmLine::Kind::LABEL, skip + ":"});
+            ++stats.longBranches;
+        }
+        part.swap(fixed);
+    };
+    fixBranches(hot, coldLabels);
+    fixBranches(coldLines, hotLabels);
+
+    // 冷片段紧跟在函数的.size之后
+    std::string coldName = name + ".cold";
+    std::string sizeDirective = "\t.size " + name + ", .-" + name;
+    auto at = std::find_if(hot.begin(), hot.end(), [&](const AsmLine& line) {
+        return line.kind == AsmLine::Kind::DIRECTIVE && line.text == sizeDirective;
+    });
+    if (at != hot.end()) ++at;
+    std::vector<AsmLine> chunk;
+    chunk.push_back({AsmLine::Kind::COMMENT, "# " + name + "的冷代码"});
+    chunk.push_back({AsmLine::Kind::DIRECTIVE, std::string(".section .text.unlikely") +
+                                                   (functionSections ? "." + name : "") + ",\"ax\",@progbits"});
+    chunk.push_back({AsmLine::Kind::DIRECTIVE, "\t.type " + coldName + ", @function"});
+    chunk.push_back({AsmLine::Kind::LABEL, coldName + ":"});
+    chunk.insert(chunk.end(), coldLines.begin(), coldLines.end());
+    chunk.push_back({AsmLine::Kind::DIRECTIVE, "\t.size " + coldName + ", .-" + coldName});
+    chunk.push_back({AsmLine::Kind::DIRECTIVE, functionSections ? ".section .text." + name + ",\"ax\",@progbits"
+                                                                : std::string(".text")});
+    hot.insert(at, chunk.begin(), chunk.end());
+    return hot;
+}
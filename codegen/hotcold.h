@@ -0,0 +1,55 @@
+#pragma once
+#include "codegen/peephole.h"
+#include "profile/profdata.h"
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// ==================== 冷热分区（-freorder-blocks-and-partition） ====================
+//
+// 把很少执行的基本块移到.text.unlikely中的"<函数>.cold"片段，让热路径更紧凑：
+// - 有边剖析数据（-fprofile-generate）时，被调用过的函数中计数为0的块为冷块。带标签的块
+//   按标签对应剖析中的块；没有标签的块是前一块的落入块，对应剖析中下一个bbN
+// - 否则用静态启发式：循环中直接离开函数的块（提前返回），以及循环中无条件跳出
+//   循环的块（break等循环出口的收尾代码）
+// - 所有前驱都是冷块的块也是冷块（没有标签的块只能从前一块落入，随之变冷）；
+//   入口块和后记块始终留在热区
+// 只处理代码生成器生成的ToyC函数（带"<函数>_epilogue"标签）。
+//
+// 分区之后的修补：
+// - 热块落入冷块、冷块落入热块时补上"j"，目标没有标签时新建标签
+// - 条件分支只有±4KiB，跨分区的条件分支改为反转条件跳过一条"j"；
+//   "j"（jal）的范围是±1MiB，足以覆盖ToyC程序的整个代码段
+class HotColdSplitter {
+public:
+    struct Stats {
+        int functions = 0;          // 被拆分的函数
+        int coldBlocks = 0;
+        int coldInstructions = 0;
+        int longBranches = 0;       // 改写为反转分支+j的跨分区条件分支
+    };
+
+    bool functionSections = false;          // 冷片段放入.text.unlikely.<函数名>
+    const ProfileData* profile = nullptr;   // 边剖析数据，nullptr时用静态启发式
+
+    Stats run(std::vector<AsmLine>& lines);
+
+private:
+    std::set<std::string> labels;           // 已使用的标签，新建标签时避免重名
+    int nextLabel = 0;
+    struct ProfiledBlocks {
+        std::vector<std::string> names;     // 剖析中的块名（IR的首标签或entry/bbN），按IR顺序
+        std::vector<std::int64_t> counts;
+        std::int64_t calls = 0;
+    };
+    std::map<std::string, ProfiledBlocks> blockCounts;  // 函数名 -> 块计数
+    Stats stats;
+
+    void loadProfile();
+    std::vector<bool> classify(const std::vector<AsmLine>& lines, const AsmFunction& function) const;
+    std::vector<AsmLine> split(const std::vector<AsmLine>& lines, const AsmFunction& function,
+                               const std::vector<bool>& cold);
+    std::string newLabel(const std::string& function);
+};
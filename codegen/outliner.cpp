@@ -0,0 +1,278 @@
+// outliner.cpp - 后缀树与机器外提实现
+#include "outliner.h"
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+// ==================== 后缀树 ====================
+
+SuffixTree::SuffixTree(const std::vector<unsigned>& str) : str(str) {
+    nodes.reserve(2 * str.size() + 1);
+    newNode(-1, -1);  // 根
+    build();
+    computeDepths();
+}
+
+int SuffixTree::newNode(int start, int end) {
+    Node node;
+    node.start = start;
+    node.end = end;
+    nodes.push_back(std::move(node));
+    return static_cast<int>(nodes.size()) - 1;
+}
+
+int SuffixTree::edgeLength(const Node& node) const {
+    if (node.start < 0) return 0;
+    return (node.end == kLeafEnd ? leafEnd : node.end) - node.start + 1;
+}
+
+void SuffixTree::build() {
+    int activeNode = 0;
+    int activeEdge = 0;
+    int activeLength = 0;
+    int remaining = 0;
+
+    for (int i = 0; i < static_cast<int>(str.size()); ++i) {
+        leafEnd = i;
+        ++remaining;
+        int lastNewNode = -1;
+
+        while (remaining > 0) {
+            if (activeLength == 0) activeEdge = i;
+            auto it = nodes[activeNode].children.find(str[activeEdge]);
+            if (it == nodes[activeNode].children.end()) {
+                int leaf = newNode(i, kLeafEnd);
+                nodes[activeNode].children[str[activeEdge]] = leaf;
+                if (lastNewNode != -1) {
+                    nodes[lastNewNode].link = activeNode;
+                    lastNewNode = -1;
+                }
+            } else {
+                int next = it->second;
+                int length = edgeLength(nodes[next]);
+                if (activeLength >= length) {
+                    // 沿边走到下一个结点（skip/count）
+                    activeEdge += length;
+                    activeLength -= length;
+                    activeNode = next;
+                    continue;
+                }
+                if (str[nodes[next].start + activeLength] == str[i]) {
+                    if (lastNewNode != -1 && activeNode != 0) {
+                        nodes[lastNewNode].link = activeNode;
+                        lastNewNode = -1;
+                    }
+                    ++activeLength;
+                    break;
+                }
+                // 在边的中间分裂
+                int split = newNode(nodes[next].start, nodes[next].start + activeLength - 1);
+                nodes[activeNode].children[str[activeEdge]] = split;
+                int leaf = newNode(i, kLeafEnd);
+                nodes[split].children[str[i]] = leaf;
+                nodes[next].start += activeLength;
+                nodes[split].children[str[nodes[next].start]] = next;
+                if (lastNewNode != -1) nodes[lastNewNode].link = split;
+                lastNewNode = split;
+            }
+            --remaining;
+            if (activeNode == 0 && activeLength > 0) {
+                --activeLength;
+                activeEdge = i - remaining + 1;
+            } else if (activeNode != 0) {
+                activeNode = nodes[activeNode].link;
+            }
+        }
+    }
+}
+
+void SuffixTree::computeDepths() {
+    std::vector<int> stack = {0};
+    while (!stack.empty()) {
+        int id = stack.back();
+        stack.pop_back();
+        for (const auto& entry : nodes[id].children) {
+            Node& child = nodes[entry.second];
+            child.depth = nodes[id].depth + edgeLength(child);
+            if (child.children.empty()) child.suffixIndex = static_cast<int>(str.size() - child.depth);
+            stack.push_back(entry.second);
+        }
+    }
+}
+
+std::vector<SuffixTree::RepeatedSubstring> SuffixTree::repeatedSubstrings(unsigned minLength) const {
+    // 后序遍历，自底向上合并叶子的后缀下标
+    std::vector<RepeatedSubstring> result;
+    std::vector<std::vector<unsigned>> leaves(nodes.size());
+    std::vector<std::pair<int, bool>> stack = {{0, false}};
+    while (!stack.empty()) {
+        auto [id, visited] = stack.back();
+        stack.pop_back();
+        const Node& node = nodes[id];
+        if (!visited) {
+            stack.push_back({id, true});
+            for (const auto& entry : node.children) stack.push_back({entry.second, false});
+            continue;
+        }
+        if (node.children.empty()) {
+            leaves[id].push_back(static_cast<unsigned>(node.suffixIndex));
+            continue;
+        }
+        for (const auto& entry : node.children) {
+            auto& childLeaves = leaves[entry.second];
+            leaves[id].insert(leaves[id].end(), childLeaves.begin(), childLeaves.end());
+            std::vector<unsigned>().swap(childLeaves);
+        }
+        if (id != 0 && node.depth >= minLength && leaves[id].size() >= 2) {
+            RepeatedSubstring repeated{node.depth, leaves[id]};
+            std::sort(repeated.starts.begin(), repeated.starts.end());
+            result.push_back(std::move(repeated));
+        }
+    }
+    return result;
+}
+
+// ==================== 机器外提 ====================
+
+bool MachineOutliner::isOutlinable(const AsmInstr& instr, bool& isReturn) {
+    AsmEffect effect = AsmEffect::of(instr);
+    isReturn = effect.kind == AsmEffect::Kind::RETURN;
+    if (effect.kind != AsmEffect::Kind::NORMAL && !isReturn) return false;
+    if (isReturn) return true;
+    auto mentionsLink = [](const std::vector<std::string>& regs) {
+        return std::find(regs.begin(), regs.end(), "t0") != regs.end();
+    };
+    return !mentionsLink(effect.uses) && !mentionsLink(effect.defs);
+}
+
+int MachineOutliner::benefitOf(unsigned length, size_t occurrences, bool tailCall) {
+    int before = static_cast<int>(occurrences * length);
+    int after = static_cast<int>(occurrences) + static_cast<int>(length) + (tailCall ? 0 : 1);
+    return before - after;
+}
+
+MachineOutliner::Stats MachineOutliner::run(std::vector<AsmLine>& lines) {
+    Stats stats;
+    instrLines.clear();
+    ids.clear();
+
+    // 指令按文本编号，不能外提的指令和标签、伪指令各取一个唯一编号，重复子串不会跨过它们
+    std::unordered_map<std::string, unsigned> idOf;
+    std::vector<bool> isReturn;
+    std::set<std::string> labels;
+    unsigned nextUnique = 1u << 31;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const AsmLine& line = lines[i];
+        if (line.kind == AsmLine::Kind::COMMENT) continue;
+        if (line.kind == AsmLine::Kind::LABEL) labels.insert(line.text.substr(0, line.text.size() - 1));
+        AsmInstr instr;
+        bool ret = false;
+        if (line.kind == AsmLine::Kind::INSTRUCTION && AsmInstr::parse(line.text, instr) && isOutlinable(instr, ret)) {
+            auto it = idOf.emplace(instr.toString(), static_cast<unsigned>(idOf.size())).first;
+            ids.push_back(it->second);
+            instrLines.push_back(i);
+            isReturn.push_back(ret);
+            if (!ret) continue;
+        }
+        if (ret || ids.empty() || ids.back() < (1u << 31)) {
+            ids.push_back(nextUnique++);
+            instrLines.push_back(std::string::npos);
+            isReturn.push_back(false);
+        }
+    }
+    ids.push_back(nextUnique++);
+    instrLines.push_back(std::string::npos);
+    isReturn.push_back(false);
+
+    std::map<std::string, size_t> labelIndex;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (lines[i].kind == AsmLine::Kind::LABEL) labelIndex[lines[i].text.substr(0, lines[i].text.size() - 1)] = i;
+    }
+
+    // ---------- 候选 ----------
+    std::vector<Candidate> candidates;
+    SuffixTree tree(ids);
+    for (auto& repeated : tree.repeatedSubstrings(2)) {
+        Candidate candidate;
+        candidate.length = repeated.length;
+        // ret之后总有分隔符，只可能出现在序列末尾
+        candidate.tailCall = isReturn[repeated.starts.front() + repeated.length - 1];
+        for (unsigned start : repeated.starts) {
+            if (candidate.tailCall || isRegisterDeadFrom(lines, instrLines[start], "t0", labelIndex)) {
+                candidate.starts.push_back(start);
+            }
+        }
+        candidate.benefit = benefitOf(candidate.length, candidate.starts.size(), candidate.tailCall);
+        if (candidate.starts.size() >= 2 && candidate.benefit > 0) candidates.push_back(std::move(candidate));
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.benefit != b.benefit) return a.benefit > b.benefit;
+        return a.length > b.length;
+    });
+
+    // ---------- 贪心选择 ----------
+    std::vector<bool> taken(ids.size(), false);
+    std::map<size_t, Replacement> replacements;  // 键为序列首条指令所在行
+    std::vector<AsmLine> outlined;
+    int nameCounter = 0;
+    for (const auto& candidate : candidates) {
+        std::vector<unsigned> starts;
+        for (unsigned start : candidate.starts) {
+            bool available = std::none_of(taken.begin() + start, taken.begin() + start + candidate.length,
+                                          [](bool t) { return t; });
+            if (available && (starts.empty() || start >= starts.back() + candidate.length)) starts.push_back(start);
+        }
+        if (starts.size() < 2 || benefitOf(candidate.length, starts.size(), candidate.tailCall) <= 0) continue;
+
+        std::string name;
+        do {
+            name = "OUTLINED_FUNCTION_" + std::to_string(nameCounter++);
+        } while (labels.count(name));
+
+        outlined.push_back({AsmLine::Kind::COMMENT, "# 外提的公共指令序列（" + std::to_string(starts.size()) + "处）"});
+        if (functionSections) {
+            outlined.push_back({AsmLine::Kind::DIRECTIVE, ".section .text." + name + ",\"ax\",@progbits"});
+        }
+        outlined.push_back({AsmLine::Kind::DIRECTIVE, "\t.type " + name + ", @function"});
+        outlined.push_back({AsmLine::Kind::LABEL, name + ":"});
+        for (unsigned k = 0; k < candidate.length; ++k) outlined.push_back(lines[instrLines[starts.front() + k]]);
+        if (!candidate.tailCall) outlined.push_back({AsmLine::Kind::INSTRUCTION, "jr t0"});
+        outlined.push_back({AsmLine::Kind::DIRECTIVE, "\t.size " + name + ", .-" + name});
+
+        for (unsigned start : starts) {
+            std::fill(taken.begin() + start, taken.begin() + start + candidate.length, true);
+            replacements[instrLines[start]] = {name, candidate.length, candidate.tailCall};
+        }
+        ++stats.functions;
+        stats.callSites += static_cast<int>(starts.size());
+        stats.savedInstructions += benefitOf(candidate.length, starts.size(), candidate.tailCall);
+    }
+    if (replacements.empty()) return stats;
+
+    // ---------- 改写 ----------
+    // 序列中间的注释（含.loc）保留在调用指令之前
+    std::vector<AsmLine> result;
+    result.reserve(lines.size() + outlined.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        auto it = replacements.find(i);
+        if (it == replacements.end()) {
+            result.push_back(std::move(lines[i]));
+            continue;
+        }
+        const Replacement& replacement = it->second;
+        unsigned remaining = replacement.length;
+        size_t j = i;
+        for (; remaining > 0; ++j) {
+            if (lines[j].kind == AsmLine::Kind::INSTRUCTION) {
+                --remaining;
+            } else {
+                result.push_back(std::move(lines[j]));
+            }
+        }
+        result.push_back({AsmLine::Kind::INSTRUCTION, (replacement.tailCall ? "j " : "jal t0, ") + replacement.name});
+        i = j - 1;
+    }
+    result.insert(result.end(), outlined.begin(), outlined.end());
+    lines.swap(result);
+    return stats;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "codegen/peephole.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// ==================== 后缀树 ====================
+
+// 整数串上的后缀树（Ukkonen算法，线性时间构造），用于找出重复出现的子串。
+// 调用方保证串的最后一个元素只出现一次，使每个后缀都结束在叶子上。
+class SuffixTree {
+public:
+    struct RepeatedSubstring {
+        unsigned length;
+        std::vector<unsigned> starts;  // 所有出现位置（升序），可能互相重叠
+    };
+
+    explicit SuffixTree(const std::vector<unsigned>& str);
+
+    // 每个字符串深度不小于minLength的内部结点对应一个出现至少两次的子串
+    std::vector<RepeatedSubstring> repeatedSubstrings(unsigned minLength) const;
+
+private:
+    static constexpr int kLeafEnd = -1;
+
+    struct Node {
+        int start;
+        int end;                        // 闭区间；叶子为kLeafEnd，长度随leafEnd增长
+        int link = 0;                   // 后缀链接
+        std::map<unsigned, int> children;
+        unsigned depth = 0;             // 根到该结点的字符串长度（含本边）
+        int suffixIndex = -1;           // 叶子对应后缀的起始位置
+    };
+
+    const std::vector<unsigned>& str;
+    std::vector<Node> nodes;
+    int leafEnd = -1;
+
+    int newNode(int start, int end);
+    int edgeLength(const Node& node) const;
+    void build();
+    void computeDepths();
+};
+
+// ==================== 机器外提（-moutline） ====================
+//
+// 在生成的汇编上寻找跨函数重复的指令序列，提取成共享子程序OUTLINED_FUNCTION_N：
+// - 普通序列：调用点改为"jal t0, F"，子程序以"jr t0"返回。序列本身不能读写t0，
+//   且t0在调用点之后必须不活跃（isRegisterDeadFrom）
+// - 以ret结尾的序列（函数后记）：调用点改为尾跳转"j F"，子程序直接ret，不占用t0
+// 序列中不能有标签、伪指令、分支、跳转和调用。收益按指令条数计算：
+//   普通: 次数*长度 - (次数*1 + 长度 + 1)      尾跳转: 次数*长度 - (次数*1 + 长度)
+// 候选按收益从大到小贪心选择，已被选中的指令不再参与其他候选。
+// 子程序与普通函数一样带有.type/.size，附加在所有函数之后。
+class MachineOutliner {
+public:
+    struct Stats {
+        int functions = 0;        // 新建的子程序
+        int callSites = 0;        // 被替换的序列
+        int savedInstructions = 0;
+    };
+
+    bool functionSections = false;  // 子程序各自放入.text.<名字>段（-ffunction-sections）
+
+    Stats run(std::vector<AsmLine>& lines);
+
+private:
+    struct Candidate {
+        unsigned length;
+        std::vector<unsigned> starts;  // 在instrLines中的下标
+        bool tailCall;
+        int benefit;
+    };
+
+    struct Replacement {
+        std::string name;
+        unsigned length;
+        bool tailCall;
+    };
+
+    std::vector<size_t> instrLines;    // 可参与外提的指令在lines中的位置（分隔符为npos）
+    std::vector<unsigned> ids;
+
+    static bool isOutlinable(const AsmInstr& instr, bool& isReturn);
+    static int benefitOf(unsigned length, size_t occurrences, bool tailCall);
+};
@@ -0,0 +1,660 @@
+// peephole.cpp - 汇编行缓冲、活跃性分析与生成规则的匹配
+#include "peephole.h"
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include <stdexcept>
+
+namespace {
+
+// ==================== 指令分类 ====================
+
+const std::set<std::string>& threeRegOps() {
+    static const std::set<std::string> ops = {
+        "add", "sub", "mul", "mulh", "mulhu", "mulhsu", "div", "divu", "rem", "remu",
+        "slt", "sltu", "and", "or", "xor", "sll", "srl", "sra"};
+    return ops;
+}
+
+const std::set<std::string>& regImmOps() {
+    static const std::set<std::string> ops = {
+        "addi", "slti", "sltiu", "andi", "ori", "xori", "slli", "srli", "srai"};
+    return ops;
+}
+
+const std::set<std::string>& unaryOps() {
+    static const std::set<std::string> ops = {"mv", "neg", "not", "seqz", "snez", "sltz", "sgtz"};
+    return ops;
+}
+
+const std::set<std::string>& twoRegBranches() {
+    static const std::set<std::string> ops = {"beq", "bne", "blt", "bge", "bltu", "bgeu", "bgt", "ble", "bgtu", "bleu"};
+    return ops;
+}
+
+const std::set<std::string>& oneRegBranches() {
+    static const std::set<std::string> ops = {"beqz", "bnez", "blez", "bgez", "bltz", "bgtz"};
+    return ops;
+}
+
+// 调用破坏的寄存器（调用者保存）
+bool isCallClobbered(const std::string& reg) {
+    if (reg == "ra") return true;
+    if (reg.size() == 2 && (reg[0] == 't' || reg[0] == 'a') && std::isdigit(static_cast<unsigned char>(reg[1]))) {
+        return reg[0] == 'a' ? reg[1] <= '7' : reg[1] <= '6';
+    }
+    return false;
+}
+
+bool isArgumentRegister(const std::string& reg) {
+    return reg.size() == 2 && reg[0] == 'a' && reg[1] >= '0' && reg[1] <= '7';
+}
+
+// "off(reg)" -> reg
+std::string baseRegister(const std::string& memOperand) {
+    size_t open = memOperand.find('(');
+    size_t close = memOperand.find(')');
+    if (open == std::string::npos || close == std::string::npos || close < open) return "";
+    return memOperand.substr(open + 1, close - open - 1);
+}
+
+bool parseInteger(const std::string& text, long long& value) {
+    if (text.empty()) return false;
+    size_t i = (text[0] == '-' || text[0] == '+') ? 1 : 0;
+    if (i == text.size()) return false;
+    for (size_t j = i; j < text.size(); ++j) {
+        if (!std::isdigit(static_cast<unsigned char>(text[j]))) return false;
+    }
+    try {
+        value = std::stoll(text);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool isRegisterName(const std::string& text) {
+    static const std::set<std::string> names = [] {
+        std::set<std::string> s = {"zero", "ra", "sp", "gp", "tp", "fp"};
+        for (int i = 0; i <= 6; ++i) s.insert("t" + std::to_string(i));
+        for (int i = 0; i <= 11; ++i) s.insert("s" + std::to_string(i));
+        for (int i = 0; i <= 7; ++i) s.insert("a" + std::to_string(i));
+        for (int i = 0; i <= 31; ++i) s.insert("x" + std::to_string(i));
+        return s;
+    }();
+    return names.count(text) > 0;
+}
+
+// 替换序列中立即数所在字段的取值范围检查
+bool immediateFits(const std::string& mnemonic, long long value) {
+    if (mnemonic == "slli" || mnemonic == "srli" || mnemonic == "srai") return value >= 0 && value <= 31;
+    if (regImmOps().count(mnemonic)) return value >= -2048 && value <= 2047;
+    return value >= INT32_MIN && value <= UINT32_MAX;
+}
+
+// 求替换序列中的立即数表达式：#N、-#N、#N+1、#N-1、log2(#N)或字面量
+bool evaluateImmediate(const std::string& expr, const std::map<std::string, long long>& imms, long long& value) {
+    if (parseInteger(expr, value)) return true;
+
+    auto lookup = [&](const std::string& var, long long& v) {
+        auto it = imms.find(var);
+        if (it == imms.end()) return false;
+        v = it->second;
+        return true;
+    };
+    long long v = 0;
+    if (expr.rfind("log2(", 0) == 0 && expr.back() == ')') {
+        if (!lookup(expr.substr(5, expr.size() - 6), v) || v <= 0 || (v & (v - 1)) != 0) return false;
+        value = 0;
+        while ((1LL << value) < v) ++value;
+        return true;
+    }
+    if (expr[0] == '-') {
+        if (!lookup(expr.substr(1), v)) return false;
+        value = -v;
+        return true;
+    }
+    size_t op = expr.find_first_of("+-", 1);
+    if (op != std::string::npos) {
+        long long delta = 0;
+        if (!lookup(expr.substr(0, op), v) || !parseInteger(expr.substr(op + 1), delta)) return false;
+        value = expr[op] == '+' ? v + delta : v - delta;
+        return true;
+    }
+    return lookup(expr, value);
+}
+
+std::vector<std::string> splitRule(const char* text) {
+    std::vector<std::string> parts;
+    std::string current;
+    for (const char* p = text; *p; ++p) {
+        if (*p == ';') {
+            parts.push_back(current);
+            current.clear();
+        } else {
+            current += *p;
+        }
+    }
+    if (!current.empty()) parts.push_back(current);
+    return parts;
+}
+
+} // namespace
+
+// ==================== 汇编行 ====================
+
+AsmLine AsmLine::classify(const std::string& line) {
+    if (line.empty() || line[0] == '#') return {Kind::COMMENT, line};
+    if (line[0] != '\t' && line.back() == ':') return {Kind::LABEL, line};
+    if (line[0] == '\t') {
+        if (line.rfind("\t.loc", 0) == 0) return {Kind::COMMENT, line};
+        if (line.size() > 1 && line[1] == '.') return {Kind::DIRECTIVE, line};
+        return {Kind::INSTRUCTION, line.substr(1)};
+    }
+    return {Kind::DIRECTIVE, line};
+}
+
+std::string AsmLine::render() const {
+    return kind == Kind::INSTRUCTION ? "\t" + text : text;
+}
+
+bool AsmInstr::parse(const std::string& text, AsmInstr& out) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == std::string::npos) return false;
+    size_t end = text.find_first_of(" \t", start);
+    out.mnemonic = text.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    out.operands.clear();
+    if (end == std::string::npos) return true;
+
+    std::string current;
+    for (size_t i = end; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == ',') {
+            out.operands.push_back(current);
+            current.clear();
+        } else if (c != ' ' && c != '\t') {
+            current += c;
+        }
+    }
+    if (!current.empty()) out.operands.push_back(current);
+    return true;
+}
+
+std::string AsmInstr::toString() const {
+    std::string text = mnemonic;
+    for (size_t i = 0; i < operands.size(); ++i) {
+        text += (i == 0 ? " " : ", ") + operands[i];
+    }
+    return text;
+}
+
+AsmEffect AsmEffect::of(const AsmInstr& instr) {
+    AsmEffect e;
+    const std::string& m = instr.mnemonic;
+    const auto& ops = instr.operands;
+    auto regs = [&](size_t from, size_t to, std::vector<std::string>& into) {
+        for (size_t i = from; i < to && i < ops.size(); ++i) {
+            if (isRegisterName(ops[i]) && ops[i] != "zero" && ops[i] != "x0") into.push_back(ops[i]);
+        }
+    };
+
+    if ((threeRegOps().count(m) && ops.size() == 3) || (regImmOps().count(m) && ops.size() == 3) ||
+        (unaryOps().count(m) && ops.size() == 2)) {
+        e.kind = Kind::NORMAL;
+        regs(0, 1, e.defs);
+        regs(1, ops.size(), e.uses);
+    } else if ((m == "li" || m == "la" || m == "lui" || m == "auipc" || m == "rdcycle" || m == "rdcycleh") &&
+               !ops.empty()) {
+        e.kind = Kind::NORMAL;
+        regs(0, 1, e.defs);
+    } else if ((m == "lw" || m == "lh" || m == "lb" || m == "lhu" || m == "lbu") && ops.size() == 2) {
+        e.kind = Kind::NORMAL;
+        regs(0, 1, e.defs);
+        std::string base = baseRegister(ops[1]);
+        if (!base.empty()) e.uses.push_back(base);
+    } else if ((m == "sw" || m == "sh" || m == "sb") && ops.size() == 2) {
+        e.kind = Kind::NORMAL;
+        regs(0, 1, e.uses);
+        std::string base = baseRegister(ops[1]);
+        if (!base.empty()) e.uses.push_back(base);
+    } else if (twoRegBranches().count(m) && ops.size() == 3) {
+        e.kind = Kind::BRANCH;
+        regs(0, 2, e.uses);
+        e.target = ops[2];
+    } else if (oneRegBranches().count(m) && ops.size() == 2) {
+        e.kind = Kind::BRANCH;
+        regs(0, 1, e.uses);
+        e.target = ops[1];
+    } else if (m == "j" && ops.size() == 1) {
+        e.kind = Kind::JUMP;
+        e.target = ops[0];
+    } else if (m == "call" && ops.size() == 1) {
+        e.kind = Kind::CALL;
+        for (int i = 0; i <= 7; ++i) e.uses.push_back("a" + std::to_string(i));
+        e.defs.push_back("ra");
+        for (int i = 0; i <= 6; ++i) e.defs.push_back("t" + std::to_string(i));
+        for (int i = 0; i <= 7; ++i) e.defs.push_back("a" + std::to_string(i));
+    } else if (m == "ret" && ops.empty()) {
+        e.kind = Kind::RETURN;
+        e.uses = {"a0", "a1", "ra", "sp"};
+    }
+    return e;
+}
+
+// ==================== 活跃性 ====================
+
+namespace {
+
+bool deadFrom(const std::vector<AsmLine>& lines, size_t from, const std::string& reg,
+              const std::map<std::string, size_t>& labelIndex, std::set<size_t>& visited, int& budget) {
+    for (size_t i = from; i < lines.size(); ++i) {
+        if (--budget <= 0) return false;
+        const AsmLine& line = lines[i];
+        if (line.kind == AsmLine::Kind::LABEL) {
+            // 沿落入路径继续；回到已经走过的标签说明这条环路上没有读取
+            if (!visited.insert(i).second) return true;
+            continue;
+        }
+        if (line.kind == AsmLine::Kind::COMMENT) continue;
+        if (line.kind == AsmLine::Kind::DIRECTIVE) return false;
+
+        AsmInstr instr;
+        if (!AsmInstr::parse(line.text, instr)) return false;
+        AsmEffect effect = AsmEffect::of(instr);
+        if (std::find(effect.uses.begin(), effect.uses.end(), reg) != effect.uses.end()) return false;
+
+        auto jumpTo = [&](size_t& next) {
+            auto it = labelIndex.find(effect.target);
+            if (it == labelIndex.end()) return false;
+            next = it->second;
+            return true;
+        };
+        switch (effect.kind) {
+            case AsmEffect::Kind::NORMAL:
+            case AsmEffect::Kind::CALL:
+                if (std::find(effect.defs.begin(), effect.defs.end(), reg) != effect.defs.end()) return true;
+                break;
+            case AsmEffect::Kind::RETURN:
+                return isCallClobbered(reg) && !isArgumentRegister(reg);
+            case AsmEffect::Kind::BRANCH: {
+                size_t target;
+                if (!jumpTo(target) || !deadFrom(lines, target, reg, labelIndex, visited, budget)) return false;
+                break;
+            }
+            case AsmEffect::Kind::JUMP: {
+                size_t target;
+                if (!jumpTo(target)) return false;
+                return deadFrom(lines, target, reg, labelIndex, visited, budget);
+            }
+            case AsmEffect::Kind::BARRIER:
+                return false;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool isRegisterDeadFrom(const std::vector<AsmLine>& lines, size_t from, const std::string& reg,
+                        const std::map<std::string, size_t>& labelIndex) {
+    std::set<size_t> visited;
+    int budget = 4096;
+    return deadFrom(lines, from, reg, labelIndex, visited, budget);
+}
+
+// ==================== 规则 ====================
+
+PeepholeRule PeepholeRule::parse(const char* pattern, const char* replacement, const char* dead,
+                                 int costBefore, int costAfter) {
+    PeepholeRule rule;
+    for (const auto& text : splitRule(pattern)) {
+        AsmInstr instr;
+        if (!AsmInstr::parse(text, instr)) throw std::runtime_error(std::string("bad peephole pattern: ") + pattern);
+        rule.pattern.push_back(instr);
+    }
+    for (const auto& text : splitRule(replacement)) {
+        AsmInstr instr;
+        if (!AsmInstr::parse(text, instr)) throw std::runtime_error(std::string("bad peephole replacement: ") + replacement);
+        rule.replacement.push_back(instr);
+    }
+    AsmInstr deadList;
+    if (AsmInstr::parse(std::string("dead ") + dead, deadList)) rule.dead = deadList.operands;
+    rule.costBefore = costBefore;
+    rule.costAfter = costAfter;
+    return rule;
+}
+
+PeepholeRewriter::PeepholeRewriter(std::vector<PeepholeRule> rules) : rules(std::move(rules)) {
+    // 长模式优先，其次是节省多的
+    std::stable_sort(this->rules.begin(), this->rules.end(), [](const PeepholeRule& a, const PeepholeRule& b) {
+        if (a.pattern.size() != b.pattern.size()) return a.pattern.size() > b.pattern.size();
+        return a.costBefore - a.costAfter > b.costBefore - b.costAfter;
+    });
+    for (const auto& rule : this->rules) maxPatternLength = std::max(maxPatternLength, rule.pattern.size());
+}
+
+const PeepholeRewriter& PeepholeRewriter::generated() {
+    static const PeepholeRewriter rewriter([] {
+        std::vector<PeepholeRule> rules;
+#define TOYC_PEEPHOLE_RULE(pattern, replacement, dead, costBefore, costAfter) \
+        rules.push_back(PeepholeRule::parse(pattern, replacement, dead, costBefore, costAfter));
+#include "peephole_rules.inc"
+#undef TOYC_PEEPHOLE_RULE
+        return rules;
+    }());
+    return rewriter;
+}
+
+bool PeepholeRewriter::match(const PeepholeRule& rule, const std::vector<AsmInstr>& window,
+                             std::vector<AsmInstr>& replacement, std::vector<std::string>& deadRegs) const {
+    std::map<std::string, std::string> regBinding;
+    std::map<std::string, long long> immBinding;
+    std::map<std::string, std::string> labelBinding;
+    std::set<std::string> boundRegs;
+
+    for (size_t k = 0; k < rule.pattern.size(); ++k) {
+        const AsmInstr& want = rule.pattern[k];
+        const AsmInstr& have = window[k];
+        if (want.mnemonic != have.mnemonic || want.operands.size() != have.operands.size()) return false;
+        for (size_t j = 0; j < want.operands.size(); ++j) {
+            const std::string& p = want.operands[j];
+            const std::string& actual = have.operands[j];
+            if (p[0] == '$') {
+                if (!isRegisterName(actual) || actual == "zero" || actual == "x0") return false;
+                auto it = regBinding.find(p);
+                if (it != regBinding.end()) {
+                    if (it->second != actual) return false;
+                } else {
+                    if (!boundRegs.insert(actual).second) return false;
+                    regBinding[p] = actual;
+                }
+            } else if (p[0] == '#') {
+                long long value;
+                if (!parseInteger(actual, value)) return false;
+                auto it = immBinding.find(p);
+                if (it != immBinding.end() && it->second != value) return false;
+                immBinding[p] = value;
+            } else if (p[0] == '@') {
+                auto it = labelBinding.find(p);
+                if (it != labelBinding.end() && it->second != actual) return false;
+                labelBinding[p] = actual;
+            } else {
+                long long a, b;
+                bool same = (parseInteger(p, a) && parseInteger(actual, b)) ? a == b : p == actual;
+                if (!same) return false;
+            }
+        }
+    }
+
+    replacement.clear();
+    for (const auto& instr : rule.replacement) {
+        AsmInstr out;
+        out.mnemonic = instr.mnemonic;
+        for (const auto& p : instr.operands) {
+            if (p[0] == '$') {
+                auto it = regBinding.find(p);
+                if (it == regBinding.end()) return false;
+                out.operands.push_back(it->second);
+            } else if (p[0] == '@') {
+                auto it = labelBinding.find(p);
+                if (it == labelBinding.end()) return false;
+                out.operands.push_back(it->second);
+            } else if (p == "zero" || isRegisterName(p)) {
+                out.operands.push_back(p);
+            } else {
+                long long value;
+                if (!evaluateImmediate(p, immBinding, value) || !immediateFits(instr.mnemonic, value)) return false;
+                out.operands.push_back(std::to_string(value));
+            }
+        }
+        replacement.push_back(out);
+    }
+
+    deadRegs.clear();
+    for (const auto& var : rule.dead) {
+        auto it = regBinding.find(var);
+        if (it == regBinding.end()) return false;
+        deadRegs.push_back(it->second);
+    }
+    return true;
+}
+
+int PeepholeRewriter::run(std::vector<AsmLine>& lines) const {
+    if (rules.empty()) return 0;
+
+    std::map<std::string, size_t> labelIndex;
+    auto indexLabels = [&]() {
+        labelIndex.clear();
+        for (size_t i = 0; i < lines.size(); ++i) {
+            if (lines[i].kind == AsmLine::Kind::LABEL) labelIndex[lines[i].text.substr(0, lines[i].text.size() - 1)] = i;
+        }
+    };
+    indexLabels();
+
+    int rewrites = 0;
+    size_t i = 0;
+    while (i < lines.size()) {
+        if (lines[i].kind != AsmLine::Kind::INSTRUCTION) {
+            ++i;
+            continue;
+        }
+
+        // 窗口：从i开始、不跨越标签和伪指令的若干条指令（注释透明）
+        std::vector<size_t> positions;
+        std::vector<AsmInstr> window;
+        for (size_t j = i; j < lines.size() && positions.size() < maxPatternLength; ++j) {
+            if (lines[j].kind == AsmLine::Kind::COMMENT) continue;
+            if (lines[j].kind != AsmLine::Kind::INSTRUCTION) break;
+            AsmInstr instr;
+            if (!AsmInstr::parse(lines[j].text, instr)) break;
+            positions.push_back(j);
+            window.push_back(instr);
+        }
+
+        bool applied = false;
+        std::vector<AsmInstr> replacement;
+        std::vector<std::string> deadRegs;
+        for (const auto& rule : rules) {
+            size_t len = rule.pattern.size();
+            if (len > window.size() || !match(rule, window, replacement, deadRegs)) continue;
+            size_t last = positions[len - 1];
+            bool allDead = std::all_of(deadRegs.begin(), deadRegs.end(), [&](const std::string& reg) {
+                return isRegisterDeadFrom(lines, last + 1, reg, labelIndex);
+            });
+            if (!allDead) continue;
+
+            // 最后一条替换为新序列，前面的指令删除（中间的注释保留）
+            std::vector<AsmLine> newLines;
+            for (const auto& instr : replacement) newLines.push_back({AsmLine::Kind::INSTRUCTION, instr.toString()});
+            lines.erase(lines.begin() + last);
+            lines.insert(lines.begin() + last, newLines.begin(), newLines.end());
+            for (size_t k = len - 1; k-- > 0;) lines.erase(lines.begin() + positions[k]);
+            indexLabels();
+            ++rewrites;
+            applied = true;
+            break;
+        }
+        if (!applied) {
+            ++i;
+            continue;
+        }
+        // 回退几条指令，让新序列与前面的指令组成新的窗口
+        size_t back = 0;
+        while (i > 0 && back < maxPatternLength) {
+            --i;
+            if (lines[i].kind == AsmLine::Kind::INSTRUCTION) ++back;
+            if (lines[i].kind == AsmLine::Kind::LABEL || lines[i].kind == AsmLine::Kind::DIRECTIVE) break;
+        }
+    }
+    return rewrites;
+}
+
+// ==================== 函数与基本块划分 ====================
+
+namespace {
+
+std::string directiveText(const AsmLine& line) {
+    size_t start = line.text.find_first_not_of(" \t");
+    return start == std::string::npos ? "" : line.text.substr(start);
+}
+
+bool isSectionDirective(const std::string& d) {
+    return d == ".text" || d == ".data" || d == ".bss" || d.rfind(".section", 0) == 0;
+}
+
+bool isTextSection(const std::string& d) {
+    return d == ".text" || d.rfind(".section .text", 0) == 0;
+}
+
+std::string labelName(const AsmLine& line) {
+    return line.text.substr(0, line.text.size() - 1);
+}
+
+void splitBlocks(const std::vector<AsmLine>& lines, AsmFunction& function) {
+    std::string lastLabel = function.name;
+    int sinceLabel = 0;
+    bool open = false;
+    int openInstrs = 0;
+    for (size_t i = function.first; i < function.last; ++i) {
+        const AsmLine& line = lines[i];
+        if (line.kind == AsmLine::Kind::LABEL) {
+            if (open && openInstrs > 0) open = false;
+            lastLabel = labelName(line);
+            sinceLabel = 0;
+            if (!open) {
+                function.blocks.push_back({lastLabel, i, function.last});
+                open = true;
+                openInstrs = 0;
+            }
+            function.blockOf[lastLabel] = function.blocks.size() - 1;
+            continue;
+        }
+        if (line.kind != AsmLine::Kind::INSTRUCTION) continue;
+        if (!open) {
+            function.blocks.push_back({lastLabel + "+" + std::to_string(sinceLabel), i, function.last});
+            open = true;
+            openInstrs = 0;
+        }
+        ++openInstrs;
+        ++sinceLabel;
+        AsmInstr instr;
+        if (!AsmInstr::parse(line.text, instr)) continue;
+        AsmEffect::Kind kind = AsmEffect::of(instr).kind;
+        if (kind == AsmEffect::Kind::BRANCH || kind == AsmEffect::Kind::JUMP || kind == AsmEffect::Kind::RETURN ||
+            instr.mnemonic == "jr" || instr.mnemonic == "tail") {
+            open = false;
+        }
+    }
+    for (size_t b = 0; b + 1 < function.blocks.size(); ++b) function.blocks[b].last = function.blocks[b + 1].first;
+}
+
+} // namespace
+
+std::vector<AsmLine> splitAsmLines(std::string_view text) {
+    std::vector<AsmLine> lines;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        lines.push_back(AsmLine::classify(std::string(text.substr(pos, end - pos))));
+        pos = end + 1;
+    }
+    return lines;
+}
+
+std::vector<AsmFunction> splitAsmFunctions(const std::vector<AsmLine>& lines) {
+    std::set<std::string> entries;
+    for (const auto& line : lines) {
+        if (line.kind == AsmLine::Kind::DIRECTIVE) {
+            std::string d = directiveText(line);
+            if (d.rfind(".global ", 0) == 0 || d.rfind(".globl ", 0) == 0) {
+                entries.insert(d.substr(d.find(' ') + 1));
+            } else if (d.rfind(".type ", 0) == 0 && d.find("@function") != std::string::npos) {
+                entries.insert(d.substr(6, d.find(',') - 6));
+            }
+        } else if (line.kind == AsmLine::Kind::INSTRUCTION) {
+            AsmInstr instr;
+            if (!AsmInstr::parse(line.text, instr) || instr.operands.empty()) continue;
+            if (instr.mnemonic == "call" || instr.mnemonic == "jal" || instr.mnemonic == "tail") {
+                entries.insert(instr.operands.back());
+            }
+        }
+    }
+
+    std::vector<AsmFunction> functions;
+    bool inText = true;
+    bool open = false;
+    auto close = [&](size_t end) {
+        if (!open) return;
+        functions.back().last = end;
+        splitBlocks(lines, functions.back());
+        open = false;
+    };
+    for (size_t i = 0; i < lines.size(); ++i) {
+        const AsmLine& line = lines[i];
+        if (line.kind == AsmLine::Kind::DIRECTIVE && isSectionDirective(directiveText(line))) {
+            close(i);
+            inText = isTextSection(directiveText(line));
+        } else if (inText && line.kind == AsmLine::Kind::LABEL && entries.count(labelName(line))) {
+            close(i);
+            functions.push_back({labelName(line), i, lines.size(), {}, {}});
+            open = true;
+        }
+    }
+    close(lines.size());
+    return functions;
+}
+
+namespace {
+
+// 块最后一条指令的效果；块中没有指令时返回false
+bool lastEffect(const std::vector<AsmLine>& lines, const AsmBlock& block, AsmInstr& instr, AsmEffect& effect) {
+    for (size_t i = block.last; i-- > block.first;) {
+        if (lines[i].kind != AsmLine::Kind::INSTRUCTION) continue;
+        if (!AsmInstr::parse(lines[i].text, instr)) return false;
+        effect = AsmEffect::of(instr);
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+bool asmBlockFallsThrough(const std::vector<AsmLine>& lines, const AsmBlock& block) {
+    AsmInstr instr;
+    AsmEffect effect;
+    if (!lastEffect(lines, block, instr, effect)) return true;
+    return effect.kind != AsmEffect::Kind::JUMP && effect.kind != AsmEffect::Kind::RETURN &&
+           instr.mnemonic != "jr" && instr.mnemonic != "tail";
+}
+
+std::vector<std::vector<size_t>> asmBlockSuccessors(const std::vector<AsmLine>& lines, const AsmFunction& function) {
+    std::vector<std::vector<size_t>> successors(function.blocks.size());
+    for (size_t b = 0; b < function.blocks.size(); ++b) {
+        AsmInstr instr;
+        AsmEffect effect;
+        if (lastEffect(lines, function.blocks[b], instr, effect) &&
+            (effect.kind == AsmEffect::Kind::BRANCH || effect.kind == AsmEffect::Kind::JUMP)) {
+            auto it = function.blockOf.find(effect.target);
+            if (it != function.blockOf.end()) successors[b].push_back(it->second);
+        }
+        if (b + 1 < function.blocks.size() && asmBlockFallsThrough(lines, function.blocks[b])) {
+            successors[b].push_back(b + 1);
+        }
+    }
+    return successors;
+}
+
+std::vector<int> asmLoopDepths(const std::vector<AsmLine>& lines, const AsmFunction& function) {
+    std::vector<int> depths(function.blocks.size(), 0);
+    for (size_t b = 0; b < function.blocks.size(); ++b) {
+        AsmInstr instr;
+        AsmEffect effect;
+        if (!lastEffect(lines, function.blocks[b], instr, effect)) continue;
+        if (effect.kind != AsmEffect::Kind::BRANCH && effect.kind != AsmEffect::Kind::JUMP) continue;
+        auto it = function.blockOf.find(effect.target);
+        if (it == function.blockOf.end() || it->second > b) continue;
+        for (size_t k = it->second; k <= b; ++k) ++depths[k];
+    }
+    return depths;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ==================== 汇编行缓冲 ====================
+
+// CodeGenerator::generate()先把函数体的汇编按行缓存下来，窥孔优化在此之上进行
+struct AsmLine {
+    enum class Kind {
+        INSTRUCTION,  // 机器指令（text不含前导制表符）
+        LABEL,        // "name:"
+        COMMENT,      // 注释和.loc，对窥孔窗口透明
+        DIRECTIVE     // 其他汇编伪指令，窥孔窗口不跨越
+    };
+
+    Kind kind;
+    std::string text;
+
+    static AsmLine classify(const std::string& line);
+    std::string render() const;
+};
+
+// 一条汇编指令："mnemonic op0, op1, ..."
+struct AsmInstr {
+    std::string mnemonic;
+    std::vector<std::string> operands;
+
+    static bool parse(const std::string& text, AsmInstr& out);
+    std::string toString() const;
+};
+
+// 指令的寄存器读写及控制流类别，供活跃性分析使用
+struct AsmEffect {
+    enum class Kind {
+        NORMAL,   // 顺序执行
+        BRANCH,   // 条件跳转到target，或落入下一条
+        JUMP,     // 无条件跳转到target
+        CALL,     // 读a0-a7，破坏ra/t0-t6/a0-a7
+        RETURN,   // 读a0及被调用者保存寄存器
+        BARRIER   // 无法分析的指令
+    };
+
+    Kind kind = Kind::BARRIER;
+    std::vector<std::string> defs;
+    std::vector<std::string> uses;
+    std::string target;
+
+    static AsmEffect of(const AsmInstr& instr);
+};
+
+// ==================== 生成的窥孔改写规则 ====================
+//
+// 规则由离线超级优化器toyc_superopt生成（codegen/peephole_rules.inc），编译时载入。
+// 模式中$N为寄存器变量（不同变量绑定不同寄存器），#N为立即数变量，@L为标签，
+// 其余为字面量；替换序列中的立即数可以是#N、-#N、#N+1、#N-1、log2(#N)或字面量。
+// dead是逗号分隔的寄存器变量，它们在窗口之后（沿所有可达路径）必须先被改写或不再被读取。
+struct PeepholeRule {
+    std::vector<AsmInstr> pattern;
+    std::vector<AsmInstr> replacement;
+    std::vector<std::string> dead;
+    int costBefore = 0;
+    int costAfter = 0;
+
+    static PeepholeRule parse(const char* pattern, const char* replacement, const char* dead,
+                              int costBefore, int costAfter);
+};
+
+class PeepholeRewriter {
+public:
+    explicit PeepholeRewriter(std::vector<PeepholeRule> rules);
+
+    // peephole_rules.inc中的全部规则
+    static const PeepholeRewriter& generated();
+
+    // 就地改写，返回应用规则的次数
+    int run(std::vector<AsmLine>& lines) const;
+
+    size_t size() const { return rules.size(); }
+
+private:
+    std::vector<PeepholeRule> rules;
+    size_t maxPatternLength = 0;
+
+    bool match(const PeepholeRule& rule, const std::vector<AsmInstr>& window,
+               std::vector<AsmInstr>& replacement, std::vector<std::string>& deadRegs) const;
+};
+
+// 从lines[from]开始，reg在所有可达路径上都先被改写（或在调用/返回处失效）而不被读取时返回true
+bool isRegisterDeadFrom(const std::vector<AsmLine>& lines, size_t from, const std::string& reg,
+                        const std::map<std::string, size_t>& labelIndex);
+
+// ==================== 函数与基本块划分 ====================
+
+// 供--cost-report、--size-report等分析最终汇编文本的工具使用：
+// - 函数入口是.global/.type声明的符号，以及call/jal/tail的目标（外提子程序、运行时例程），
+//   一个函数延续到下一个入口或段切换；数据段中的内容不属于任何函数
+// - 标签开始新块，控制转移结束当前块；没有标签的块以"前一标签+指令偏移"命名，
+//   块之间的注释和伪指令归入前一个块
+struct AsmBlock {
+    std::string name;
+    size_t first;   // lines中的范围[first, last)
+    size_t last;
+};
+
+struct AsmFunction {
+    std::string name;
+    size_t first;
+    size_t last;
+    std::vector<AsmBlock> blocks;
+    std::map<std::string, size_t> blockOf;  // 标签 -> blocks下标
+};
+
+std::vector<AsmLine> splitAsmLines(std::string_view text);
+std::vector<AsmFunction> splitAsmFunctions(const std::vector<AsmLine>& lines);
+
+// 块是否会顺序执行到下一块（最后一条指令不是无条件跳转、返回、jr或tail）
+bool asmBlockFallsThrough(const std::vector<AsmLine>& lines, const AsmBlock& block);
+// 各块的后继（块下标）：分支/跳转的目标和顺序落入的下一块
+std::vector<std::vector<size_t>> asmBlockSuccessors(const std::vector<AsmLine>& lines, const AsmFunction& function);
+// 各块的循环深度：块b的最后一条指令跳向不晚于b的块h时，[h, b]构成一个循环
+std::vector<int> asmLoopDepths(const std::vector<AsmLine>& lines, const AsmFunction& function);
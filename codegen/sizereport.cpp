@@ -0,0 +1,153 @@
+// sizereport.cpp - 生成代码按函数、基本块和类别的体积统计
+#include "sizereport.h"
+#include <algorithm>
+#include <iomanip>
+
+namespace {
+
+bool isMemoryAccess(const std::string& m) {
+    return m == "lw" || m == "lh" || m == "lb" || m == "lhu" || m == "lbu" || m == "sw" || m == "sh" || m == "sb";
+}
+
+bool isFrameAccess(const AsmInstr& instr) {
+    if (!isMemoryAccess(instr.mnemonic) || instr.operands.size() != 2) return false;
+    const std::string& mem = instr.operands[1];
+    return mem.find("(fp)") != std::string::npos || mem.find("(sp)") != std::string::npos ||
+           mem.find("(s0)") != std::string::npos;
+}
+
+bool isCallStatement(const std::string& comment) {
+    return comment.rfind("# call ", 0) == 0 || comment.find(" = call ") != std::string::npos;
+}
+
+} // namespace
+
+const char* SizeReport::categoryName(Category category) {
+    switch (category) {
+    case PROLOGUE_EPILOGUE: return "prologue/epilogue";
+    case CALL_MARSHALLING: return "call";
+    case SPILL_RELOAD: return "spill/reload";
+    case CONTROL_FLOW: return "control";
+    case COMPUTATION: return "compute";
+    default: return "?";
+    }
+}
+
+int SizeReport::instructionBytes(const AsmInstr& instr) {
+    const std::string& m = instr.mnemonic;
+    if (m == "la" || m == "lla" || m == "call" || m == "tail") return 8;
+    if (m == "li" && instr.operands.size() == 2) {
+        // 12位以内为addi；低12位为0时只需lui
+        long long value = 0;
+        try {
+            value = std::stoll(instr.operands[1], nullptr, 0);
+        } catch (const std::exception&) {
+            return 8;
+        }
+        if (value >= -2048 && value <= 2047) return 4;
+        return (value & 0xfff) == 0 ? 4 : 8;
+    }
+    return 4;
+}
+
+void SizeReport::analyze(std::string_view assembly) {
+    functionSizes.clear();
+    blockSizes.clear();
+
+    std::vector<AsmLine> lines = splitAsmLines(assembly);
+    for (const auto& function : splitAsmFunctions(lines)) {
+        FunctionSize size;
+        size.name = function.name;
+        bool sharedFrameRoutine =
+            function.name.rfind("__toyc_save_", 0) == 0 || function.name.rfind("__toyc_restore_", 0) == 0;
+
+        // 注释划分的区域，跨基本块保持
+        enum class Region { BODY, PROLOGUE, EPILOGUE, CALL } region = Region::BODY;
+        for (const auto& block : function.blocks) {
+            BlockSize blockSize;
+            blockSize.function = function.name;
+            blockSize.name = block.name;
+            for (size_t i = block.first; i < block.last; ++i) {
+                const AsmLine& line = lines[i];
+                if (line.kind == AsmLine::Kind::COMMENT && !line.text.empty() && line.text[0] == '#') {
+                    const std::string& text = line.text;
+                    if (text == "# 函数序言") {
+                        region = Region::PROLOGUE;
+                    } else if (text == "# 函数后记") {
+                        region = Region::EPILOGUE;
+                    } else if (region == Region::EPILOGUE) {
+                        // 后记一直延续到函数结束
+                    } else if (region == Region::PROLOGUE &&
+                               (text == "# 保存被调用者保存的寄存器" || text == "# 函数形参压栈")) {
+                        // 仍属于序言
+                    } else if (region == Region::CALL &&
+                               (text == "# 保存调用者保存的寄存器" || text == "# 恢复调用者保存的寄存器")) {
+                        // 仍属于调用
+                    } else {
+                        region = isCallStatement(text) ? Region::CALL : Region::BODY;
+                    }
+                    continue;
+                }
+                if (line.kind != AsmLine::Kind::INSTRUCTION) continue;
+                AsmInstr instr;
+                if (!AsmInstr::parse(line.text, instr)) continue;
+
+                Category category;
+                if (sharedFrameRoutine || region == Region::PROLOGUE || region == Region::EPILOGUE) {
+                    category = PROLOGUE_EPILOGUE;
+                } else if (region == Region::CALL) {
+                    category = CALL_MARSHALLING;
+                } else if (isFrameAccess(instr)) {
+                    category = SPILL_RELOAD;
+                } else if (AsmEffect::of(instr).kind != AsmEffect::Kind::NORMAL) {
+                    category = CONTROL_FLOW;
+                } else {
+                    category = COMPUTATION;
+                }
+                int bytes = instructionBytes(instr);
+                size.categoryBytes[category] += bytes;
+                size.bytes += bytes;
+                blockSize.bytes += bytes;
+            }
+            blockSizes.push_back(blockSize);
+        }
+        functionSizes.push_back(size);
+    }
+}
+
+void SizeReport::printReport(std::ostream& out) const {
+    int total = 0;
+    int categoryTotal[CATEGORY_COUNT] = {};
+    for (const auto& f : functionSizes) {
+        total += f.bytes;
+        for (int c = 0; c < CATEGORY_COUNT; ++c) categoryTotal[c] += f.categoryBytes[c];
+    }
+
+    out << "===== 代码体积（RV32I，不含压缩指令） =====\n";
+    out << std::left << std::setw(28) << "function" << std::right << std::setw(8) << "bytes";
+    for (int c = 0; c < CATEGORY_COUNT; ++c) out << std::setw(19) << categoryName(static_cast<Category>(c));
+    out << "\n";
+    auto row = [&](const std::string& name, int bytes, const int* categories) {
+        out << std::left << std::setw(28) << name << std::right << std::setw(8) << bytes;
+        for (int c = 0; c < CATEGORY_COUNT; ++c) out << std::setw(19) << categories[c];
+        out << "\n";
+    };
+    for (const auto& f : functionSizes) row(f.name, f.bytes, f.categoryBytes);
+    row("(total)", total, categoryTotal);
+
+    out << "--- 类别占比 ---\n";
+    for (int c = 0; c < CATEGORY_COUNT; ++c) {
+        out << "  " << std::left << std::setw(20) << categoryName(static_cast<Category>(c)) << std::right
+            << std::setw(8) << categoryTotal[c] << std::setw(8) << std::fixed << std::setprecision(1)
+            << (total > 0 ? 100.0 * categoryTotal[c] / total : 0.0) << "%\n";
+    }
+
+    out << "--- 基本块 ---\n";
+    out << std::left << std::setw(28) << "function" << std::setw(24) << "block" << std::right << std::setw(8)
+        << "bytes" << "\n";
+    for (const auto& b : blockSizes) {
+        if (b.bytes == 0) continue;
+        out << std::left << std::setw(28) << b.function << std::setw(24) << b.name << std::right << std::setw(8)
+            << b.bytes << "\n";
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "codegen/peephole.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ==================== 代码体积报告（--size-report） ====================
+//
+// 按RV32I（不含压缩指令）估计生成代码的字节数：普通指令4字节，la/call/tail以及
+// 超出12位的li展开为两条指令（8字节）。按函数、基本块和类别汇总，类别依据代码生成器
+// 输出的注释划分：
+// - 序言/后记："函数序言"到函数体第一条IR之前（含被调用者保存寄存器和形参压栈），
+//   "函数后记"之后，以及-msave-restore的共享例程
+// - 调用传参：IR调用语句生成的代码（保存/恢复调用者保存寄存器、传参、call、取返回值）
+// - spill/reload：其余以fp/sp为基址的lw/sw
+// - 控制流：其余分支和跳转
+// - 计算：其他指令
+class SizeReport {
+public:
+    enum Category { PROLOGUE_EPILOGUE, CALL_MARSHALLING, SPILL_RELOAD, CONTROL_FLOW, COMPUTATION, CATEGORY_COUNT };
+
+    struct BlockSize {
+        std::string function;
+        std::string name;
+        int bytes = 0;
+    };
+
+    struct FunctionSize {
+        std::string name;
+        int bytes = 0;
+        int categoryBytes[CATEGORY_COUNT] = {};
+    };
+
+    void analyze(std::string_view assembly);
+    void printReport(std::ostream& out) const;
+
+    const std::vector<FunctionSize>& functions() const { return functionSizes; }
+    const std::vector<BlockSize>& blocks() const { return blockSizes; }
+
+    static const char* categoryName(Category category);
+    static int instructionBytes(const AsmInstr& instr);
+
+private:
+    std::vector<FunctionSize> functionSizes;
+    std::vector<BlockSize> blockSizes;
+};
@@ -0,0 +1,300 @@
+// cfgsimplify.cpp - 控制流简化实现
+#include "cfgsimplify.h"
+#include <unordered_set>
+
+namespace {
+
+bool endsBlock(OpCode opcode) {
+    return opcode == OpCode::GOTO || opcode == OpCode::IF_GOTO || opcode == OpCode::RETURN;
+}
+
+const std::shared_ptr<Operand>& targetOperand(const std::shared_ptr<IRInstr>& instr) {
+    if (instr->opcode == OpCode::GOTO) return std::static_pointer_cast<GotoInstr>(instr)->target;
+    return std::static_pointer_cast<IfGotoInstr>(instr)->target;
+}
+
+void setTarget(const std::shared_ptr<IRInstr>& instr, const std::shared_ptr<Operand>& label) {
+    auto target = std::make_shared<Operand>(*label);
+    if (instr->opcode == OpCode::GOTO) std::static_pointer_cast<GotoInstr>(instr)->target = target;
+    else std::static_pointer_cast<IfGotoInstr>(instr)->target = target;
+}
+
+} // namespace
+
+// ==================== 入口 ====================
+
+CFGSimplifier::Stats CFGSimplifier::run(std::vector<std::shared_ptr<IRInstr>>& instructions) {
+    stats = Stats();
+    std::vector<std::shared_ptr<IRInstr>> result;
+    result.reserve(instructions.size());
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        size_t end = i + 1;
+        bool function = instructions[i]->opcode == OpCode::FUNCTION_BEGIN;
+        while (function && end < instructions.size() && instructions[end]->opcode != OpCode::FUNCTION_END) ++end;
+        if (!function || end == instructions.size()) {
+            result.push_back(instructions[i]);
+            continue;
+        }
+        std::vector<std::shared_ptr<IRInstr>> functionBody(instructions.begin() + i + 1, instructions.begin() + end);
+        simplifyFunction(functionBody);
+        result.push_back(instructions[i]);
+        result.insert(result.end(), functionBody.begin(), functionBody.end());
+        result.push_back(instructions[end]);
+        i = end;
+    }
+    instructions.swap(result);
+    return stats;
+}
+
+void CFGSimplifier::simplifyFunction(std::vector<std::shared_ptr<IRInstr>>& functionBody) {
+    if (!buildBlocks(functionBody)) return;
+
+    foldConstantBranches();
+    threadJumps();
+    removeUnreachable();
+    for (int b = head; b != -1; b = blocks[b].next) removeRedundantJump(b);
+    countPredecessors();
+    removeEmptyBlocks();
+    mergeBlocks();
+    removeDeadLabels();
+
+    functionBody.clear();
+    for (int b = head; b != -1; b = blocks[b].next) {
+        functionBody.insert(functionBody.end(), blocks[b].labels.begin(), blocks[b].labels.end());
+        functionBody.insert(functionBody.end(), blocks[b].body.begin(), blocks[b].body.end());
+    }
+}
+
+// ==================== 基本块 ====================
+
+// 连续的标签属于同一块；跳转、返回之后开始新块
+bool CFGSimplifier::buildBlocks(const std::vector<std::shared_ptr<IRInstr>>& functionBody) {
+    blocks.clear();
+    labelBlock.clear();
+    head = -1;
+    bool startNew = true;
+    for (const auto& instr : functionBody) {
+        bool label = instr->opcode == OpCode::LABEL;
+        if (startNew || (label && !blocks.back().body.empty())) {
+            Block block;
+            block.prev = static_cast<int>(blocks.size()) - 1;
+            if (block.prev >= 0) blocks[block.prev].next = static_cast<int>(blocks.size());
+            blocks.push_back(std::move(block));
+        }
+        if (label) {
+            labelBlock[std::static_pointer_cast<LabelInstr>(instr)->label] = static_cast<int>(blocks.size()) - 1;
+            blocks.back().labels.push_back(instr);
+        } else {
+            blocks.back().body.push_back(instr);
+        }
+        startNew = endsBlock(instr->opcode);
+    }
+    if (blocks.empty()) return false;
+    head = 0;
+
+    for (const auto& block : blocks) {
+        if (block.body.empty()) continue;
+        const auto& last = block.body.back();
+        if ((last->opcode == OpCode::GOTO || last->opcode == OpCode::IF_GOTO) &&
+            !labelBlock.count(targetOperand(last)->name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int CFGSimplifier::jumpTarget(int b) const {
+    const auto& body = blocks[b].body;
+    if (body.empty()) return -1;
+    if (body.back()->opcode != OpCode::GOTO && body.back()->opcode != OpCode::IF_GOTO) return -1;
+    return labelBlock.at(targetOperand(body.back())->name);
+}
+
+bool CFGSimplifier::fallsThrough(int b) const {
+    const auto& body = blocks[b].body;
+    return body.empty() || (body.back()->opcode != OpCode::GOTO && body.back()->opcode != OpCode::RETURN);
+}
+
+void CFGSimplifier::successors(int b, std::vector<int>& succs) const {
+    succs.clear();
+    int target = jumpTarget(b);
+    if (target != -1) succs.push_back(target);
+    if (fallsThrough(b) && blocks[b].next != -1) succs.push_back(blocks[b].next);
+}
+
+void CFGSimplifier::unlink(int b) {
+    Block& block = blocks[b];
+    if (block.prev != -1) blocks[block.prev].next = block.next;
+    else head = block.next;
+    if (block.next != -1) blocks[block.next].prev = block.prev;
+    block.removed = true;
+}
+
+// ==================== 简化步骤 ====================
+
+void CFGSimplifier::foldConstantBranches() {
+    for (auto& block : blocks) {
+        if (block.body.empty() || block.body.back()->opcode != OpCode::IF_GOTO) continue;
+        auto branch = std::static_pointer_cast<IfGotoInstr>(block.body.back());
+        if (branch->condition->type != OperandType::CONSTANT) continue;
+        if (branch->condition->value) {
+            auto jump = std::make_shared<GotoInstr>(branch->target);
+            jump->loc = branch->loc;
+            block.body.back() = jump;
+        } else {
+            block.body.pop_back();
+        }
+        stats.foldedBranches++;
+    }
+}
+
+// 转发块（除标签外只有一条goto）的最终目标标签：沿转发链走到第一个非转发块，
+// 链上的块都记下结果，每块只走一次；转发块构成环时停在环上
+void CFGSimplifier::threadJumps() {
+    const int n = static_cast<int>(blocks.size());
+    auto isForwarder = [&](int b) {
+        return blocks[b].body.size() == 1 && blocks[b].body[0]->opcode == OpCode::GOTO;
+    };
+    std::vector<std::shared_ptr<Operand>> finalLabel(n);
+    std::vector<char> state(n, 0);     // 0未访问，1在当前链上，2已求出
+    std::vector<int> path;
+    for (int b = 0; b < n; ++b) {
+        if (state[b] || !isForwarder(b)) continue;
+        path.clear();
+        int current = b;
+        while (isForwarder(current) && state[current] == 0) {
+            state[current] = 1;
+            path.push_back(current);
+            current = jumpTarget(current);
+        }
+        auto label = isForwarder(current) && state[current] == 2 ? finalLabel[current]
+                                                                 : targetOperand(blocks[path.back()].body[0]);
+        for (int p : path) {
+            finalLabel[p] = label;
+            state[p] = 2;
+        }
+    }
+
+    for (int b = 0; b < n; ++b) {
+        int target = jumpTarget(b);
+        if (target == -1 || !finalLabel[target]) continue;
+        const auto& jump = blocks[b].body.back();
+        if (targetOperand(jump)->name == finalLabel[target]->name) continue;
+        setTarget(jump, finalLabel[target]);
+        stats.threadedJumps++;
+    }
+}
+
+void CFGSimplifier::removeUnreachable() {
+    std::vector<bool> reachable(blocks.size(), false);
+    std::vector<int> worklist{head};
+    std::vector<int> succs;
+    reachable[head] = true;
+    while (!worklist.empty()) {
+        int b = worklist.back();
+        worklist.pop_back();
+        successors(b, succs);
+        for (int s : succs) {
+            if (reachable[s]) continue;
+            reachable[s] = true;
+            worklist.push_back(s);
+        }
+    }
+    for (int b = head; b != -1;) {
+        int next = blocks[b].next;
+        if (!reachable[b]) {
+            for (const auto& label : blocks[b].labels) {
+                labelBlock.erase(std::static_pointer_cast<LabelInstr>(label)->label);
+            }
+            unlink(b);
+            stats.unreachableBlocks++;
+        }
+        b = next;
+    }
+}
+
+// 跳到布局中下一块的goto/if-goto是多余的
+bool CFGSimplifier::removeRedundantJump(int b) {
+    int target = jumpTarget(b);
+    if (target == -1 || target != blocks[b].next) return false;
+    blocks[b].body.pop_back();
+    stats.removedJumps++;
+    return true;
+}
+
+void CFGSimplifier::countPredecessors() {
+    std::vector<int> succs;
+    for (int b = head; b != -1; b = blocks[b].next) blocks[b].preds = 0;
+    blocks[head].preds = 1;
+    for (int b = head; b != -1; b = blocks[b].next) {
+        successors(b, succs);
+        for (int s : succs) blocks[s].preds++;
+    }
+}
+
+// 只剩标签的块落入下一块：标签移到下一块，原来的入边都改为进入下一块。
+// 从后往前处理，连续的空块中每个标签只移动一次
+void CFGSimplifier::removeEmptyBlocks() {
+    int tail = head;
+    while (blocks[tail].next != -1) tail = blocks[tail].next;
+    for (int b = tail; b != -1;) {
+        int prev = blocks[b].prev;
+        int next = blocks[b].next;
+        if (blocks[b].body.empty() && next != -1) {
+            auto& labels = blocks[next].labels;
+            for (const auto& label : blocks[b].labels) {
+                labelBlock[std::static_pointer_cast<LabelInstr>(label)->label] = next;
+            }
+            labels.insert(labels.begin(), blocks[b].labels.begin(), blocks[b].labels.end());
+            blocks[next].preds += blocks[b].preds - 1;
+            unlink(b);
+            stats.emptyBlocks++;
+        }
+        b = prev;
+    }
+}
+
+// 块a的唯一后继b只有a一个前驱时把b并入a。b在布局中紧随a（落入或goto），
+// 或者b以goto/return结束、不会落出（此时a以goto进入b，b的布局前驱也不会落入b）
+void CFGSimplifier::mergeBlocks() {
+    for (int a = head; a != -1; a = blocks[a].next) {
+        while (true) {
+            auto& body = blocks[a].body;
+            int b = -1;
+            if (!body.empty() && body.back()->opcode == OpCode::GOTO) b = jumpTarget(a);
+            else if (fallsThrough(a) && (body.empty() || body.back()->opcode != OpCode::IF_GOTO)) b = blocks[a].next;
+            if (b == -1 || b == a || blocks[b].preds != 1) break;
+            if (b != blocks[a].next && fallsThrough(b)) break;
+
+            if (!body.empty() && body.back()->opcode == OpCode::GOTO) body.pop_back();
+            for (const auto& label : blocks[b].labels) {
+                labelBlock.erase(std::static_pointer_cast<LabelInstr>(label)->label);
+            }
+            body.insert(body.end(), blocks[b].body.begin(), blocks[b].body.end());
+            unlink(b);
+            stats.mergedBlocks++;
+
+            // 并入的块可能以跳到新的下一块的跳转结束；if-goto的两条边合为一条
+            int next = blocks[a].next;
+            bool conditional = !body.empty() && body.back()->opcode == OpCode::IF_GOTO;
+            if (removeRedundantJump(a) && conditional) blocks[next].preds--;
+        }
+    }
+}
+
+// 没有跳转引用的标签不再需要（它们只会把块切开）
+void CFGSimplifier::removeDeadLabels() {
+    std::unordered_set<std::string> referenced;
+    for (int b = head; b != -1; b = blocks[b].next) {
+        if (jumpTarget(b) != -1) referenced.insert(targetOperand(blocks[b].body.back())->name);
+    }
+    for (int b = head; b != -1; b = blocks[b].next) {
+        auto& labels = blocks[b].labels;
+        size_t kept = 0;
+        for (auto& label : labels) {
+            if (referenced.count(std::static_pointer_cast<LabelInstr>(label)->label)) labels[kept++] = label;
+        }
+        stats.deadLabels += static_cast<int>(labels.size() - kept);
+        labels.resize(kept);
+    }
+}
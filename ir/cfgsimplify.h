@@ -0,0 +1,64 @@
+#pragma once
+#include "ir.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ==================== 控制流简化（controlFlowOptimization） ====================
+//
+// 逐函数在线性IR上简化控制流，保持块的相对布局：
+// - 条件为常量的if-goto折叠为goto或删除
+// - 跳到“只有一条goto”的转发块的跳转直接改到最终目标（跳转链收缩）
+// - 从函数入口块迭代遍历，删除不可达块
+// - 删除跳到布局中下一块的goto/if-goto；只剩标签的空块把标签并入下一块
+// - 唯一后继与唯一前驱相连的块对合并为一块（落入，或goto到不会落出的块）
+// - 删除没有跳转引用的标签
+// 每一步都是一次遍历或worklist，标签到块的索引随合并、删除维护，
+// 总时间与函数大小成线性（均摊）。跳转目标不在本函数内的函数保持不变。
+class CFGSimplifier {
+public:
+    struct Stats {
+        int foldedBranches = 0;     // 折叠的常量条件跳转
+        int threadedJumps = 0;      // 改到最终目标的跳转
+        int removedJumps = 0;       // 删除的多余跳转
+        int unreachableBlocks = 0;  // 删除的不可达块
+        int emptyBlocks = 0;        // 并入下一块的空块
+        int mergedBlocks = 0;       // 并入前驱的块
+        int deadLabels = 0;         // 删除的无引用标签
+    };
+
+    Stats run(std::vector<std::shared_ptr<IRInstr>>& instructions);
+
+private:
+    struct Block {
+        std::vector<std::shared_ptr<IRInstr>> labels;   // 块首的标签
+        std::vector<std::shared_ptr<IRInstr>> body;     // 其余指令
+        int prev = -1, next = -1;                       // 布局中的相邻块
+        int preds = 0;                                  // 入边条数，入口块另加1
+        bool removed = false;
+    };
+
+    Stats stats;
+
+    // 当前函数
+    std::vector<Block> blocks;
+    int head = -1;                                      // 布局中的第一块（入口块）
+    std::unordered_map<std::string, int> labelBlock;
+
+    void simplifyFunction(std::vector<std::shared_ptr<IRInstr>>& functionBody);
+    bool buildBlocks(const std::vector<std::shared_ptr<IRInstr>>& functionBody);
+    int jumpTarget(int b) const;                        // 块末跳转的目标块，没有跳转时为-1
+    bool fallsThrough(int b) const;
+    void successors(int b, std::vector<int>& succs) const;
+
+    void foldConstantBranches();
+    void threadJumps();
+    void removeUnreachable();
+    bool removeRedundantJump(int b);
+    void countPredecessors();
+    void removeEmptyBlocks();
+    void mergeBlocks();
+    void removeDeadLabels();
+    void unlink(int b);
+};
@@ -0,0 +1,258 @@
+// deadargs.cpp - 死参数与无用返回值消除实现
+#include "deadargs.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_set>
+
+namespace {
+
+bool sameArgument(const std::shared_ptr<Operand>& a, const std::shared_ptr<Operand>& b) {
+    if (a == b) return true;
+    if (!a || !b || a->type != b->type) return false;
+    return a->type == OperandType::CONSTANT ? a->value == b->value : a->name == b->name;
+}
+
+std::unordered_set<std::string> usedNames(const std::vector<std::shared_ptr<IRInstr>>& body) {
+    std::unordered_set<std::string> used;
+    for (const auto& instr : body) {
+        for (const auto& name : instr->getUseRegisters()) used.insert(name);
+    }
+    return used;
+}
+
+} // namespace
+
+// ==================== 入口 ====================
+
+DeadArgumentEliminator::Stats DeadArgumentEliminator::run(std::vector<std::shared_ptr<IRInstr>>& instructions) {
+    functions.clear();
+    functionIndex.clear();
+    stats = Stats();
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto begin = std::dynamic_pointer_cast<FunctionBeginInstr>(instructions[i]);
+        size_t end = i + 1;
+        while (begin && end < instructions.size() && instructions[end]->opcode != OpCode::FUNCTION_END) ++end;
+        if (!begin || end == instructions.size()) {
+            Function loose;
+            loose.body.push_back(instructions[i]);
+            functions.push_back(std::move(loose));
+            continue;
+        }
+        Function fn;
+        fn.begin = begin;
+        fn.body.assign(instructions.begin() + i + 1, instructions.begin() + end);
+        fn.end = instructions[end];
+        functionIndex.emplace(begin->funcName, functions.size());
+        functions.push_back(std::move(fn));
+        i = end;
+    }
+
+    bool changed = false;
+    while (eliminateOnce()) changed = true;
+    if (!changed) return stats;
+
+    std::vector<std::shared_ptr<IRInstr>> result;
+    result.reserve(instructions.size());
+    for (const auto& fn : functions) {
+        if (fn.begin) result.push_back(fn.begin);
+        result.insert(result.end(), fn.body.begin(), fn.body.end());
+        if (fn.end) result.push_back(fn.end);
+    }
+    instructions.swap(result);
+    return stats;
+}
+
+// ==================== 一轮分析与改写 ====================
+
+bool DeadArgumentEliminator::eliminateOnce() {
+    // 收集调用点；有调用点无法匹配param指令的函数不做改动
+    std::unordered_map<std::string, std::vector<CallSite>> sites;
+    std::unordered_set<std::string> unmatched;
+    for (size_t c = 0; c < functions.size(); ++c) {
+        const Function& caller = functions[c];
+        for (size_t i = 0; i < caller.body.size(); ++i) {
+            auto call = std::dynamic_pointer_cast<CallInstr>(caller.body[i]);
+            if (!call || !functionIndex.count(call->funcName)) continue;
+            CallSite site{c, i, {}};
+            if (caller.begin && matchParams(caller, i, call->paramCount, site.paramIndices)) {
+                sites[call->funcName].push_back(std::move(site));
+            } else {
+                unmatched.insert(call->funcName);
+            }
+        }
+    }
+
+    // 只被无用计算读取的名字不算使用，例如形参只参与了结果被丢弃的运算
+    std::vector<std::unordered_set<std::string>> used;
+    for (const auto& fn : functions) {
+        int ignored = 0;
+        used.push_back(usedNames(pruneDeadComputations(fn.body, ignored)));
+    }
+
+    struct Plan {
+        std::vector<bool> deadParam;
+        int deadCount = 0;
+        bool voidResult = false;
+    };
+    std::map<size_t, Plan> plans;
+    for (size_t f = 0; f < functions.size(); ++f) {
+        const Function& fn = functions[f];
+        if (!fn.begin || fn.begin->funcName == "main" || unmatched.count(fn.begin->funcName)) continue;
+        const auto& calls = sites[fn.begin->funcName];
+        const auto& params = fn.begin->paramNames;
+        bool arityOk = std::all_of(calls.begin(), calls.end(), [&](const CallSite& site) {
+            return site.paramIndices.size() == params.size();
+        });
+        if (!arityOk) continue;
+
+        Plan plan;
+        for (const auto& param : params) {
+            plan.deadParam.push_back(!used[f].count(param));
+            plan.deadCount += plan.deadParam.back();
+        }
+        plan.voidResult = fn.begin->returnType != "void" &&
+                          std::all_of(calls.begin(), calls.end(), [&](const CallSite& site) {
+                              auto call = std::static_pointer_cast<CallInstr>(functions[site.caller].body[site.index]);
+                              return !call->result || !used[site.caller].count(call->result->name);
+                          });
+        if (plan.deadCount > 0 || plan.voidResult) plans.emplace(f, std::move(plan));
+    }
+    if (plans.empty()) return false;
+
+    // 先改写调用点（下标基于改写前的函数体），再改写函数定义
+    std::map<size_t, std::set<size_t>> dropped;
+    std::map<size_t, std::map<size_t, std::shared_ptr<IRInstr>>> replaced;
+    for (const auto& entry : plans) {
+        const Plan& plan = entry.second;
+        for (const auto& site : sites[functions[entry.first].begin->funcName]) {
+            auto call = std::static_pointer_cast<CallInstr>(functions[site.caller].body[site.index]);
+            auto rewritten = std::make_shared<CallInstr>(*call);
+            rewritten->params.clear();
+            for (size_t k = 0; k < site.paramIndices.size(); ++k) {
+                if (plan.deadParam[k]) {
+                    dropped[site.caller].insert(site.paramIndices[k]);
+                    ++stats.removedArgs;
+                } else if (!call->params.empty()) {
+                    rewritten->params.push_back(call->params[k]);
+                }
+            }
+            rewritten->paramCount -= plan.deadCount;
+            if (plan.voidResult) rewritten->result = nullptr;
+            replaced[site.caller][site.index] = rewritten;
+            functions[site.caller].touched = true;
+        }
+    }
+    for (auto& fnEntry : replaced) {
+        Function& caller = functions[fnEntry.first];
+        const auto& drop = dropped[fnEntry.first];
+        std::vector<std::shared_ptr<IRInstr>> body;
+        body.reserve(caller.body.size());
+        for (size_t i = 0; i < caller.body.size(); ++i) {
+            if (drop.count(i)) continue;
+            auto it = fnEntry.second.find(i);
+            body.push_back(it != fnEntry.second.end() ? it->second : caller.body[i]);
+        }
+        caller.body.swap(body);
+    }
+
+    for (const auto& entry : plans) {
+        Function& fn = functions[entry.first];
+        const Plan& plan = entry.second;
+        auto begin = std::make_shared<FunctionBeginInstr>(*fn.begin);
+        begin->paramNames.clear();
+        for (size_t k = 0; k < fn.begin->paramNames.size(); ++k) {
+            if (!plan.deadParam[k]) begin->paramNames.push_back(fn.begin->paramNames[k]);
+        }
+        stats.removedParams += plan.deadCount;
+        if (plan.voidResult) {
+            begin->returnType = "void";
+            for (auto& instr : fn.body) {
+                if (instr->opcode != OpCode::RETURN) continue;
+                auto ret = std::make_shared<ReturnInstr>();
+                ret->loc = instr->loc;
+                instr = ret;
+            }
+            ++stats.voidedFunctions;
+        }
+        fn.begin = begin;
+        fn.touched = true;
+    }
+
+    for (auto& fn : functions) {
+        if (!fn.touched) continue;
+        fn.body = pruneDeadComputations(std::move(fn.body), stats.removedInstrs);
+        fn.touched = false;
+    }
+    return true;
+}
+
+// ==================== 辅助函数 ====================
+
+// 从call向前找它的paramCount条param指令：中间只允许出现普通运算，
+// 遇到标签、跳转或另一次调用说明param与call不在同一段直线代码中，放弃匹配
+bool DeadArgumentEliminator::matchParams(const Function& fn, size_t callIndex, int paramCount,
+                                         std::vector<size_t>& paramIndices) const {
+    auto call = std::static_pointer_cast<CallInstr>(fn.body[callIndex]);
+    paramIndices.clear();
+    for (size_t j = callIndex; j > 0 && static_cast<int>(paramIndices.size()) < paramCount; --j) {
+        const auto& instr = fn.body[j - 1];
+        switch (instr->opcode) {
+            case OpCode::PARAM:
+                paramIndices.push_back(j - 1);
+                break;
+            case OpCode::CALL: case OpCode::LABEL: case OpCode::GOTO: case OpCode::IF_GOTO:
+            case OpCode::RETURN: case OpCode::FUNCTION_BEGIN: case OpCode::FUNCTION_END:
+                return false;
+            default:
+                break;
+        }
+    }
+    if (static_cast<int>(paramIndices.size()) != paramCount) return false;
+    std::reverse(paramIndices.begin(), paramIndices.end());
+
+    if (call->params.empty()) return true;
+    if (call->params.size() != paramIndices.size()) return false;
+    for (size_t k = 0; k < paramIndices.size(); ++k) {
+        auto param = std::static_pointer_cast<ParamInstr>(fn.body[paramIndices[k]]);
+        if (!sameArgument(param->param, call->params[k])) return false;
+    }
+    return true;
+}
+
+// 流不敏感的清理：删除结果在整个函数中都不再被读取的运算和赋值，
+// 并去掉无人使用的调用结果，直到不再变化
+std::vector<std::shared_ptr<IRInstr>> DeadArgumentEliminator::pruneDeadComputations(
+    std::vector<std::shared_ptr<IRInstr>> body, int& removed) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        std::unordered_set<std::string> used = usedNames(body);
+        std::vector<std::shared_ptr<IRInstr>> kept;
+        kept.reserve(body.size());
+        for (const auto& instr : body) {
+            bool pure = std::dynamic_pointer_cast<BinaryOpInstr>(instr) || std::dynamic_pointer_cast<UnaryOpInstr>(instr) ||
+                        std::dynamic_pointer_cast<AssignInstr>(instr);
+            if (pure) {
+                auto defs = instr->getDefRegisters();
+                if (!defs.empty() && std::none_of(defs.begin(), defs.end(),
+                                                  [&](const std::string& name) { return used.count(name); })) {
+                    ++removed;
+                    changed = true;
+                    continue;
+                }
+            } else if (auto call = std::dynamic_pointer_cast<CallInstr>(instr)) {
+                if (call->result && !used.count(call->result->name)) {
+                    auto rewritten = std::make_shared<CallInstr>(*call);
+                    rewritten->result = nullptr;
+                    kept.push_back(rewritten);
+                    continue;
+                }
+            }
+            kept.push_back(instr);
+        }
+        body.swap(kept);
+    }
+    return body;
+}
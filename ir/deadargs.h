@@ -0,0 +1,51 @@
+#pragma once
+#include "ir.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ==================== 死参数与无用返回值消除（deadArgumentElimination） ====================
+//
+// 过程间优化遍，只处理main以外、在本模块中定义的函数：
+// - 函数体内从未读取的形参从定义中删除，所有调用点去掉对应的param指令和实参
+// - 所有调用点都不使用结果（例如表达式语句中的调用）的函数改为void，
+//   return不再带值，调用点不再接收结果
+// 改写后在受影响的函数内删除因此不再被使用的计算（只删除无副作用的运算和赋值），
+// 调用方的形参可能随之变为无用，因此迭代到不动点。
+// 某个函数的任一调用点找不到与之匹配的param指令时，该函数保持不变。
+class DeadArgumentEliminator {
+public:
+    struct Stats {
+        int removedParams = 0;      // 删除的形参
+        int removedArgs = 0;        // 删除的调用点实参
+        int voidedFunctions = 0;    // 改为void的函数
+        int removedInstrs = 0;      // 清理掉的无用指令
+    };
+
+    Stats run(std::vector<std::shared_ptr<IRInstr>>& instructions);
+
+private:
+    struct Function {
+        std::shared_ptr<FunctionBeginInstr> begin;
+        std::vector<std::shared_ptr<IRInstr>> body;
+        std::shared_ptr<IRInstr> end;
+        bool touched = false;
+    };
+
+    // 一个调用点：所在函数、call指令下标及其各实参对应的param指令下标
+    struct CallSite {
+        size_t caller;
+        size_t index;
+        std::vector<size_t> paramIndices;
+    };
+
+    std::vector<Function> functions;
+    std::unordered_map<std::string, size_t> functionIndex;
+    Stats stats;
+
+    bool eliminateOnce();
+    bool matchParams(const Function& fn, size_t callIndex, int paramCount, std::vector<size_t>& paramIndices) const;
+    static std::vector<std::shared_ptr<IRInstr>> pruneDeadComputations(
+        std::vector<std::shared_ptr<IRInstr>> body, int& removed);
+};
@@ -0,0 +1,343 @@
+// defuse.cpp - 定义-使用链实现
+#include "defuse.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+using Bits = std::vector<std::uint64_t>;
+
+void setBit(Bits& bits, size_t i) { bits[i / 64] |= std::uint64_t(1) << (i % 64); }
+
+// 置位区间[from, to)
+void setRange(Bits& bits, size_t from, size_t to) {
+    for (; from < to && from % 64; ++from) setBit(bits, from);
+    for (; from + 64 <= to; from += 64) bits[from / 64] = ~std::uint64_t(0);
+    for (; from < to; ++from) setBit(bits, from);
+}
+
+// 按顺序访问区间[from, to)中的置位
+template <typename Fn>
+void forEachSetBit(const Bits& bits, size_t from, size_t to, Fn&& fn) {
+    while (from < to) {
+        std::uint64_t word = bits[from / 64] >> (from % 64);
+        if (!word) {
+            from = (from / 64 + 1) * 64;
+            continue;
+        }
+        from += static_cast<size_t>(std::countr_zero(word));
+        if (from < to) fn(from);
+        ++from;
+    }
+}
+
+// 访问指令中被使用的变量/临时变量操作数字段
+template <typename Fn>
+void forEachUseSlot(const std::shared_ptr<IRInstr>& instr, Fn&& fn) {
+    auto visit = [&](std::shared_ptr<Operand>& op) {
+        if (op && (op->type == OperandType::VARIABLE || op->type == OperandType::TEMP)) fn(op);
+    };
+    if (auto bin = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) {
+        visit(bin->left); visit(bin->right);
+    } else if (auto un = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) {
+        visit(un->operand);
+    } else if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) {
+        visit(assign->source);
+    } else if (auto branch = std::dynamic_pointer_cast<IfGotoInstr>(instr)) {
+        visit(branch->condition);
+    } else if (auto param = std::dynamic_pointer_cast<ParamInstr>(instr)) {
+        visit(param->param);
+    } else if (auto call = std::dynamic_pointer_cast<CallInstr>(instr)) {
+        for (auto& arg : call->params) visit(arg);
+    } else if (auto ret = std::dynamic_pointer_cast<ReturnInstr>(instr)) {
+        visit(ret->value);
+    }
+}
+
+bool endsBlock(OpCode opcode) {
+    return opcode == OpCode::GOTO || opcode == OpCode::IF_GOTO || opcode == OpCode::RETURN;
+}
+
+} // namespace
+
+// ==================== 构建 ====================
+
+DefUseChains::DefUseChains(std::vector<std::shared_ptr<IRInstr>>& instructions)
+    : instructions(instructions),
+      defUses(instructions.size()),
+      instrUses(instructions.size()),
+      removed(instructions.size(), false),
+      inFunction(instructions.size(), false) {
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        if (instructions[i]->opcode != OpCode::FUNCTION_BEGIN) continue;
+        size_t end = i + 1;
+        while (end < instructions.size() && instructions[end]->opcode != OpCode::FUNCTION_END) ++end;
+        if (end == instructions.size()) break;
+        buildFunction(i, end);
+        i = end;
+    }
+}
+
+std::shared_ptr<Operand> DefUseChains::definedOperand(const std::shared_ptr<IRInstr>& instr) {
+    std::shared_ptr<Operand> def;
+    if (auto bin = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) def = bin->result;
+    else if (auto un = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) def = un->result;
+    else if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) def = assign->target;
+    else if (auto call = std::dynamic_pointer_cast<CallInstr>(instr)) def = call->result;
+    if (def && def->type != OperandType::VARIABLE && def->type != OperandType::TEMP) return nullptr;
+    return def;
+}
+
+// begin/end是FUNCTION_BEGIN/FUNCTION_END的下标
+void DefUseChains::buildFunction(size_t begin, size_t end) {
+    // ---------- 基本块：标签（连续的标签属于同一块）或跳转、返回之后开始 ----------
+    Function fn;
+    fn.firstBlock = blockList.size();
+    bool startNew = true;
+    for (size_t i = begin + 1; i < end; ++i) {
+        bool label = instructions[i]->opcode == OpCode::LABEL;
+        if (startNew || (label && instructions[i - 1]->opcode != OpCode::LABEL)) {
+            blockList.push_back(Block());
+            blockList.back().first = i;
+        }
+        blockList.back().last = i + 1;
+        startNew = endsBlock(instructions[i]->opcode);
+        inFunction[i] = true;
+    }
+    fn.lastBlock = blockList.size();
+    if (fn.firstBlock == fn.lastBlock) {
+        functionList.push_back(fn);
+        return;
+    }
+
+    std::unordered_map<std::string, size_t> labelBlock;
+    for (size_t b = fn.firstBlock; b < fn.lastBlock; ++b) {
+        for (size_t i = blockList[b].first; i < blockList[b].last && instructions[i]->opcode == OpCode::LABEL; ++i) {
+            labelBlock[std::static_pointer_cast<LabelInstr>(instructions[i])->label] = b;
+        }
+    }
+    for (size_t b = fn.firstBlock; b < fn.lastBlock; ++b) {
+        Block& block = blockList[b];
+        const auto& last = instructions[block.last - 1];
+        std::shared_ptr<Operand> target;
+        if (auto jump = std::dynamic_pointer_cast<GotoInstr>(last)) target = jump->target;
+        if (auto branch = std::dynamic_pointer_cast<IfGotoInstr>(last)) target = branch->target;
+        if (target) {
+            auto it = labelBlock.find(target->name);
+            if (it != labelBlock.end()) block.succs.push_back(it->second);
+        }
+        bool fallsThrough = last->opcode != OpCode::GOTO && last->opcode != OpCode::RETURN;
+        if (fallsThrough && b + 1 < fn.lastBlock &&
+            std::find(block.succs.begin(), block.succs.end(), b + 1) == block.succs.end()) {
+            block.succs.push_back(b + 1);
+        }
+        for (size_t s : block.succs) blockList[s].preds.push_back(b);
+    }
+
+    // ---------- 逆后序（迭代DFS）：数据流worklist的初始顺序 ----------
+    const size_t blockCount = fn.lastBlock - fn.firstBlock;
+    std::vector<bool> visited(blockCount, false);
+    std::vector<std::pair<size_t, size_t>> stack{{fn.firstBlock, 0}};   // 块，下一个要访问的后继
+    visited[0] = true;
+    while (!stack.empty()) {
+        size_t b = stack.back().first;
+        size_t k = stack.back().second++;
+        if (k < blockList[b].succs.size()) {
+            size_t s = blockList[b].succs[k];
+            if (!visited[s - fn.firstBlock]) {
+                visited[s - fn.firstBlock] = true;
+                stack.emplace_back(s, 0);
+            }
+        } else {
+            fn.order.push_back(b);
+            stack.pop_back();
+        }
+    }
+    std::reverse(fn.order.begin(), fn.order.end());
+    for (size_t b = fn.firstBlock; b < fn.lastBlock; ++b) {
+        if (!visited[b - fn.firstBlock]) fn.order.push_back(b);
+    }
+
+    // ---------- 名字：在某块中先使用、后（或不在块内）定义的名字才参与全局分析 ----------
+    // 其余名字（通常是临时变量）的每个使用都取块内前面最近的定义
+    std::unordered_map<std::string, size_t> nameIds;
+    std::vector<bool> global;
+    std::vector<size_t> definedIn;                 // 名字 -> 最近定义它的块+1（块内扫描用）
+    std::vector<size_t> lastLocal;                 // 名字 -> 块内最近的定义指令
+    auto nameId = [&](const std::string& name) {
+        auto [it, inserted] = nameIds.emplace(name, global.size());
+        if (inserted) {
+            global.push_back(false);
+            definedIn.push_back(0);
+            lastLocal.push_back(0);
+        }
+        return it->second;
+    };
+    for (size_t b = fn.firstBlock; b < fn.lastBlock; ++b) {
+        for (size_t i = blockList[b].first; i < blockList[b].last; ++i) {
+            forEachUseSlot(instructions[i], [&](std::shared_ptr<Operand>& op) {
+                size_t name = nameId(op->name);
+                if (definedIn[name] != b + 1) global[name] = true;
+            });
+            if (auto def = definedOperand(instructions[i])) definedIn[nameId(def->name)] = b + 1;
+        }
+    }
+
+    // ---------- 定义编号：同名的定义编号连续，区间开头是该名字的入口值，kill即清一段区间 ----------
+    const size_t nameCount = global.size();
+    std::vector<size_t> rangeBegin(nameCount + 1, 0);
+    for (size_t i = begin + 1; i < end; ++i) {
+        auto def = definedOperand(instructions[i]);
+        if (def && global[nameIds.at(def->name)]) rangeBegin[nameIds.at(def->name) + 1]++;
+    }
+    for (size_t n = 0; n < nameCount; ++n) {
+        rangeBegin[n + 1] += rangeBegin[n] + (global[n] ? 1 : 0);
+    }
+    const size_t slots = rangeBegin[nameCount];
+    const size_t words = (slots + 63) / 64;
+    std::vector<int> slotInstr(slots, kEntry);     // 编号 -> 定义指令（区间开头为kEntry）
+    std::vector<size_t> nextSlot(nameCount);
+    for (size_t n = 0; n < nameCount; ++n) nextSlot[n] = rangeBegin[n] + 1;
+    std::vector<size_t> defSlot(end - begin, 0);
+    for (size_t i = begin + 1; i < end; ++i) {
+        auto def = definedOperand(instructions[i]);
+        if (!def || !global[nameIds.at(def->name)]) continue;
+        size_t slot = nextSlot[nameIds.at(def->name)]++;
+        slotInstr[slot] = static_cast<int>(i);
+        defSlot[i - begin] = slot;
+    }
+
+    // ---------- 到达定义：out = gen ∪ (in - kill) ----------
+    std::vector<Bits> gen(blockCount, Bits(words, 0)), kill(blockCount, Bits(words, 0));
+    std::fill(definedIn.begin(), definedIn.end(), 0);
+    for (size_t b = 0; b < blockCount; ++b) {
+        const Block& block = blockList[fn.firstBlock + b];
+        std::vector<size_t> defined;               // 块内定义的全局名字
+        for (size_t i = block.first; i < block.last; ++i) {
+            auto def = definedOperand(instructions[i]);
+            if (!def) continue;
+            size_t name = nameIds.at(def->name);
+            if (!global[name]) continue;
+            if (definedIn[name] != fn.firstBlock + b + 1) defined.push_back(name);
+            definedIn[name] = fn.firstBlock + b + 1;
+            lastLocal[name] = i;
+        }
+        for (size_t name : defined) {
+            setRange(kill[b], rangeBegin[name], rangeBegin[name + 1]);
+            setBit(gen[b], defSlot[lastLocal[name] - begin]);
+        }
+    }
+    Bits entry(words, 0);
+    for (size_t n = 0; n < nameCount; ++n) {
+        if (global[n]) setBit(entry, rangeBegin[n]);
+    }
+
+    // worklist按逆后序位置取最靠前的块，out变化时加入后继
+    std::vector<size_t> position(blockCount);
+    for (size_t k = 0; k < fn.order.size(); ++k) position[fn.order[k] - fn.firstBlock] = k;
+    std::vector<Bits> in(blockCount, Bits(words, 0)), out(blockCount, Bits(words, 0));
+    std::set<size_t> worklist;
+    for (size_t k = 0; k < fn.order.size(); ++k) worklist.insert(k);
+    Bits next(words);
+    while (!worklist.empty()) {
+        size_t blockId = fn.order[*worklist.begin()];
+        worklist.erase(worklist.begin());
+        size_t b = blockId - fn.firstBlock;
+        if (b == 0) next = entry;
+        else std::fill(next.begin(), next.end(), 0);
+        for (size_t p : blockList[blockId].preds) {
+            const Bits& predOut = out[p - fn.firstBlock];
+            for (size_t w = 0; w < words; ++w) next[w] |= predOut[w];
+        }
+        in[b] = next;
+        for (size_t w = 0; w < words; ++w) next[w] = gen[b][w] | (next[w] & ~kill[b][w]);
+        if (next == out[b]) continue;
+        out[b].swap(next);
+        for (size_t s : blockList[blockId].succs) worklist.insert(position[s - fn.firstBlock]);
+    }
+
+    // ---------- 逐块顺序建链：块内已定义的名字取最近的定义，否则取块入口的到达定义 ----------
+    std::fill(definedIn.begin(), definedIn.end(), 0);
+    for (size_t b = 0; b < blockCount; ++b) {
+        const Block& block = blockList[fn.firstBlock + b];
+        for (size_t i = block.first; i < block.last; ++i) {
+            forEachUseSlot(instructions[i], [&](std::shared_ptr<Operand>& op) {
+                size_t name = nameIds.at(op->name);
+                Use use;
+                use.instr = i;
+                use.slot = &op;
+                if (definedIn[name] == fn.firstBlock + b + 1) {
+                    use.defs.push_back(static_cast<int>(lastLocal[name]));
+                } else {
+                    forEachSetBit(in[b], rangeBegin[name], rangeBegin[name + 1],
+                                  [&](size_t slot) { use.defs.push_back(slotInstr[slot]); });
+                }
+                instrUses[i].push_back(useList.size());
+                useList.push_back(std::move(use));
+                link(useList.size() - 1);
+            });
+            if (auto def = definedOperand(instructions[i])) {
+                size_t name = nameIds.at(def->name);
+                definedIn[name] = fn.firstBlock + b + 1;
+                lastLocal[name] = i;
+            }
+        }
+    }
+    functionList.push_back(std::move(fn));
+}
+
+// ==================== 查询与改写 ====================
+
+int DefUseChains::uniqueDefinition(size_t useId) const {
+    const auto& defs = useList[useId].defs;
+    return defs.size() == 1 ? defs[0] : -2;
+}
+
+void DefUseChains::link(size_t useId) {
+    for (int d : useList[useId].defs) {
+        if (d != kEntry) defUses[d].push_back(useId);
+    }
+}
+
+void DefUseChains::unlink(size_t useId) {
+    for (int d : useList[useId].defs) {
+        if (d == kEntry) continue;
+        auto& uses = defUses[d];
+        uses.erase(std::remove(uses.begin(), uses.end(), useId), uses.end());
+    }
+}
+
+void DefUseChains::replaceUse(size_t useId, std::shared_ptr<Operand> operand, const std::vector<int>& defs) {
+    unlink(useId);
+    Use& use = useList[useId];
+    *use.slot = std::move(operand);
+    use.defs = defs;
+    link(useId);
+}
+
+void DefUseChains::replaceAllUses(size_t def, const std::shared_ptr<Operand>& operand, const std::vector<int>& defs) {
+    std::vector<size_t> uses = defUses[def];
+    for (size_t useId : uses) replaceUse(useId, operand, defs);
+}
+
+void DefUseChains::erase(size_t instr) {
+    removed[instr] = true;
+    for (size_t useId : instrUses[instr]) {
+        unlink(useId);
+        useList[useId].defs.clear();
+    }
+}
+
+size_t DefUseChains::compact() {
+    size_t kept = 0;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        if (!removed[i]) instructions[kept++] = instructions[i];
+    }
+    size_t count = instructions.size() - kept;
+    instructions.resize(kept);
+    return count;
+}
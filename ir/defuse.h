@@ -0,0 +1,77 @@
+#pragma once
+#include "ir.h"
+#include <memory>
+#include <vector>
+
+// ==================== 定义-使用链 ====================
+//
+// 对模块中每个函数做一次到达定义分析，建立：
+// - 使用-定义链：每个使用（指令中的一个变量/临时变量操作数）可能取到的定义
+// - 定义-使用链：每条定义指令的值可能被哪些使用取到
+// 之后的查询都是O(1)或与链长成正比，不再从某个位置线性扫描指令序列。
+//
+// 定义以指令下标表示，kEntry表示函数入口的值（参数、未初始化的变量）。
+// 改写接口在原指令上就地替换操作数字段或标记删除，并同步更新两个方向的链；
+// 下标在compact()之前保持不变，compact()之后链失效。
+// 跳转目标只在同一函数内解析，函数之外的散指令不建链。
+class DefUseChains {
+public:
+    static constexpr int kEntry = -1;
+
+    struct Use {
+        size_t instr = 0;                          // 使用所在的指令下标
+        std::shared_ptr<Operand>* slot = nullptr;  // 指令中的操作数字段
+        std::vector<int> defs;                     // 到达的定义：指令下标或kEntry
+    };
+
+    struct Block {
+        size_t first = 0, last = 0;                // 指令区间[first, last)
+        std::vector<size_t> succs;
+        std::vector<size_t> preds;
+    };
+
+    // 函数的基本块区间[firstBlock, lastBlock)，firstBlock是入口块
+    struct Function {
+        size_t firstBlock = 0, lastBlock = 0;
+        std::vector<size_t> order;                 // 可达块的逆后序，不可达块按布局排在最后
+    };
+
+    explicit DefUseChains(std::vector<std::shared_ptr<IRInstr>>& instructions);
+
+    // 指令定义的操作数（变量或临时变量），没有定义时为nullptr
+    static std::shared_ptr<Operand> definedOperand(const std::shared_ptr<IRInstr>& instr);
+
+    const std::vector<Block>& blocks() const { return blockList; }
+    const std::vector<Function>& functions() const { return functionList; }
+
+    const Use& use(size_t id) const { return useList[id]; }
+    size_t useCount() const { return useList.size(); }
+    const std::vector<size_t>& usesOf(size_t def) const { return defUses[def]; }   // 定义-使用
+    const std::vector<size_t>& usesIn(size_t instr) const { return instrUses[instr]; }
+    int uniqueDefinition(size_t useId) const;      // 唯一的到达定义，没有或不唯一时为-2
+    bool erased(size_t instr) const { return removed[instr]; }
+    bool covers(size_t instr) const { return inFunction[instr]; }  // 指令在某个函数体内（建了链）
+
+    // 把使用改为operand，defs是新操作数在该处的到达定义（常量为空）
+    void replaceUse(size_t useId, std::shared_ptr<Operand> operand, const std::vector<int>& defs = {});
+    // 把定义def的全部使用改为operand
+    void replaceAllUses(size_t def, const std::shared_ptr<Operand>& operand, const std::vector<int>& defs = {});
+    // 删除指令：它的使用从各定义的使用链中摘除；它自己的定义不应再有使用
+    void erase(size_t instr);
+    // 从指令序列中去掉已删除的指令，返回删除的条数
+    size_t compact();
+
+private:
+    std::vector<std::shared_ptr<IRInstr>>& instructions;
+    std::vector<Use> useList;
+    std::vector<std::vector<size_t>> defUses;      // 指令下标 -> 使用
+    std::vector<std::vector<size_t>> instrUses;    // 指令下标 -> 指令中的使用
+    std::vector<bool> removed;
+    std::vector<bool> inFunction;
+    std::vector<Block> blockList;
+    std::vector<Function> functionList;
+
+    void buildFunction(size_t begin, size_t end);
+    void link(size_t useId);
+    void unlink(size_t useId);
+};
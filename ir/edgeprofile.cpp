@@ -0,0 +1,280 @@
+// edgeprofile.cpp - 边剖析插桩实现
+#include "edgeprofile.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <sstream>
+
+// ==================== 布局描述 ====================
+
+// 格式（行文本，"data"行之后紧跟counterCount个小端64位计数器）：
+//   TOYCPROF edge 1
+//   counters N functions F
+//   function NAME blocks B edges E
+//   b ID NAME            （B行，最后一块为exit）
+//   e SRC DST COUNTER    （E行，COUNTER为'-'表示生成树边）
+//   end
+//   data
+std::string ProfileLayout::describe() const {
+    std::ostringstream out;
+    out << "TOYCPROF edge 1\n";
+    out << "counters " << counterCount << " functions " << functions.size() << "\n";
+    for (const auto& fn : functions) {
+        out << "function " << fn.name << " blocks " << fn.blockNames.size()
+            << " edges " << fn.edges.size() << "\n";
+        for (size_t i = 0; i < fn.blockNames.size(); ++i) {
+            out << "b " << i << " " << fn.blockNames[i] << "\n";
+        }
+        for (const auto& e : fn.edges) {
+            out << "e " << e.src << " " << e.dst << " ";
+            if (e.counter >= 0) out << e.counter;
+            else out << "-";
+            out << "\n";
+        }
+        out << "end\n";
+    }
+    out << "data\n";
+    return out.str();
+}
+
+// ==================== 插桩入口 ====================
+
+ProfileLayout EdgeProfileInstrumenter::instrument(std::vector<std::shared_ptr<IRInstr>>& instructions) {
+    ProfileLayout layout;
+    std::vector<std::shared_ptr<IRInstr>> result;
+    result.reserve(instructions.size() * 5 / 4);
+
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto begin = std::dynamic_pointer_cast<FunctionBeginInstr>(instructions[i]);
+        if (!begin) {
+            result.push_back(instructions[i]);
+            continue;
+        }
+
+        size_t end = i + 1;
+        while (end < instructions.size() && instructions[end]->opcode != OpCode::FUNCTION_END) ++end;
+        if (end == instructions.size()) {
+            // 没有匹配的function end，原样保留
+            result.insert(result.end(), instructions.begin() + i, instructions.end());
+            break;
+        }
+
+        std::vector<std::shared_ptr<IRInstr>> body(instructions.begin() + i + 1, instructions.begin() + end);
+        ProfileFunctionLayout fnLayout;
+        fnLayout.name = begin->funcName;
+
+        result.push_back(begin);
+        auto newBody = instrumentFunction(begin, body, fnLayout);
+        result.insert(result.end(), newBody.begin(), newBody.end());
+        result.push_back(instructions[end]);
+
+        layout.functions.push_back(std::move(fnLayout));
+        i = end;
+    }
+
+    layout.counterCount = nextCounter;
+    instructions.swap(result);
+    return layout;
+}
+
+// ==================== 基本块划分 ====================
+
+// 标签开始新块，goto/if goto/return结束当前块
+std::vector<EdgeProfileInstrumenter::Block> EdgeProfileInstrumenter::splitBlocks(
+    const std::vector<std::shared_ptr<IRInstr>>& body, std::vector<std::string>& blockNames) {
+    std::vector<Block> blocks;
+    Block current;
+
+    for (const auto& instr : body) {
+        if (instr->opcode == OpCode::LABEL && !current.instrs.empty()) {
+            blocks.push_back(std::move(current));
+            current = Block();
+        }
+        current.instrs.push_back(instr);
+        if (instr->opcode == OpCode::GOTO || instr->opcode == OpCode::IF_GOTO ||
+            instr->opcode == OpCode::RETURN) {
+            blocks.push_back(std::move(current));
+            current = Block();
+        }
+    }
+    if (!current.instrs.empty() || blocks.empty()) {
+        blocks.push_back(std::move(current));
+    }
+
+    blockNames.clear();
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        auto label = blocks[b].instrs.empty() ? nullptr
+                                               : std::dynamic_pointer_cast<LabelInstr>(blocks[b].instrs.front());
+        if (label) blockNames.push_back(label->label);
+        else if (b == 0) blockNames.push_back("entry");
+        else blockNames.push_back("bb" + std::to_string(b));
+    }
+    blockNames.push_back("exit");
+    return blocks;
+}
+
+// 按代码布局估计循环深度：每条向后的边[dst, src]视为一个循环区间
+std::vector<int> EdgeProfileInstrumenter::estimateLoopDepths(int blockCount, const std::vector<ProfileEdge>& edges) {
+    std::vector<int> depth(blockCount + 1, 0);
+    for (const auto& e : edges) {
+        if (e.src >= blockCount || e.dst >= blockCount || e.dst > e.src) continue;
+        for (int b = e.dst; b <= e.src; ++b) ++depth[b];
+    }
+    return depth;
+}
+
+std::shared_ptr<Operand> EdgeProfileInstrumenter::newLabel() {
+    return std::make_shared<Operand>(OperandType::LABEL, "Lprof" + std::to_string(nextLabel++));
+}
+
+// ==================== 单个函数插桩 ====================
+
+std::vector<std::shared_ptr<IRInstr>> EdgeProfileInstrumenter::instrumentFunction(
+    const std::shared_ptr<FunctionBeginInstr>& begin,
+    const std::vector<std::shared_ptr<IRInstr>>& body,
+    ProfileFunctionLayout& layout) {
+    std::vector<Block> blocks = splitBlocks(body, layout.blockNames);
+    const int n = static_cast<int>(blocks.size());
+    const int exit = n;
+
+    std::map<std::string, int> labelToBlock;
+    for (int b = 0; b < n; ++b) {
+        for (const auto& instr : blocks[b].instrs) {
+            if (auto label = std::dynamic_pointer_cast<LabelInstr>(instr)) labelToBlock[label->label] = b;
+        }
+    }
+
+    // 建立CFG边
+    std::vector<EdgeKind> kinds;
+    auto addEdge = [&](int src, int dst, EdgeKind kind) {
+        layout.edges.push_back({src, dst, -1});
+        kinds.push_back(kind);
+        if (src < n) blocks[src].outEdges.push_back(static_cast<int>(layout.edges.size()) - 1);
+    };
+    auto targetBlock = [&](const std::shared_ptr<Operand>& target) {
+        auto it = labelToBlock.find(target->name);
+        if (it != labelToBlock.end()) return it->second;
+        *diagnostics << "警告: 函数 " << begin->funcName << " 中跳转目标 " << target->name
+                  << " 不存在，按函数出口处理" << std::endl;
+        return exit;
+    };
+
+    for (int b = 0; b < n; ++b) {
+        int next = b + 1 < n ? b + 1 : exit;
+        auto last = blocks[b].instrs.empty() ? nullptr : blocks[b].instrs.back();
+        if (auto jump = std::dynamic_pointer_cast<GotoInstr>(last)) {
+            addEdge(b, targetBlock(jump->target), EdgeKind::JUMP);
+        } else if (auto branch = std::dynamic_pointer_cast<IfGotoInstr>(last)) {
+            addEdge(b, targetBlock(branch->target), EdgeKind::TAKEN);
+            addEdge(b, next, EdgeKind::FALLTHROUGH);
+        } else if (last && last->opcode == OpCode::RETURN) {
+            addEdge(b, exit, EdgeKind::RETURN);
+        } else {
+            addEdge(b, next, EdgeKind::FALLTHROUGH);
+        }
+    }
+    addEdge(exit, 0, EdgeKind::VIRTUAL);
+
+    // Kruskal最大生成树：估计频率高的边进树（不计数），弦上放计数器
+    std::vector<int> depth = estimateLoopDepths(n, layout.edges);
+    std::vector<double> weight(layout.edges.size());
+    for (size_t e = 0; e < layout.edges.size(); ++e) {
+        const auto& edge = layout.edges[e];
+        if (kinds[e] == EdgeKind::VIRTUAL) {
+            weight[e] = std::numeric_limits<double>::infinity();
+            continue;
+        }
+        int d = std::min(std::min(depth[edge.src], depth[edge.dst]), 6);
+        weight[e] = std::pow(10.0, d);
+        // 成立分支上计数需要额外的跳板块，尽量让它留在树中
+        if (kinds[e] == EdgeKind::TAKEN) weight[e] *= 1.5;
+    }
+
+    std::vector<int> order(layout.edges.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return weight[a] > weight[b]; });
+
+    std::vector<int> parent(n + 1);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&](int x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
+    for (int e : order) {
+        int a = find(layout.edges[e].src);
+        int b = find(layout.edges[e].dst);
+        if (a != b) {
+            parent[a] = b;
+        } else {
+            layout.edges[e].counter = nextCounter++;
+        }
+    }
+
+    // 重写函数体，插入计数指令
+    std::vector<std::shared_ptr<IRInstr>> out;
+    std::vector<std::shared_ptr<IRInstr>> stubs;
+    bool fallsOffEnd = false;
+
+    auto emitCounter = [&](std::vector<std::shared_ptr<IRInstr>>& dest, int e) {
+        if (layout.edges[e].counter >= 0) {
+            dest.push_back(std::make_shared<ProfileCounterInstr>(layout.edges[e].counter));
+        }
+    };
+
+    for (int b = 0; b < n; ++b) {
+        const auto& instrs = blocks[b].instrs;
+        const auto& outEdges = blocks[b].outEdges;
+        auto last = instrs.empty() ? nullptr : instrs.back();
+        OpCode term = last ? last->opcode : OpCode::LABEL;
+
+        if (term == OpCode::GOTO || term == OpCode::RETURN) {
+            out.insert(out.end(), instrs.begin(), instrs.end() - 1);
+            emitCounter(out, outEdges[0]);
+            out.push_back(last);
+        } else if (term == OpCode::IF_GOTO) {
+            out.insert(out.end(), instrs.begin(), instrs.end() - 1);
+            auto branch = std::static_pointer_cast<IfGotoInstr>(last);
+            int taken = outEdges[0];
+            int fall = outEdges[1];
+
+            if (layout.edges[taken].counter >= 0) {
+                // 跳板块: Lprof: profcount k; goto 原目标
+                auto stubLabel = newLabel();
+                auto redirected = std::make_shared<IfGotoInstr>(branch->condition, stubLabel);
+                redirected->loc = branch->loc;
+                out.push_back(redirected);
+                stubs.push_back(std::make_shared<LabelInstr>(stubLabel->name));
+                emitCounter(stubs, taken);
+                auto back = std::make_shared<GotoInstr>(branch->target);
+                back->loc = branch->loc;
+                stubs.push_back(back);
+            } else {
+                out.push_back(last);
+            }
+            emitCounter(out, fall);
+            if (layout.edges[fall].dst == exit) fallsOffEnd = true;
+        } else {
+            out.insert(out.end(), instrs.begin(), instrs.end());
+            emitCounter(out, outEdges[0]);
+            if (layout.edges[outEdges[0]].dst == exit) fallsOffEnd = true;
+        }
+    }
+
+    if (!stubs.empty()) {
+        // 跳板块放在函数末尾；若最后一块会落到函数结尾，先跳过它们
+        std::shared_ptr<Operand> endLabel;
+        if (fallsOffEnd) {
+            endLabel = newLabel();
+            out.push_back(std::make_shared<GotoInstr>(endLabel));
+        }
+        out.insert(out.end(), stubs.begin(), stubs.end());
+        if (endLabel) out.push_back(std::make_shared<LabelInstr>(endLabel->name));
+    }
+    return out;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "ir.h"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ==================== 边剖析插桩（-fprofile-generate） ====================
+//
+// 对每个函数构建CFG，加入虚拟边EXIT->ENTRY后按估计执行频率求最大生成树，
+// 只在生成树之外的边（弦）上插入ProfileCounterInstr。树边的计数由
+// toyc_profdata根据流量守恒（每个块流入=流出）恢复，计数器数量为E-V+1。
+
+struct ProfileEdge {
+    int src = 0;
+    int dst = 0;
+    int counter = -1;  // 计数器下标，-1表示生成树边（运行时不计数）
+};
+
+struct ProfileFunctionLayout {
+    std::string name;
+    std::vector<std::string> blockNames;  // 块编号->块名（首标签或"entry"/"bbN"），最后一个为"exit"
+    std::vector<ProfileEdge> edges;       // 最后一条为虚拟边exit->entry
+
+    int exitBlock() const { return static_cast<int>(blockNames.size()) - 1; }
+};
+
+struct ProfileLayout {
+    std::vector<ProfileFunctionLayout> functions;
+    int counterCount = 0;
+
+    // 布局描述文本：写入目标程序的.rodata，运行时与计数器表一起输出到剖析文件
+    std::string describe() const;
+};
+
+class EdgeProfileInstrumenter {
+public:
+    explicit EdgeProfileInstrumenter(std::ostream& diagnostics = std::cerr) : diagnostics(&diagnostics) {}
+
+    // 就地插桩instructions，返回计数器布局
+    ProfileLayout instrument(std::vector<std::shared_ptr<IRInstr>>& instructions);
+
+private:
+    enum class EdgeKind {
+        FALLTHROUGH,  // 顺序落入下一块（含if不成立的一侧）
+        JUMP,         // goto
+        TAKEN,        // if成立的一侧：需要跳板块才能计数
+        RETURN,       // return到EXIT
+        VIRTUAL       // EXIT->ENTRY
+    };
+
+    struct Block {
+        std::vector<std::shared_ptr<IRInstr>> instrs;
+        std::vector<int> outEdges;  // 按指令顺序：IF_GOTO为{成立边, 不成立边}
+    };
+
+    std::ostream* diagnostics;
+    int nextCounter = 0;
+    int nextLabel = 0;
+
+    std::vector<std::shared_ptr<IRInstr>> instrumentFunction(
+        const std::shared_ptr<FunctionBeginInstr>& begin,
+        const std::vector<std::shared_ptr<IRInstr>>& body,
+        ProfileFunctionLayout& layout);
+
+    std::vector<Block> splitBlocks(const std::vector<std::shared_ptr<IRInstr>>& body,
+                                   std::vector<std::string>& blockNames);
+
+    static std::vector<int> estimateLoopDepths(int blockCount, const std::vector<ProfileEdge>& edges);
+
+    std::shared_ptr<Operand> newLabel();
+};
@@ -0,0 +1,261 @@
+// funcorder.cpp - 调用图驱动的函数排序（C3聚类）
+#include "funcorder.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int kBytesPerIRInstruction = 12;  // 未优化代码生成下每条IR平均约3条RV32指令
+constexpr int kClusterBytes = 4096;         // 簇不超过一页
+constexpr int kMaxLoopDepth = 6;            // 10^深度的上限，避免深层嵌套压倒其他调用点
+constexpr double kRecursionWeight = 10.0;
+
+} // namespace
+
+// ==================== 入口 ====================
+
+FunctionOrderer::Stats FunctionOrderer::run(std::vector<std::shared_ptr<IRInstr>>& instructions) {
+    Stats stats;
+    split(instructions);
+    buildCallGraph(instructions);
+    if (profile) {
+        applyProfile();
+    } else {
+        estimateFrequencies();
+    }
+
+    std::vector<Cluster> clusters = clusterHotFunctions();
+    std::vector<size_t> order;
+    for (const auto& cluster : clusters) {
+        order.insert(order.end(), cluster.members.begin(), cluster.members.end());
+        stats.hotFunctions += static_cast<int>(cluster.members.size());
+    }
+    stats.clusters = static_cast<int>(clusters.size());
+    for (size_t f = 0; f < functions.size(); ++f) {
+        if (functions[f].reachable && functions[f].frequency <= 0.0) {
+            order.push_back(f);
+            ++stats.coldFunctions;
+        }
+    }
+    for (size_t f = 0; f < functions.size(); ++f) {
+        if (!functions[f].reachable) {
+            order.push_back(f);
+            ++stats.unreachableFunctions;
+        }
+    }
+
+    orderedNames.clear();
+    std::vector<std::shared_ptr<IRInstr>> result(loose);
+    result.reserve(instructions.size());
+    for (size_t k = 0; k < order.size(); ++k) {
+        const Function& fn = functions[order[k]];
+        if (order[k] != k) stats.reordered = true;
+        orderedNames.push_back(fn.begin->funcName);
+        result.push_back(fn.begin);
+        result.insert(result.end(), fn.body.begin(), fn.body.end());
+        result.push_back(fn.end);
+    }
+    instructions.swap(result);
+    return stats;
+}
+
+// ==================== 调用图 ====================
+
+void FunctionOrderer::split(const std::vector<std::shared_ptr<IRInstr>>& instructions) {
+    functions.clear();
+    loose.clear();
+    functionIndex.clear();
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto begin = std::dynamic_pointer_cast<FunctionBeginInstr>(instructions[i]);
+        size_t end = i + 1;
+        while (begin && end < instructions.size() && instructions[end]->opcode != OpCode::FUNCTION_END) ++end;
+        if (!begin || end == instructions.size()) {
+            loose.push_back(instructions[i]);
+            continue;
+        }
+        Function fn;
+        fn.begin = begin;
+        fn.body.assign(instructions.begin() + i + 1, instructions.begin() + end);
+        fn.end = instructions[end];
+        fn.bytes = static_cast<int>(fn.body.size() + 2) * kBytesPerIRInstruction;
+        functionIndex.emplace(begin->funcName, functions.size());
+        functions.push_back(std::move(fn));
+        i = end;
+    }
+}
+
+void FunctionOrderer::buildCallGraph(const std::vector<std::shared_ptr<IRInstr>>& instructions) {
+    siteWeights.clear();
+    edgeWeights.clear();
+    std::vector<int> depths = IRAnalyzer::computeLoopDepths(instructions);
+    size_t caller = functions.size();
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        if (auto begin = std::dynamic_pointer_cast<FunctionBeginInstr>(instructions[i])) {
+            auto it = functionIndex.find(begin->funcName);
+            caller = it != functionIndex.end() ? it->second : functions.size();
+            continue;
+        }
+        auto call = std::dynamic_pointer_cast<CallInstr>(instructions[i]);
+        if (!call || caller == functions.size()) continue;
+        auto callee = functionIndex.find(call->funcName);
+        if (callee == functionIndex.end()) continue;
+        siteWeights[{caller, callee->second}] += std::pow(10.0, std::min(depths[i], kMaxLoopDepth));
+    }
+}
+
+// 从root出发的DFS逆后序；标出可达函数和递归（回边的目标）
+std::vector<size_t> FunctionOrderer::reversePostOrder(size_t root) {
+    std::vector<std::vector<size_t>> callees(functions.size());
+    for (const auto& [edge, weight] : siteWeights) callees[edge.first].push_back(edge.second);
+
+    enum class Mark { NONE, ACTIVE, DONE };
+    std::vector<Mark> marks(functions.size(), Mark::NONE);
+    std::vector<size_t> postOrder;
+    std::vector<std::pair<size_t, size_t>> stack{{root, 0}};
+    marks[root] = Mark::ACTIVE;
+    functions[root].reachable = true;
+    while (!stack.empty()) {
+        auto& [node, next] = stack.back();
+        if (next == callees[node].size()) {
+            marks[node] = Mark::DONE;
+            postOrder.push_back(node);
+            stack.pop_back();
+            continue;
+        }
+        size_t callee = callees[node][next++];
+        if (marks[callee] == Mark::ACTIVE) {
+            functions[callee].recursive = true;
+        } else if (marks[callee] == Mark::NONE) {
+            marks[callee] = Mark::ACTIVE;
+            functions[callee].reachable = true;
+            stack.push_back({callee, 0});
+        }
+    }
+    std::reverse(postOrder.begin(), postOrder.end());
+    return postOrder;
+}
+
+// 静态估计：按逆后序传播，回边（递归调用）不参与传播
+void FunctionOrderer::estimateFrequencies() {
+    std::vector<size_t> roots;
+    auto mainIt = functionIndex.find("main");
+    if (mainIt != functionIndex.end()) {
+        roots.push_back(mainIt->second);
+    } else {
+        // 没有main时，没有调用方的函数都视为入口
+        std::vector<bool> called(functions.size(), false);
+        for (const auto& [edge, weight] : siteWeights) {
+            if (edge.first != edge.second) called[edge.second] = true;
+        }
+        for (size_t f = 0; f < functions.size(); ++f) {
+            if (!called[f]) roots.push_back(f);
+        }
+    }
+
+    for (size_t root : roots) {
+        if (functions[root].reachable) continue;
+        std::vector<size_t> rpo = reversePostOrder(root);
+        std::vector<size_t> position(functions.size(), functions.size());
+        for (size_t k = 0; k < rpo.size(); ++k) position[rpo[k]] = k;
+
+        functions[root].frequency = std::max(functions[root].frequency, 1.0);
+        for (size_t f : rpo) {
+            if (functions[f].recursive) functions[f].frequency *= kRecursionWeight;
+            for (auto it = siteWeights.lower_bound({f, 0}); it != siteWeights.end() && it->first.first == f; ++it) {
+                size_t callee = it->first.second;
+                if (position[callee] <= position[f]) continue;
+                functions[callee].frequency += functions[f].frequency * it->second;
+            }
+        }
+    }
+
+    for (const auto& [edge, weight] : siteWeights) {
+        edgeWeights[edge] = functions[edge.first].frequency * weight;
+    }
+}
+
+// 剖析数据：频率为实际调用次数，调用次数按调用方频率×静态权重分摊到各调用方
+void FunctionOrderer::applyProfile() {
+    std::unordered_map<std::string, double> calls;
+    for (const auto& timing : profile->timings) {
+        calls[timing.name] = static_cast<double>(timing.calls);
+    }
+    if (profile->timings.empty()) {
+        for (ProfiledFunction fn : profile->functions) {
+            fn.reconstruct(profile->counters);
+            calls[fn.name] = static_cast<double>(fn.blockCount(static_cast<int>(fn.blocks.size()) - 1));
+        }
+    }
+
+    auto mainIt = functionIndex.find("main");
+    for (size_t f = 0; f < functions.size(); ++f) {
+        auto it = calls.find(functions[f].begin->funcName);
+        functions[f].frequency = it != calls.end() ? it->second : 0.0;
+        if (mainIt == functionIndex.end()) functions[f].reachable = true;
+    }
+    if (mainIt != functionIndex.end()) reversePostOrder(mainIt->second);
+
+    std::vector<double> share(functions.size(), 0.0);
+    for (const auto& [edge, weight] : siteWeights) {
+        share[edge.second] += functions[edge.first].frequency * weight;
+    }
+    for (const auto& [edge, weight] : siteWeights) {
+        double total = share[edge.second];
+        if (total <= 0.0) continue;
+        edgeWeights[edge] = functions[edge.second].frequency * functions[edge.first].frequency * weight / total;
+    }
+}
+
+// ==================== C3聚类 ====================
+
+std::vector<FunctionOrderer::Cluster> FunctionOrderer::clusterHotFunctions() {
+    std::vector<size_t> hot;
+    for (size_t f = 0; f < functions.size(); ++f) {
+        if (functions[f].reachable && functions[f].frequency > 0.0) hot.push_back(f);
+    }
+    std::stable_sort(hot.begin(), hot.end(),
+                     [&](size_t a, size_t b) { return functions[a].frequency > functions[b].frequency; });
+
+    // 每个热函数的主要调用方（调用次数估计最大，且不是自己）
+    std::vector<size_t> bestCaller(functions.size(), functions.size());
+    std::vector<double> bestWeight(functions.size(), 0.0);
+    for (const auto& [edge, weight] : edgeWeights) {
+        auto [caller, callee] = edge;
+        if (caller == callee || !functions[caller].reachable || functions[caller].frequency <= 0.0) continue;
+        if (weight > bestWeight[callee]) {
+            bestWeight[callee] = weight;
+            bestCaller[callee] = caller;
+        }
+    }
+
+    std::vector<Cluster> clusters(functions.size());
+    for (size_t f : hot) {
+        functions[f].cluster = f;
+        clusters[f].members = {f};
+        clusters[f].bytes = functions[f].bytes;
+        clusters[f].weight = functions[f].frequency * functions[f].bytes;
+    }
+    for (size_t f : hot) {
+        size_t caller = bestCaller[f];
+        if (caller == functions.size()) continue;
+        size_t into = functions[caller].cluster, from = functions[f].cluster;
+        if (into == from || clusters[into].bytes + clusters[from].bytes > kClusterBytes) continue;
+        for (size_t member : clusters[from].members) functions[member].cluster = into;
+        clusters[into].members.insert(clusters[into].members.end(), clusters[from].members.begin(),
+                                      clusters[from].members.end());
+        clusters[into].bytes += clusters[from].bytes;
+        clusters[into].weight += clusters[from].weight;
+        clusters[from] = Cluster();
+    }
+
+    std::vector<Cluster> result;
+    for (auto& cluster : clusters) {
+        if (!cluster.members.empty()) result.push_back(std::move(cluster));
+    }
+    std::stable_sort(result.begin(), result.end(), [](const Cluster& a, const Cluster& b) {
+        double da = a.weight / a.bytes, db = b.weight / b.bytes;
+        if (da != db) return da > db;
+        return a.members.front() < b.members.front();
+    });
+    return result;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "ir.h"
+#include "profile/profdata.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ==================== 函数排序（-ffunction-order） ====================
+//
+// 按调用图把经常相互调用的函数排在一起，提高指令缓存和TLB的局部性：
+// - 调用点权重：静态估计为10^循环深度，各函数的执行频率从main沿调用图传播
+//   （递归函数再乘10）；有剖析数据时频率取实际调用次数，每个函数的调用次数
+//   按静态权重分摊到它的各个调用方
+// - C3聚类：按频率从高到低处理热函数，把它并到调用它最多的调用方所在簇的末尾，
+//   簇的估计大小不超过一页；最后按簇的密度（频率×大小/大小）从高到低输出
+// - 剖析中从未调用的冷函数、从main不可达的函数按源码顺序放在最后
+class FunctionOrderer {
+public:
+    struct Stats {
+        int hotFunctions = 0;
+        int clusters = 0;
+        int coldFunctions = 0;          // 剖析中调用次数为0
+        int unreachableFunctions = 0;   // 从main不可达
+        bool reordered = false;
+    };
+
+    // profile为nullptr时使用静态估计；只需要函数调用次数，来自func段或edge段
+    explicit FunctionOrderer(const ProfileData* profile = nullptr) : profile(profile) {}
+
+    Stats run(std::vector<std::shared_ptr<IRInstr>>& instructions);
+
+    // 最近一次run后的函数顺序
+    const std::vector<std::string>& order() const { return orderedNames; }
+
+private:
+    struct Function {
+        std::shared_ptr<FunctionBeginInstr> begin;
+        std::vector<std::shared_ptr<IRInstr>> body;
+        std::shared_ptr<IRInstr> end;
+        int bytes = 0;              // 估计的机器码大小
+        double frequency = 0.0;
+        bool reachable = false;
+        bool recursive = false;     // 调用图中有回到它的环
+        size_t cluster = 0;
+    };
+
+    struct Cluster {
+        std::vector<size_t> members;
+        int bytes = 0;
+        double weight = 0.0;        // sum(频率×大小)
+    };
+
+    const ProfileData* profile;
+    std::vector<Function> functions;
+    std::vector<std::shared_ptr<IRInstr>> loose;   // 函数之外的指令，保持在最前
+    std::unordered_map<std::string, size_t> functionIndex;
+    std::map<std::pair<size_t, size_t>, double> siteWeights;  // (调用方, 被调用方) -> 静态调用点权重之和
+    std::map<std::pair<size_t, size_t>, double> edgeWeights;  // (调用方, 被调用方) -> 调用次数估计
+    std::vector<std::string> orderedNames;
+
+    void split(const std::vector<std::shared_ptr<IRInstr>>& instructions);
+    void buildCallGraph(const std::vector<std::shared_ptr<IRInstr>>& instructions);
+    std::vector<size_t> reversePostOrder(size_t root);
+    void estimateFrequencies();
+    void applyProfile();
+    std::vector<Cluster> clusterHotFunctions();
+};
@@ -0,0 +1,381 @@
+// icf.cpp - 相同代码折叠实现
+#include "icf.h"
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// 参数化合并的门槛：函数体太小时合并收益抵不过调用方多传参数的开销
+const size_t kMinMergeSize = 6;
+// 每组最多引入的额外参数个数；合并后总参数不超过8个，全部走a0-a7
+const size_t kMaxExtraParams = 2;
+const size_t kMaxRegisterParams = 8;
+
+// 按固定顺序访问指令的全部操作数（标签操作数也包括在内）
+template <typename Fn>
+void forEachOperand(const std::shared_ptr<IRInstr>& instr, Fn&& fn) {
+    if (auto bin = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) {
+        fn(bin->result); fn(bin->left); fn(bin->right);
+    } else if (auto un = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) {
+        fn(un->result); fn(un->operand);
+    } else if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) {
+        fn(assign->target); fn(assign->source);
+    } else if (auto jump = std::dynamic_pointer_cast<GotoInstr>(instr)) {
+        fn(jump->target);
+    } else if (auto branch = std::dynamic_pointer_cast<IfGotoInstr>(instr)) {
+        fn(branch->condition); fn(branch->target);
+    } else if (auto param = std::dynamic_pointer_cast<ParamInstr>(instr)) {
+        fn(param->param);
+    } else if (auto call = std::dynamic_pointer_cast<CallInstr>(instr)) {
+        fn(call->result);
+        for (auto& arg : call->params) fn(arg);
+    } else if (auto ret = std::dynamic_pointer_cast<ReturnInstr>(instr)) {
+        fn(ret->value);
+    }
+}
+
+// 浅拷贝一条指令（操作数指针共享），供改写操作数前使用：
+// 指令对象可能被多个函数共用（例如内联时直接复用了原指令）
+std::shared_ptr<IRInstr> cloneInstr(const std::shared_ptr<IRInstr>& instr) {
+    if (auto bin = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) return std::make_shared<BinaryOpInstr>(*bin);
+    if (auto un = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) return std::make_shared<UnaryOpInstr>(*un);
+    if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) return std::make_shared<AssignInstr>(*assign);
+    if (auto jump = std::dynamic_pointer_cast<GotoInstr>(instr)) return std::make_shared<GotoInstr>(*jump);
+    if (auto branch = std::dynamic_pointer_cast<IfGotoInstr>(instr)) return std::make_shared<IfGotoInstr>(*branch);
+    if (auto param = std::dynamic_pointer_cast<ParamInstr>(instr)) return std::make_shared<ParamInstr>(*param);
+    if (auto call = std::dynamic_pointer_cast<CallInstr>(instr)) return std::make_shared<CallInstr>(*call);
+    if (auto ret = std::dynamic_pointer_cast<ReturnInstr>(instr)) return std::make_shared<ReturnInstr>(*ret);
+    return instr;
+}
+
+// 生成改写后的调用：目标改为to，并在实参末尾追加extraArgs
+std::shared_ptr<CallInstr> retargetCall(const std::shared_ptr<CallInstr>& call, const std::string& to,
+                                        const std::vector<std::shared_ptr<Operand>>& extraArgs) {
+    auto rewritten = std::make_shared<CallInstr>(*call);
+    rewritten->funcName = to;
+    rewritten->params.insert(rewritten->params.end(), extraArgs.begin(), extraArgs.end());
+    rewritten->paramCount += static_cast<int>(extraArgs.size());
+    return rewritten;
+}
+
+std::string exactKey(const std::string& shape, const std::vector<int>& constants) {
+    std::string key = shape;
+    key += '|';
+    for (int value : constants) {
+        key += std::to_string(value);
+        key += ',';
+    }
+    return key;
+}
+
+} // namespace
+
+// ==================== 入口 ====================
+
+IdenticalCodeFolder::Stats IdenticalCodeFolder::run(std::vector<std::shared_ptr<IRInstr>>& instructions) {
+    functions.clear();
+    stats = Stats();
+
+    // 切分为函数；函数之外的指令单独成段，原样保留
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto begin = std::dynamic_pointer_cast<FunctionBeginInstr>(instructions[i]);
+        size_t end = i + 1;
+        while (begin && end < instructions.size() && instructions[end]->opcode != OpCode::FUNCTION_END) ++end;
+        if (!begin || end == instructions.size()) {
+            Function loose;
+            loose.body.push_back(instructions[i]);
+            functions.push_back(std::move(loose));
+            continue;
+        }
+        Function fn;
+        fn.begin = begin;
+        fn.body.assign(instructions.begin() + i + 1, instructions.begin() + end);
+        fn.end = instructions[end];
+        functions.push_back(std::move(fn));
+        i = end;
+    }
+
+    bool changed = foldIdentical();
+    while (mergeSimilar()) {
+        changed = true;
+        // 合并改写了调用方，可能又出现完全相同的函数
+        foldIdentical();
+    }
+    if (!changed) return stats;
+
+    std::vector<std::shared_ptr<IRInstr>> result;
+    result.reserve(instructions.size());
+    for (const auto& fn : functions) {
+        if (fn.removed) continue;
+        if (fn.begin) result.push_back(fn.begin);
+        result.insert(result.end(), fn.body.begin(), fn.body.end());
+        if (fn.end) result.push_back(fn.end);
+    }
+    instructions.swap(result);
+    return stats;
+}
+
+// ==================== 规范化 ====================
+
+// 形如"int/2;0 v2 v0 #;21 L0;..."：每条指令为操作码、特有字段和规范化后的操作数
+IdenticalCodeFolder::Signature IdenticalCodeFolder::signatureOf(const Function& fn) const {
+    Signature sig;
+    std::unordered_map<std::string, int> locals;
+    std::unordered_map<std::string, int> labels;
+    for (const auto& param : fn.begin->paramNames) locals.emplace(param, static_cast<int>(locals.size()));
+
+    auto labelId = [&](const std::string& name) {
+        return labels.emplace(name, static_cast<int>(labels.size())).first->second;
+    };
+
+    std::string& shape = sig.shape;
+    shape += fn.begin->returnType;
+    shape += '/';
+    shape += std::to_string(fn.begin->paramNames.size());
+    for (const auto& instr : fn.body) {
+        shape += ';';
+        shape += std::to_string(static_cast<int>(instr->opcode));
+        if (auto label = std::dynamic_pointer_cast<LabelInstr>(instr)) {
+            shape += " L" + std::to_string(labelId(label->label));
+        } else if (auto call = std::dynamic_pointer_cast<CallInstr>(instr)) {
+            shape += call->funcName == fn.begin->funcName ? " @self" : " @" + call->funcName;
+            shape += "," + std::to_string(call->paramCount);
+        } else if (auto counter = std::dynamic_pointer_cast<ProfileCounterInstr>(instr)) {
+            shape += " c" + std::to_string(counter->counterIndex);
+        }
+        forEachOperand(instr, [&](const std::shared_ptr<Operand>& op) {
+            if (!op) {
+                shape += " _";
+            } else if (op->type == OperandType::CONSTANT) {
+                shape += " #";
+                sig.constants.push_back(op->value);
+            } else if (op->type == OperandType::LABEL) {
+                shape += " L" + std::to_string(labelId(op->name));
+            } else {
+                int id = locals.emplace(op->name, static_cast<int>(locals.size())).first->second;
+                shape += (op->type == OperandType::TEMP ? " t" : " v") + std::to_string(id);
+            }
+        });
+    }
+    return sig;
+}
+
+// ==================== 完全相同的函数 ====================
+
+bool IdenticalCodeFolder::foldIdentical() {
+    bool any = false;
+    while (true) {
+        // 同一轮内先收集再改写调用方，保证每个函数的签名都在改写前计算
+        std::unordered_map<std::string, size_t> leaders;
+        std::vector<std::pair<size_t, size_t>> folds;
+        for (size_t i = 0; i < functions.size(); ++i) {
+            const Function& fn = functions[i];
+            if (!fn.begin || fn.removed || fn.begin->funcName == "main") continue;
+            Signature sig = signatureOf(fn);
+            auto inserted = leaders.emplace(exactKey(sig.shape, sig.constants), i);
+            if (!inserted.second) folds.emplace_back(i, inserted.first->second);
+        }
+        if (folds.empty()) return any;
+
+        for (const auto& fold : folds) {
+            functions[fold.first].removed = true;
+            redirectCalls(functions[fold.first].begin->funcName, functions[fold.second].begin->funcName);
+            ++stats.foldedFunctions;
+        }
+        any = true;
+    }
+}
+
+// ==================== 仅常量不同的函数 ====================
+
+// 每次至多合并一组，合并后由调用方重新扫描
+bool IdenticalCodeFolder::mergeSimilar() {
+    std::map<std::string, std::vector<size_t>> groups;
+    std::vector<std::string> order;
+    std::vector<Signature> sigs(functions.size());
+    for (size_t i = 0; i < functions.size(); ++i) {
+        const Function& fn = functions[i];
+        if (!fn.begin || fn.removed || fn.thunk || fn.begin->funcName == "main") continue;
+        if (fn.body.size() < kMinMergeSize) continue;
+        sigs[i] = signatureOf(fn);
+        auto& members = groups[sigs[i].shape];
+        if (members.empty()) order.push_back(sigs[i].shape);
+        members.push_back(i);
+    }
+
+    for (const auto& shape : order) {
+        const std::vector<size_t>& members = groups[shape];
+        if (members.size() < 2) continue;
+        const Function& leader = functions[members.front()];
+
+        // 各成员在同一位置取值相同的常量保持不变；取值组合相同的位置共用一个额外参数
+        size_t slotCount = sigs[members.front()].constants.size();
+        std::map<std::vector<int>, int> tupleToParam;
+        std::vector<std::vector<int>> paramValues;  // [额外参数][成员]
+        std::vector<int> slotParam(slotCount, -1);
+        for (size_t s = 0; s < slotCount; ++s) {
+            std::vector<int> tuple;
+            for (size_t m : members) tuple.push_back(sigs[m].constants[s]);
+            if (std::all_of(tuple.begin(), tuple.end(), [&](int v) { return v == tuple.front(); })) continue;
+            auto it = tupleToParam.emplace(tuple, static_cast<int>(paramValues.size()));
+            if (it.second) paramValues.push_back(tuple);
+            slotParam[s] = it.first->second;
+        }
+        size_t extra = paramValues.size();
+        size_t paramCount = leader.begin->paramNames.size();
+        if (extra == 0 || extra > kMaxExtraParams || paramCount + extra > kMaxRegisterParams) continue;
+
+        // 代价按IR指令条数估计：合并函数本身，加上每个成员改写调用方或保留thunk的较小者
+        size_t bodySize = leader.body.size();
+        size_t thunkSize = paramCount + extra + 2;
+        std::vector<size_t> callSites;
+        size_t cost = bodySize;
+        for (size_t m : members) {
+            callSites.push_back(countCallSites(functions[m].begin->funcName));
+            cost += std::min(callSites.back() * extra, thunkSize);
+        }
+        if (cost >= bodySize * members.size()) continue;
+
+        // 合并函数：复制第一个成员的函数体，把参与参数化的常量换成额外参数
+        std::unordered_set<std::string> taken(leader.begin->paramNames.begin(), leader.begin->paramNames.end());
+        for (const auto& instr : leader.body) {
+            for (const auto& name : instr->getDefRegisters()) taken.insert(name);
+            for (const auto& name : instr->getUseRegisters()) taken.insert(name);
+        }
+        std::vector<std::shared_ptr<Operand>> extraParams;
+        for (size_t j = 0; j < extra; ++j) {
+            std::string name = "icf_k" + std::to_string(j);
+            while (taken.count(name)) name += "_";
+            extraParams.push_back(std::make_shared<Operand>(OperandType::VARIABLE, name));
+        }
+
+        std::string mergedName = uniqueFunctionName(leader.begin->funcName + "_icf");
+        Function merged;
+        merged.begin = std::make_shared<FunctionBeginInstr>(mergedName, leader.begin->returnType);
+        merged.begin->loc = leader.begin->loc;
+        merged.begin->paramNames = leader.begin->paramNames;
+        for (const auto& param : extraParams) merged.begin->paramNames.push_back(param->name);
+        merged.end = std::make_shared<FunctionEndInstr>(mergedName);
+
+        size_t slot = 0;
+        for (const auto& instr : leader.body) {
+            auto copy = cloneInstr(instr);
+            forEachOperand(copy, [&](std::shared_ptr<Operand>& op) {
+                if (!op || op->type != OperandType::CONSTANT) return;
+                if (slotParam[slot] >= 0) op = extraParams[slotParam[slot]];
+                ++slot;
+            });
+            auto call = std::dynamic_pointer_cast<CallInstr>(copy);
+            if (call && call->funcName == leader.begin->funcName) {
+                // 自递归：额外参数原样传递
+                for (const auto& param : extraParams) {
+                    auto paramInstr = std::make_shared<ParamInstr>(param);
+                    paramInstr->loc = call->loc;
+                    merged.body.push_back(paramInstr);
+                }
+                copy = retargetCall(call, mergedName, extraParams);
+            }
+            merged.body.push_back(copy);
+        }
+
+        // 各成员：调用点少时改写调用方并删除，否则保留为thunk
+        for (size_t idx = 0; idx < members.size(); ++idx) {
+            Function& fn = functions[members[idx]];
+            std::vector<int> args;
+            for (const auto& values : paramValues) args.push_back(values[idx]);
+            ++stats.mergedFunctions;
+
+            if (callSites[idx] * extra <= thunkSize) {
+                fn.removed = true;
+                rewriteCallers(fn.begin->funcName, mergedName, args);
+                stats.rewrittenCalls += static_cast<int>(callSites[idx]);
+                continue;
+            }
+
+            std::vector<std::shared_ptr<IRInstr>> thunk;
+            std::vector<std::shared_ptr<Operand>> callArgs;
+            for (const auto& name : fn.begin->paramNames) {
+                callArgs.push_back(std::make_shared<Operand>(OperandType::VARIABLE, name));
+            }
+            for (int value : args) callArgs.push_back(std::make_shared<Operand>(value));
+            for (const auto& arg : callArgs) thunk.push_back(std::make_shared<ParamInstr>(arg));
+            auto result = newTemp();
+            auto call = std::make_shared<CallInstr>(result, mergedName, static_cast<int>(callArgs.size()));
+            call->params = callArgs;
+            thunk.push_back(call);
+            thunk.push_back(std::make_shared<ReturnInstr>(fn.begin->returnType == "void" ? nullptr : result));
+            for (auto& instr : thunk) instr->loc = fn.begin->loc;
+            fn.body = std::move(thunk);
+            fn.thunk = true;
+            ++stats.thunks;
+        }
+
+        functions.insert(functions.begin() + members.front(), std::move(merged));
+        return true;
+    }
+    return false;
+}
+
+// ==================== 调用方改写 ====================
+
+void IdenticalCodeFolder::redirectCalls(const std::string& from, const std::string& to) {
+    rewriteCallers(from, to, {});
+}
+
+void IdenticalCodeFolder::rewriteCallers(const std::string& from, const std::string& to,
+                                         const std::vector<int>& extraArgs) {
+    for (auto& fn : functions) {
+        if (fn.removed) continue;
+        bool touched = std::any_of(fn.body.begin(), fn.body.end(), [&](const std::shared_ptr<IRInstr>& instr) {
+            auto call = std::dynamic_pointer_cast<CallInstr>(instr);
+            return call && call->funcName == from;
+        });
+        if (!touched) continue;
+
+        std::vector<std::shared_ptr<IRInstr>> body;
+        body.reserve(fn.body.size() + extraArgs.size());
+        for (const auto& instr : fn.body) {
+            auto call = std::dynamic_pointer_cast<CallInstr>(instr);
+            if (!call || call->funcName != from) {
+                body.push_back(instr);
+                continue;
+            }
+            // 额外实参紧跟在原有param指令之后
+            std::vector<std::shared_ptr<Operand>> args;
+            for (int value : extraArgs) {
+                args.push_back(std::make_shared<Operand>(value));
+                auto paramInstr = std::make_shared<ParamInstr>(args.back());
+                paramInstr->loc = call->loc;
+                body.push_back(paramInstr);
+            }
+            body.push_back(retargetCall(call, to, args));
+        }
+        fn.body.swap(body);
+    }
+}
+
+// 不计被调函数自身内的递归调用：合并后它们直接调用合并函数
+size_t IdenticalCodeFolder::countCallSites(const std::string& callee) const {
+    size_t count = 0;
+    for (const auto& fn : functions) {
+        if (fn.removed || (fn.begin && fn.begin->funcName == callee)) continue;
+        for (const auto& instr : fn.body) {
+            auto call = std::dynamic_pointer_cast<CallInstr>(instr);
+            if (call && call->funcName == callee) ++count;
+        }
+    }
+    return count;
+}
+
+std::string IdenticalCodeFolder::uniqueFunctionName(const std::string& base) const {
+    std::string name = base;
+    for (int suffix = 1;; ++suffix) {
+        bool clash = std::any_of(functions.begin(), functions.end(), [&](const Function& fn) {
+            return fn.begin && fn.begin->funcName == name;
+        });
+        if (!clash) return name;
+        name = base + std::to_string(suffix);
+    }
+}
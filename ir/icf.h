@@ -0,0 +1,61 @@
+#pragma once
+#include "ir.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ==================== 相同代码折叠（identicalCodeFolding） ====================
+//
+// 模块级优化遍，在其他优化之后运行：
+// - 对每个函数的IR做结构化规范化（参数、变量、临时变量和标签按首次出现的顺序
+//   重新编号，自递归调用记为@self），完全相同的函数只保留一个，调用方改为调用它；
+//   改写调用方后可能产生新的相同函数，因此迭代到不动点
+// - 仅常量不同的近似函数合并为一个带额外参数的函数：不同的常量由新参数传入。
+//   原函数按代价选择改写调用方（每个调用点多传几个常量）或保留为转发到合并函数的thunk
+// main不参与折叠。
+class IdenticalCodeFolder {
+public:
+    struct Stats {
+        int foldedFunctions = 0;   // 因完全相同而删除的函数
+        int mergedFunctions = 0;   // 并入参数化合并函数的函数
+        int thunks = 0;            // 保留为thunk的函数
+        int rewrittenCalls = 0;    // 改写的调用点
+    };
+
+    using TempFactory = std::function<std::shared_ptr<Operand>()>;
+
+    // newTemp用于为thunk创建调用结果的临时变量
+    explicit IdenticalCodeFolder(TempFactory newTemp) : newTemp(std::move(newTemp)) {}
+
+    Stats run(std::vector<std::shared_ptr<IRInstr>>& instructions);
+
+private:
+    // 模块中的一段：函数（begin非空）或函数之外的散指令
+    struct Function {
+        std::shared_ptr<FunctionBeginInstr> begin;
+        std::vector<std::shared_ptr<IRInstr>> body;
+        std::shared_ptr<IRInstr> end;
+        bool removed = false;
+        bool thunk = false;       // 已改为转发到合并函数的thunk，不再参与合并
+    };
+
+    // 规范形式：shape中常量只记作占位符，常量值按出现顺序放在constants中
+    struct Signature {
+        std::string shape;
+        std::vector<int> constants;
+    };
+
+    TempFactory newTemp;
+    std::vector<Function> functions;
+    Stats stats;
+
+    Signature signatureOf(const Function& fn) const;
+    bool foldIdentical();
+    bool mergeSimilar();
+    void redirectCalls(const std::string& from, const std::string& to);
+    void rewriteCallers(const std::string& from, const std::string& to,
+                        const std::vector<int>& extraArgs);
+    size_t countCallSites(const std::string& callee) const;
+    std::string uniqueFunctionName(const std::string& base) const;
+};
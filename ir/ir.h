@@ -23,7 +23,8 @@ enum class OpCode {
     GOTO, IF_GOTO,
     PARAM, CALL, RETURN,
     LABEL,
-    FUNCTION_BEGIN, FUNCTION_END
+    FUNCTION_BEGIN, FUNCTION_END,
+    PROFILE_COUNT
 };
 
 // ==================== 操作数类 ====================
@@ -45,11 +46,32 @@ bool isProcessableReg(const Operand& op);
 std::vector<std::string> extractReg(const std::shared_ptr<Operand>& op);
 std::vector<std::string> collectRegs(const std::initializer_list<std::shared_ptr<Operand>>& ops);
 
+// ==================== 源码位置 ====================
+
+// 指令对应的ToyC源码位置（line为0表示未知，例如编译器合成的指令）
+struct SourceLocation {
+    int line = 0;
+    int column = 0;
+
+    SourceLocation() = default;
+    SourceLocation(int line, int column) : line(line), column(column) {}
+
+    bool isValid() const { return line > 0; }
+    bool operator==(const SourceLocation& other) const {
+        return line == other.line && column == other.column;
+    }
+    bool operator!=(const SourceLocation& other) const { return !(*this == other); }
+
+    // 合并两个位置：相同则保留，否则取较早的一行（用于CSE等合并多条指令的场景）
+    static SourceLocation merge(const SourceLocation& a, const SourceLocation& b);
+};
+
 // ==================== IR指令基类 ====================
 
 class IRInstr {
 public:
     OpCode opcode;
+    SourceLocation loc;
     
     IRInstr(OpCode opcode) : opcode(opcode) {}
     virtual ~IRInstr();
@@ -287,6 +309,25 @@ public:
     }
 };
 
+// 插桩计数：将剖析计数器表中的第counterIndex项加一（-fprofile-generate）
+class ProfileCounterInstr : public IRInstr {
+public:
+    int counterIndex;
+
+    ProfileCounterInstr(int counterIndex)
+        : IRInstr(OpCode::PROFILE_COUNT), counterIndex(counterIndex) {}
+
+    std::string toString() const override;
+
+    std::vector<std::string> getDefRegisters() override {
+        return {};
+    }
+
+    std::vector<std::string> getUseRegisters() override {
+        return {};
+    }
+};
+
 // ==================== IR工具类 ====================
 
 class IRPrinter {
@@ -296,16 +337,6 @@ public:
 
 class IRAnalyzer {
 public:
-    static int findDefinition(const std::vector<std::shared_ptr<IRInstr>>& instructions, 
-                             const std::string& operandName);
-                             
-    static std::vector<int> findUses(const std::vector<std::shared_ptr<IRInstr>>& instructions, 
-                                   const std::string& operandName);
-                                   
-    static bool isVariableLive(const std::vector<std::shared_ptr<IRInstr>>& instructions,
-                              const std::string& varName,
-                              int position);
-                              
     static std::vector<std::string> getDefinedVariables(const std::shared_ptr<IRInstr>& instr);
     
     static std::vector<std::string> getUsedVariables(const std::shared_ptr<IRInstr>& instr);
@@ -317,6 +348,7 @@ public:
     static bool isPureFunction(const std::vector<std::shared_ptr<IRInstr>>& instructions);
     static int countInstructions(const std::vector<std::shared_ptr<IRInstr>>& instructions);
 
-    static void replaceUsedVariable(std::shared_ptr<IRInstr>& instr, 
-                            const std::string& oldVar, const std::string& newVar);
+    // 每条指令所在的循环嵌套深度：同一函数内跳回前面标签的goto/if-goto构成一个循环区间，
+    // 深度为包含该指令的区间个数（ToyC的循环都是结构化的，足以近似自然循环）
+    static std::vector<int> computeLoopDepths(const std::vector<std::shared_ptr<IRInstr>>& instructions);
 };
\ No newline at end of file
@@ -1,7 +1,13 @@
 // irgen.cpp - 实现IR生成器和优化器
 #include "irgen.h"
 #include "ir.h"
+#include "deadargs.h"
+#include "icf.h"
+#include "superblock.h"
+#include "defuse.h"
+#include "cfgsimplify.h"
 #include <set>
+#include <cstdint>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
@@ -56,6 +62,14 @@ std::vector<std::string> collectRegs(
 
 IRInstr::~IRInstr() = default;
 
+// 合并源码位置：任一方未知时取另一方，两者不同时取较早出现的位置
+SourceLocation SourceLocation::merge(const SourceLocation& a, const SourceLocation& b) {
+    if (!a.isValid()) return b;
+    if (!b.isValid()) return a;
+    if (a.line != b.line) return a.line < b.line ? a : b;
+    return a.column <= b.column ? a : b;
+}
+
 std::vector<std::string> IRInstr::getDefRegisters() {
     return {};
 }
@@ -170,8 +184,14 @@ std::string LabelInstr::toString() const {
 }
 
 // FunctionBeginInstr toString方法 - 表示函数定义开始
+// 格式: function int add(a, b) begin，保留返回类型和形参以便IRParser读回
 std::string FunctionBeginInstr::toString() const {
-    return "function " + funcName + " begin";
+    std::string params;
+    for (size_t i = 0; i < paramNames.size(); ++i) {
+        if (i > 0) params += ", ";
+        params += paramNames[i];
+    }
+    return "function " + returnType + " " + funcName + "(" + params + ") begin";
 }
 
 // FunctionEndInstr toString方法 - 表示函数定义结束
@@ -179,6 +199,11 @@ std::string FunctionEndInstr::toString() const {
     return "function " + funcName + " end";
 }
 
+// ProfileCounterInstr toString方法 - 表示剖析计数器加一
+std::string ProfileCounterInstr::toString() const {
+    return "profcount " + std::to_string(counterIndex);
+}
+
 //------------------------------------------------------------------------------
 // IR生成器核心方法
 //------------------------------------------------------------------------------
@@ -203,6 +228,36 @@ void IRGenerator::generate(std::shared_ptr<CompUnit> ast) {
     }
 }
 
+/**
+ * 直接载入现成的IR指令（例如由IRParser从文本读入）。
+ * 
+ * 用于跳过前端，直接对IR运行optimize()和代码生成。会根据已有的
+ * t<N>/L<N>名字推进临时变量和标签计数器，避免优化遍新建的名字与之冲突。
+ * 
+ * @param instrs 要载入的IR指令
+ */
+void IRGenerator::loadInstructions(const std::vector<std::shared_ptr<IRInstr>>& instrs) {
+    instructions = instrs;
+
+    auto bumpCounter = [](const std::string& name, char prefix, int& counter) {
+        if (name.size() < 2 || name.size() > 10 || name[0] != prefix) return;
+        if (!std::all_of(name.begin() + 1, name.end(),
+                         [](char c) { return c >= '0' && c <= '9'; })) return;
+        counter = std::max(counter, std::stoi(name.substr(1)) + 1);
+    };
+
+    for (const auto& instr : instructions) {
+        for (const auto& name : instr->getDefRegisters()) bumpCounter(name, 't', tempCount);
+        for (const auto& name : instr->getUseRegisters()) bumpCounter(name, 't', tempCount);
+
+        if (auto label = std::dynamic_pointer_cast<LabelInstr>(instr)) {
+            bumpCounter(label->label, 'L', labelCount);
+        } else if (auto call = std::dynamic_pointer_cast<CallInstr>(instr)) {
+            markFunctionAsUsed(call->funcName);
+        }
+    }
+}
+
 /**
  * 创建一个新的临时变量。
  * 
@@ -233,6 +288,9 @@ std::shared_ptr<Operand> IRGenerator::createLabel() {
  * @param instr 要添加的指令
  */
 void IRGenerator::addInstruction(std::shared_ptr<IRInstr> instr) {
+    if (!instr->loc.isValid()) {
+        instr->loc = currentLoc;
+    }
     instructions.push_back(instr);
 }
 
@@ -246,7 +304,7 @@ void IRGenerator::addInstruction(std::shared_ptr<IRInstr> instr) {
  */
 std::shared_ptr<Operand> IRGenerator::getTopOperand() {
     if (operandStack.empty()) {
-        std::cerr << "Error: Operand stack is empty" << std::endl;
+        *config.diagnostics << "Error: Operand stack is empty" << std::endl;
         return std::make_shared<Operand>(0); // 默认返回常量0
     }
     
@@ -390,7 +448,7 @@ std::shared_ptr<Operand> IRGenerator::getVariable(const std::string& name, bool
 void IRGenerator::dumpIR(const std::string& filename) const {
     std::ofstream outFile(filename);
     if (!outFile) {
-        std::cerr << "Error: Could not open file " << filename << " for writing" << std::endl;
+        *config.diagnostics << "Error: Could not open file " << filename << " for writing" << std::endl;
         return;
     }
     
@@ -405,24 +463,66 @@ void IRGenerator::dumpIR(const std::string& filename) const {
 /**
  * 优化生成的IR。
  * 
- * 对IR指令应用各种优化技术。
+ * 按config.pipeline中的顺序执行各优化遍（见ir/pipeline_presets.inc）。
  */
 void IRGenerator::optimize() {
-     // 基本优化
-    constantFolding();              // 常量折叠
-    constantPropagationCFG();       // 常量传播
-    copyPropagationCFG();           // 复制传播
-    
-    // 循环优化
-    loopInvariantCodeMotion();      // 新增：循环不变量外提
-    
-    // 函数优化
-    functionInlining();             // 新增：函数内联
-    
-    // 其他优化
-    commonSubexpressionElimination(); // 公共子表达式消除
-    deadCodeElimination();          // 死代码消除
-    controlFlowOptimization();      // 控制流优化
+    for (const auto& pass : config.pipeline.passes) {
+        runPass(pass);
+    }
+}
+
+/**
+ * 优化遍注册表。
+ * 
+ * 名字用于runPass()、流水线预设和--time-report等按遍统计的场合；
+ * 顺序与"default"预设一致。
+ */
+const std::vector<IRGenerator::PassEntry>& IRGenerator::passRegistry() {
+    static const std::vector<PassEntry> registry = {
+        // 基本优化
+        {"constantFolding", &IRGenerator::constantFolding},                 // 常量折叠
+        {"constantPropagationCFG", &IRGenerator::constantPropagationCFG},   // 常量传播
+        {"copyPropagationCFG", &IRGenerator::copyPropagationCFG},           // 复制传播
+        // 循环优化
+        {"loopInvariantCodeMotion", &IRGenerator::loopInvariantCodeMotion}, // 循环不变量外提
+        {"superblockFormation", &IRGenerator::superblockFormation},         // 超块形成（尾复制）
+        // 函数优化
+        {"functionInlining", &IRGenerator::functionInlining},               // 函数内联
+        {"deadArgumentElimination", &IRGenerator::deadArgumentElimination}, // 死参数与无用返回值消除
+        // 其他优化
+        {"commonSubexpressionElimination", &IRGenerator::commonSubexpressionElimination}, // 公共子表达式消除
+        {"deadCodeElimination", &IRGenerator::deadCodeElimination},         // 死代码消除
+        {"controlFlowOptimization", &IRGenerator::controlFlowOptimization}, // 控制流优化
+        // 模块级优化：在各函数优化完成后比较函数体
+        {"identicalCodeFolding", &IRGenerator::identicalCodeFolding},       // 相同代码折叠
+    };
+    return registry;
+}
+
+std::vector<std::string> IRGenerator::passNames() {
+    std::vector<std::string> names;
+    for (const auto& pass : passRegistry()) {
+        names.push_back(pass.name);
+    }
+    return names;
+}
+
+/**
+ * 按名字执行单个优化遍，前后通知passListener。
+ * 
+ * @param name 优化遍名字（见passRegistry）
+ * @return 名字存在时返回true
+ */
+bool IRGenerator::runPass(const std::string& name) {
+    for (const auto& pass : passRegistry()) {
+        if (name != pass.name) continue;
+
+        if (passListener) passListener->beforePass(name, instructions);
+        (this->*pass.run)();
+        if (passListener) passListener->afterPass(name, instructions);
+        return true;
+    }
+    return false;
 }
 
 /**
@@ -479,6 +579,7 @@ void IRGenerator::constantFolding() {
                     // 用赋值指令替换原二元操作指令
                     auto constResult = std::make_shared<Operand>(result);
                     auto assignInstr = std::make_shared<AssignInstr>(binOp->result, constResult);
+                    assignInstr->loc = binOp->loc;
                     instructions[i] = assignInstr;
                 }
             }
@@ -500,6 +601,7 @@ void IRGenerator::constantFolding() {
                     // 用赋值指令替换原一元操作指令
                     auto constResult = std::make_shared<Operand>(result);
                     auto assignInstr = std::make_shared<AssignInstr>(unaryOp->result, constResult);
+                    assignInstr->loc = unaryOp->loc;
                     instructions[i] = assignInstr;
                 }
             }
@@ -516,10 +618,10 @@ void IRGenerator::constantFolding() {
 /*
 *   常量传播优化
 *
-*   基于基本块 + 控制流图（CFG）+ 数据流分析 的实现
+*   基于定义-使用链（defuse.h）的稀疏实现
 */
 
-// --- Lattice / ConstMap ---
+// --- Lattice ---
 enum class LatticeKind { Unknown, Constant, Top };  // 三态：未知 / 常量 / 冲突
 
 struct LatticeValue {
@@ -533,248 +635,12 @@ struct LatticeValue {
     bool operator!=(const LatticeValue& o) const { return !(*this == o); }  // != 运算符重载
 };
 
-using ConstMap = std::unordered_map<std::string, LatticeValue>;
-
-// ---------- 帮助函数（用于比较两个constMap是否语义等价） ----------
-static bool constMapsEqual(const ConstMap& a, const ConstMap& b) {
-
-    // 将缺失的键视为Unknown状态
-    if (a.size() == b.size()) {
-        for (auto& [k, v] : a) {
-            auto it = b.find(k);
-            if (it == b.end()) return false;        // 键不一致直接返回false
-            if (v != it->second) return false;      // 值不一致直接返回false
-        }
-        return true;    // 所有键值对完全匹配
-    }
-
-    // 大小不同时：仍需检查键的并集
-    std::unordered_set<std::string> keys;   // 存储所有键的集合
-    for (auto& [k,_] : a) keys.insert(k);   // 收集a的键
-    for (auto& [k,_] : b) keys.insert(k);   // 收集b的键
-    for (auto& k : keys) {
-        auto ita = a.find(k);
-        auto itb = b.find(k);
-        // 若键不存在则使用默认LatticeValue(即Unknown)
-        LatticeValue va = (ita == a.end() ? LatticeValue{} : ita->second);
-        LatticeValue vb = (itb == b.end() ? LatticeValue{} : itb->second);
-        if (va != vb) return false;     // 存在不匹配的值
-    }
-    return true;    // 所有键的对应值语义等价
-}
-
-// 在循环中对于回边的特殊处理
-using BlockID = int;
-std::vector<std::pair<BlockID, BlockID>> findBackEdges(
-    const std::unordered_map<BlockID, std::vector<BlockID>>& cfg) 
-{
-    std::vector<std::pair<BlockID, BlockID>> backEdges;     // 存储回边结果
-    std::unordered_set<BlockID> visited;                    // 记录已访问的块
-    std::vector<BlockID> stack;                             // DFS递归栈，用于检测回边
-
-    // DFS遍历函数（Lambda表达式）
-    std::function<void(BlockID)> dfs = [&](BlockID b) {
-        visited.insert(b);      // 标记当前块为已访问
-        stack.push_back(b);     // 将当前块压入DFS栈
-
-        // 遍历当前块的所有后继
-        for (auto succ : cfg.at(b)) {
-            // 情况1：后继块在DFS栈中 -> 发现回边
-            if (std::find(stack.begin(), stack.end(), succ) != stack.end()) {
-                backEdges.emplace_back(b, succ);
-            } 
-            // 情况2：后继块未访问 -> 递归处理
-            else if (!visited.count(succ)) {
-                dfs(succ);
-            }
-        }
-
-        stack.pop_back();   // 回溯：当前块处理完毕，弹出栈
-    };
-
-    // 对所有未访问的块启动DFS
-    for (auto& kv : cfg) {
-        if (!visited.count(kv.first)) {
-            dfs(kv.first);
-        }
-    }
-    return backEdges;
-}
-
-/**
- * 获取循环体内定义的所有变量集合（循环定义变量分析）。
- * 通过遍历从循环入口到回边的所有基本块，收集其中被赋值的变量名。
- * 
- * @param cfg 控制流图（BlockID -> 后继块列表）
- * @param fromBlk 回边的起始块（循环体出口）
- * @param toBlk 回边的目标块（循环体入口）
- * @param blocks 基本块集合（BlockID -> Block结构体）
- * @return 包含循环体内所有被赋值变量名的集合
- */
-std::unordered_set<std::string> IRGenerator::getLoopDefs(
-    const std::unordered_set<BlockID>& loopBlocks,
-    const std::unordered_map<BlockID, IRGenerator::BasicBlock>& blocks)
-{
-    std::unordered_set<std::string> defs;   // 存储结果：循环内所有被赋值的变量名
-
-    // 遍历循环体内的每一个基本块
-    for (auto blkId : loopBlocks) {
-        // 查找当前块ID对应的基本块对象
-        auto it = blocks.find(blkId);
-        if (it == blocks.end()) continue; // 没找到块，跳过
-
-        // 遍历当前块的所有指令
-        for (auto& inst : it->second.instructions) {
-            // 检查是否为赋值指令
-            if (auto assignInstr = std::dynamic_pointer_cast<AssignInstr>(inst)) {
-                // 记录被赋值的变量名
-                defs.insert(assignInstr->target->name);
-            }
-        }
-    }
-    return defs;
-}
-
-/**
- * 获取由回边(fromBlk→toBlk)定义的循环体内的所有基本块ID集合
- * 
- * @param cfg 控制流图（BlockID -> 后继列表）
- * @param fromBlk 回边的起始块ID（循环体出口）
- * @param toBlk 回边的目标块ID（循环体入口）
- * @return 包含循环体内所有块ID的无序集合
- */
-std::unordered_set<int> IRGenerator::getLoopBlocks(
-    const std::unordered_map<int, std::vector<int>>& cfg,
-    int fromBlk, int toBlk)
-{
-    // 构建反向CFG
-    std::unordered_map<int, std::vector<int>> predMap;
-    for (auto& kv : cfg) {
-        int u = kv.first;
-        for (int v : kv.second) {
-            predMap[v].push_back(u);
-        }
-    }
-
-    // 反向遍历识别循环体
-    // 从 fromBlk 出发沿反向边走
-    std::unordered_set<int> loopBlocks;
-    std::stack<int> st;
-
-    // 初始化：回边两端一定在循环体内
-    st.push(fromBlk);
-    loopBlocks.insert(toBlk); // 循环入口一定在循环内
-    loopBlocks.insert(fromBlk);
-
-    while (!st.empty()) {
-        int cur = st.top();
-        st.pop();
-
-        // 遍历当前块的所有前驱
-        for (int pred : predMap[cur]) {
-            if (loopBlocks.count(pred)) continue;   // 已处理则跳过
-            loopBlocks.insert(pred);
-            // 关键限制：不越过循环入口（避免包含外部块）
-            if (pred != toBlk) {
-                st.push(pred);
-            }
-        }
-    }
-
-    return loopBlocks;
-}
-
-
-/**
- * 清除指定基本块在循环中定义的变量的常量状态，将其标记为未知（Unknown）。
- * 用于处理循环体中对变量的重新定义，确保数据流分析的保守性。
- * 
- * @param inMap 当前块的输入常量映射表（将被修改）
- * @param loopDefs 预计算的各循环块中定义的变量集合（BlockID -> 变量名集合）
- * @param block 当前处理的基本块ID
- */
-void clearLoopDefs(ConstMap& inMap, 
-    const std::unordered_map<BlockID, std::unordered_set<std::string>>& loopDefs,
-    BlockID block) 
-{
-    // 查找当前块是否属于某个循环定义域
-    auto it = loopDefs.find(block);
-    if (it != loopDefs.end()) {
-        // 遍历该循环块中所有被定义的变量
-        for (auto& var : it->second) {
-            // 强制将变量状态设为未知（覆盖可能的常量传播结果）
-            inMap[var] = {LatticeKind::Unknown, 0}; 
-        }
-    }
-}
-
-
-// meet (合并) 两个 ConstMap：对每个变量，如果两个都是同一常量，则保留，否则 Unknown/Top 规则
-static ConstMap meetMaps(const ConstMap& A, const ConstMap& B) {
-    ConstMap R;     // 结果映射表
-
-    // 1. 收集所有键的并集
-    std::unordered_set<std::string> keys;
-    for (auto& p : A) keys.insert(p.first);
-    for (auto& p : B) keys.insert(p.first);
-
-    // 2. 对每个键进行合并操作
-    for (auto& k : keys) {
-        // 获取两个映射表中该键的值（不存在则视为Unknown）
-        auto ita = A.find(k);
-        auto itb = B.find(k);
-        LatticeValue va = (ita == A.end() ? LatticeValue{} : ita->second);
-        LatticeValue vb = (itb == B.end() ? LatticeValue{} : itb->second);
-
-        // 根据值的类型进行合并  
-        // 情况1：两者都是常量值     
-        if (va.kind == LatticeKind::Constant && vb.kind == LatticeKind::Constant) { 
-            if (va.constantValue == vb.constantValue) {
-                R[k] = va;
-            } else {
-                R[k] = LatticeValue{LatticeKind::Top, 0};
-            }
-        } 
-        // 情况2：一方是Unknown，直接取另一方的值（Unknown不影响结果）
-        else if (va.kind == LatticeKind::Unknown) {
-            R[k] = vb;
-        } 
-        else if (vb.kind == LatticeKind::Unknown) {
-            R[k] = va;
-        } 
-        // 情况3：其他情况（至少一方是Top，或类型组合不明确）
-        else {
-            if (va.kind == LatticeKind::Top || vb.kind == LatticeKind::Top) {
-                R[k] = LatticeValue{LatticeKind::Top, 0};
-            } else {
-                R[k] = LatticeValue{LatticeKind::Top, 0};
-            }
-        }
-    }
-    return R;
-}
-
-// 将 Operand 转换为 LatticeValue（使用当前 env）
-static LatticeValue valueOfOperand(const std::shared_ptr<Operand>& op, const ConstMap& env) {
-
-    // 1. 处理空指针情况：返回Unknown表示无效操作数
-    if (!op) return LatticeValue{LatticeKind::Unknown, 0};
-
-    // 2. 处理常量类型操作数
-    if (op->type == OperandType::CONSTANT) {
-        return LatticeValue{LatticeKind::Constant, op->value};
-    } 
-    // 3. 处理变量或临时变量
-    else if (op->type == OperandType::VARIABLE || op->type == OperandType::TEMP) {
-        auto it = env.find(op->name);
-        if (it == env.end()) return LatticeValue{LatticeKind::Unknown, 0};
-        return it->second;
-    } 
-    // 4. 处理其他类型操作数(如函数调用、指针等)
-    else {
-        // 返回Top表示"可能任何值"(最不精确状态)
-        return LatticeValue{LatticeKind::Top, 0};
-    }
+// 格上的交汇：Unknown是单位元，不同的常量交汇为Top
+static LatticeValue meetLattice(const LatticeValue& a, const LatticeValue& b) {
+    if (a.kind == LatticeKind::Unknown) return b;
+    if (b.kind == LatticeKind::Unknown) return a;
+    if (a == b) return a;
+    return LatticeValue{LatticeKind::Top, 0};
 }
 
 // 尝试计算二元运算的常量（如果两边常量且 op 可计算）
@@ -1108,711 +974,141 @@ void IRGenerator::buildCFG(std::vector<std::shared_ptr<BasicBlock>>& blocks) {
     }
 }
 
-// ---------- transfer function：基于当前 env 更新 env（顺序应用 block 内指令） ----------
-void applyTransferToEnv(ConstMap& env, const std::shared_ptr<IRInstr>& instr) {
-
-    // AssignInstr
-    if (auto assignInstr = std::dynamic_pointer_cast<AssignInstr>(instr)) {
-        // 如果 source 是常量，直接写常量
-        if (assignInstr->source->type == OperandType::CONSTANT) {
-            env[assignInstr->target->name] = LatticeValue{LatticeKind::Constant, assignInstr->source->value};
-        } else if (assignInstr->source->type == OperandType::VARIABLE || assignInstr->source->type == OperandType::TEMP) {
-            // 如果 source 在 env 中是常量，赋值传播，否则变 Top
-            auto it = env.find(assignInstr->source->name);
-            if (it != env.end() && it->second.kind == LatticeKind::Constant) {
-                env[assignInstr->target->name] = it->second;
-            } else if (it != env.end() && it->second.kind == LatticeKind::Unknown) {
-                env[assignInstr->target->name] = LatticeValue{LatticeKind::Unknown, 0};
-            } else {
-                env[assignInstr->target->name] = LatticeValue{LatticeKind::Top, 0};
-            }
-        } else {
-            // 来源复杂（如 memory），置 Top
-            env[assignInstr->target->name] = LatticeValue{LatticeKind::Top, 0};
-        }
-    } 
-    // BinaryOpInstr
-    else if (auto binOp = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) {
-        // 尝试如果左右都是常量，则计算结果
-        auto L = valueOfOperand(binOp->left, env);
-        auto R = valueOfOperand(binOp->right, env);
-        if (L.kind == LatticeKind::Constant && R.kind == LatticeKind::Constant) {
-            int outv;
-            if (tryEvalBinaryOp(binOp, L.constantValue, R.constantValue, outv)) {
-                env[binOp->result->name] = LatticeValue{LatticeKind::Constant, outv};
-            } else {
-                env[binOp->result->name] = LatticeValue{LatticeKind::Top, 0};
-            }
-        } else if (L.kind == LatticeKind::Unknown || R.kind == LatticeKind::Unknown) {
-            env[binOp->result->name] = LatticeValue{LatticeKind::Unknown, 0};
-        } else {
-            env[binOp->result->name] = LatticeValue{LatticeKind::Top, 0};
-        }
-    } 
-    // UnaryOpInstr
-    else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) {
-        auto V = valueOfOperand(unaryOp->operand, env);
-        if (V.kind == LatticeKind::Constant) {
-
-            // 按照对应的操作符执行操作
-            int outv = V.constantValue;
-            if(unaryOp->opcode == OpCode::NEG) outv = -outv;
-            else if(unaryOp->opcode == OpCode::NOT) outv = !outv;
-
-            env[unaryOp->result->name] = LatticeValue{LatticeKind::Constant, outv};
-        } else if (V.kind == LatticeKind::Unknown) {
-            env[unaryOp->result->name] = LatticeValue{LatticeKind::Unknown, 0};
-        } else {
-            env[unaryOp->result->name] = LatticeValue{LatticeKind::Top, 0};
-        }
-    } 
-    // CallInstr
-    else if (auto callInstr = std::dynamic_pointer_cast<CallInstr>(instr)) {
-        // 保守处理：函数调用可能有副作用，result 置 Top；如果你能保证调用不影响其他变量，可优化
-        if (callInstr->result) env[callInstr->result->name] = LatticeValue{LatticeKind::Top, 0};
-    } 
-    // 其他指令
-    else {
-        // GotoInstr / IfGotoInstr / ParamInstr / ReturnInstr / LabelInstr / FunctionBeginInstr / FunctionEndInstr
-        // 不会产生新的定义，因此 env 保持不变
-    }
-}
-
-// ---------- 主分析与替换（CFG 版常量传播） ----------
-void IRGenerator::constantPropagationCFG() {
-    // 1. 构建 basic blocks 与 CFG
-    auto blocks = buildBasicBlocks();
-    buildCFG(blocks);
-
-    int n = (int)blocks.size();
-    if (n == 0) return;
-
-    // 生成 CFG 映射：BlockID -> 后继列表
-    std::unordered_map<int, std::vector<int>> cfg;
-    for (auto& b : blocks) {
-        std::vector<int> succIds;
-        for (auto& s : b->successors) {
-            succIds.push_back(s->id);
-        }
-        cfg[b->id] = std::move(succIds);
-    }
-
-    // 2. 找回边
-    auto backEdges = findBackEdges(cfg);
-
-    // 3. 针对回边，找循环体内所有定义变量集合
-    //    这里需要一个 BlockID -> BasicBlock 映射方便访问
-    std::unordered_map<int, IRGenerator::BasicBlock> blocksMap;
-    for (auto& b : blocks) blocksMap[b->id] = *b;
-    
-
-    // 循环入口块ID -> 循环内所有定义变量集合
-    std::unordered_map<int, std::unordered_set<std::string>> loopDefs;
-    for (auto& edge : backEdges) {
-        int fromBlk = edge.first;
-        int toBlk = edge.second;
-
-        //auto defs = getLoopDefs(cfg, fromBlk, toBlk, blocksMap);
-
-        // 用 getLoopBlocks 得到该回边的自然循环块集合
-        auto loopBlocks = getLoopBlocks(cfg, fromBlk, toBlk);
-
-        // 收集该循环体内所有定义变量
-        auto defs = getLoopDefs(loopBlocks, blocksMap);
-
-        // 合并 defs 到 loopDefs，key用循环入口块ID（toBlk）
-        auto& defSet = loopDefs[toBlk];
-        defSet.insert(defs.begin(), defs.end());
-
-    }
-
-    // 4. 初始化 in/out map
-    std::vector<ConstMap> inMap(n), outMap(n);
-
-    // 5. worklist（初始把入口块放入）
-    std::queue<int> q;
-    // 假定 blocks[0] 是入口（如果函数有多入口或特殊结构需修改）
-    q.push(0);
-
-    std::unordered_set<int> clearedLoops; // 记录已清理的循环入口块
-    while (!q.empty()) {
-        int bid = q.front(); q.pop();
-        auto blk = blocks[bid];
-
-        // 计算 inMap[bid]
-        // in[bid] = meet(out[pred]) for all predecessors
-        if (blk->predecessors.empty()) {
-            inMap[bid].clear();
-        } else {
-            ConstMap accum;
-            bool first = true;
-            for (auto& p : blk->predecessors) {
-                if (first) {
-                    accum = outMap[p->id];
-                    first = false;
-                } else {
-                    accum = meetMaps(accum, outMap[p->id]);
-                }
-            }
-
-            // 清除循环定义变量的常量状态（只有循环入口块才清除）
-            /*if (loopDefs.count(bid)) {
-                clearLoopDefs(accum, loopDefs, bid);
-            }*/
-
-            // 只对未清理的循环入口块做清理
-            if (loopDefs.count(bid) && clearedLoops.count(bid) == 0) {
-                clearLoopDefs(accum, loopDefs, bid);
-                clearedLoops.insert(bid);
-            }
-
-            inMap[bid] = accum;
-        }
-
-
-        // 计算 outMap[bid]
-        // out = transfer(in, block.instructions)
-        ConstMap outEnv = inMap[bid];
-        for (auto& instr : blk->instructions) {
-            applyTransferToEnv(outEnv, instr);
-        }
-
-        // 如果 out 改变，更新并把所有后继放入队列
-        if (!constMapsEqual(outEnv, outMap[bid])) {
-            outMap[bid] = outEnv;
-            for (auto& succ : blk->successors) q.push(succ->id);
-        }
-    }
-
-    // 6. 用 inMap 替换每个基本块内部可确定为常量的操作数（在替换时顺序应用 transfer）
-    for (int bid = 0; bid < n; ++bid) {
-
-        // 获取当前块的常量环境（inMap）和基本块对象
-        ConstMap env = inMap[bid];
-        auto blk = blocks[bid];
-
-        // 遍历块中的每条指令
-        for (auto& instr : blk->instructions) {
-            // 处理赋值指令
-            if (auto assignInstr = std::dynamic_pointer_cast<AssignInstr>(instr)) {
-                // 检查源操作数是否为变量/临时变量
-                if (assignInstr->source->type == OperandType::VARIABLE || assignInstr->source->type == OperandType::TEMP) {
-                    // 在环境查找变量状态
-                    auto it = env.find(assignInstr->source->name);
-                    // 如果是常量则替换为常量操作数
-                    if (it != env.end() && it->second.kind == LatticeKind::Constant) {
-                        assignInstr->source = makeConstantOperand(it->second.constantValue, assignInstr->source->name);
-                    }
-                }
-            } 
-            // 处理二元运算指令
-            else if (auto binOp = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) {
-                // 检查左操作数
-                if (binOp->left->type == OperandType::VARIABLE || binOp->left->type == OperandType::TEMP) {
-                    auto it = env.find(binOp->left->name);
-                    if (it != env.end() && it->second.kind == LatticeKind::Constant) {
-                        binOp->left = makeConstantOperand(it->second.constantValue, binOp->left->name);
-                    }
-                }
-                // 检查右操作数
-                if (binOp->right->type == OperandType::VARIABLE || binOp->right->type == OperandType::TEMP) {
-                    auto it = env.find(binOp->right->name);
-                    if (it != env.end() && it->second.kind == LatticeKind::Constant) {
-                        binOp->right = makeConstantOperand(it->second.constantValue, binOp->right->name);
-                    }
-                }
-            } 
-            // 处理一元运算指令
-            else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) {
-                if (unaryOp->operand->type == OperandType::VARIABLE || unaryOp->operand->type == OperandType::TEMP) {
-                    auto it = env.find(unaryOp->operand->name);
-                    if (it != env.end() && it->second.kind == LatticeKind::Constant) {
-                        unaryOp->operand = makeConstantOperand(it->second.constantValue, unaryOp->operand->name);
-                    }
-                }
-            } 
-            // 处理参数传递指令
-            else if (auto paramInstr = std::dynamic_pointer_cast<ParamInstr>(instr)) {
-                if (paramInstr->param->type == OperandType::VARIABLE || paramInstr->param->type == OperandType::TEMP) {
-                    auto it = env.find(paramInstr->param->name);
-                    if (it != env.end() && it->second.kind == LatticeKind::Constant) {
-                        paramInstr->param = makeConstantOperand(it->second.constantValue, paramInstr->param->name);
-                    }
-                }
-            } 
-            // 处理函数调用指令
-            else if (auto callInstr = std::dynamic_pointer_cast<CallInstr>(instr)) {
-                for (auto& arg : callInstr->params) {
-                    if (arg->type == OperandType::VARIABLE || arg->type == OperandType::TEMP) {
-                        auto it = env.find(arg->name);
-                        if (it != env.end() && it->second.kind == LatticeKind::Constant) {
-                            arg = makeConstantOperand(it->second.constantValue, arg->name);
-                        }
-                    }
-                }
-            } 
-            // 处理返回指令
-            else if (auto returnInstr = std::dynamic_pointer_cast<ReturnInstr>(instr)) {
-                if (returnInstr->value && (returnInstr->value->type == OperandType::VARIABLE || returnInstr->value->type == OperandType::TEMP)) {
-                    auto it = env.find(returnInstr->value->name);
-                    if (it != env.end() && it->second.kind == LatticeKind::Constant) {
-                        returnInstr->value = makeConstantOperand(it->second.constantValue, returnInstr->value->name);
-                    }
-                }
-            } 
-            // 处理条件跳转指令
-            else if (auto ifg = std::dynamic_pointer_cast<IfGotoInstr>(instr)) {
-                if (ifg->condition->type == OperandType::VARIABLE || ifg->condition->type == OperandType::TEMP) {
-                    auto it = env.find(ifg->condition->name);
-                    if (it != env.end() && it->second.kind == LatticeKind::Constant) {
-                        ifg->condition = makeConstantOperand(it->second.constantValue, ifg->condition->name);
-                    }
-                }
-            }
-            // 逐条指令应用 transfer，使 env 随 block 内顺序更新（保守，保持一致）
-            applyTransferToEnv(env, instr);
-        }
-    }
-
-    // 7. 再执行常量折叠（已有的函数）
-    constantFolding();
-}
-
-
-/**
- * 执行死代码消除优化（Dead Code Elimination, DCE）
- * 算法步骤：
- * 1. 构建基本块和控制流图（CFG）
- * 2. 计算每个基本块的use和def集合
- * 3. 迭代计算live_in和live_out集合（数据流分析）
- * 4. 反向扫描指令，删除未被使用的定义
- */
-void IRGenerator::deadCodeElimination() {
-    // ========== Step 0: 构建CFG ==========
-    auto basicBlocks = buildBasicBlocks();
-    buildCFG(basicBlocks);
-
-    // ========== Step 1: 收集use/def集合 ==========
-    std::unordered_map<std::shared_ptr<BasicBlock>, std::unordered_set<std::string>> use, def;
-    for (auto& block : basicBlocks) {
-        for (auto& instr : block->instructions) {
-            // 获取当前指令定义和使用的变量
-            auto defs = IRAnalyzer::getDefinedVariables(instr);
-            auto uses = IRAnalyzer::getUsedVariables(instr);
-
-            // 构建use集合：变量在被定义前被使用
-            for (auto& u : uses) {
-                if (def[block].find(u) == def[block].end()) {
-                    use[block].insert(u);
-                }
-            }
-
-            // 构建def集合：当前指令定义的所有变量
-            for (auto& d : defs) {
-                def[block].insert(d);
-            }
-        }
-    }
-
-
-    // ========== MODIFIED: Tarjan算法识别循环(SCC) ==========
-    std::unordered_map<std::shared_ptr<BasicBlock>, int> indexMap;
-    std::unordered_map<std::shared_ptr<BasicBlock>, int> lowlink;
-    std::unordered_set<std::shared_ptr<BasicBlock>> onStack;
-    std::stack<std::shared_ptr<BasicBlock>> tarjanStack;    // 存储所有强连通分量（SCC）
-    int indexCounter = 0;
-    std::vector<std::vector<std::shared_ptr<BasicBlock>>> sccList;
-
-    // Tarjan的DFS实现
-    std::function<void(std::shared_ptr<BasicBlock>)> tarjan = [&](std::shared_ptr<BasicBlock> v) {
-        indexMap[v] = ++indexCounter;
-        lowlink[v] = indexMap[v];
-        tarjanStack.push(v);
-        onStack.insert(v);
-
-        // 遍历后继节点
-        for (auto w : v->successors) {
-            if (!indexMap.count(w)) {   // 未访问过的节点
-                tarjan(w);  
-                lowlink[v] = std::min(lowlink[v], lowlink[w]);
-            } else if (onStack.count(w)) {  // 已在栈中的节点（形成环）
-                lowlink[v] = std::min(lowlink[v], indexMap[w]);
-            }
-        }
-
-        // 发现SCC（lowlink[v] == indexMap[v]表示找到一个强连通分量）
-        if (lowlink[v] == indexMap[v]) {
-            std::vector<std::shared_ptr<BasicBlock>> scc;
-            while (!tarjanStack.empty()) {
-                auto w = tarjanStack.top();
-                tarjanStack.pop();
-                onStack.erase(w);
-                scc.push_back(w);
-                if (w == v) break;  // 弹出直到当前节点
-            }
-            sccList.push_back(std::move(scc));
-        }
-    };
-
-    // 对所有块执行Tarjan算法
-    for (auto& b : basicBlocks) {
-        if (!indexMap.count(b)) tarjan(b);
-    }
-
-    // 建立块到SCC的映射（block -> SCC ID）
-    std::unordered_map<std::shared_ptr<BasicBlock>, int> blockToScc;
-    for (int i = 0; i < (int)sccList.size(); ++i) {
-        for (auto& b : sccList[i]) blockToScc[b] = i;
-    }
-
-    // 预计算每个SCC的出口块（后继不在同一SCC的块）
-    std::unordered_map<int, std::unordered_set<std::shared_ptr<BasicBlock>>> sccExitBlocks;
-    for (int i = 0; i < (int)sccList.size(); ++i) {
-        for (auto& b : sccList[i]) {
-            for (auto& succ : b->successors) {
-                if (blockToScc[succ] != i) {
-                    sccExitBlocks[i].insert(succ);
-                }
-            }
-        }
-    }
-
-    
-
-    // Step 2: 计算活跃变量（live_in和live_out）
-    std::unordered_map<std::shared_ptr<BasicBlock>, std::unordered_set<std::string>> live_in, live_out;
-
-    // 初始化 worklist（逆序放入所有块）
-    std::queue<std::shared_ptr<BasicBlock>> worklist;
-    std::unordered_set<std::shared_ptr<BasicBlock>> inQueue;
-    for (auto it = basicBlocks.rbegin(); it != basicBlocks.rend(); ++it) {
-        worklist.push(*it);
-        inQueue.insert(*it);
-    }
-
-    while (!worklist.empty()) {
-        auto block = worklist.front();
-        worklist.pop();
-        inQueue.erase(block);
-
-        // live_out = 后继的 live_in 并集
-        std::unordered_set<std::string> new_live_out;
-        
-        // MODIFIED: 区分普通边和回边（循环内部边）
-        int thisScc = -1;
-        if (blockToScc.count(block)) thisScc = blockToScc[block];
-
-        for (auto succ : block->successors) {
-            int succScc = -1;
-            if (blockToScc.count(succ)) succScc = blockToScc[succ];
-
-            if (thisScc != -1 && succScc == thisScc) {
-                // 边属于同一 SCC —— 可能是回边或 SCC 内部边
-                // 将该 SCC 的所有出口块的 live_in 注入 new_live_out
-                for (auto exitBlk : sccExitBlocks[thisScc]) {
-                    new_live_out.insert(live_in[exitBlk].begin(), live_in[exitBlk].end());
-                }
-                // 同时也可以合并 succ 本身的 live_in（保险起见）
-                new_live_out.insert(live_in[succ].begin(), live_in[succ].end());
-            } else {
-                // 普通边（跨 SCC）：直接合并后继的live_in
-                new_live_out.insert(live_in[succ].begin(), live_in[succ].end());
-            }
-        }
-
-
-        // live_in = use ∪ (live_out - def)
-        std::unordered_set<std::string> new_live_in = use[block];
-        for (auto& var : new_live_out) {
-            if (def[block].find(var) == def[block].end()) {
-                new_live_in.insert(var);
-            }
-        }
-
-        // 如果有变化，更新并把前驱加入队列
-        if (new_live_in != live_in[block] || new_live_out != live_out[block]) {
-            live_in[block] = std::move(new_live_in);
-            live_out[block] = std::move(new_live_out);
-
-            for (auto pred : block->predecessors) {
-                if (!inQueue.count(pred)) {
-                    worklist.push(pred);
-                    inQueue.insert(pred);
-                }
-            }
-        }
-    }
-
-
-
-    // Step 3: 反向删除死代码
-    for (auto& block : basicBlocks) {
-        auto live = live_out[block];    // 初始化为基本块出口的活跃变量集合
-
-        // 反向遍历指令（从后往前）
-        for (auto it = block->instructions.rbegin(); it != block->instructions.rend(); ) {
-            auto defs = IRAnalyzer::getDefinedVariables(*it);
-            auto uses = IRAnalyzer::getUsedVariables(*it);
-
-            bool hasSideEffect = isSideEffectInstr(*it);    // 检查是否是副作用指令
-
-            // 判断当前指令是否定义了活跃变量
-            bool isLive = false;
-            for (auto& d : defs) {
-                if (live.find(d) != live.end()) {
-                    isLive = true;
-                    break;
-                }
-            }
-
-            // 删除条件：1. 未定义活跃变量 2. 无副作用 3. 实际有定义（避免删除空指令）
-            if (!isLive && !hasSideEffect && !defs.empty()) {
-                // 删除死代码
-                it = decltype(it){ block->instructions.erase(std::next(it).base()) };
-                continue;
-            }
-
-            // 更新 live 集合
-            for (auto& d : defs) {
-                live.erase(d);      // 定义的变量不再活跃
-            }
-            for (auto& u : uses) {
-                live.insert(u);     // 使用的变量变为活跃
-            }
-
-            ++it;
-        }
-    }
-
-    this->instructions.clear();
-    for (auto& block : basicBlocks) {
-        for (auto& instr : block->instructions) {
-            this->instructions.push_back(instr);
-        }
-    }
-
-}
-
-
-/**
- * 判断指令是否具有副作用
- * 有副作用的指令包括：
- * - 函数调用（可能修改外部状态）
- * - 控制流指令（跳转、返回等）
- * - 标签和函数边界指令
- * - 参数传递指令
- */
-bool IRGenerator::isSideEffectInstr(const std::shared_ptr<IRInstr>& instr) {
-    return
-        std::dynamic_pointer_cast<CallInstr>(instr) != nullptr ||               // 函数调用
-        std::dynamic_pointer_cast<ReturnInstr>(instr) != nullptr ||             // 返回指令
-        std::dynamic_pointer_cast<GotoInstr>(instr) != nullptr ||               // 无条件跳转
-        std::dynamic_pointer_cast<IfGotoInstr>(instr) != nullptr ||             // 条件跳转
-        std::dynamic_pointer_cast<LabelInstr>(instr) != nullptr ||              // 标签
-        std::dynamic_pointer_cast<FunctionBeginInstr>(instr) != nullptr ||      // 函数开始
-        std::dynamic_pointer_cast<FunctionEndInstr>(instr) != nullptr ||        // 函数结束
-        std::dynamic_pointer_cast<ParamInstr>(instr) != nullptr;                // 参数传递
-}
-
-// 复制传播优化实现
-// 复制传播状态类型：变量到变量的映射
-//using CopyMap = std::unordered_map<std::string, std::string>;
-using CopyMap = std::map<std::string, std::string>;
-
-// 稳定比较函数
-bool copyMapEqual(const CopyMap& a, const CopyMap& b) {
-    if (a.size() != b.size()) return false;
-    for (auto itA = a.begin(), itB = b.begin(); itA != a.end(); ++itA, ++itB) {
-        if (itA->first != itB->first || itA->second != itB->second) return false;
-    }
-    return true;
-}
-
-
-// 合并两个 CopyMap：求交集，只有两边相同映射保留
-CopyMap meetCopyMaps(const CopyMap& a, const CopyMap& b) {
-    CopyMap result;
-    for (auto& [var, mappedVar] : a) {
-        auto it = b.find(var);
-        if (it != b.end() && it->second == mappedVar) {
-            result[var] = mappedVar;
-        }
-    }
-    return result;
-}
-
-// 迁移函数：根据指令更新 CopyMap
-/*void applyCopyTransfer(CopyMap& env, const std::shared_ptr<IRInstr>& instr) {
-
-    // 简化：只处理简单赋值 instr: x = y
-    if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) {
-        auto defVar = assign->target->name;
-        // 如果赋值是简单复制
-        if (assign->isSimpleCopy()) { // 你需要实现判断是否简单复制的接口，比如源操作数是变量而非常量表达式
-            auto srcVar = assign->source->name;
-            env[defVar] = srcVar;
-        } else {
-            // 非复制赋值，变量重新定义，去除之前映射
-            env.erase(defVar);
-            // 这里简化不处理映射链中其他变量映射到defVar的情况
-        }
-    } else {
-        // 其它指令可能定义变量，需删除对应映射
-        auto defs = IRAnalyzer::getDefinedVariables(instr);
-        for (auto& d : defs) {
-            env.erase(d);
-        }
-    }
-}*/
-void applyCopyTransfer(CopyMap& env, const std::shared_ptr<IRInstr>& instr) {
-    if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) {
-        auto defVar = assign->target->name;
-
-        if (assign->isSimpleCopy()) {
-            auto srcVar = assign->source->name;
-
-            // 1. 删除所有映射中指向 defVar 的条目（防止旧映射失效后残留）
-            for (auto it = env.begin(); it != env.end(); ) {
-                if (it->second == defVar) {
-                    it = env.erase(it);
-                } else {
-                    ++it;
-                }
-            }
-
-            // 2. 检查是否会产生映射环（比如 srcVar 最终映射回 defVar）
-            /*std::string cur = srcVar;
-            while (env.find(cur) != env.end()) {
-                cur = env[cur];
-                if (cur == defVar) {
-                    // 发现环路，不能建立映射，直接清理 defVar
-                    env.erase(defVar);
-                    return;
-                }
-            }*/
-            // === 修改点1：映射环检测改用访问集合防止死循环 ===
-            std::unordered_set<std::string> visited;   // 记录访问过的变量
-            std::string cur = srcVar;
-            while (env.find(cur) != env.end()) {
-                if (visited.count(cur)) {
-                    // 访问过，检测到环，停止查找，防止死循环
-                    break;
-                }
-                visited.insert(cur);
-
-                cur = env[cur];
-                if (cur == defVar) {
-                    // 发现环路，不能建立映射，直接清理 defVar 映射，返回
-                    env.erase(defVar);
-                    return;
-                }
-            }
-
-            // 3. 更新映射
-            env[defVar] = srcVar;
-        } else {
-            // 非简单复制，变量重新定义，删除 defVar 及指向 defVar 的映射
-            env.erase(defVar);
-            for (auto it = env.begin(); it != env.end(); ) {
-                if (it->second == defVar) {
-                    it = env.erase(it);
-                } else {
-                    ++it;
-                }
-            }
-        }
-    } else {
-        // 对于其它指令，删除所有定义变量对应的映射以及指向它们的映射
-        auto defs = IRAnalyzer::getDefinedVariables(instr);
-        for (auto& d : defs) {
-            env.erase(d);
-            for (auto it = env.begin(); it != env.end(); ) {
-                if (it->second == d) {
-                    it = env.erase(it);
-                } else {
-                    ++it;
-                }
-            }
-        }
-    }
-}
-
-
-// 替换指令中使用变量，根据 CopyMap 做替换
-void replaceCopyUses(std::shared_ptr<IRInstr>& instr, const CopyMap& env) {
-    // 遍历指令所有使用变量，替换成映射变量（递归替换直到不变）
-    auto uses = IRAnalyzer::getUsedVariables(instr);
-    for (auto& useVar : uses) {
-        std::string cur = useVar;
-        while (env.find(cur) != env.end()) {
-            cur = env.at(cur);
-        }
-        IRAnalyzer::replaceUsedVariable(instr, useVar, cur);
-    }
-}
-
-// 在给定指令 instr 中，将所有使用的变量名 useVar 替换为新的变量名 cur
-void IRAnalyzer::replaceUsedVariable(std::shared_ptr<IRInstr>& instr, 
-    const std::string& oldVar, 
-    const std::string& newVar) 
-{
+/**
+ * 基于定义-使用链的稀疏常量传播
+ * 算法步骤：
+ * 1. 建立定义-使用链，所有定义的值初始为Unknown（乐观假设，循环中不变的常量也能传播）
+ * 2. worklist：定义的值变化时，只重新计算使用它的定义指令
+ * 3. 使用处的值是所有到达定义的交汇，为常量时替换为常量操作数，再执行常量折叠
+ */
+void IRGenerator::constantPropagationCFG() {
+    DefUseChains chains(instructions);
+    std::vector<LatticeValue> values(instructions.size());     // 定义指令 -> 定义的值
 
-    // 1. 赋值指令
-    if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) {
-        if (assign->source->type == OperandType::VARIABLE || assign->source->type == OperandType::TEMP) {
-            if (assign->source->name == oldVar) {
-                assign->source->name = newVar;
-            }
+    // 函数入口的值（参数、未初始化的变量）视为Top
+    auto valueOfUse = [&](size_t useId) {
+        LatticeValue v;
+        for (int d : chains.use(useId).defs) {
+            v = meetLattice(v, d == DefUseChains::kEntry ? LatticeValue{LatticeKind::Top, 0} : values[d]);
         }
-    }
-    // 2. 二元运算指令
-    else if (auto binOp = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) {
-        if ((binOp->left->type == OperandType::VARIABLE || binOp->left->type == OperandType::TEMP) &&
-        binOp->left->name == oldVar) {
-            binOp->left->name = newVar;
+        return v;
+    };
+    auto valueOfOperand = [&](const std::shared_ptr<Operand>& op, size_t instr) {
+        if (op->type == OperandType::CONSTANT) return LatticeValue{LatticeKind::Constant, op->value};
+        for (size_t useId : chains.usesIn(instr)) {
+            if (chains.use(useId).slot == &op) return valueOfUse(useId);
         }
-        if ((binOp->right->type == OperandType::VARIABLE || binOp->right->type == OperandType::TEMP) &&
-        binOp->right->name == oldVar) {
-            binOp->right->name = newVar;
+        return LatticeValue{LatticeKind::Top, 0};
+    };
+
+    auto evaluate = [&](size_t i) {
+        const auto& instr = instructions[i];
+        if (auto assignInstr = std::dynamic_pointer_cast<AssignInstr>(instr)) {
+            return valueOfOperand(assignInstr->source, i);
         }
-    }
-    // 3. 一元运算指令
-    else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) {
-        if ((unaryOp->operand->type == OperandType::VARIABLE || unaryOp->operand->type == OperandType::TEMP) &&
-        unaryOp->operand->name == oldVar) {
-            unaryOp->operand->name = newVar;
+        if (auto binOp = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) {
+            auto L = valueOfOperand(binOp->left, i);
+            auto R = valueOfOperand(binOp->right, i);
+            if (L.kind == LatticeKind::Constant && R.kind == LatticeKind::Constant) {
+                int outv;
+                if (tryEvalBinaryOp(binOp, L.constantValue, R.constantValue, outv)) {
+                    return LatticeValue{LatticeKind::Constant, outv};
+                }
+                return LatticeValue{LatticeKind::Top, 0};
+            }
+            if (L.kind == LatticeKind::Top || R.kind == LatticeKind::Top) return LatticeValue{LatticeKind::Top, 0};
+            return LatticeValue{};
         }
-    }
-    // 4. 参数传递指令
-    else if (auto paramInstr = std::dynamic_pointer_cast<ParamInstr>(instr)) {
-        if ((paramInstr->param->type == OperandType::VARIABLE || paramInstr->param->type == OperandType::TEMP) &&
-        paramInstr->param->name == oldVar) {
-            paramInstr->param->name = newVar;
+        if (auto unaryOp = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) {
+            auto V = valueOfOperand(unaryOp->operand, i);
+            if (V.kind != LatticeKind::Constant) return V;
+            int outv = V.constantValue;
+            if (unaryOp->opcode == OpCode::NEG) outv = -outv;
+            else if (unaryOp->opcode == OpCode::NOT) outv = !outv;
+            return LatticeValue{LatticeKind::Constant, outv};
         }
+        // 函数调用的返回值
+        return LatticeValue{LatticeKind::Top, 0};
+    };
+
+    std::vector<size_t> worklist;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        if (chains.covers(i) && DefUseChains::definedOperand(instructions[i])) worklist.push_back(i);
     }
-    // 5. 函数调用指令
-    else if (auto callInstr = std::dynamic_pointer_cast<CallInstr>(instr)) {
-        for (auto& arg : callInstr->params) {
-            if ((arg->type == OperandType::VARIABLE || arg->type == OperandType::TEMP) &&
-            arg->name == oldVar) {
-                arg->name = newVar;
-            }
+    while (!worklist.empty()) {
+        size_t i = worklist.back();
+        worklist.pop_back();
+        LatticeValue v = evaluate(i);
+        if (v == values[i]) continue;
+        values[i] = v;
+        for (size_t useId : chains.usesOf(i)) {
+            size_t user = chains.use(useId).instr;
+            if (DefUseChains::definedOperand(instructions[user])) worklist.push_back(user);
         }
     }
-    // 6. 条件跳转指令
-    else if (auto ifg = std::dynamic_pointer_cast<IfGotoInstr>(instr)) {
-        if ((ifg->condition->type == OperandType::VARIABLE || ifg->condition->type == OperandType::TEMP) &&
-        ifg->condition->name == oldVar) {
-            ifg->condition->name = newVar;
-        }
+
+    for (size_t useId = 0; useId < chains.useCount(); ++useId) {
+        LatticeValue v = valueOfUse(useId);
+        if (v.kind != LatticeKind::Constant) continue;
+        chains.replaceUse(useId, makeConstantOperand(v.constantValue, (*chains.use(useId).slot)->name));
+    }
+
+    constantFolding();
+}
+
+
+/**
+ * 基于定义-使用链的死代码消除（Dead Code Elimination, DCE）
+ * 没有副作用、定义的值没有任何使用的指令是死代码。删除一条指令后，
+ * 它所使用的值的定义可能随之失去最后一个使用，放回worklist继续检查
+ */
+void IRGenerator::deadCodeElimination() {
+    DefUseChains chains(instructions);
+    auto isDead = [&](size_t i) {
+        return chains.covers(i) && !chains.erased(i) && !isSideEffectInstr(instructions[i]) &&
+               DefUseChains::definedOperand(instructions[i]) && chains.usesOf(i).empty();
+    };
+
+    std::vector<size_t> worklist;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        if (isDead(i)) worklist.push_back(i);
     }
-    // 7. 返回指令
-    else if (auto retInstr = std::dynamic_pointer_cast<ReturnInstr>(instr)) {
-        if (retInstr->value && (retInstr->value->type == OperandType::VARIABLE || retInstr->value->type == OperandType::TEMP) &&
-        retInstr->value->name == oldVar) {
-            retInstr->value->name = newVar;
+    while (!worklist.empty()) {
+        size_t i = worklist.back();
+        worklist.pop_back();
+        if (!isDead(i)) continue;
+
+        std::vector<int> operandDefs;
+        for (size_t useId : chains.usesIn(i)) {
+            for (int d : chains.use(useId).defs) {
+                if (d != DefUseChains::kEntry) operandDefs.push_back(d);
+            }
         }
+        chains.erase(i);
+        for (int d : operandDefs) worklist.push_back(d);
     }
+    chains.compact();
+}
+
+
+/**
+ * 判断指令是否具有副作用
+ * 有副作用的指令包括：
+ * - 函数调用（可能修改外部状态）
+ * - 控制流指令（跳转、返回等）
+ * - 标签和函数边界指令
+ * - 参数传递指令
+ */
+bool IRGenerator::isSideEffectInstr(const std::shared_ptr<IRInstr>& instr) {
+    return
+        std::dynamic_pointer_cast<CallInstr>(instr) != nullptr ||               // 函数调用
+        std::dynamic_pointer_cast<ReturnInstr>(instr) != nullptr ||             // 返回指令
+        std::dynamic_pointer_cast<GotoInstr>(instr) != nullptr ||               // 无条件跳转
+        std::dynamic_pointer_cast<IfGotoInstr>(instr) != nullptr ||             // 条件跳转
+        std::dynamic_pointer_cast<LabelInstr>(instr) != nullptr ||              // 标签
+        std::dynamic_pointer_cast<FunctionBeginInstr>(instr) != nullptr ||      // 函数开始
+        std::dynamic_pointer_cast<FunctionEndInstr>(instr) != nullptr ||        // 函数结束
+        std::dynamic_pointer_cast<ParamInstr>(instr) != nullptr;                // 参数传递
 }
 
 // ---------- 构建基本块（仅用标签划分） ----------
@@ -1866,100 +1162,140 @@ std::vector<std::shared_ptr<IRGenerator::BasicBlock>> IRGenerator::buildBasicBlo
 
 
 /**
- * 执行基于控制流图(CFG)的复制传播优化(Copy Propagation)
+ * 基于定义-使用链的复制传播优化(Copy Propagation)
  * 算法步骤：
- * 1. 构建基本块和控制流图(CFG)
- * 2. 使用worklist算法迭代计算每个基本块的in/out拷贝映射
- * 3. 根据计算结果替换指令中的变量引用
+ * 1. 建立定义-使用链，收集每个函数中的复制指令 x = y
+ * 2. 可用复制分析（must）：复制在某点可用，当且仅当到达该点的每条路径都执行了它，
+ *    且之后x、y都没有被重新定义。块的gen/kill预先算好，worklist迭代
+ * 3. 使用的唯一到达定义是可用的复制时，把使用改为复制的源（沿复制链传递），
+ *    链更新为源在复制处的到达定义。块内的可用性由各名字在块内最近的定义位置判断
  */
 void IRGenerator::copyPropagationCFG() {
-    // ========== Step 1: 构建CFG ==========
-    //auto blocks = buildBasicBlocksByLabel();
-    auto blocks = buildBasicBlocks();
-    buildCFG(blocks);
-
-    int n = (int)blocks.size();
-    if (n == 0) return;
-
-    // ========== Step 2: 构建CFG的快速访问结构 ==========
-    std::unordered_map<int, std::vector<int>> cfg;  // blockID -> successorIDs
-    for (auto& b : blocks) {
-        std::vector<int> succIds;
-        for (auto& s : b->successors) {
-            succIds.push_back(s->id);   // 记录后继块ID
-        }
-        cfg[b->id] = std::move(succIds);
-    }
-
-    // ========== Step 3: 数据流分析初始化 =========
-    std::vector<CopyMap> inMap(n), outMap(n);   // 每个块的输入/输出拷贝映射
-    std::queue<int> q;                          // worklist队列
-    std::unordered_set<int> inQueue;            // 记录已在队列中的块
-
-    q.push(0); // 假定0为入口
-    inQueue.insert(0);
-
-    // ========== Step 4: 迭代计算in/out集合 ==========
-    while (!q.empty()) {
-        int bid = q.front();
-        q.pop();
-        inQueue.erase(bid);
-        auto blk = blocks[bid];
+    DefUseChains chains(instructions);
+    const auto& blocks = chains.blocks();
+    std::vector<int> copyIndex(instructions.size(), -1);   // 指令 -> 函数内的复制编号
+    std::vector<size_t> defName(instructions.size(), 0);  // 定义指令 -> 函数内的名字编号
+
+    using Bits = std::vector<std::uint64_t>;
+    auto setBit = [](Bits& bits, size_t i) { bits[i / 64] |= std::uint64_t(1) << (i % 64); };
+    auto testBit = [](const Bits& bits, size_t i) { return (bits[i / 64] >> (i % 64)) & 1; };
+
+    struct Copy {
+        size_t instr = 0;
+        size_t target = 0, source = 0;      // 名字编号
+        std::shared_ptr<Operand> operand;   // 改写前的源操作数
+        std::vector<int> sourceDefs;        // 源在复制处的到达定义
+    };
 
-        // 计算 inMap[bid] = meet(outMap[pred])
-        if (blk->predecessors.empty()) {
-            inMap[bid].clear();
-        } else {
-            CopyMap accum;
-            bool first = true;
-            for (auto& p : blk->predecessors) {
-                if (first) {
-                    accum = outMap[p->id];  // 第一个前驱
-                    first = false;
-                } else {
-                    // meet操作：保留所有前驱共有的拷贝关系
-                    accum = meetCopyMaps(accum, outMap[p->id]);
+    for (const auto& fn : chains.functions()) {
+        std::unordered_map<std::string, size_t> nameIds;
+        auto nameId = [&](const std::string& name) { return nameIds.emplace(name, nameIds.size()).first->second; };
+        std::vector<Copy> copies;
+        for (size_t b = fn.firstBlock; b < fn.lastBlock; ++b) {
+            for (size_t i = blocks[b].first; i < blocks[b].last; ++i) {
+                auto def = DefUseChains::definedOperand(instructions[i]);
+                if (!def) continue;
+                defName[i] = nameId(def->name);
+                auto assign = std::dynamic_pointer_cast<AssignInstr>(instructions[i]);
+                if (!assign || !assign->isSimpleCopy() || assign->target->name == assign->source->name) continue;
+                copyIndex[i] = static_cast<int>(copies.size());
+                copies.push_back({i, defName[i], nameId(assign->source->name), assign->source,
+                                  chains.use(chains.usesIn(i).front()).defs});
+            }
+        }
+        if (copies.empty()) continue;
+        std::vector<std::vector<size_t>> killedBy(nameIds.size());         // 名字 -> 重新定义它时失效的复制
+        for (size_t c = 0; c < copies.size(); ++c) {
+            killedBy[copies[c].target].push_back(c);
+            killedBy[copies[c].source].push_back(c);
+        }
+
+        // 块内扫描：名字在当前块中最近的定义指令
+        std::vector<size_t> stamp(nameIds.size(), 0), lastDef(nameIds.size(), 0);
+        auto definedBefore = [&](size_t name, size_t b) { return stamp[name] == b + 1; };
+
+        // gen：块内执行后仍可用的复制；kill：块内重新定义的名字所影响的复制
+        const size_t blockCount = fn.lastBlock - fn.firstBlock;
+        const size_t words = (copies.size() + 63) / 64;
+        std::vector<Bits> gen(blockCount, Bits(words, 0)), kill(blockCount, Bits(words, 0));
+        for (size_t b = fn.firstBlock; b < fn.lastBlock; ++b) {
+            std::vector<size_t> blockCopies;
+            for (size_t i = blocks[b].first; i < blocks[b].last; ++i) {
+                if (!DefUseChains::definedOperand(instructions[i])) continue;
+                size_t name = defName[i];
+                if (!definedBefore(name, b)) {
+                    for (size_t c : killedBy[name]) setBit(kill[b - fn.firstBlock], c);
+                }
+                stamp[name] = b + 1;
+                lastDef[name] = i;
+                if (copyIndex[i] >= 0) blockCopies.push_back(copyIndex[i]);
+            }
+            for (size_t c : blockCopies) {
+                const Copy& copy = copies[c];
+                if (lastDef[copy.target] == copy.instr && lastDef[copy.source] < copy.instr) {
+                    setBit(gen[b - fn.firstBlock], c);
                 }
             }
-            inMap[bid] = accum;
-        }
-
-        // 计算 outMap[bid] = transfer(inMap[bid], instructions)
-        CopyMap outEnv = inMap[bid];    // 从inMap初始化
-        for (auto& instr : blk->instructions) {
-            applyCopyTransfer(outEnv, instr);   // 每条指令更新拷贝关系
         }
 
-        // 如果状态改变，更新 outMap 并加入后继块
-        if (!copyMapEqual(outEnv, outMap[bid])) {
-            outMap[bid] = std::move(outEnv);
-            // 将后继块加入worklist
-            for (auto& succ : blk->successors) {
-                if (!inQueue.count(succ->id)) {
-                    q.push(succ->id);
-                    inQueue.insert(succ->id);
+        // 入口块和没有前驱的块 in = ∅，其余块 in = ∩ out(pred)，out初始为全集
+        // worklist按逆后序位置取最靠前的块，out变化时加入后继
+        std::vector<size_t> position(blockCount);
+        for (size_t k = 0; k < fn.order.size(); ++k) position[fn.order[k] - fn.firstBlock] = k;
+        std::vector<Bits> in(blockCount, Bits(words, 0)), out(blockCount, Bits(words, ~std::uint64_t(0)));
+        std::set<size_t> worklist;
+        for (size_t k = 0; k < fn.order.size(); ++k) worklist.insert(k);
+        Bits avail(words);
+        while (!worklist.empty()) {
+            size_t blockId = fn.order[*worklist.begin()];
+            worklist.erase(worklist.begin());
+            size_t b = blockId - fn.firstBlock;
+            const auto& preds = blocks[blockId].preds;
+            std::fill(avail.begin(), avail.end(), b != 0 && !preds.empty() ? ~std::uint64_t(0) : 0);
+            for (size_t p : preds) {
+                const Bits& predOut = out[p - fn.firstBlock];
+                for (size_t w = 0; w < words; ++w) avail[w] &= predOut[w];
+            }
+            in[b] = avail;
+            for (size_t w = 0; w < words; ++w) avail[w] = gen[b][w] | (avail[w] & ~kill[b][w]);
+            if (avail == out[b]) continue;
+            out[b].swap(avail);
+            for (size_t s : blocks[blockId].succs) worklist.insert(position[s - fn.firstBlock]);
+        }
+
+        // 复制c在块b的当前位置可用：c在本块前面时，其后x、y都未重新定义；
+        // 否则c在块入口可用，且块内到目前为止x、y都未重新定义
+        std::fill(stamp.begin(), stamp.end(), 0);
+        auto available = [&](size_t c, size_t b, size_t i) {
+            const Copy& copy = copies[c];
+            if (copy.instr >= blocks[b].first && copy.instr < i) {
+                return lastDef[copy.target] == copy.instr &&
+                       (!definedBefore(copy.source, b) || lastDef[copy.source] < copy.instr);
+            }
+            return testBit(in[b - fn.firstBlock], c) && !definedBefore(copy.target, b) &&
+                   !definedBefore(copy.source, b);
+        };
+        for (size_t b = fn.firstBlock; b < fn.lastBlock; ++b) {
+            for (size_t i = blocks[b].first; i < blocks[b].last; ++i) {
+                for (size_t useId : chains.usesIn(i)) {
+                    const Copy* chosen = nullptr;
+                    int d = chains.uniqueDefinition(useId);
+                    for (size_t steps = 0; steps < copies.size() && d >= 0 && copyIndex[d] >= 0 &&
+                                           available(copyIndex[d], b, i); ++steps) {
+                        chosen = &copies[copyIndex[d]];
+                        d = chosen->sourceDefs.size() == 1 ? chosen->sourceDefs[0] : -2;
+                    }
+                    if (chosen) {
+                        chains.replaceUse(useId, std::make_shared<Operand>(*chosen->operand), chosen->sourceDefs);
+                    }
+                }
+                if (DefUseChains::definedOperand(instructions[i])) {
+                    stamp[defName[i]] = b + 1;
+                    lastDef[defName[i]] = i;
                 }
             }
         }
     }
-
-    // ========== Step 5: 应用复制传播 ==========
-    for (int bid = 0; bid < n; ++bid) {
-        CopyMap env = inMap[bid];   // 获取当前块的初始拷贝关系
-        auto blk = blocks[bid];
-        for (auto& instr : blk->instructions) {
-            replaceCopyUses(instr, env);    // 替换指令中的可传播变量
-            applyCopyTransfer(env, instr);  // 同步更新环境
-        }
-    }
-
-    // ========== Step 6: 重建指令序列 ==========
-    this->instructions.clear();
-    for (auto& b : blocks) {
-        for (auto& instr : b->instructions) {
-            this->instructions.push_back(instr);
-        }
-    }
 }
 
 /**
@@ -2178,6 +1514,7 @@ void IRGenerator::commonSubexpressionElimination() {
             const std::string defVar = binOp->result ? binOp->result->name : std::string{};
             if (canReplace && replOperand) {
                 blk->instructions[i] = std::make_shared<AssignInstr>(binOp->result, replOperand);
+                blk->instructions[i]->loc = binOp->loc;
                 // 即使替换也要更新版本和操作数映射
                 if (!defVar.empty()) {
                     ++varVersion[defVar];
@@ -2227,290 +1564,12 @@ void IRGenerator::commonSubexpressionElimination() {
 
 /**
  * 执行控制流优化（Control Flow Optimization）
- * 主要包含四个优化阶段：
- * 1. 删除不可达基本块
- * 2. 合并直连基本块
- * 3. 删除多余跳转
- * 4. 重新线性化指令
+ * 折叠常量条件跳转、收缩跳转链、删除不可达块与空块、合并直连基本块，
+ * 逐函数进行，见cfgsimplify.h
  */
-
-// 辅助：更新所有跳转指令目标标签，fromLabel -> toLabel
-void IRGenerator::updateJumpTargets(
-    std::vector<std::shared_ptr<BasicBlock>>& blocks,
-    const std::string& fromLabel,
-    const std::string& toLabel)
-{
-    for (auto& blk : blocks) {
-        for (auto& instr : blk->instructions) {
-            if (auto gotoInstr = std::dynamic_pointer_cast<GotoInstr>(instr)) {
-                if (gotoInstr->target && gotoInstr->target->name == fromLabel) {
-                    gotoInstr->target->name = toLabel;
-                }
-            }
-            if (auto ifGotoInstr = std::dynamic_pointer_cast<IfGotoInstr>(instr)) {
-                if (ifGotoInstr->target && ifGotoInstr->target->name == fromLabel) {
-                    ifGotoInstr->target->name = toLabel;
-                }
-            }
-        }
-    }
-}
-
-// 校验 CFG 有效性，标签唯一且跳转目标存在
-bool IRGenerator::validateCFG(const std::vector<std::shared_ptr<BasicBlock>>& blocks) {
-    std::unordered_set<std::string> allLabels;
-    std::unordered_set<std::string> usedLabels;
-
-    for (const auto& blk : blocks) {
-        if (blk->instructions.empty()) continue;
-        // 基本块首指令必须是标签
-        auto firstInstr = blk->instructions.front();
-        auto labelInstr = std::dynamic_pointer_cast<LabelInstr>(firstInstr);
-        if (!labelInstr) {
-            std::cerr << "Error: BasicBlock missing starting LabelInstr\n";
-            return false;
-        }
-        // 标签唯一
-        if (allLabels.count(labelInstr->label)) {
-            std::cerr << "Error: Duplicate label: " << labelInstr->label << "\n";
-            return false;
-        }
-        allLabels.insert(labelInstr->label);
-
-        // 收集跳转目标
-        for (const auto& instr : blk->instructions) {
-            if (auto g = std::dynamic_pointer_cast<GotoInstr>(instr)) {
-                if (g->target) usedLabels.insert(g->target->name);
-            }
-            if (auto ig = std::dynamic_pointer_cast<IfGotoInstr>(instr)) {
-                if (ig->target) usedLabels.insert(ig->target->name);
-            }
-        }
-    }
-
-    // 检查跳转目标是否都存在
-    for (const auto& label : usedLabels) {
-        if (!allLabels.count(label)) {
-            std::cerr << "Error: Jump target label not found: " << label << "\n";
-            return false;
-        }
-    }
-    return true;
-}
-
 void IRGenerator::controlFlowOptimization() {
-    // 构建基本块和CFG
-    auto blocks = buildBasicBlocks();
-    buildCFG(blocks);
-    if (blocks.empty()) return;
-
-    // Step 1: 删除不可达基本块
-    std::unordered_set<std::shared_ptr<BasicBlock>> reachable;      // 存储可达块
-    std::unordered_set<std::shared_ptr<BasicBlock>> inProgress;                     // 存储正在处理的块，用于检测循环
-
-    /*std::function<void(std::shared_ptr<BasicBlock>)> dfs =
-        [&](std::shared_ptr<BasicBlock> blk) {
-            if (!blk || reachable.count(blk)) return;
-            reachable.insert(blk);
-            for (auto& succ : blk->successors) {
-                dfs(succ);
-            }
-        };*/
-
-    // 使用安全的DFS遍历，避免循环导致的无限递归
-    std::function<void(std::shared_ptr<BasicBlock>)> dfs = [&](std::shared_ptr<BasicBlock> blk) {
-        if (!blk || reachable.count(blk)) return;  // 已访问的块直接返回
-    
-        // 检测是否在当前DFS路径上（循环检测）
-        if (inProgress.count(blk)) return;         // 如果当前块正在处理中，直接返回
-    
-        inProgress.insert(blk);                    // 标记当前块为处理中
-        reachable.insert(blk);                     // 标记当前块为可达
-    
-        // 递归处理所有后继块
-        for (auto succ : blk->successors) {
-            dfs(succ);
-        }
-    
-        inProgress.erase(blk);                     // 处理完成，从处理中集合移除
-    };
-
-
-    // 寻找程序入口
-    std::shared_ptr<BasicBlock> entry = nullptr;
-
-    for (auto& blk : blocks) {
-        for (auto& ins : blk->instructions) {
-            if (auto funcInstr = std::dynamic_pointer_cast<FunctionBeginInstr>(ins)) {
-                if (funcInstr->funcName == "main") { 
-                    entry = blk;
-                    goto found; // 直接跳出双层循环
-                }
-            }
-        }
-    }
-
-    found:
-    if (!entry) {
-        throw std::runtime_error("入口块 'main' 未找到");
-    }
-
-    dfs(entry);
-
-    // 过滤不可达块
-    std::vector<std::shared_ptr<BasicBlock>> newBlocks;
-    for (auto& blk : blocks) {
-        if (reachable.count(blk)) newBlocks.push_back(blk);
-    }
-    blocks.swap(newBlocks);
-
-
-    // Step 2: 合并直连基本块
-    std::unordered_set<std::shared_ptr<BasicBlock>> toRemove;
-
-    for (auto& blk : blocks) {
-        if (blk->instructions.empty()) continue;
-
-        // 必须保证第一个指令是标签
-        auto firstInstr = blk->instructions.front();
-        auto blkLabelInstr = std::dynamic_pointer_cast<LabelInstr>(firstInstr);
-        if (!blkLabelInstr) continue; // 【修改点】跳过无标签块，确保标签存在
-
-        // 检查最后一条是否为goto
-        if (auto gotoInstr = std::dynamic_pointer_cast<GotoInstr>(blk->instructions.back())) {
-            if (blk->successors.size() != 1) continue;
-            auto target = blk->successors[0];
-            if (!target || target->instructions.empty()) continue;
-
-            // 目标块必须只有一个前驱（即当前块）
-            if (target->predecessors.size() != 1 || target->predecessors[0] != blk) continue;
-
-            // 目标块第一个指令必须是标签
-            auto targetLabelInstr = std::dynamic_pointer_cast<LabelInstr>(target->instructions.front());
-            if (!targetLabelInstr) continue;
-
-            // 【修改点】合并块前先记录标签名
-            std::string blkLabel = blkLabelInstr->label;
-            std::string targetLabel = targetLabelInstr->label;
-
-            // 【修改点】合并时删除当前块尾部goto
-            blk->instructions.pop_back();
-
-            // 【修改点】删除目标块标签指令（保持块唯一标签）
-            target->instructions.erase(target->instructions.begin());
-
-            // 合并目标块剩余指令
-            blk->instructions.insert(
-                blk->instructions.end(),
-                target->instructions.begin(),
-                target->instructions.end()
-            );
-
-            // 更新CFG successors
-            blk->successors = target->successors;
-
-            // 更新目标块后继的predecessors指向当前块
-            for (auto& succ : target->successors) {
-                for (auto& pred : succ->predecessors) {
-                    if (pred == target) {
-                        pred = blk;
-                    }
-                }
-            }
-
-            // 【修改点】更新所有跳转指令指向目标标签的，改为指向当前块标签
-            updateJumpTargets(blocks, targetLabel, blkLabel);
-
-            toRemove.insert(target);
-        }
-    }
-
-    // 删除合并块
-    blocks.erase(
-        std::remove_if(blocks.begin(), blocks.end(),
-            [&](const std::shared_ptr<BasicBlock>& b) { return toRemove.count(b); }),
-        blocks.end()
-    );
-
-    // Step 3: 删除多余跳转，且同步更新 successors
-    for (size_t i = 0; i + 1 < blocks.size(); ++i) {
-        auto& blk = blocks[i];
-        if (blk->instructions.empty()) continue;
-
-        if (auto gotoInstr = std::dynamic_pointer_cast<GotoInstr>(blk->instructions.back())) {
-            auto& nextBlk = blocks[i + 1];
-            if (nextBlk->instructions.empty()) continue;
-
-            auto labelInstr = std::dynamic_pointer_cast<LabelInstr>(nextBlk->instructions.front());
-            if (!labelInstr) continue;
-
-            if (gotoInstr->target && gotoInstr->target->name == labelInstr->label) {
-                // 删除跳转指令
-                blk->instructions.pop_back();
-
-                // 【修改点】同步删除 successors 中的 nextBlk
-                blk->successors.erase(
-                    std::remove(blk->successors.begin(), blk->successors.end(), nextBlk),
-                    blk->successors.end()
-                );
-            }
-        }
-    }
-
-    // Step 4: 重新线性化指令，优先fall-through后继
-    instructions.clear();   // 清空最终的指令序列，准备重新生成
-    for (auto& block : blocks) {
-        instructions.insert(instructions.end(), block->instructions.begin(), block->instructions.end());
-    }
-    /*std::unordered_set<std::shared_ptr<BasicBlock>> visited;
-
-    // 定义深度优先搜索（DFS）函数，用于线性化基本块
-    std::function<void(std::shared_ptr<BasicBlock>)> dfsLinearize = [&](std::shared_ptr<BasicBlock> blk) {
-        // 如果基本块为空或已访问过，直接返回
-        if (!blk || visited.count(blk)) return;
-
-        // 标记当前基本块为已访问
-        visited.insert(blk);
-
-        // 将当前基本块的所有指令追加到最终的指令序列中
-        instructions.insert(instructions.end(), blk->instructions.begin(), blk->instructions.end());
-
-        // 找fall-through后继（非跳转目标）
-        std::shared_ptr<BasicBlock> fallthrough = nullptr;
-        if (!blk->instructions.empty()) {
-            auto lastInstr = blk->instructions.back();  // 获取最后一条指令
-
-            // 如果是 `Goto` 或 `Return`，则没有 fall-through
-            if (std::dynamic_pointer_cast<GotoInstr>(lastInstr) || std::dynamic_pointer_cast<ReturnInstr>(lastInstr)) {
-                fallthrough = nullptr; // 无fall-through
-            } 
-            // 如果是 `IfGoto`（条件跳转），则 fall-through 是第二个后继（false 分支）
-            else if (auto ifGoto = std::dynamic_pointer_cast<IfGotoInstr>(lastInstr)) {
-                if (blk->successors.size() > 1) fallthrough = blk->successors[1];
-            } 
-            // 其他情况（普通指令），fall-through 是唯一后继（如果有的话）
-            else {
-                if (blk->successors.size() == 1) fallthrough = blk->successors[0];
-            }
-        }
-
-        // 优先处理 fall-through 后继（保证顺序执行）
-        if (fallthrough) dfsLinearize(fallthrough);
-
-        // 处理其他后继（跳转目标）
-        for (auto& succ : blk->successors) {
-            if (succ != fallthrough) dfsLinearize(succ);
-        }
-    };
-
-    // 从入口基本块开始线性化
-    dfsLinearize(entry);*/
-
-    // Step 5: 最后校验CFG有效性，避免标签或跳转错误
-    if (!validateCFG(blocks)) {
-        std::cerr << "Error: CFG validation failed after controlFlowOptimization\n";
-        // 这里可考虑回滚或抛异常
-    }
+    CFGSimplifier simplifier;
+    simplifier.run(instructions);
 }
 
 /**
@@ -2558,6 +1617,7 @@ void IRGenerator::visit(VariableExpr& expr) {
  * @param expr 二元表达式
  */
 void IRGenerator::visit(BinaryExpr& expr) {
+    LocationScope locScope(*this, expr);
     // 处理逻辑运算符的短路求值
     if (expr.op == "&&") {
         auto result = generateShortCircuitAnd(expr);
@@ -2592,7 +1652,7 @@ void IRGenerator::visit(BinaryExpr& expr) {
     else if (expr.op == "&&") opcode = OpCode::AND;
     else if (expr.op == "||") opcode = OpCode::OR;
     else {
-        std::cerr << "Error: Unknown binary operator: " << expr.op << std::endl;
+        *config.diagnostics << "Error: Unknown binary operator: " << expr.op << std::endl;
         opcode = OpCode::ADD; // 默认使用加法
     }
     
@@ -2694,6 +1754,7 @@ std::shared_ptr<Operand> IRGenerator::generateShortCircuitOr(BinaryExpr& expr) {
  * @param expr 一元表达式
  */
 void IRGenerator::visit(UnaryExpr& expr) {
+    LocationScope locScope(*this, expr);
     expr.operand->accept(*this);
     std::shared_ptr<Operand> operand = getTopOperand();
     
@@ -2710,7 +1771,7 @@ void IRGenerator::visit(UnaryExpr& expr) {
         // 一元加（无效果）
         addInstruction(std::make_shared<AssignInstr>(result, operand));
     } else {
-        std::cerr << "错误: 未知的一元运算符: " << expr.op << std::endl;
+        *config.diagnostics << "错误: 未知的一元运算符: " << expr.op << std::endl;
         // 默认为取负
         addInstruction(std::make_shared<UnaryOpInstr>(OpCode::NEG, result, operand));
     }
@@ -2727,6 +1788,7 @@ void IRGenerator::visit(UnaryExpr& expr) {
  * @param expr 函数调用表达式
  */
 void IRGenerator::visit(CallExpr& expr) {
+    LocationScope locScope(*this, expr);
     // 处理参数
     std::vector<std::shared_ptr<Operand>> args;
     for (const auto& arg : expr.arguments) {
@@ -2771,6 +1833,7 @@ void IRGenerator::visit(CallExpr& expr) {
  * @param stmt 表达式语句
  */
 void IRGenerator::visit(ExprStmt& stmt) {
+    LocationScope locScope(*this, stmt);
     if (stmt.expression) {
         stmt.expression->accept(*this);
         // 表达式语句的结果会被丢弃
@@ -2798,6 +1861,7 @@ void IRGenerator::visit(ExprStmt& stmt) {
     }
 }*/
 void IRGenerator::visit(VarDeclStmt& stmt) {
+    LocationScope locScope(*this, stmt);
     // 关键修改：使用 createInCurrentScope = true，强制在当前作用域创建新变量
     std::shared_ptr<Operand> var = getVariable(stmt.name, true);
     
@@ -2817,6 +1881,7 @@ void IRGenerator::visit(VarDeclStmt& stmt) {
  * @param stmt 赋值语句
  */
 void IRGenerator::visit(AssignStmt& stmt) {
+    LocationScope locScope(*this, stmt);
     // 评估右侧
     stmt.value->accept(*this);
     std::shared_ptr<Operand> value = getTopOperand();
@@ -2855,6 +1920,7 @@ void IRGenerator::visit(BlockStmt& stmt) {
  * @param stmt if语句
  */
 void IRGenerator::visit(IfStmt& stmt) {
+    LocationScope locScope(*this, stmt);
     // 为else分支和结束创建标签
     std::shared_ptr<Operand> elseLabel = createLabel();
     std::shared_ptr<Operand> endLabel = stmt.elseBranch ? createLabel() : elseLabel;
@@ -2901,6 +1967,7 @@ void IRGenerator::visit(IfStmt& stmt) {
  * @param stmt while语句
  */
 void IRGenerator::visit(WhileStmt& stmt) {
+    LocationScope locScope(*this, stmt);
     std::shared_ptr<Operand> startLabel = createLabel();
     std::shared_ptr<Operand> condLabel = createLabel();
     std::shared_ptr<Operand> endLabel = createLabel();
@@ -2943,9 +2010,10 @@ void IRGenerator::visit(WhileStmt& stmt) {
  * 
  * @param stmt break语句
  */
-void IRGenerator::visit(BreakStmt&) {
+void IRGenerator::visit(BreakStmt& stmt) {
+    LocationScope locScope(*this, stmt);
     if (breakLabels.empty()) {
-        std::cerr << "Error: Break statement outside of loop" << std::endl;
+        *config.diagnostics << "Error: Break statement outside of loop" << std::endl;
         return;
     }
     
@@ -2960,9 +2028,10 @@ void IRGenerator::visit(BreakStmt&) {
  * 
  * @param stmt continue语句
  */
-void IRGenerator::visit(ContinueStmt&) {
+void IRGenerator::visit(ContinueStmt& stmt) {
+    LocationScope locScope(*this, stmt);
     if (continueLabels.empty()) {
-        std::cerr << "Error: Continue statement outside of loop" << std::endl;
+        *config.diagnostics << "Error: Continue statement outside of loop" << std::endl;
         return;
     }
     
@@ -2978,6 +2047,7 @@ void IRGenerator::visit(ContinueStmt&) {
  * @param stmt return语句
  */
 void IRGenerator::visit(ReturnStmt& stmt) {
+    LocationScope locScope(*this, stmt);
     if (stmt.value) {
         stmt.value->accept(*this);
         std::shared_ptr<Operand> value = getTopOperand();
@@ -3000,6 +2070,7 @@ void IRGenerator::visit(ReturnStmt& stmt) {
  * @param funcDef 函数定义
  */
 void IRGenerator::visit(FunctionDef& funcDef) {
+    LocationScope locScope(*this, funcDef);
     currentFunction = funcDef.name;
     currentFunctionReturnType = funcDef.returnType;
 
@@ -3080,82 +2151,6 @@ void IRPrinter::print(const std::vector<std::shared_ptr<IRInstr>>& instructions,
 // IR分析器实现
 //------------------------------------------------------------------------------
 
-/**
- * 查找定义变量的指令。
- * 
- * @param instructions 要搜索的IR指令
- * @param operandName 要查找的变量名
- * @return 定义指令的索引，如果未找到则为-1
- */
-int IRAnalyzer::findDefinition(const std::vector<std::shared_ptr<IRInstr>>& instructions, 
-                              const std::string& operandName) {
-    for (int i = 0; i < instructions.size(); ++i) {
-        auto instr = instructions[i];
-        
-        // 检查是否定义了该操作数
-        auto definedVars = getDefinedVariables(instr);
-        if (std::find(definedVars.begin(), definedVars.end(), operandName) != definedVars.end()) {
-            return i;
-        }
-    }
-    
-    return -1; // 未找到定义
-}
-
-/**
- * 查找使用变量的所有指令。
- * 
- * @param instructions 要搜索的IR指令
- * @param operandName 要查找的变量名
- * @return 使用变量的指令索引向量
- */
-std::vector<int> IRAnalyzer::findUses(const std::vector<std::shared_ptr<IRInstr>>& instructions, 
-                                    const std::string& operandName) {
-    std::vector<int> uses;
-    
-    for (int i = 0; i < instructions.size(); ++i) {
-        auto instr = instructions[i];
-        
-        // 检查是否使用了该操作数
-        auto usedVars = getUsedVariables(instr);
-        if (std::find(usedVars.begin(), usedVars.end(), operandName) != usedVars.end()) {
-            uses.push_back(i);
-        }
-    }
-    
-    return uses;
-}
-
-/**
- * 检查变量在给定位置是否活跃。
- * 
- * 如果变量在位置之后使用且未重新定义，则它是活跃的。
- * 
- * @param instructions 要搜索的IR指令
- * @param varName 要检查的变量名
- * @param position 要检查的位置
- * @return 如果变量在位置处活跃则为true
- */
-bool IRAnalyzer::isVariableLive(const std::vector<std::shared_ptr<IRInstr>>& instructions,
-                               const std::string& varName,
-                               int position) {
-    // 如果变量在position之后被使用，则认为它是活跃的
-    for (int i = position + 1; i < instructions.size(); ++i) {
-        auto usedVars = getUsedVariables(instructions[i]);
-        if (std::find(usedVars.begin(), usedVars.end(), varName) != usedVars.end()) {
-            return true;
-        }
-        
-        // 如果变量在这条指令中被重新定义，则之前的值不再活跃
-        auto definedVars = getDefinedVariables(instructions[i]);
-        if (std::find(definedVars.begin(), definedVars.end(), varName) != definedVars.end()) {
-            return false;
-        }
-    }
-    
-    return false; // 变量不再被使用
-}
-
 /**
  * 获取指令定义的所有变量。
  * 
@@ -3278,24 +2273,29 @@ std::shared_ptr<Operand> cloneOperand(const std::shared_ptr<Operand>& op) {
 
 std::shared_ptr<IRInstr> IRGenerator::cloneInstruction(const std::shared_ptr<IRInstr>& instr) {
     // 这里只实现几种常见指令的克隆
+    std::shared_ptr<IRInstr> cloned;
     if (auto binOp = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) {
-        return std::make_shared<BinaryOpInstr>(
+        cloned = std::make_shared<BinaryOpInstr>(
             binOp->opcode,
             cloneOperand(binOp->result),
             cloneOperand(binOp->left),
             cloneOperand(binOp->right));
     }
     else if (auto unaryOp = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) {
-        return std::make_shared<UnaryOpInstr>(
+        cloned = std::make_shared<UnaryOpInstr>(
             unaryOp->opcode,
             cloneOperand(unaryOp->result),
             cloneOperand(unaryOp->operand));
     }
     else if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) {
-        return std::make_shared<AssignInstr>(
+        cloned = std::make_shared<AssignInstr>(
             cloneOperand(assign->target),
             cloneOperand(assign->source));
     }
+    if (cloned) {
+        cloned->loc = instr->loc;
+        return cloned;
+    }
     
     // 其他类型直接返回原指令（简化）
     return instr;
@@ -3316,7 +2316,8 @@ bool IRAnalyzer::hasSideEffects(const std::shared_ptr<IRInstr>& instr) {
     return std::dynamic_pointer_cast<CallInstr>(instr) != nullptr ||
            std::dynamic_pointer_cast<ReturnInstr>(instr) != nullptr ||
            std::dynamic_pointer_cast<GotoInstr>(instr) != nullptr ||
-           std::dynamic_pointer_cast<IfGotoInstr>(instr) != nullptr;
+           std::dynamic_pointer_cast<IfGotoInstr>(instr) != nullptr ||
+           std::dynamic_pointer_cast<ProfileCounterInstr>(instr) != nullptr;
 }
 
 bool IRAnalyzer::isPureFunction(const std::vector<std::shared_ptr<IRInstr>>& instructions) {
@@ -3340,6 +2341,35 @@ int IRAnalyzer::countInstructions(const std::vector<std::shared_ptr<IRInstr>>& i
     return count;
 }
 
+std::vector<int> IRAnalyzer::computeLoopDepths(const std::vector<std::shared_ptr<IRInstr>>& instructions) {
+    std::vector<int> depths(instructions.size(), 0);
+    std::unordered_map<std::string, size_t> labelIndex;
+    size_t functionStart = 0;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        const auto& instr = instructions[i];
+        if (instr->opcode == OpCode::FUNCTION_BEGIN) {
+            labelIndex.clear();
+            functionStart = i;
+        } else if (auto label = std::dynamic_pointer_cast<LabelInstr>(instr)) {
+            labelIndex[label->label] = i;
+        }
+
+        std::shared_ptr<Operand> target;
+        if (auto gotoInstr = std::dynamic_pointer_cast<GotoInstr>(instr)) {
+            target = gotoInstr->target;
+        } else if (auto ifGoto = std::dynamic_pointer_cast<IfGotoInstr>(instr)) {
+            target = ifGoto->target;
+        }
+        if (!target) continue;
+        auto it = labelIndex.find(target->name);
+        if (it == labelIndex.end() || it->second < functionStart) continue;
+        for (size_t k = it->second; k <= i; ++k) {
+            ++depths[k];
+        }
+    }
+    return depths;
+}
+
 /**
  * 简化的循环不变量外提优化
  */
@@ -3396,6 +2426,16 @@ void IRGenerator::loopInvariantCodeMotion() {
                                 std::make_shared<GotoInstr>(
                                     std::make_shared<Operand>(OperandType::LABEL, loop.header->label)));
                             
+                            // preheader归属到循环头对应的源码行
+                            for (auto& hdrInstr : loop.header->instructions) {
+                                if (hdrInstr->loc.isValid()) {
+                                    for (auto& phInstr : preheader->instructions) {
+                                        phInstr->loc = hdrInstr->loc;
+                                    }
+                                    break;
+                                }
+                            }
+                            
                             loop.preheader = preheader;
                             detectedLoops.push_back(loop);
                             blocks.push_back(preheader);
@@ -3480,6 +2520,11 @@ void IRGenerator::loopInvariantCodeMotion() {
                         auto& preheaderInstrs = loop.preheader->instructions;
                         size_t insertPos = preheaderInstrs.size() - 1; // 在跳转前插入
                         
+                        // 外提后的指令在循环入口执行，源码位置与循环头合并
+                        for (auto& hoisted : toHoist) {
+                            hoisted->loc = SourceLocation::merge(hoisted->loc, preheaderInstrs.back()->loc);
+                        }
+                        
                         preheaderInstrs.insert(preheaderInstrs.begin() + insertPos,
                                              toHoist.begin(), toHoist.end());
                         
@@ -3563,11 +2608,11 @@ bool IRGenerator::shouldInlineFunction(const std::string& funcName, int callCoun
     
     const auto& info = it->second;
     
-    // 简化规则：只内联很小的函数（少于10条指令）
-    if (info.body.size() > 10) return false;
+    // 简化规则：只内联很小的函数（阈值见config.pipeline）
+    if (static_cast<int>(info.body.size()) > config.pipeline.inlineMaxInstructions) return false;
     
-    // 且只被调用一次的函数
-    if (callCount != 1) return false;
+    // 且调用点很少的函数
+    if (callCount < 1 || callCount > config.pipeline.inlineMaxCallSites) return false;
     
     return true;
 }
@@ -3607,3 +2652,33 @@ void IRGenerator::functionInlining() {
     instructions.swap(newInstructions);
 }
 
+
+/**
+ * 死参数与无用返回值消除。
+ * 
+ * 删除函数中从未读取的形参及各调用点对应的实参；所有调用点都不使用结果的函数改为void。
+ */
+void IRGenerator::deadArgumentElimination() {
+    DeadArgumentEliminator eliminator;
+    eliminator.run(instructions);
+}
+
+/**
+ * 相同代码折叠。
+ * 
+ * 合并优化后完全相同或仅常量不同的函数，调用方改为调用保留下来的函数。
+ */
+void IRGenerator::identicalCodeFolding() {
+    IdenticalCodeFolder folder([this]() { return createTemp(); });
+    folder.run(instructions);
+}
+
+/**
+ * 超块形成。
+ * 
+ * 沿循环中最可能的路径尾复制汇合块，消除轨迹的侧入口，供之后的局部优化使用。
+ */
+void IRGenerator::superblockFormation() {
+    SuperblockFormer former([this]() { return createTemp(); }, [this]() { return createLabel(); });
+    former.run(instructions);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "ir.h"
+#include "pipeline.h"
 #include "parser/ast.h"
 #include "semantic/semantic.h"
 #include <string>
@@ -10,6 +11,7 @@
 #include <functional>
 #include <queue>
 #include <unordered_set>
+#include <iostream>
 
 using BlockID = int;
 
@@ -24,6 +26,24 @@ struct IRGenConfig {
     bool enableOptimizations = false;
     bool generateDebugInfo = false;
     bool inlineSmallFunctions = false;
+    OptPipeline pipeline = OptPipeline::standard();  // optimize()执行的优化遍与阈值
+    std::ostream* diagnostics = &std::cerr;   // 错误与警告输出（不能为nullptr）
+};
+
+// ==================== 优化遍监听接口 ====================
+
+// optimize()/runPass()在每个优化遍前后回调，用于计时、性能计数和模糊测试
+class IRPassListener {
+public:
+    virtual ~IRPassListener() = default;
+    virtual void beforePass(const std::string& passName,
+                            const std::vector<std::shared_ptr<IRInstr>>& instructions) {
+        (void)passName; (void)instructions;
+    }
+    virtual void afterPass(const std::string& passName,
+                           const std::vector<std::shared_ptr<IRInstr>>& instructions) {
+        (void)passName; (void)instructions;
+    }
 };
 
 // ==================== IR优化器接口 ====================
@@ -82,6 +102,27 @@ private:
     
     IRGenConfig config;
 
+    IRPassListener* passListener = nullptr;
+
+    // 优化遍注册表：名字供runPass()和流水线预设引用
+    struct PassEntry {
+        const char* name;
+        void (IRGenerator::*run)();
+    };
+    static const std::vector<PassEntry>& passRegistry();
+
+    // 源码位置跟踪：访问AST节点时更新，addInstruction时写入新指令
+    SourceLocation currentLoc;
+
+    struct LocationScope {
+        IRGenerator& gen;
+        SourceLocation saved;
+        LocationScope(IRGenerator& gen, const ASTNode& node) : gen(gen), saved(gen.currentLoc) {
+            if (node.line > 0) gen.currentLoc = SourceLocation(node.line, node.column);
+        }
+        ~LocationScope() { gen.currentLoc = saved; }
+    };
+
 
 public:
     struct BasicBlock {
@@ -151,9 +192,15 @@ public:
     }
     
     void generate(std::shared_ptr<CompUnit> ast);
+    void loadInstructions(const std::vector<std::shared_ptr<IRInstr>>& instrs);
     void dumpIR(const std::string& filename) const;
     void optimize();
 
+    // 按名字单独执行一个优化遍，名字未知时返回false
+    bool runPass(const std::string& name);
+    static std::vector<std::string> passNames();
+    void setPassListener(IRPassListener* listener) { passListener = listener; }
+
     std::shared_ptr<Operand> createTemp();
     std::shared_ptr<Operand> createLabel();
     void addInstruction(std::shared_ptr<IRInstr> instr);
@@ -200,11 +247,14 @@ private:
     void constantPropagationCFG();
     void deadCodeElimination();
     void copyPropagationCFG();
-    void controlFlowOptimization();
+    void controlFlowOptimization();  // 控制流简化（见cfgsimplify.h）
     void commonSubexpressionElimination();
 
     void loopInvariantCodeMotion();  // 新增：循环不变量外提
     void functionInlining();         // 新增：函数内联
+    void deadArgumentElimination();  // 死参数与无用返回值消除（见deadargs.h）
+    void identicalCodeFolding();     // 相同代码折叠（见icf.h）
+    void superblockFormation();      // 超块形成（见superblock.h）
 
     bool isSideEffectInstr(const std::shared_ptr<IRInstr>& instr);
 
@@ -222,23 +272,9 @@ private:
     std::vector<std::shared_ptr<BasicBlock>> buildBasicBlocks();
     std::vector<std::shared_ptr<BasicBlock>> buildBasicBlocksByLabel();
 
-    std::unordered_set<std::string> getLoopDefs(
-        const std::unordered_set<BlockID>& loopBlocks,
-        const std::unordered_map<BlockID, BasicBlock>& blocks);
-
-    std::unordered_set<int> getLoopBlocks(
-        const std::unordered_map<int, std::vector<int>>& cfg,
-        int fromBlk, int toBlk);
    
     void buildCFG(std::vector<std::shared_ptr<BasicBlock>>& blocks);
 
-    void updateJumpTargets(
-        std::vector<std::shared_ptr<BasicBlock>>& blocks,
-        const std::string& fromLabel,
-        const std::string& toLabel);
-
-    bool validateCFG(const std::vector<std::shared_ptr<BasicBlock>>& blocks);
-    
     bool allPathsReturn(const std::shared_ptr<Stmt>& stmt);
     void markFunctionAsUsed(const std::string& funcName);
 
@@ -0,0 +1,342 @@
+// irparser.cpp - 文本IR解析器实现
+#include "irparser.h"
+#include <sstream>
+#include <cctype>
+#include <climits>
+
+namespace {
+
+const std::map<std::string, OpCode> binaryOps = {
+    {"+", OpCode::ADD}, {"-", OpCode::SUB}, {"*", OpCode::MUL},
+    {"/", OpCode::DIV}, {"%", OpCode::MOD},
+    {"<", OpCode::LT}, {">", OpCode::GT}, {"<=", OpCode::LE},
+    {">=", OpCode::GE}, {"==", OpCode::EQ}, {"!=", OpCode::NE},
+    {"&&", OpCode::AND}, {"||", OpCode::OR}
+};
+
+bool isTempName(const std::string& name) {
+    if (name.size() < 2 || name[0] != 't') return false;
+    for (size_t i = 1; i < name.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(name[i]))) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// ==================== 主解析流程 ====================
+
+std::vector<std::shared_ptr<IRInstr>> IRParser::parse() {
+    std::vector<std::shared_ptr<IRInstr>> result;
+    std::istringstream in(source);
+    std::string line;
+    lineNo = 0;
+
+    while (std::getline(in, line)) {
+        ++lineNo;
+        tokenizeLine(line);
+        if (tokens.empty()) continue;
+
+        auto instr = parseLine();
+        if (instr) {
+            result.push_back(instr);
+        }
+    }
+
+    if (inFunction) {
+        throw error("unexpected end of input inside a function");
+    }
+    return result;
+}
+
+// 将一行切分为标记；'#'之后为注释
+void IRParser::tokenizeLine(const std::string& line) {
+    tokens.clear();
+    pos = 0;
+
+    size_t i = 0;
+    while (i < line.size()) {
+        char c = line[i];
+        if (c == '#') break;
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+            continue;
+        }
+
+        // 负数字面量：'-'紧跟数字且前面不是操作数（否则是减号）
+        bool prevIsOperand = !tokens.empty() && tokens.back().kind != IRToken::SYMBOL;
+        bool negativeLiteral = c == '-' && !prevIsOperand && i + 1 < line.size() &&
+                               std::isdigit(static_cast<unsigned char>(line[i + 1]));
+
+        if (std::isdigit(static_cast<unsigned char>(c)) || negativeLiteral) {
+            size_t start = i;
+            if (negativeLiteral) ++i;
+            while (i < line.size() && std::isdigit(static_cast<unsigned char>(line[i]))) ++i;
+            std::string text = line.substr(start, i - start);
+            long long value = 0;
+            try {
+                value = std::stoll(text);
+            } catch (const std::out_of_range&) {
+                throw error("integer literal out of range: " + text);
+            }
+            if (value < INT_MIN || value > INT_MAX) {
+                throw error("integer literal out of range: " + text);
+            }
+            tokens.push_back({IRToken::NUMBER, text, value});
+            continue;
+        }
+
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            size_t start = i;
+            while (i < line.size() &&
+                   (std::isalnum(static_cast<unsigned char>(line[i])) || line[i] == '_')) ++i;
+            tokens.push_back({IRToken::IDENT, line.substr(start, i - start)});
+            continue;
+        }
+
+        // 双字符运算符优先
+        if (i + 1 < line.size()) {
+            std::string two = line.substr(i, 2);
+            if (two == "<=" || two == ">=" || two == "==" || two == "!=" ||
+                two == "&&" || two == "||") {
+                tokens.push_back({IRToken::SYMBOL, two});
+                i += 2;
+                continue;
+            }
+        }
+
+        if (std::string("+-*/%<>=!(),:").find(c) != std::string::npos) {
+            tokens.push_back({IRToken::SYMBOL, std::string(1, c)});
+            ++i;
+            continue;
+        }
+
+        throw error(std::string("unexpected character '") + c + "'");
+    }
+}
+
+std::shared_ptr<IRInstr> IRParser::parseLine() {
+    if (checkIdent("function")) {
+        return parseFunction();
+    }
+
+    if (!inFunction) {
+        throw error("instruction outside of a function");
+    }
+
+    // 标签: NAME:
+    if (tokens.size() == 2 && tokens[0].kind == IRToken::IDENT &&
+        tokens[1].kind == IRToken::SYMBOL && tokens[1].text == ":") {
+        return std::make_shared<LabelInstr>(tokens[0].text);
+    }
+
+    if (checkIdent("goto")) {
+        advance();
+        auto target = parseLabelOperand();
+        expectEnd();
+        return std::make_shared<GotoInstr>(target);
+    }
+
+    if (checkIdent("if")) {
+        advance();
+        auto condition = parseOperand();
+        if (!checkIdent("goto")) throw error("expected 'goto' after condition");
+        advance();
+        auto target = parseLabelOperand();
+        expectEnd();
+        return std::make_shared<IfGotoInstr>(condition, target);
+    }
+
+    if (checkIdent("param")) {
+        advance();
+        auto param = parseOperand();
+        expectEnd();
+        pendingParams.push_back(param);
+        return std::make_shared<ParamInstr>(param);
+    }
+
+    if (checkIdent("call")) {
+        advance();
+        return parseCall(nullptr);
+    }
+
+    if (checkIdent("return")) {
+        advance();
+        if (atEnd()) {
+            return std::make_shared<ReturnInstr>();
+        }
+        auto value = parseOperand();
+        expectEnd();
+        return std::make_shared<ReturnInstr>(value);
+    }
+
+    return parseDefinition();
+}
+
+// ==================== 各类指令 ====================
+
+// function NAME begin | function TYPE NAME(p, ...) begin | function NAME end
+std::shared_ptr<IRInstr> IRParser::parseFunction() {
+    advance();
+    std::string first = expectIdent("function name");
+
+    if (checkIdent("end")) {
+        advance();
+        expectEnd();
+        if (!inFunction) throw error("'function " + first + " end' without matching begin");
+        inFunction = false;
+        if (!pendingParams.empty()) throw error("param without call before function end");
+        return std::make_shared<FunctionEndInstr>(first);
+    }
+
+    if (inFunction) throw error("nested function '" + first + "'");
+
+    std::string returnType = "int";
+    std::string name = first;
+    std::vector<std::string> params;
+
+    if (!checkIdent("begin")) {
+        returnType = first;
+        name = expectIdent("function name");
+        expectSymbol("(");
+        if (!checkSymbol(")")) {
+            params.push_back(expectIdent("parameter name"));
+            while (checkSymbol(",")) {
+                advance();
+                params.push_back(expectIdent("parameter name"));
+            }
+        }
+        expectSymbol(")");
+    }
+    if (!checkIdent("begin")) throw error("expected 'begin' in function header");
+    advance();
+    expectEnd();
+
+    inFunction = true;
+    operands.clear();
+    pendingParams.clear();
+    currentParams = std::set<std::string>(params.begin(), params.end());
+
+    auto instr = std::make_shared<FunctionBeginInstr>(name, returnType);
+    instr->paramNames = params;
+    return instr;
+}
+
+// call F, N —— params取自最近的N条param指令
+std::shared_ptr<IRInstr> IRParser::parseCall(std::shared_ptr<Operand> result) {
+    std::string funcName = expectIdent("callee name");
+    expectSymbol(",");
+    if (atEnd() || tokens[pos].kind != IRToken::NUMBER || tokens[pos].value < 0) {
+        throw error("expected parameter count after callee name");
+    }
+    int paramCount = static_cast<int>(advance().value);
+    expectEnd();
+
+    if (static_cast<int>(pendingParams.size()) < paramCount) {
+        throw error("call " + funcName + " expects " + std::to_string(paramCount) +
+                    " params but only " + std::to_string(pendingParams.size()) + " precede it");
+    }
+
+    auto call = std::make_shared<CallInstr>(result, funcName, paramCount);
+    call->params.assign(pendingParams.end() - paramCount, pendingParams.end());
+    pendingParams.clear();
+    return call;
+}
+
+// D = X | D = -X | D = !X | D = X op Y | D = call F, N
+std::shared_ptr<IRInstr> IRParser::parseDefinition() {
+    if (atEnd() || tokens[pos].kind != IRToken::IDENT) {
+        throw error("expected an instruction");
+    }
+    auto dest = internName(advance().text);
+    expectSymbol("=");
+
+    if (checkIdent("call")) {
+        advance();
+        return parseCall(dest);
+    }
+
+    if (checkSymbol("-") || checkSymbol("!")) {
+        OpCode op = advance().text == "-" ? OpCode::NEG : OpCode::NOT;
+        auto operand = parseOperand();
+        expectEnd();
+        return std::make_shared<UnaryOpInstr>(op, dest, operand);
+    }
+
+    auto left = parseOperand();
+    if (atEnd()) {
+        return std::make_shared<AssignInstr>(dest, left);
+    }
+
+    auto it = binaryOps.end();
+    if (tokens[pos].kind == IRToken::SYMBOL) {
+        it = binaryOps.find(tokens[pos].text);
+    }
+    if (it == binaryOps.end()) {
+        throw error("unknown binary operator '" + tokens[pos].text + "'");
+    }
+    advance();
+    auto right = parseOperand();
+    expectEnd();
+    return std::make_shared<BinaryOpInstr>(it->second, dest, left, right);
+}
+
+// ==================== 操作数 ====================
+
+std::shared_ptr<Operand> IRParser::parseOperand() {
+    if (atEnd()) throw error("expected an operand");
+    const IRToken& tok = advance();
+    if (tok.kind == IRToken::NUMBER) {
+        return std::make_shared<Operand>(static_cast<int>(tok.value));
+    }
+    if (tok.kind == IRToken::IDENT) {
+        return internName(tok.text);
+    }
+    throw error("expected an operand, got '" + tok.text + "'");
+}
+
+std::shared_ptr<Operand> IRParser::parseLabelOperand() {
+    return std::make_shared<Operand>(OperandType::LABEL, expectIdent("label"));
+}
+
+std::shared_ptr<Operand> IRParser::internName(const std::string& name) {
+    auto it = operands.find(name);
+    if (it != operands.end()) return it->second;
+
+    OperandType type = (isTempName(name) && !currentParams.count(name))
+                           ? OperandType::TEMP : OperandType::VARIABLE;
+    auto op = std::make_shared<Operand>(type, name);
+    operands[name] = op;
+    return op;
+}
+
+// ==================== 标记辅助函数 ====================
+
+bool IRParser::checkSymbol(const std::string& sym) const {
+    return !atEnd() && tokens[pos].kind == IRToken::SYMBOL && tokens[pos].text == sym;
+}
+
+bool IRParser::checkIdent(const std::string& word) const {
+    return !atEnd() && tokens[pos].kind == IRToken::IDENT && tokens[pos].text == word;
+}
+
+const IRParser::IRToken& IRParser::advance() {
+    if (atEnd()) throw error("unexpected end of line");
+    return tokens[pos++];
+}
+
+std::string IRParser::expectIdent(const std::string& what) {
+    if (atEnd() || tokens[pos].kind != IRToken::IDENT) {
+        throw error("expected " + what);
+    }
+    return advance().text;
+}
+
+void IRParser::expectSymbol(const std::string& sym) {
+    if (!checkSymbol(sym)) throw error("expected '" + sym + "'");
+    advance();
+}
+
+void IRParser::expectEnd() {
+    if (!atEnd()) throw error("unexpected '" + tokens[pos].text + "' at end of instruction");
+}
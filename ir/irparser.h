@@ -0,0 +1,76 @@
+#pragma once
+#include "ir.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
+
+// ==================== IR文本解析 ====================
+//
+// 读取IRPrinter::print / IRGenerator::dumpIR输出的文本IR，重建IR指令序列，
+// 便于保存精简的IR用例、直接对IR运行优化遍和后端。
+//
+// 约定：
+//   - '#'开头的内容为注释，空行忽略
+//   - 形如 t<数字> 的名字视为临时变量，除非它是当前函数的形参
+//   - 同一函数内同名的变量/临时变量共享同一个Operand对象（与IRGenerator一致）
+//   - call指令的params由其前面最近的paramCount条param指令重建
+
+class IRParseError : public std::runtime_error {
+public:
+    int line;
+
+    IRParseError(const std::string& message, int line)
+        : std::runtime_error("IR line " + std::to_string(line) + ": " + message), line(line) {}
+};
+
+class IRParser {
+private:
+    struct IRToken {
+        enum Kind { IDENT, NUMBER, SYMBOL } kind;
+        std::string text;
+        long long value = 0;
+    };
+
+    std::string source;
+    int lineNo = 0;
+
+    // 当前行的标记
+    std::vector<IRToken> tokens;
+    size_t pos = 0;
+
+    // 当前函数上下文
+    std::map<std::string, std::shared_ptr<Operand>> operands;
+    std::set<std::string> currentParams;
+    std::vector<std::shared_ptr<Operand>> pendingParams;
+    bool inFunction = false;
+
+public:
+    explicit IRParser(const std::string& source) : source(source) {}
+
+    // 解析全部文本，出错时抛出IRParseError
+    std::vector<std::shared_ptr<IRInstr>> parse();
+
+private:
+    void tokenizeLine(const std::string& line);
+    std::shared_ptr<IRInstr> parseLine();
+
+    std::shared_ptr<IRInstr> parseFunction();
+    std::shared_ptr<IRInstr> parseCall(std::shared_ptr<Operand> result);
+    std::shared_ptr<IRInstr> parseDefinition();
+
+    std::shared_ptr<Operand> parseOperand();
+    std::shared_ptr<Operand> parseLabelOperand();
+    std::shared_ptr<Operand> internName(const std::string& name);
+
+    bool atEnd() const { return pos >= tokens.size(); }
+    bool checkSymbol(const std::string& sym) const;
+    bool checkIdent(const std::string& word) const;
+    const IRToken& advance();
+    std::string expectIdent(const std::string& what);
+    void expectSymbol(const std::string& sym);
+    void expectEnd();
+    IRParseError error(const std::string& message) const { return IRParseError(message, lineNo); }
+};
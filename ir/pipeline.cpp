@@ -0,0 +1,49 @@
+// pipeline.cpp - 优化流水线预设
+#include "pipeline.h"
+
+std::string OptPipeline::passList() const {
+    std::string text;
+    for (const auto& pass : passes) {
+        if (!text.empty()) text += ",";
+        text += pass;
+    }
+    return text;
+}
+
+std::vector<std::string> OptPipeline::parsePassList(const std::string& text) {
+    std::vector<std::string> passes;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) end = text.size();
+        std::string pass = text.substr(start, end - start);
+        size_t first = pass.find_first_not_of(" \t");
+        size_t last = pass.find_last_not_of(" \t");
+        if (first != std::string::npos) passes.push_back(pass.substr(first, last - first + 1));
+        start = end + 1;
+    }
+    return passes;
+}
+
+const std::vector<OptPipeline>& OptPipeline::presets() {
+    static const std::vector<OptPipeline> pipelines = [] {
+        std::vector<OptPipeline> result;
+#define TOYC_PIPELINE_PRESET(name, passes, inlineMaxInstructions, inlineMaxCallSites) \
+        result.push_back({name, parsePassList(passes), inlineMaxInstructions, inlineMaxCallSites});
+#include "pipeline_presets.inc"
+#undef TOYC_PIPELINE_PRESET
+        return result;
+    }();
+    return pipelines;
+}
+
+const OptPipeline* OptPipeline::findPreset(const std::string& name) {
+    for (const auto& pipeline : presets()) {
+        if (pipeline.name == name) return &pipeline;
+    }
+    return nullptr;
+}
+
+const OptPipeline& OptPipeline::standard() {
+    return *findPreset("default");
+}
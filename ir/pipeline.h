@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// ==================== 优化流水线 ====================
+//
+// -opt执行的优化遍序列（按顺序执行，同一个遍可以出现多次）和内联阈值。
+// 命名预设在ir/pipeline_presets.inc中，由离线自动调优工具toyc_autotune在基准语料上
+// 搜索后写入；"default"是手工确定的原始流水线。
+struct OptPipeline {
+    std::string name;
+    std::vector<std::string> passes;
+    int inlineMaxInstructions = 10;  // 只内联函数体不超过这么多条IR指令的函数
+    int inlineMaxCallSites = 1;      // 且调用点不超过这么多个
+
+    // 逗号分隔的遍列表
+    std::string passList() const;
+    static std::vector<std::string> parsePassList(const std::string& text);
+
+    static const std::vector<OptPipeline>& presets();
+    static const OptPipeline* findPreset(const std::string& name);  // 未知的名字返回nullptr
+    static const OptPipeline& standard();                           // "default"
+};
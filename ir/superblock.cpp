@@ -0,0 +1,367 @@
+// superblock.cpp - 超块形成（沿轨迹尾复制）实现
+#include "superblock.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+constexpr int kMaxTailInstructions = 40;  // 每条轨迹最多复制的指令数
+constexpr int kMinFunctionGrowth = 16;    // 小函数也允许的增长量
+
+// 临时变量的新名字，以及原操作数对象到新对象的对应
+struct Rename {
+    std::string name;
+    std::unordered_map<const Operand*, std::shared_ptr<Operand>> copies;
+};
+using RenameMap = std::unordered_map<std::string, Rename>;
+
+// 访问指令的全部数据操作数（不含标签）
+template <typename Fn>
+void forEachOperand(const std::shared_ptr<IRInstr>& instr, Fn&& fn) {
+    if (auto bin = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) {
+        fn(bin->result); fn(bin->left); fn(bin->right);
+    } else if (auto un = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) {
+        fn(un->result); fn(un->operand);
+    } else if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) {
+        fn(assign->target); fn(assign->source);
+    } else if (auto branch = std::dynamic_pointer_cast<IfGotoInstr>(instr)) {
+        fn(branch->condition);
+    } else if (auto param = std::dynamic_pointer_cast<ParamInstr>(instr)) {
+        fn(param->param);
+    } else if (auto call = std::dynamic_pointer_cast<CallInstr>(instr)) {
+        fn(call->result);
+        for (const auto& p : call->params) fn(p);
+    } else if (auto ret = std::dynamic_pointer_cast<ReturnInstr>(instr)) {
+        fn(ret->value);
+    }
+}
+
+// 指令定义的操作数
+std::shared_ptr<Operand> definedOperand(const std::shared_ptr<IRInstr>& instr) {
+    if (auto bin = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) return bin->result;
+    if (auto un = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) return un->result;
+    if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) return assign->target;
+    if (auto call = std::dynamic_pointer_cast<CallInstr>(instr)) return call->result;
+    return nullptr;
+}
+
+// 复制品与原指令共享操作数对象（与生成器的约定一致：复制传播等就地改名的遍会同时作用于两者）；
+// 改名的临时变量按原操作数对象一一对应新对象，保持原来的共享关系
+std::shared_ptr<Operand> cloneOperand(const std::shared_ptr<Operand>& op, RenameMap& renames) {
+    if (!op || !op->isTemp()) return op;
+    auto it = renames.find(op->name);
+    if (it == renames.end()) return op;
+    auto& copy = it->second.copies[op.get()];
+    if (!copy) copy = std::make_shared<Operand>(OperandType::TEMP, it->second.name);
+    return copy;
+}
+
+std::shared_ptr<IRInstr> cloneInstr(const std::shared_ptr<IRInstr>& instr, RenameMap& renames) {
+    std::shared_ptr<IRInstr> copy;
+    if (auto bin = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) {
+        copy = std::make_shared<BinaryOpInstr>(bin->opcode, cloneOperand(bin->result, renames),
+                                               cloneOperand(bin->left, renames), cloneOperand(bin->right, renames));
+    } else if (auto un = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) {
+        copy = std::make_shared<UnaryOpInstr>(un->opcode, cloneOperand(un->result, renames),
+                                              cloneOperand(un->operand, renames));
+    } else if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) {
+        copy = std::make_shared<AssignInstr>(cloneOperand(assign->target, renames),
+                                             cloneOperand(assign->source, renames));
+    } else if (auto jump = std::dynamic_pointer_cast<GotoInstr>(instr)) {
+        copy = std::make_shared<GotoInstr>(cloneOperand(jump->target, renames));
+    } else if (auto branch = std::dynamic_pointer_cast<IfGotoInstr>(instr)) {
+        copy = std::make_shared<IfGotoInstr>(cloneOperand(branch->condition, renames),
+                                             cloneOperand(branch->target, renames));
+    } else if (auto param = std::dynamic_pointer_cast<ParamInstr>(instr)) {
+        copy = std::make_shared<ParamInstr>(cloneOperand(param->param, renames));
+    } else if (auto call = std::dynamic_pointer_cast<CallInstr>(instr)) {
+        auto callCopy = std::make_shared<CallInstr>(cloneOperand(call->result, renames), call->funcName,
+                                                    call->paramCount);
+        for (const auto& p : call->params) callCopy->params.push_back(cloneOperand(p, renames));
+        copy = callCopy;
+    } else if (auto ret = std::dynamic_pointer_cast<ReturnInstr>(instr)) {
+        copy = std::make_shared<ReturnInstr>(cloneOperand(ret->value, renames));
+    } else {
+        return nullptr;
+    }
+    copy->loc = instr->loc;
+    return copy;
+}
+
+bool endsBlock(OpCode opcode) {
+    return opcode == OpCode::GOTO || opcode == OpCode::IF_GOTO || opcode == OpCode::RETURN;
+}
+
+} // namespace
+
+// ==================== 入口 ====================
+
+SuperblockFormer::Stats SuperblockFormer::run(std::vector<std::shared_ptr<IRInstr>>& instructions) {
+    stats = Stats();
+    std::vector<std::shared_ptr<IRInstr>> result;
+    result.reserve(instructions.size());
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        size_t end = i + 1;
+        bool function = instructions[i]->opcode == OpCode::FUNCTION_BEGIN;
+        while (function && end < instructions.size() && instructions[end]->opcode != OpCode::FUNCTION_END) ++end;
+        if (!function || end == instructions.size()) {
+            result.push_back(instructions[i]);
+            continue;
+        }
+        std::vector<std::shared_ptr<IRInstr>> functionBody(instructions.begin() + i + 1, instructions.begin() + end);
+        formFunction(functionBody);
+        result.push_back(instructions[i]);
+        result.insert(result.end(), functionBody.begin(), functionBody.end());
+        result.push_back(instructions[end]);
+        i = end;
+    }
+    instructions.swap(result);
+    return stats;
+}
+
+void SuperblockFormer::formFunction(std::vector<std::shared_ptr<IRInstr>>& functionBody) {
+    body = functionBody;
+    if (!buildBlocks()) return;
+
+    // 内层循环先选轨迹，先使用增长预算
+    std::vector<size_t> heads;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (blocks[b].header) heads.push_back(b);
+    }
+    std::stable_sort(heads.begin(), heads.end(),
+                     [&](size_t a, size_t b) { return blocks[a].depth > blocks[b].depth; });
+
+    int budget = std::max(kMinFunctionGrowth, static_cast<int>(body.size()) / 2);
+    std::vector<bool> inTrace(blocks.size(), false);
+    std::vector<Duplication> plans;
+    for (size_t head : heads) {
+        if (inTrace[head]) continue;
+        std::vector<size_t> trace = selectTrace(head, inTrace);
+        for (size_t b : trace) inTrace[b] = true;
+        if (trace.size() < 2) continue;
+        ++stats.traces;
+
+        Duplication plan;
+        if (!planDuplication(trace, budget, plan)) continue;
+        emitCopies(plan);
+        ++stats.superblocks;
+        stats.duplicatedBlocks += static_cast<int>(plan.region.size());
+        stats.duplicatedInstructions += static_cast<int>(plan.copies.size());
+        plans.push_back(std::move(plan));
+    }
+    if (plans.empty()) return;
+
+    // 轨迹互不相交，每个块至多是一次复制的前驱
+    std::vector<const Duplication*> planFrom(blocks.size(), nullptr);
+    for (const auto& plan : plans) planFrom[plan.from] = &plan;
+    std::vector<std::shared_ptr<IRInstr>> result;
+    result.reserve(body.size() + stats.duplicatedInstructions);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        if (needsLabel[b]) result.push_back(std::make_shared<LabelInstr>(blockLabels[b]));
+        const Duplication* plan = planFrom[b];
+        size_t last = plan && plan->replaceGoto ? blocks[b].last - 1 : blocks[b].last;
+        result.insert(result.end(), body.begin() + blocks[b].first, body.begin() + last);
+        if (plan) result.insert(result.end(), plan->copies.begin(), plan->copies.end());
+    }
+    functionBody.swap(result);
+}
+
+// ==================== 控制流图 ====================
+
+// 基本块从标签（连续的标签属于同一块）或跳转、返回之后开始。
+// 跳到函数外标签的函数不处理
+bool SuperblockFormer::buildBlocks() {
+    blocks.clear();
+    blockLabels.clear();
+    bool startNew = true;
+    for (size_t i = 0; i < body.size(); ++i) {
+        bool label = body[i]->opcode == OpCode::LABEL;
+        if (startNew || (label && body[i - 1]->opcode != OpCode::LABEL)) {
+            blocks.push_back(Block());
+            blocks.back().first = i;
+            blockLabels.push_back(label ? std::static_pointer_cast<LabelInstr>(body[i])->label : "");
+        }
+        blocks.back().last = i + 1;
+        startNew = endsBlock(body[i]->opcode);
+    }
+    needsLabel.assign(blocks.size(), false);
+
+    std::unordered_map<std::string, size_t> labelBlock;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (size_t i = blocks[b].first; i < blocks[b].last && body[i]->opcode == OpCode::LABEL; ++i) {
+            labelBlock[std::static_pointer_cast<LabelInstr>(body[i])->label] = b;
+        }
+    }
+
+    std::vector<int> depths = IRAnalyzer::computeLoopDepths(body);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        Block& block = blocks[b];
+        block.depth = depths[block.first];
+        const auto& last = body[block.last - 1];
+        std::shared_ptr<Operand> target;
+        if (auto jump = std::dynamic_pointer_cast<GotoInstr>(last)) target = jump->target;
+        if (auto branch = std::dynamic_pointer_cast<IfGotoInstr>(last)) target = branch->target;
+        if (target) {
+            auto it = labelBlock.find(target->name);
+            if (it == labelBlock.end()) return false;
+            block.succs.push_back(it->second);
+        }
+        bool fallsThrough = last->opcode != OpCode::GOTO && last->opcode != OpCode::RETURN;
+        if (fallsThrough && b + 1 < blocks.size() && (block.succs.empty() || block.succs[0] != b + 1)) {
+            block.succs.push_back(b + 1);
+        }
+    }
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        for (size_t s : blocks[b].succs) {
+            blocks[s].preds.push_back(b);
+            if (s <= b) blocks[s].header = true;
+        }
+    }
+    return true;
+}
+
+// ==================== 轨迹选择 ====================
+
+// 静态分支预测：回边（继续循环）> 留在循环内 > 不直接返回 > 落入方向
+size_t SuperblockFormer::likelySuccessor(size_t b) const {
+    const auto& succs = blocks[b].succs;
+    if (succs.empty()) return blocks.size();
+    if (succs.size() == 1) return succs[0];
+    size_t taken = succs[0], fall = succs[1];
+    auto back = [&](size_t s) { return s <= b; };
+    auto leaves = [&](size_t s) { return blocks[s].depth < blocks[b].depth; };
+    auto returns = [&](size_t s) { return body[blocks[s].last - 1]->opcode == OpCode::RETURN; };
+    if (back(taken) != back(fall)) return back(taken) ? taken : fall;
+    if (leaves(taken) != leaves(fall)) return leaves(taken) ? fall : taken;
+    if (returns(taken) != returns(fall)) return returns(taken) ? fall : taken;
+    return fall;
+}
+
+std::vector<size_t> SuperblockFormer::selectTrace(size_t head, const std::vector<bool>& inTrace) const {
+    std::vector<size_t> trace{head};
+    size_t current = head;
+    while (true) {
+        size_t next = likelySuccessor(current);
+        if (next == blocks.size() || next <= current || inTrace[next] || blocks[next].header ||
+            blocks[next].depth < blocks[head].depth) {
+            break;
+        }
+        // 条件跳转的目标方向：复制品需要反转条件才能落入，不延伸
+        if (body[blocks[current].last - 1]->opcode == OpCode::IF_GOTO && next != current + 1) break;
+        trace.push_back(next);
+        current = next;
+    }
+    return trace;
+}
+
+// ==================== 尾复制 ====================
+
+bool SuperblockFormer::planDuplication(const std::vector<size_t>& trace, int& budget, Duplication& plan) {
+    size_t entry = 1;
+    while (entry < trace.size() &&
+           std::all_of(blocks[trace[entry]].preds.begin(), blocks[trace[entry]].preds.end(),
+                       [&](size_t p) { return p == trace[entry - 1]; })) {
+        ++entry;
+    }
+    if (entry == trace.size()) return false;
+
+    plan.from = trace[entry - 1];
+    plan.replaceGoto = body[blocks[plan.from].last - 1]->opcode == OpCode::GOTO;
+
+    // 复制范围止于循环的回边块之前：复制回边块相当于循环轮转，会改变循环头
+    size_t maxEnd = entry;
+    while (maxEnd < trace.size() &&
+           std::none_of(blocks[trace[maxEnd]].succs.begin(), blocks[trace[maxEnd]].succs.end(),
+                        [&](size_t s) { return s <= trace[maxEnd]; })) {
+        ++maxEnd;
+    }
+
+    // 从最长的范围开始尝试，逐步缩短到满足预算且临时变量不跨出复制范围
+    int limit = std::min(kMaxTailInstructions, budget);
+    for (size_t end = maxEnd; end > entry; --end) {
+        std::vector<size_t> region(trace.begin() + entry, trace.begin() + end);
+        size_t tail = region.back();
+        bool closing = body[blocks[tail].last - 1]->opcode != OpCode::GOTO &&
+                       body[blocks[tail].last - 1]->opcode != OpCode::RETURN;
+        if (closing && tail + 1 == blocks.size()) continue;
+
+        int size = closing ? 1 : 0;
+        bool copyable = true;
+        for (size_t b : region) {
+            for (size_t i = blocks[b].first; i < blocks[b].last; ++i) {
+                OpCode opcode = body[i]->opcode;
+                if (opcode == OpCode::LABEL) continue;
+                if (opcode == OpCode::PROFILE_COUNT) copyable = false;
+                ++size;
+            }
+        }
+        if (!copyable || size > limit || !regionTempsAreLocal(region)) continue;
+
+        plan.region = std::move(region);
+        budget -= size;
+        return true;
+    }
+    return false;
+}
+
+bool SuperblockFormer::regionTempsAreLocal(const std::vector<size_t>& region) const {
+    std::vector<bool> inRegion(blocks.size(), false);
+    for (size_t b : region) inRegion[b] = true;
+
+    std::unordered_set<std::string> defined;
+    for (size_t b : region) {
+        for (size_t i = blocks[b].first; i < blocks[b].last; ++i) {
+            auto def = definedOperand(body[i]);
+            if (def && def->isTemp()) defined.insert(def->name);
+        }
+    }
+    if (defined.empty()) return true;
+
+    bool local = true;
+    for (size_t b = 0; b < blocks.size() && local; ++b) {
+        if (inRegion[b]) continue;
+        for (size_t i = blocks[b].first; i < blocks[b].last; ++i) {
+            forEachOperand(body[i], [&](const std::shared_ptr<Operand>& op) {
+                if (op && op->isTemp() && defined.count(op->name)) local = false;
+            });
+        }
+    }
+    return local;
+}
+
+// 复制品按轨迹顺序相接：块间的goto去掉，最后一块补goto回到原来的后继
+void SuperblockFormer::emitCopies(Duplication& plan) {
+    RenameMap renames;
+    for (size_t b : plan.region) {
+        for (size_t i = blocks[b].first; i < blocks[b].last; ++i) {
+            auto def = definedOperand(body[i]);
+            if (def && def->isTemp() && !renames.count(def->name)) renames[def->name].name = newTemp()->name;
+        }
+    }
+
+    for (size_t k = 0; k < plan.region.size(); ++k) {
+        size_t b = plan.region[k];
+        bool tail = k + 1 == plan.region.size();
+        for (size_t i = blocks[b].first; i < blocks[b].last; ++i) {
+            OpCode opcode = body[i]->opcode;
+            if (opcode == OpCode::LABEL) continue;
+            if (!tail && i + 1 == blocks[b].last && opcode == OpCode::GOTO) continue;
+            plan.copies.push_back(cloneInstr(body[i], renames));
+        }
+        OpCode lastOpcode = body[blocks[b].last - 1]->opcode;
+        if (tail && lastOpcode != OpCode::GOTO && lastOpcode != OpCode::RETURN) {
+            auto jump = std::make_shared<GotoInstr>(labelOf(b + 1));
+            jump->loc = body[blocks[b].last - 1]->loc;
+            plan.copies.push_back(jump);
+        }
+    }
+}
+
+std::shared_ptr<Operand> SuperblockFormer::labelOf(size_t b) {
+    if (blockLabels[b].empty()) {
+        blockLabels[b] = newLabel()->name;
+        needsLabel[b] = true;
+    }
+    return std::make_shared<Operand>(OperandType::LABEL, blockLabels[b]);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "ir.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ==================== 超块形成（superblockFormation） ====================
+//
+// 在循环中沿最可能的路径选出轨迹（trace），用尾复制消除轨迹的侧入口，
+// 使轨迹成为只有一个入口、可以有多个出口的超块，块内的局部优化可以跨越原来的汇合点：
+// - 轨迹从循环头出发，每步选最可能的后继：留在循环内、不直接返回的后继优先，
+//   都满足时取落入方向（ToyC的if先生成then分支）；遇到回边、其他循环头或离开
+//   种子所在循环时停止。按条件跳转方向的边不延伸轨迹（线性IR中需要反转条件）
+// - 轨迹中第一个有侧入口的汇合块及其后的所有块复制一份，放在前驱块之后（替换前驱的
+//   goto或紧跟在落入处）；复制品没有标签，只能从轨迹进入，末尾补goto回到原来的后继。
+//   原块保留给侧入口使用
+// - 复制范围不包含循环的回边块（复制它相当于循环轮转，循环头随之改变）
+// - 只在复制范围内定义和使用的临时变量在复制品中重命名；有临时变量跨出复制范围时
+//   缩短复制范围
+// - 代码增长预算：每条轨迹最多复制kMaxTailInstructions条指令，每个函数最多增长
+//   原大小的一半（至少kMinFunctionGrowth条）；内层循环优先使用预算
+class SuperblockFormer {
+public:
+    struct Stats {
+        int traces = 0;                 // 选出的长度不小于2的轨迹
+        int superblocks = 0;            // 做了尾复制的轨迹
+        int duplicatedBlocks = 0;
+        int duplicatedInstructions = 0;
+    };
+
+    using OperandFactory = std::function<std::shared_ptr<Operand>()>;
+
+    // newTemp为复制品中的临时变量改名，newLabel为需要跳回的无标签块创建标签
+    SuperblockFormer(OperandFactory newTemp, OperandFactory newLabel)
+        : newTemp(std::move(newTemp)), newLabel(std::move(newLabel)) {}
+
+    Stats run(std::vector<std::shared_ptr<IRInstr>>& instructions);
+
+private:
+    struct Block {
+        size_t first = 0, last = 0;     // 指令区间[first, last)
+        std::vector<size_t> succs;      // 条件跳转为{目标, 落入}
+        std::vector<size_t> preds;
+        int depth = 0;
+        bool header = false;            // 回边的目标
+    };
+
+    // 一次尾复制：把轨迹块region（按顺序）复制到from块的出口
+    struct Duplication {
+        size_t from = 0;
+        bool replaceGoto = false;       // from以goto进入region.front()，复制品替换该goto
+        std::vector<size_t> region;
+        std::vector<std::shared_ptr<IRInstr>> copies;
+    };
+
+    OperandFactory newTemp;
+    OperandFactory newLabel;
+    Stats stats;
+
+    // 当前函数
+    std::vector<std::shared_ptr<IRInstr>> body;
+    std::vector<Block> blocks;
+    std::vector<std::string> blockLabels;   // 块的首标签，没有标签时为空
+    std::vector<bool> needsLabel;           // 复制品需要跳到这个无标签块
+
+    void formFunction(std::vector<std::shared_ptr<IRInstr>>& functionBody);
+    bool buildBlocks();
+    size_t likelySuccessor(size_t b) const;
+    std::vector<size_t> selectTrace(size_t head, const std::vector<bool>& inTrace) const;
+    bool planDuplication(const std::vector<size_t>& trace, int& budget, Duplication& plan);
+    bool regionTempsAreLocal(const std::vector<size_t>& region) const;
+    void emitCopies(Duplication& plan);
+    std::shared_ptr<Operand> labelOf(size_t b);
+};
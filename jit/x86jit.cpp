@@ -0,0 +1,538 @@
+// x86jit.cpp - IR到x86-64机器码的JIT实现
+#include "x86jit.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+enum Reg {
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R8 = 8, R9 = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15
+};
+
+const int argRegs[] = {RDI, RSI, RDX, RCX, R8, R9};
+const int allocatableRegs[] = {RBX, R12, R13, R14, R15};
+
+// 条件码（Jcc/SETcc的低4位）
+enum Cond { CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+
+// ==================== 机器码缓冲区 ====================
+
+class CodeBuffer {
+public:
+    std::vector<uint8_t> bytes;
+
+    size_t pos() const { return bytes.size(); }
+    void byte(uint8_t b) { bytes.push_back(b); }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; ++i) byte(static_cast<uint8_t>(v >> (8 * i)));
+    }
+    void patchRel32(size_t at, size_t target) {
+        int32_t rel = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+        std::memcpy(&bytes[at], &rel, 4);
+    }
+
+    // 32位操作的REX前缀：只有用到r8-r15时才需要
+    void rex(bool wide, int reg, int rm) {
+        uint8_t v = 0x40 | (wide ? 8 : 0) | ((reg >> 3) & 1) << 2 | ((rm >> 3) & 1);
+        if (v != 0x40) byte(v);
+    }
+    void modrmReg(int reg, int rm) { byte(static_cast<uint8_t>(0xC0 | (reg & 7) << 3 | (rm & 7))); }
+    void modrmRbp(int reg, int disp) {
+        byte(static_cast<uint8_t>(0x80 | (reg & 7) << 3 | 5));
+        u32(static_cast<uint32_t>(disp));
+    }
+
+    // op r/m32, r32
+    void aluRegReg(uint8_t opcode, int dst, int src) {
+        rex(false, src, dst);
+        byte(opcode);
+        modrmReg(src, dst);
+    }
+    void mov(int dst, int src) {
+        if (dst != src) aluRegReg(0x89, dst, src);
+    }
+    void movImm(int dst, int32_t imm) {
+        if (imm == 0) {
+            aluRegReg(0x31, dst, dst);  // xor r, r
+            return;
+        }
+        rex(false, 0, dst);
+        byte(static_cast<uint8_t>(0xB8 + (dst & 7)));
+        u32(static_cast<uint32_t>(imm));
+    }
+    void load(int dst, int disp) {   // mov r32, [rbp+disp]
+        rex(false, dst, RBP);
+        byte(0x8B);
+        modrmRbp(dst, disp);
+    }
+    void store(int disp, int src) {  // mov [rbp+disp], r32
+        rex(false, src, RBP);
+        byte(0x89);
+        modrmRbp(src, disp);
+    }
+    void imul(int dst, int src) {
+        rex(false, dst, src);
+        byte(0x0F);
+        byte(0xAF);
+        modrmReg(dst, src);
+    }
+    void unaryF7(int ext, int reg) {  // neg(/3), idiv(/7)
+        rex(false, 0, reg);
+        byte(0xF7);
+        modrmReg(ext, reg);
+    }
+    void setccAl(Cond cc) {          // setcc al; movzx eax, al
+        byte(0x0F); byte(static_cast<uint8_t>(0x90 | cc)); byte(0xC0);
+        byte(0x0F); byte(0xB6); byte(0xC0);
+    }
+    void push(int reg) {
+        if (reg >= 8) byte(0x41);
+        byte(static_cast<uint8_t>(0x50 + (reg & 7)));
+    }
+    void pop(int reg) {
+        if (reg >= 8) byte(0x41);
+        byte(static_cast<uint8_t>(0x58 + (reg & 7)));
+    }
+    void rspImm(bool add, int32_t imm) {  // add/sub rsp, imm32
+        byte(0x48); byte(0x81); byte(add ? 0xC4 : 0xEC);
+        u32(static_cast<uint32_t>(imm));
+    }
+    size_t jmp() { byte(0xE9); u32(0); return pos() - 4; }
+    size_t jcc(Cond cc) { byte(0x0F); byte(static_cast<uint8_t>(0x80 | cc)); u32(0); return pos() - 4; }
+    size_t call() { byte(0xE8); u32(0); return pos() - 4; }
+};
+
+// ==================== 单个函数翻译 ====================
+
+struct Home {
+    bool inReg = false;
+    int reg = 0;
+    int disp = 0;
+};
+
+struct CallFixup {
+    size_t at;
+    std::string callee;
+};
+
+class FunctionTranslator {
+public:
+    FunctionTranslator(CodeBuffer& buf, const FunctionBeginInstr& begin,
+                       const std::vector<std::shared_ptr<IRInstr>>& body,
+                       const std::map<std::string, size_t>& paramCounts,
+                       std::vector<CallFixup>& callFixups)
+        : buf(buf), begin(begin), body(body), paramCounts(paramCounts), callFixups(callFixups) {}
+
+    void translate() {
+        assignHomes();
+        emitPrologue();
+        for (const auto& instr : body) translateInstr(instr);
+        // 落到函数结尾（void函数或缺少return）时返回0
+        buf.movImm(RAX, 0);
+        bindLabel(epilogueLabel);
+        emitEpilogue();
+        for (const auto& [at, label] : jumpFixups) {
+            if (labelPos[label] == SIZE_MAX) {
+                throw JitError("function '" + begin.funcName + "' jumps to an undefined label");
+            }
+            buf.patchRel32(at, labelPos[label]);
+        }
+    }
+
+private:
+    CodeBuffer& buf;
+    const FunctionBeginInstr& begin;
+    const std::vector<std::shared_ptr<IRInstr>>& body;
+    const std::map<std::string, size_t>& paramCounts;
+    std::vector<CallFixup>& callFixups;
+
+    std::map<std::string, Home> homes;
+    std::vector<int> savedRegs;
+    int frameBytes = 0;
+
+    std::map<std::string, int> labelIds;
+    std::vector<size_t> labelPos;
+    std::vector<std::pair<size_t, int>> jumpFixups;
+    int epilogueLabel = newLabel();
+    std::vector<std::shared_ptr<Operand>> paramQueue;
+
+    int newLabel() {
+        labelPos.push_back(SIZE_MAX);
+        return static_cast<int>(labelPos.size()) - 1;
+    }
+    int labelFor(const std::string& name) {
+        auto it = labelIds.find(name);
+        if (it != labelIds.end()) return it->second;
+        int id = newLabel();
+        labelIds[name] = id;
+        return id;
+    }
+    void bindLabel(int id) { labelPos[id] = buf.pos(); }
+    void jumpTo(size_t at, int label) { jumpFixups.emplace_back(at, label); }
+
+    // ---------- 寄存器分配 ----------
+
+    // 按循环深度加权的使用次数挑选变量放进被调用者保存寄存器
+    void assignHomes() {
+        std::map<std::string, size_t> labelIndex;
+        for (size_t i = 0; i < body.size(); ++i) {
+            if (auto label = std::dynamic_pointer_cast<LabelInstr>(body[i])) labelIndex[label->label] = i;
+        }
+        std::vector<int> depth(body.size(), 0);
+        for (size_t j = 0; j < body.size(); ++j) {
+            std::shared_ptr<Operand> target;
+            if (auto g = std::dynamic_pointer_cast<GotoInstr>(body[j])) target = g->target;
+            else if (auto c = std::dynamic_pointer_cast<IfGotoInstr>(body[j])) target = c->target;
+            if (!target) continue;
+            auto it = labelIndex.find(target->name);
+            if (it == labelIndex.end() || it->second > j) continue;
+            for (size_t k = it->second; k <= j; ++k) ++depth[k];
+        }
+
+        std::map<std::string, double> weight;
+        std::vector<std::string> order;
+        auto touch = [&](const std::string& name, double w) {
+            if (!weight.count(name)) order.push_back(name);
+            weight[name] += w;
+        };
+        for (size_t i = 0; i < begin.paramNames.size(); ++i) touch(begin.paramNames[i], 1.0);
+        for (size_t i = 0; i < body.size(); ++i) {
+            double w = 1.0;
+            for (int d = 0; d < std::min(depth[i], 4); ++d) w *= 10.0;
+            for (const auto& name : body[i]->getDefRegisters()) touch(name, w);
+            for (const auto& name : body[i]->getUseRegisters()) touch(name, w);
+        }
+
+        // 第7个及以后的形参留在调用者压栈的位置
+        for (size_t i = 6; i < begin.paramNames.size(); ++i) {
+            homes[begin.paramNames[i]].disp = 16 + 8 * static_cast<int>(i - 6);
+        }
+
+        std::vector<std::string> candidates;
+        for (const auto& name : order) {
+            if (!homes.count(name)) candidates.push_back(name);
+        }
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [&](const std::string& a, const std::string& b) { return weight[a] > weight[b]; });
+
+        size_t regCount = std::min(candidates.size(), std::size(allocatableRegs));
+        for (size_t i = 0; i < regCount; ++i) {
+            savedRegs.push_back(allocatableRegs[i]);
+            homes[candidates[i]] = {true, allocatableRegs[i], 0};
+        }
+        int savedBytes = 8 * static_cast<int>(savedRegs.size());
+        int slot = 0;
+        for (size_t i = regCount; i < candidates.size(); ++i) {
+            homes[candidates[i]].disp = -(savedBytes + 8 * ++slot);
+        }
+        // push rbp之后rsp按16对齐；被保存寄存器与栈槽合计也保持16对齐，调用点无需再调整
+        frameBytes = 8 * slot;
+        if ((savedBytes + frameBytes) % 16 != 0) frameBytes += 8;
+    }
+
+    const Home& homeOf(const std::shared_ptr<Operand>& op) {
+        auto it = homes.find(op->name);
+        if (it == homes.end()) {
+            throw JitError("function '" + begin.funcName + "' uses unknown operand '" + op->name + "'");
+        }
+        return it->second;
+    }
+
+    void load(const std::shared_ptr<Operand>& op, int reg) {
+        if (!op) {
+            buf.movImm(reg, 0);
+        } else if (op->type == OperandType::CONSTANT) {
+            buf.movImm(reg, op->value);
+        } else {
+            const Home& home = homeOf(op);
+            if (home.inReg) buf.mov(reg, home.reg);
+            else buf.load(reg, home.disp);
+        }
+    }
+
+    void store(int reg, const std::shared_ptr<Operand>& op) {
+        if (!op) return;
+        const Home& home = homeOf(op);
+        if (home.inReg) buf.mov(home.reg, reg);
+        else buf.store(home.disp, reg);
+    }
+
+    // ---------- 序言和后记 ----------
+
+    void emitPrologue() {
+        buf.push(RBP);
+        buf.byte(0x48); buf.byte(0x89); buf.byte(0xE5);  // mov rbp, rsp
+        for (int reg : savedRegs) buf.push(reg);
+        if (frameBytes > 0) buf.rspImm(false, frameBytes);
+
+        size_t regParams = std::min<size_t>(begin.paramNames.size(), 6);
+        for (size_t i = 0; i < regParams; ++i) {
+            const Home& home = homes[begin.paramNames[i]];
+            if (home.inReg) buf.mov(home.reg, argRegs[i]);
+            else buf.store(home.disp, argRegs[i]);
+        }
+    }
+
+    void emitEpilogue() {
+        // lea rsp, [rbp - 8*saved]
+        buf.byte(0x48); buf.byte(0x8D); buf.byte(0xA5);
+        buf.u32(static_cast<uint32_t>(-8 * static_cast<int>(savedRegs.size())));
+        for (auto it = savedRegs.rbegin(); it != savedRegs.rend(); ++it) buf.pop(*it);
+        buf.pop(RBP);
+        buf.byte(0xC3);
+    }
+
+    // ---------- 指令翻译 ----------
+
+    void translateInstr(const std::shared_ptr<IRInstr>& instr) {
+        switch (instr->opcode) {
+            case OpCode::ADD: case OpCode::SUB: case OpCode::MUL: case OpCode::DIV: case OpCode::MOD:
+            case OpCode::LT: case OpCode::GT: case OpCode::LE: case OpCode::GE: case OpCode::EQ: case OpCode::NE:
+            case OpCode::AND: case OpCode::OR:
+                translateBinary(*std::static_pointer_cast<BinaryOpInstr>(instr));
+                break;
+            case OpCode::NEG:
+            case OpCode::NOT: {
+                auto& un = *std::static_pointer_cast<UnaryOpInstr>(instr);
+                load(un.operand, RAX);
+                if (instr->opcode == OpCode::NEG) {
+                    buf.unaryF7(3, RAX);
+                } else {
+                    buf.aluRegReg(0x85, RAX, RAX);
+                    buf.setccAl(CC_E);
+                }
+                store(RAX, un.result);
+                break;
+            }
+            case OpCode::ASSIGN: {
+                auto& assign = *std::static_pointer_cast<AssignInstr>(instr);
+                const Home& target = homeOf(assign.target);
+                if (target.inReg) {
+                    load(assign.source, target.reg);
+                } else {
+                    load(assign.source, RAX);
+                    store(RAX, assign.target);
+                }
+                break;
+            }
+            case OpCode::GOTO:
+                jumpTo(buf.jmp(), labelFor(std::static_pointer_cast<GotoInstr>(instr)->target->name));
+                break;
+            case OpCode::IF_GOTO: {
+                auto& branch = *std::static_pointer_cast<IfGotoInstr>(instr);
+                load(branch.condition, RAX);
+                buf.aluRegReg(0x85, RAX, RAX);
+                jumpTo(buf.jcc(CC_NE), labelFor(branch.target->name));
+                break;
+            }
+            case OpCode::PARAM:
+                paramQueue.push_back(std::static_pointer_cast<ParamInstr>(instr)->param);
+                break;
+            case OpCode::CALL:
+                translateCall(*std::static_pointer_cast<CallInstr>(instr));
+                break;
+            case OpCode::RETURN:
+                load(std::static_pointer_cast<ReturnInstr>(instr)->value, RAX);
+                jumpTo(buf.jmp(), epilogueLabel);
+                break;
+            case OpCode::LABEL:
+                bindLabel(labelFor(std::static_pointer_cast<LabelInstr>(instr)->label));
+                break;
+            case OpCode::PROFILE_COUNT:
+                break;  // 剖析插桩只对生成的汇编有意义
+            default:
+                throw JitError("unsupported instruction in function '" + begin.funcName + "': " + instr->toString());
+        }
+    }
+
+    void translateBinary(const BinaryOpInstr& bin) {
+        load(bin.left, RAX);
+        load(bin.right, RCX);
+        switch (bin.opcode) {
+            case OpCode::ADD: buf.aluRegReg(0x01, RAX, RCX); break;
+            case OpCode::SUB: buf.aluRegReg(0x29, RAX, RCX); break;
+            case OpCode::MUL: buf.imul(RAX, RCX); break;
+            case OpCode::DIV:
+            case OpCode::MOD: translateDivision(bin.opcode == OpCode::MOD); break;
+            case OpCode::LT: buf.aluRegReg(0x39, RAX, RCX); buf.setccAl(CC_L); break;
+            case OpCode::GT: buf.aluRegReg(0x39, RAX, RCX); buf.setccAl(CC_G); break;
+            case OpCode::LE: buf.aluRegReg(0x39, RAX, RCX); buf.setccAl(CC_LE); break;
+            case OpCode::GE: buf.aluRegReg(0x39, RAX, RCX); buf.setccAl(CC_GE); break;
+            case OpCode::EQ: buf.aluRegReg(0x39, RAX, RCX); buf.setccAl(CC_E); break;
+            case OpCode::NE: buf.aluRegReg(0x39, RAX, RCX); buf.setccAl(CC_NE); break;
+            case OpCode::AND:
+            case OpCode::OR:
+                // (eax != 0) op (ecx != 0)
+                buf.aluRegReg(0x85, RAX, RAX);
+                buf.byte(0x0F); buf.byte(0x95); buf.byte(0xC0);  // setne al
+                buf.aluRegReg(0x85, RCX, RCX);
+                buf.byte(0x0F); buf.byte(0x95); buf.byte(0xC1);  // setne cl
+                buf.byte(bin.opcode == OpCode::AND ? 0x20 : 0x08); buf.byte(0xC8);  // and/or al, cl
+                buf.byte(0x0F); buf.byte(0xB6); buf.byte(0xC0);  // movzx eax, al
+                break;
+            default:
+                break;
+        }
+        store(RAX, bin.result);
+    }
+
+    // eax = eax / ecx 或 eax % ecx，按RISC-V语义处理除零和INT_MIN/-1（x86的idiv会触发异常）
+    void translateDivision(bool isMod) {
+        buf.aluRegReg(0x85, RCX, RCX);
+        size_t toZero = buf.jcc(CC_E);
+        buf.byte(0x83); buf.byte(0xF9); buf.byte(0xFF);  // cmp ecx, -1
+        size_t toMinusOne = buf.jcc(CC_E);
+        buf.byte(0x99);                                   // cdq
+        buf.unaryF7(7, RCX);                              // idiv ecx
+        if (isMod) buf.mov(RAX, RDX);
+        size_t doneFromDiv = buf.jmp();
+
+        buf.patchRel32(toZero, buf.pos());
+        if (!isMod) buf.movImm(RAX, -1);                  // x/0 = -1，x%0 = x
+        size_t doneFromZero = buf.jmp();
+
+        buf.patchRel32(toMinusOne, buf.pos());
+        if (isMod) buf.movImm(RAX, 0);                    // x%-1 = 0
+        else buf.unaryF7(3, RAX);                         // x/-1 = -x（INT_MIN回绕）
+
+        buf.patchRel32(doneFromDiv, buf.pos());
+        buf.patchRel32(doneFromZero, buf.pos());
+    }
+
+    void translateCall(const CallInstr& call) {
+        auto callee = paramCounts.find(call.funcName);
+        if (callee == paramCounts.end()) {
+            throw JitError("call to undefined function '" + call.funcName + "'");
+        }
+        size_t argc = static_cast<size_t>(std::max(call.paramCount, 0));
+        if (argc != callee->second) {
+            throw JitError("call to '" + call.funcName + "' passes " + std::to_string(argc) +
+                           " arguments, expected " + std::to_string(callee->second));
+        }
+
+        std::vector<std::shared_ptr<Operand>> args = call.params;
+        if (args.empty() && argc > 0) {
+            if (paramQueue.size() < argc) {
+                throw JitError("call to '" + call.funcName + "' is missing param instructions");
+            }
+            args.assign(paramQueue.end() - argc, paramQueue.end());
+        }
+        if (paramQueue.size() >= argc) paramQueue.erase(paramQueue.end() - argc, paramQueue.end());
+
+        // 栈上实参逆序压栈，个数为奇数时先补8字节保持16对齐
+        size_t stackArgs = argc > 6 ? argc - 6 : 0;
+        int stackBytes = static_cast<int>(stackArgs + stackArgs % 2) * 8;
+        if (stackArgs % 2) buf.rspImm(false, 8);
+        for (size_t i = argc; i > 6; --i) {
+            load(args[i - 1], RAX);
+            buf.push(RAX);
+        }
+        for (size_t i = 0; i < std::min<size_t>(argc, 6); ++i) {
+            load(args[i], argRegs[i]);
+        }
+
+        callFixups.push_back({buf.call(), call.funcName});
+        if (stackBytes > 0) buf.rspImm(true, stackBytes);
+        store(RAX, call.result);
+    }
+};
+
+} // namespace
+
+// ==================== JIT入口 ====================
+
+X86Jit::X86Jit(const std::vector<std::shared_ptr<IRInstr>>& instructions) : instructions(instructions) {}
+
+X86Jit::~X86Jit() {
+    if (code) munmap(code, mappedBytes);
+}
+
+bool X86Jit::isSupported() {
+    return true;
+}
+
+void X86Jit::compile() {
+    // 先收集全部函数的形参个数，调用点据此检查并解析
+    for (const auto& instr : instructions) {
+        if (auto begin = std::dynamic_pointer_cast<FunctionBeginInstr>(instr)) {
+            functionParamCounts[begin->funcName] = begin->paramNames.size();
+        }
+    }
+
+    CodeBuffer buf;
+    std::vector<CallFixup> callFixups;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto begin = std::dynamic_pointer_cast<FunctionBeginInstr>(instructions[i]);
+        if (!begin) continue;
+
+        size_t end = i + 1;
+        while (end < instructions.size() && instructions[end]->opcode != OpCode::FUNCTION_END) ++end;
+        std::vector<std::shared_ptr<IRInstr>> body(instructions.begin() + i + 1, instructions.begin() + end);
+
+        // 函数入口按16字节对齐
+        while (buf.pos() % 16) buf.byte(0xCC);
+        functionOffsets[begin->funcName] = buf.pos();
+        FunctionTranslator(buf, *begin, body, functionParamCounts, callFixups).translate();
+        i = end;
+    }
+
+    for (const auto& fixup : callFixups) {
+        buf.patchRel32(fixup.at, functionOffsets.at(fixup.callee));
+    }
+
+    long pageSize = sysconf(_SC_PAGESIZE);
+    codeBytes = buf.bytes.size();
+    mappedBytes = (std::max<size_t>(codeBytes, 1) + pageSize - 1) / pageSize * pageSize;
+    void* mem = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        throw JitError(std::string("mmap failed: ") + std::strerror(errno));
+    }
+    std::memcpy(mem, buf.bytes.data(), codeBytes);
+    if (mprotect(mem, mappedBytes, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, mappedBytes);
+        throw JitError(std::string("mprotect failed: ") + std::strerror(errno));
+    }
+    code = mem;
+}
+
+int X86Jit::run(const std::string& entry) {
+    if (!code) throw JitError("run() called before compile()");
+    auto it = functionOffsets.find(entry);
+    if (it == functionOffsets.end()) {
+        throw JitError("no function named '" + entry + "'");
+    }
+    if (functionParamCounts[entry] != 0) {
+        throw JitError("entry function '" + entry + "' must not take parameters");
+    }
+    auto fn = reinterpret_cast<int (*)()>(static_cast<uint8_t*>(code) + it->second);
+    return fn();
+}
+
+#else // 非x86-64 Linux平台
+
+X86Jit::X86Jit(const std::vector<std::shared_ptr<IRInstr>>& instructions) : instructions(instructions) {}
+
+X86Jit::~X86Jit() = default;
+
+bool X86Jit::isSupported() {
+    return false;
+}
+
+void X86Jit::compile() {
+    throw JitError("--run is only supported on x86-64 Linux");
+}
+
+int X86Jit::run(const std::string&) {
+    throw JitError("--run is only supported on x86-64 Linux");
+}
+
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+#include "ir/ir.h"
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// ==================== JIT错误 ====================
+
+class JitError : public std::runtime_error {
+public:
+    explicit JitError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// ==================== x86-64 JIT（--run） ====================
+//
+// 把IR翻译成x86-64机器码放入mmap的可执行缓冲区直接运行，无需RISC-V工具链或模拟器。
+// 仅在x86-64 Linux上可用（其他平台compile()抛出JitError）。
+//
+// - ToyC函数之间按System V调用约定互相调用：前6个实参在edi/esi/edx/ecx/r8d/r9d，
+//   其余按8字节压栈，返回值在eax
+// - 简单寄存器分配：按循环深度加权的使用次数，把最常用的变量放进被调用者保存的
+//   rbx/r12-r15，其余放在栈槽中；eax/ecx/edx作为运算的临时寄存器
+// - 算术按32位补码回绕；除零和INT_MIN/-1按RISC-V语义处理（div得-1/溢出值，rem得被除数/0）
+class X86Jit {
+public:
+    explicit X86Jit(const std::vector<std::shared_ptr<IRInstr>>& instructions);
+    ~X86Jit();
+
+    X86Jit(const X86Jit&) = delete;
+    X86Jit& operator=(const X86Jit&) = delete;
+
+    static bool isSupported();
+
+    // 翻译全部函数并装入可执行内存，失败时抛出JitError
+    void compile();
+
+    // 调用无参函数entry（默认main）并返回其结果
+    int run(const std::string& entry = "main");
+
+    size_t codeSize() const { return codeBytes; }
+
+private:
+    const std::vector<std::shared_ptr<IRInstr>>& instructions;
+    void* code = nullptr;
+    size_t codeBytes = 0;
+    size_t mappedBytes = 0;
+    std::map<std::string, size_t> functionOffsets;
+    std::map<std::string, size_t> functionParamCounts;
+};
@@ -5,32 +5,56 @@
 
 // ==================== 构造函数 ====================
 
-Lexer::Lexer() : source(""), position(0), line(1), column(1) {
-    keywords["int"] = TokenType::INT;
-    keywords["void"] = TokenType::VOID;
-    keywords["if"] = TokenType::IF;
-    keywords["else"] = TokenType::ELSE;
-    keywords["while"] = TokenType::WHILE;
-    keywords["break"] = TokenType::BREAK;
-    keywords["continue"] = TokenType::CONTINUE;
-    keywords["return"] = TokenType::RETURN;
-    
-    initOperators();
+// 关键字和运算符表只读，所有Lexer实例（包括不同线程中的）共享同一份
+namespace {
+
+const std::unordered_map<std::string, TokenType>& keywordTable() {
+    static const std::unordered_map<std::string, TokenType> keywords = {
+        {"int", TokenType::INT},
+        {"void", TokenType::VOID},
+        {"if", TokenType::IF},
+        {"else", TokenType::ELSE},
+        {"while", TokenType::WHILE},
+        {"break", TokenType::BREAK},
+        {"continue", TokenType::CONTINUE},
+        {"return", TokenType::RETURN},
+    };
+    return keywords;
 }
 
-Lexer::Lexer(const std::string& source) : source(source), position(0), line(1), column(1) {
-    keywords["int"] = TokenType::INT;
-    keywords["void"] = TokenType::VOID;
-    keywords["if"] = TokenType::IF;
-    keywords["else"] = TokenType::ELSE;
-    keywords["while"] = TokenType::WHILE;
-    keywords["break"] = TokenType::BREAK;
-    keywords["continue"] = TokenType::CONTINUE;
-    keywords["return"] = TokenType::RETURN;
-
-    initOperators();
+const std::unordered_map<std::string, TokenType>& operatorTable() {
+    static const std::unordered_map<std::string, TokenType> operators = {
+        {"=", TokenType::ASSIGN},
+        {"+", TokenType::PLUS},
+        {"-", TokenType::MINUS},
+        {"*", TokenType::MULTIPLY},
+        {"/", TokenType::DIVIDE},
+        {"%", TokenType::MODULO},
+        {"<", TokenType::LT},
+        {">", TokenType::GT},
+        {"<=", TokenType::LE},
+        {">=", TokenType::GE},
+        {"==", TokenType::EQ},
+        {"!=", TokenType::NEQ},
+        {"&&", TokenType::AND},
+        {"||", TokenType::OR},
+        {"!", TokenType::NOT},
+        {"(", TokenType::LPAREN},
+        {")", TokenType::RPAREN},
+        {"{", TokenType::LBRACE},
+        {"}", TokenType::RBRACE},
+        {";", TokenType::SEMICOLON},
+        {",", TokenType::COMMA},
+    };
+    return operators;
 }
 
+} // namespace
+
+Lexer::Lexer() : source(""), position(0), line(1), column(1) {}
+
+Lexer::Lexer(std::string_view source) : source(source), position(0), line(1), column(1) {}
+
 // ==================== 核心扫描方法 ====================
 
 std::vector<Token> Lexer::tokenize() {
@@ -139,8 +163,9 @@ Token Lexer::scanIdentifier() {
 
     std::string lexeme = source.substr(startPos, position - startPos);
     
-    if (keywords.find(lexeme) != keywords.end()) {
-        return Token(keywords[lexeme], lexeme, startLine, startColumn);
+    auto keyword = keywordTable().find(lexeme);
+    if (keyword != keywordTable().end()) {
+        return Token(keyword->second, lexeme, startLine, startColumn);
     }
     
     return Token(TokenType::IDENTIFIER, lexeme, startLine, startColumn);
@@ -165,30 +190,6 @@ Token Lexer::scanNumber() {
 
 // ==================== 辅助方法 ====================
 
-void Lexer::initOperators() {
-    operators["="] = TokenType::ASSIGN;
-    operators["+"] = TokenType::PLUS;
-    operators["-"] = TokenType::MINUS;
-    operators["*"] = TokenType::MULTIPLY;
-    operators["/"] = TokenType::DIVIDE;
-    operators["%"] = TokenType::MODULO;
-    operators["<"] = TokenType::LT;
-    operators[">"] = TokenType::GT;
-    operators["<="] = TokenType::LE;
-    operators[">="] = TokenType::GE;
-    operators["=="] = TokenType::EQ;
-    operators["!="] = TokenType::NEQ;
-    operators["&&"] = TokenType::AND;
-    operators["||"] = TokenType::OR;
-    operators["!"] = TokenType::NOT;
-    operators["("] = TokenType::LPAREN;
-    operators[")"] = TokenType::RPAREN;
-    operators["{"] = TokenType::LBRACE;
-    operators["}"] = TokenType::RBRACE;
-    operators[";"] = TokenType::SEMICOLON;
-    operators[","] = TokenType::COMMA;
-}
-
 char Lexer::peek(int offset) const {
     if (position + offset >= source.length()) {
         return '\0';
@@ -286,16 +287,18 @@ Token Lexer::readOperatorOrPunctuator() {
         char next = peek();
         std::string twoCharOp = std::string(1, c) + next;
         
-        if (operators.find(twoCharOp) != operators.end()) {
+        auto op = operatorTable().find(twoCharOp);
+        if (op != operatorTable().end()) {
             position++;
             column++;
-            return Token(operators.at(twoCharOp), twoCharOp, startLine, startColumn);
+            return Token(op->second, twoCharOp, startLine, startColumn);
         }
     }
 
     std::string singleCharOp = std::string(1, c);
-    if (operators.find(singleCharOp) != operators.end()) {
-        return Token(operators.at(singleCharOp), singleCharOp, startLine, startColumn);
+    auto op = operatorTable().find(singleCharOp);
+    if (op != operatorTable().end()) {
+        return Token(op->second, singleCharOp, startLine, startColumn);
     }
 
     return Token(TokenType::UNKNOWN, singleCharOp, startLine, startColumn);
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
@@ -42,11 +43,7 @@ private:
     int position = 0;
     int line = 1;
     int column = 1;
-    
-    std::unordered_map<std::string, TokenType> keywords;
-    std::unordered_map<std::string, TokenType> operators;
 
-    void initOperators();
     char peek(int offset = 0) const;
     char advance();
     bool isAtEnd() const;
@@ -60,7 +57,7 @@ private:
 
 public:
     Lexer();
-    Lexer(const std::string& source);
+    Lexer(std::string_view source);
     
     int getLine() const { return line; }
     int getColumn() const { return column; }
@@ -0,0 +1,224 @@
+// toyc.cpp - libtoyc编译流水线
+#include "toyc.h"
+#include "lexer/lexer.h"
+#include "parser/parser.h"
+#include "semantic/semantic.h"
+#include "ir/irgen.h"
+#include "ir/irparser.h"
+#include "ir/edgeprofile.h"
+#include "ir/funcorder.h"
+#include "codegen/codegen.h"
+#include "codegen/costmodel.h"
+#include "codegen/sizereport.h"
+#include "profile/phase_profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <streambuf>
+
+namespace toyc {
+
+void CompileOutput::clear() {
+    assembly.clear();
+    diagnostics.clear();
+    ir.clear();
+    costReport.clear();
+    sizeReport.clear();
+    program.clear();
+    stats = CompileStats();
+}
+
+namespace {
+
+// 直接追加到调用方字符串的输出缓冲：重复使用同一个CompileOutput时复用其容量
+class StringAppendBuf : public std::streambuf {
+public:
+    explicit StringAppendBuf(std::string& target) : target(target) {}
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) target.push_back(traits_type::to_char_type(ch));
+        return traits_type::not_eof(ch);
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        target.append(s, static_cast<size_t>(n));
+        return n;
+    }
+
+private:
+    std::string& target;
+};
+
+// 各阶段的诊断信息都写入同一个流（即output.diagnostics）
+bool runPipeline(std::string_view source, const CompileOptions& options, CompileOutput& output,
+                 std::ostream& diagnostics) {
+    PhaseProfiler* profiler = options.profiler;
+
+    IRGenConfig irConfig;
+    irConfig.enableOptimizations = options.optimize;
+    irConfig.generateDebugInfo = options.debugInfo;
+    irConfig.diagnostics = &diagnostics;
+    if (options.pipeline) irConfig.pipeline = *options.pipeline;
+
+    IRGenerator irGenerator(irConfig);
+    irGenerator.setPassListener(profiler);
+
+    if (options.irInput) {
+        // 输入为文本IR：跳过前端，直接载入IR
+        try {
+            PhaseProfiler::Scope phase(profiler, "IRParser");
+            IRParser irParser{std::string(source)};
+            irGenerator.loadInstructions(irParser.parse());
+        } catch (const IRParseError& e) {
+            diagnostics << "Error: " << e.what() << "\n";
+            return false;
+        }
+        if (options.optimize) {
+            PhaseProfiler::Scope phase(profiler, "optimize");
+            irGenerator.optimize();
+        }
+    } else {
+        std::vector<Token> tokens;
+        {
+            PhaseProfiler::Scope phase(profiler, "Lexer");
+            Lexer lexer(source);
+            tokens = lexer.tokenize();
+        }
+        output.stats.tokens = tokens.size();
+
+        std::shared_ptr<CompUnit> ast;
+        {
+            PhaseProfiler::Scope phase(profiler, "Parser");
+            Parser parser(tokens, diagnostics);
+            ast = parser.parse();
+        }
+        if (!ast) {
+            diagnostics << "Error: Parsing failed.\n";
+            return false;
+        }
+
+        bool semanticOk;
+        {
+            PhaseProfiler::Scope phase(profiler, "SemanticAnalyzer");
+            SemanticAnalyzer semanticAnalyzer(diagnostics);
+            semanticOk = semanticAnalyzer.analyze(ast);
+        }
+        if (!semanticOk) {
+            diagnostics << "Error: Semantic analysis failed.\n";
+            return false;
+        }
+
+        // 开启优化时各优化遍作为IRGenerator的子阶段记录
+        PhaseProfiler::Scope phase(profiler, "IRGenerator");
+        irGenerator.generate(ast);
+    }
+    if (options.formSuperblocks && !options.optimize) {
+        PhaseProfiler::Scope phase(profiler, "superblockFormation");
+        irGenerator.runPass("superblockFormation");
+    }
+    if (options.foldIdenticalCode && !options.optimize) {
+        PhaseProfiler::Scope phase(profiler, "identicalCodeFolding");
+        irGenerator.runPass("identicalCodeFolding");
+    }
+
+    // 边剖析插桩在全部优化之后进行，计数的是最终代码的CFG
+    output.program = irGenerator.getInstructions();
+    ProfileLayout profileLayout;
+    if (options.profileGenerate) {
+        PhaseProfiler::Scope phase(profiler, "EdgeProfileInstrumenter");
+        EdgeProfileInstrumenter instrumenter(diagnostics);
+        profileLayout = instrumenter.instrument(output.program);
+        if (std::none_of(profileLayout.functions.begin(), profileLayout.functions.end(),
+                         [](const ProfileFunctionLayout& fn) { return fn.name == "main"; })) {
+            diagnostics << "Warning: no main function, profile data will never be written\n";
+        }
+        output.stats.profileCounters = profileLayout.counterCount;
+    }
+    if (options.functionOrder) {
+        PhaseProfiler::Scope phase(profiler, "FunctionOrderer");
+        FunctionOrderer orderer(options.functionOrderProfile);
+        orderer.run(output.program);
+    }
+    output.stats.irInstructions = output.program.size();
+
+    if (options.emitIR) {
+        StringAppendBuf irBuf(output.ir);
+        std::ostream irText(&irBuf);
+        IRPrinter::print(output.program, irText);
+    }
+    if (!options.emitAssembly) return true;
+
+    CodeGenConfig config;
+    config.emitDebugLineInfo = options.debugInfo;
+    config.sourceFileName = options.sourceName;
+    config.enablePeepholeOptimizations = options.peephole || options.optimize;
+    config.enableMachineOutliner = options.outline;
+    config.saveRestore = options.saveRestore;
+    config.functionSections = options.functionSections;
+    config.hotColdSplit = options.hotColdSplit;
+    config.hotColdProfile = options.hotColdProfile;
+    if (options.profileGenerate) {
+        config.instrumentEdgeProfile = true;
+        config.profileCounterCount = profileLayout.counterCount;
+        config.profileDescriptor = profileLayout.describe();
+    }
+    config.instrumentFunctions = options.instrumentFunctions;
+    config.profileOutputFile = options.profileOutputFile;
+    config.diagnostics = &diagnostics;
+    config.traceProgress = options.traceProgress;
+
+    StringAppendBuf assemblyBuf(output.assembly);
+    std::ostream assembly(&assemblyBuf);
+    {
+        PhaseProfiler::Scope phase(profiler, "CodeGenerator");
+        CodeGenerator generator(assembly, output.program, config);
+        generator.generate();
+    }
+    output.stats.assemblyBytes = output.assembly.size();
+
+    if (options.costReport) {
+        const CoreModel* core = CoreModel::find(options.costModel);
+        if (!core) {
+            diagnostics << "Error: unknown core model '" << options.costModel << "'\n";
+            return false;
+        }
+        PhaseProfiler::Scope phase(profiler, "CostModel");
+        CostModel model(*core);
+        model.analyze(output.assembly);
+        StringAppendBuf reportBuf(output.costReport);
+        std::ostream report(&reportBuf);
+        model.printReport(report);
+    }
+    if (options.sizeReport) {
+        PhaseProfiler::Scope phase(profiler, "SizeReport");
+        SizeReport sizes;
+        sizes.analyze(output.assembly);
+        StringAppendBuf reportBuf(output.sizeReport);
+        std::ostream report(&reportBuf);
+        sizes.printReport(report);
+    }
+    return true;
+}
+
+} // namespace
+
+bool compile(std::string_view source, const CompileOptions& options, CompileOutput& output) {
+    auto start = std::chrono::steady_clock::now();
+    output.clear();
+    output.stats.sourceBytes = source.size();
+
+    StringAppendBuf diagnosticsBuf(output.diagnostics);
+    std::ostream diagnostics(&diagnosticsBuf);
+    bool ok;
+    try {
+        ok = runPipeline(source, options, output, diagnostics);
+    } catch (const std::exception& e) {
+        // 嵌入方不应因编译器内部错误而崩溃
+        diagnostics << "Error: internal compiler error: " << e.what() << "\n";
+        ok = false;
+    }
+    output.stats.totalMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+} // namespace toyc
@@ -0,0 +1,79 @@
+#pragma once
+#include "ir/ir.h"
+#include "ir/pipeline.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class PhaseProfiler;
+struct ProfileData;
+
+// ==================== libtoyc：可嵌入的编译器接口 ====================
+//
+// 把toyc_compiler的完整流水线（词法、语法、语义、IR生成与优化、插桩、代码生成）
+// 封装为一次函数调用，供构建服务等在进程内反复编译，省去进程创建和初始化开销。
+//
+// - 可重入：不使用全局可变状态，也不写std::cerr/std::cout；不同线程可以同时调用
+//   toyc::compile，只要各自使用不同的CompileOutput（以及PhaseProfiler）
+// - 输出写入调用方提供的CompileOutput，重复使用同一个对象时字符串缓冲区的容量得以保留
+namespace toyc {
+
+struct CompileOptions {
+    bool optimize = false;             // -opt
+    const OptPipeline* pipeline = nullptr;  // -opt执行的流水线（--pipeline=<预设>），nullptr时为"default"
+    bool foldIdenticalCode = false;    // -ficf：不开-opt时单独执行相同代码折叠
+    bool formSuperblocks = false;      // -fsuperblock：不开-opt时单独执行超块形成（ir/superblock.h）
+    bool peephole = false;             // -fpeephole：不开-opt时单独执行汇编窥孔优化
+    bool outline = false;              // -moutline：外提跨函数重复的指令序列（以代码体积为目标，-opt不包含）
+    bool saveRestore = false;          // -msave-restore：序言/后记调用共享的寄存器保存/恢复例程
+    bool functionOrder = false;        // -ffunction-order：按调用图排列函数（ir/funcorder.h）
+    const ProfileData* functionOrderProfile = nullptr;  // -ffunction-order=<剖析文件>，nullptr时用静态估计
+    bool functionSections = false;     // -ffunction-sections：每个函数放进自己的.text.<name>节
+    bool hotColdSplit = false;         // -freorder-blocks-and-partition：冷块移入.text.unlikely（codegen/hotcold.h）
+    const ProfileData* hotColdProfile = nullptr;  // -freorder-blocks-and-partition=<剖析文件>，需要边剖析数据
+    bool debugInfo = false;            // -g
+    bool costReport = false;           // --cost-report：估计生成代码的静态周期代价，写入CompileOutput::costReport
+    std::string costModel = "rocket";  // --cost-report=<core>使用的处理器核（codegen/costmodel.h）
+    bool sizeReport = false;           // --size-report：按函数、基本块和类别统计代码体积，写入CompileOutput::sizeReport
+    bool irInput = false;              // source是文本IR（--ir-in），跳过前端
+    std::string sourceName = "<stdin>";  // .file指令中记录的源文件名
+
+    bool profileGenerate = false;      // -fprofile-generate
+    bool instrumentFunctions = false;  // -finstrument-functions-lite
+    std::string profileOutputFile = "toyc.profraw";
+
+    bool emitAssembly = true;          // false时只生成IR（例如交给JIT/VM执行）
+    bool emitIR = false;               // 把最终IR的文本写入CompileOutput::ir
+    bool traceProgress = false;        // 在诊断信息中输出代码生成各阶段的进度
+
+    PhaseProfiler* profiler = nullptr; // 可选：记录各阶段和各优化遍的耗时
+};
+
+struct CompileStats {
+    std::size_t sourceBytes = 0;
+    std::size_t tokens = 0;
+    std::size_t irInstructions = 0;    // 最终IR（含插桩）的指令条数
+    std::size_t assemblyBytes = 0;
+    int profileCounters = 0;           // -fprofile-generate分配的计数器个数
+    double totalMs = 0.0;
+};
+
+struct CompileOutput {
+    std::string assembly;
+    std::string diagnostics;           // 错误、警告（与toyc_compiler的stderr内容一致）
+    std::string ir;
+    std::string costReport;
+    std::string sizeReport;
+    std::vector<std::shared_ptr<IRInstr>> program;  // 最终IR，可直接交给X86Jit/BytecodeCompiler
+    CompileStats stats;
+
+    // 清空内容，保留字符串容量
+    void clear();
+};
+
+// 编译source，成功返回true；失败时原因写在output.diagnostics中
+bool compile(std::string_view source, const CompileOptions& options, CompileOutput& output);
+
+} // namespace toyc
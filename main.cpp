@@ -1,18 +1,47 @@
 // main.cpp - 编译器主程序
-#include "lexer/lexer.h"
-#include "parser/parser.h"
-#include "semantic/semantic.h"
-#include "ir/ir.h"
-#include "ir/irgen.h"
-#include "codegen/codegen.h"
+#include "libtoyc/toyc.h"
+#include "codegen/costmodel.h"
+#include "jit/x86jit.h"
+#include "vm/bytecode.h"
+#include "vm/irinterp.h"
+#include "vm/vm.h"
+#include "profile/phase_profiler.h"
+#include "profile/profdata.h"
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 
 int main(int argc, char* argv[]) {
     bool enableOptimization = false;
+    const OptPipeline* pipeline = nullptr;
+    bool foldIdenticalCode = false;
+    bool formSuperblocks = false;
+    bool peephole = false;
+    bool outline = false;
+    bool saveRestore = false;
+    bool functionSections = false;
+    bool functionOrder = false;
+    std::unique_ptr<ProfileData> functionOrderProfile;
+    bool hotColdSplit = false;
+    std::unique_ptr<ProfileData> hotColdProfile;
+    bool costReport = false;
+    std::string costModel = "rocket";
+    bool sizeReport = false;
     bool enablePrintIR = true;
+    bool enableDebugInfo = false;
+    bool irInput = false;
+    bool timeReport = false;
+    bool perfCounters = false;
+    std::string perfJsonFile;
+    bool profileGenerate = false;
+    std::string profileOutputFile = "toyc.profraw";
+    bool instrumentFunctions = false;
+    bool runProgram = false;
+    std::string runEngine = "jit";
+    bool vmStats = false;
+    bool printBytecode = false;
     
     std::string filename;
     
@@ -21,6 +50,109 @@ int main(int argc, char* argv[]) {
         if (arg == "-opt") {
             enableOptimization = true;
             std::cerr << "Optimization enabled." << std::endl;
+        } else if (arg.rfind("--pipeline=", 0) == 0) {
+            // 按名字选择ir/pipeline_presets.inc中的优化流水线，隐含-opt
+            std::string name = arg.substr(std::string("--pipeline=").size());
+            pipeline = OptPipeline::findPreset(name);
+            if (!pipeline) {
+                std::cerr << "Error: unknown pipeline preset '" << name << "' (available:";
+                for (const auto& preset : OptPipeline::presets()) std::cerr << " " << preset.name;
+                std::cerr << ")" << std::endl;
+                return 1;
+            }
+            enableOptimization = true;
+        } else if (arg == "-ficf") {
+            // 单独开启相同代码折叠（-opt已包含）
+            foldIdenticalCode = true;
+        } else if (arg == "-fsuperblock") {
+            // 单独开启超块形成（default流水线不包含，toyc_autotune可以选用）
+            formSuperblocks = true;
+        } else if (arg == "-fpeephole") {
+            // 单独开启汇编窥孔优化（-opt已包含）
+            peephole = true;
+        } else if (arg == "-moutline") {
+            outline = true;
+        } else if (arg == "-msave-restore") {
+            saveRestore = true;
+        } else if (arg == "-ffunction-order") {
+            functionOrder = true;
+        } else if (arg.rfind("-ffunction-order=", 0) == 0) {
+            // 按剖析文件（-fprofile-generate或-finstrument-functions-lite产生）中的调用次数排序
+            std::string path = arg.substr(std::string("-ffunction-order=").size());
+            std::string error;
+            functionOrderProfile = std::make_unique<ProfileData>();
+            if (!ProfileData::read(path, *functionOrderProfile, error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return 1;
+            }
+            functionOrder = true;
+        } else if (arg == "-freorder-blocks-and-partition") {
+            hotColdSplit = true;
+        } else if (arg.rfind("-freorder-blocks-and-partition=", 0) == 0) {
+            // 按-fprofile-generate产生的边计数划分冷块
+            std::string path = arg.substr(std::string("-freorder-blocks-and-partition=").size());
+            std::string error;
+            hotColdProfile = std::make_unique<ProfileData>();
+            if (!ProfileData::read(path, *hotColdProfile, error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return 1;
+            }
+            if (!hotColdProfile->hasEdges) {
+                std::cerr << "Error: " << path << " has no edge counters (compile with -fprofile-generate)"
+                          << std::endl;
+                return 1;
+            }
+            hotColdSplit = true;
+        } else if (arg == "-ffunction-sections") {
+            functionSections = true;
+        } else if (arg == "-g") {
+            enableDebugInfo = true;
+        } else if (arg == "--run") {
+            runProgram = true;
+        } else if (arg.rfind("--run=", 0) == 0) {
+            // 执行引擎：jit（x86-64机器码）、vm（字节码虚拟机）、ir（直接解释IR）
+            runProgram = true;
+            runEngine = arg.substr(std::string("--run=").size());
+            if (runEngine != "jit" && runEngine != "vm" && runEngine != "ir") {
+                std::cerr << "Error: unknown execution engine '" << runEngine << "'" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--cost-report") {
+            costReport = true;
+        } else if (arg.rfind("--cost-report=", 0) == 0) {
+            // 处理器核：rocket（默认）、u74、ibex
+            costReport = true;
+            costModel = arg.substr(std::string("--cost-report=").size());
+            if (!CoreModel::find(costModel)) {
+                std::cerr << "Error: unknown core model '" << costModel << "'" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--size-report") {
+            sizeReport = true;
+        } else if (arg == "--vm-stats") {
+            vmStats = true;
+        } else if (arg == "--print-bytecode") {
+            printBytecode = true;
+        } else if (arg == "--ir-in") {
+            irInput = true;
+        } else if (arg == "--time-report") {
+            timeReport = true;
+        } else if (arg == "--perf-counters") {
+            perfCounters = true;
+            timeReport = true;
+        } else if (arg == "-fprofile-generate") {
+            profileGenerate = true;
+        } else if (arg.rfind("-fprofile-generate=", 0) == 0) {
+            profileGenerate = true;
+            profileOutputFile = arg.substr(std::string("-fprofile-generate=").size());
+        } else if (arg == "-finstrument-functions-lite") {
+            instrumentFunctions = true;
+        } else if (arg.rfind("-finstrument-functions-lite=", 0) == 0) {
+            // 与-fprofile-generate同时使用时写入同一个剖析文件
+            instrumentFunctions = true;
+            profileOutputFile = arg.substr(std::string("-finstrument-functions-lite=").size());
+        } else if (arg.rfind("--perf-json=", 0) == 0) {
+            perfJsonFile = arg.substr(std::string("--perf-json=").size());
         } else {
             filename = arg;
         }
@@ -40,43 +172,121 @@ int main(int argc, char* argv[]) {
     }
     
     std::string source = buffer.str();
-    
-    Lexer lexer(source);
-    std::vector<Token> tokens = lexer.tokenize();
-    
-    Parser parser(tokens);
-    std::shared_ptr<CompUnit> ast = parser.parse();
-    if (!ast) {
-        std::cerr << "Error: Parsing failed." << std::endl;
-        return 1;
+
+    // 阶段剖析：--time-report / --perf-counters / --perf-json
+    std::unique_ptr<PhaseProfiler> profiler;
+    if (timeReport || !perfJsonFile.empty()) {
+        profiler = std::make_unique<PhaseProfiler>(perfCounters);
     }
-    
-    SemanticAnalyzer semanticAnalyzer;
-    if (!semanticAnalyzer.analyze(ast)) {
-        std::cerr << "Error: Semantic analysis failed." << std::endl;
-        return 1;
+    auto reportProfile = [&]() {
+        if (!profiler) return 0;
+        if (timeReport) {
+            profiler->printReport(std::cerr);
+        }
+        if (!perfJsonFile.empty()) {
+            std::ofstream jsonFile(perfJsonFile);
+            if (!jsonFile) {
+                std::cerr << "Error: Cannot open file " << perfJsonFile << std::endl;
+                return 1;
+            }
+            profiler->writeJson(jsonFile);
+        }
+        return 0;
+    };
+
+    // 编译流水线在libtoyc中；驱动程序只负责参数、文件和输出
+    toyc::CompileOptions options;
+    options.optimize = enableOptimization;
+    options.foldIdenticalCode = foldIdenticalCode;
+    options.formSuperblocks = formSuperblocks;
+    options.peephole = peephole;
+    options.outline = outline;
+    options.saveRestore = saveRestore;
+    options.functionSections = functionSections;
+    options.functionOrder = functionOrder;
+    options.functionOrderProfile = functionOrderProfile.get();
+    options.hotColdSplit = hotColdSplit;
+    options.hotColdProfile = hotColdProfile.get();
+    options.pipeline = pipeline;
+    options.costReport = costReport;
+    options.costModel = costModel;
+    options.sizeReport = sizeReport;
+    options.debugInfo = enableDebugInfo;
+    options.irInput = irInput;
+    if (!filename.empty()) {
+        options.sourceName = filename;
     }
+    options.profileGenerate = profileGenerate;
+    options.instrumentFunctions = instrumentFunctions;
+    options.profileOutputFile = profileOutputFile;
+    options.emitAssembly = !runProgram;
+    options.emitIR = enablePrintIR;
+    options.traceProgress = true;
+    options.profiler = profiler.get();
 
-    IRGenConfig irConfig;
-    if (enableOptimization) {
-        irConfig.enableOptimizations = true;
+    toyc::CompileOutput output;
+    bool compiled = toyc::compile(source, options, output);
+    std::cerr << output.diagnostics;
+    if (!compiled) {
+        return 1;
     }
-    
-    IRGenerator irGenerator(irConfig);
-    irGenerator.generate(ast);
-    
-    if (enablePrintIR) {
-        IRPrinter::print(irGenerator.getInstructions(), std::cerr);
+    std::cerr << output.ir;
+    const std::vector<std::shared_ptr<IRInstr>>& program = output.program;
+
+    if (runProgram) {
+        // --run[=jit|vm|ir]：在本机执行main并打印返回值，不生成汇编
+        int result = 0;
+        try {
+            if (runEngine == "jit") {
+                X86Jit jit(program);
+                {
+                    PhaseProfiler::Scope phase(profiler.get(), "JIT");
+                    jit.compile();
+                }
+                PhaseProfiler::Scope phase(profiler.get(), "Execute");
+                result = jit.run();
+            } else if (runEngine == "vm") {
+                VmModule module;
+                {
+                    PhaseProfiler::Scope phase(profiler.get(), "BytecodeCompiler");
+                    module = BytecodeCompiler::compile(program);
+                }
+                if (printBytecode) {
+                    module.dump(std::cerr);
+                }
+                VirtualMachine vm(module);
+                vm.setCountOps(vmStats);
+                {
+                    PhaseProfiler::Scope phase(profiler.get(), "Execute");
+                    result = vm.run();
+                }
+                if (vmStats) {
+                    vm.printOpCounts(std::cerr);
+                }
+            } else {
+                IRInterpreter interpreter(program);
+                {
+                    PhaseProfiler::Scope phase(profiler.get(), "Execute");
+                    result = interpreter.run();
+                }
+                if (vmStats) {
+                    std::cerr << "IR instructions executed: " << interpreter.executedInstructions() << std::endl;
+                }
+            }
+        } catch (const JitError& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        } catch (const VmError& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << result << std::endl;
+        return reportProfile();
     }
     
-    CodeGenConfig config;
-    
-    std::stringstream outputStream;
-    
-    CodeGenerator generator(outputStream, irGenerator.getInstructions(), config);
-    generator.generate();
-    
-    std::cout << outputStream.str();
-    
-    return 0;
-}
\ No newline at end of file
+    std::cout << output.assembly;
+    std::cerr << output.costReport;
+    std::cerr << output.sizeReport;
+
+    return reportProfile();
+}
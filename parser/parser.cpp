@@ -11,7 +11,7 @@ Token Parser::advance() {
 
 ParseError Parser::error(const Token& token, const std::string& message) {
     if (!isRecovering) {
-        std::cerr << "[Error at line " << token.line << ", column " << token.column << "] "
+        *diagnostics << "[Error at line " << token.line << ", column " << token.column << "] "
                   << message << std::endl;
         errorCount++;
         hadError = true;
@@ -321,7 +321,7 @@ std::shared_ptr<Stmt> Parser::exprStmt() {
     
     auto expression = expr();
     consume(TokenType::SEMICOLON, "Expected ';' after expression.");
-    return std::make_shared<ExprStmt>(expression);
+    return std::make_shared<ExprStmt>(expression, line, column);
 }
 
 std::shared_ptr<Stmt> Parser::varDeclStmt() {
@@ -418,8 +418,10 @@ std::shared_ptr<Expr> Parser::lorExpr() {
     
     while (match({TokenType::OR})) {
         std::string op = previous().lexeme;
+        int line = previous().line;
+        int column = previous().column;
         auto right = landExpr();
-        expr = std::make_shared<BinaryExpr>(expr, op, right);
+        expr = std::make_shared<BinaryExpr>(expr, op, right, line, column);
     }
     
     return expr;
@@ -430,8 +432,10 @@ std::shared_ptr<Expr> Parser::landExpr() {
     
     while (match({TokenType::AND})) {
         std::string op = previous().lexeme;
+        int line = previous().line;
+        int column = previous().column;
         auto right = relExpr();
-        expr = std::make_shared<BinaryExpr>(expr, op, right);
+        expr = std::make_shared<BinaryExpr>(expr, op, right, line, column);
     }
     
     return expr;
@@ -443,8 +447,10 @@ std::shared_ptr<Expr> Parser::relExpr() {
     while (match({TokenType::LT, TokenType::GT, TokenType::LE, 
                  TokenType::GE, TokenType::EQ, TokenType::NEQ})) {
         std::string op = previous().lexeme;
+        int line = previous().line;
+        int column = previous().column;
         auto right = addExpr();
-        expr = std::make_shared<BinaryExpr>(expr, op, right);
+        expr = std::make_shared<BinaryExpr>(expr, op, right, line, column);
     }
     
     return expr;
@@ -455,8 +461,10 @@ std::shared_ptr<Expr> Parser::addExpr() {
     
     while (match({TokenType::PLUS, TokenType::MINUS})) {
         std::string op = previous().lexeme;
+        int line = previous().line;
+        int column = previous().column;
         auto right = mulExpr();
-        expr = std::make_shared<BinaryExpr>(expr, op, right);
+        expr = std::make_shared<BinaryExpr>(expr, op, right, line, column);
     }
     
     return expr;
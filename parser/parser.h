@@ -2,6 +2,7 @@
 #include "lexer/lexer.h"
 #include "parser/ast.h"
 #include <vector>
+#include <iostream>
 #include <memory>
 #include <stdexcept>
 
@@ -17,9 +18,11 @@ private:
     bool hadError = false;
     int errorCount = 0;
     bool isRecovering = false;
+    std::ostream* diagnostics;
 
 public:
-    Parser(const std::vector<Token>& tokens) : tokens(tokens) {}
+    Parser(const std::vector<Token>& tokens, std::ostream& diagnostics = std::cerr)
+        : tokens(tokens), diagnostics(&diagnostics) {}
     
     std::shared_ptr<CompUnit> parse();
     bool hasError() const { return hadError; }
@@ -0,0 +1,255 @@
+// phase_profiler.cpp - 编译阶段耗时与硬件性能计数器
+#include "phase_profiler.h"
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::uint64_t nowNs() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+// ==================== 硬件性能计数器 ====================
+
+PerfCounterGroup::PerfCounterGroup() {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        fds[i] = -1;
+        memberIndex[i] = -1;
+    }
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+#ifdef __linux__
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+#endif
+}
+
+const char* PerfCounterGroup::eventName(int event) {
+    switch (event) {
+        case PERF_CYCLES: return "cycles";
+        case PERF_INSTRUCTIONS: return "instructions";
+        case PERF_CACHE_MISSES: return "cache_misses";
+        case PERF_BRANCH_MISSES: return "branch_misses";
+        default: return "unknown";
+    }
+}
+
+bool PerfCounterGroup::open() {
+#ifdef __linux__
+    static const std::uint64_t configs[PERF_EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = leaderFd < 0 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leaderFd, 0));
+        if (fd < 0) {
+            if (leaderFd < 0) {
+                // 组长（cycles）打不开则整体不可用
+                reason = std::string("perf_event_open failed: ") + std::strerror(errno);
+                if (errno == EACCES || errno == EPERM) {
+                    reason += " (check /proc/sys/kernel/perf_event_paranoid)";
+                } else if (errno == ENOENT || errno == EOPNOTSUPP || errno == ENODEV) {
+                    reason += " (no hardware PMU, e.g. inside a VM or container)";
+                }
+                return false;
+            }
+            continue;  // 单个事件不支持时跳过，其余照常计数
+        }
+        fds[i] = fd;
+        memberIndex[i] = memberCount++;
+        if (leaderFd < 0) leaderFd = fd;
+    }
+
+    ioctl(leaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+#else
+    reason = "hardware performance counters require Linux perf_event_open";
+    return false;
+#endif
+}
+
+PerfCounterValues PerfCounterGroup::read() const {
+    PerfCounterValues result;
+#ifdef __linux__
+    if (leaderFd < 0) return result;
+
+    // 读取格式：nr, time_enabled, time_running, value[nr]
+    std::uint64_t buffer[3 + PERF_EVENT_COUNT] = {};
+    ssize_t n = ::read(leaderFd, buffer, sizeof(buffer));
+    if (n < static_cast<ssize_t>(3 * sizeof(std::uint64_t))) return result;
+
+    std::uint64_t nr = buffer[0];
+    double enabled = static_cast<double>(buffer[1]);
+    double running = static_cast<double>(buffer[2]);
+    double scale = (running > 0 && running < enabled) ? enabled / running : 1.0;
+
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        int idx = memberIndex[i];
+        if (idx < 0 || static_cast<std::uint64_t>(idx) >= nr) continue;
+        result.values[i] = static_cast<std::uint64_t>(static_cast<double>(buffer[3 + idx]) * scale);
+        result.valid[i] = true;
+    }
+#endif
+    return result;
+}
+
+// ==================== 阶段剖析器 ====================
+
+PhaseProfiler::PhaseProfiler(bool useCounters) : useCounters(useCounters) {
+    if (useCounters) {
+        counters.open();
+    }
+}
+
+void PhaseProfiler::begin(const std::string& name) {
+    Sample sample;
+    sample.name = name;
+    sample.depth = static_cast<int>(open.size());
+    samples.push_back(sample);
+
+    OpenPhase phase;
+    phase.sampleIndex = samples.size() - 1;
+    if (countersAvailable()) phase.startCounters = counters.read();
+    phase.startNs = nowNs();
+    open.push_back(phase);
+}
+
+void PhaseProfiler::end() {
+    if (open.empty()) return;
+    std::uint64_t endNs = nowNs();
+    PerfCounterValues endCounters;
+    if (countersAvailable()) endCounters = counters.read();
+
+    OpenPhase phase = open.back();
+    open.pop_back();
+
+    Sample& sample = samples[phase.sampleIndex];
+    sample.wallMs = static_cast<double>(endNs - phase.startNs) / 1e6;
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (phase.startCounters.valid[i] && endCounters.valid[i]) {
+            sample.counters.values[i] = endCounters.values[i] - phase.startCounters.values[i];
+            sample.counters.valid[i] = true;
+        }
+    }
+}
+
+void PhaseProfiler::beforePass(const std::string& passName,
+                               const std::vector<std::shared_ptr<IRInstr>>&) {
+    begin(passName);
+}
+
+void PhaseProfiler::afterPass(const std::string&,
+                              const std::vector<std::shared_ptr<IRInstr>>&) {
+    end();
+}
+
+void PhaseProfiler::printReport(std::ostream& out) const {
+    out << "===== 编译阶段耗时 =====\n";
+    if (useCounters && !counters.available()) {
+        out << "(硬件计数器不可用: " << counters.unavailableReason() << ")\n";
+    }
+
+    out << std::left << std::setw(36) << "phase" << std::right << std::setw(12) << "wall ms";
+    if (countersAvailable()) {
+        out << std::setw(14) << "cycles" << std::setw(14) << "instructions" << std::setw(7) << "IPC"
+            << std::setw(14) << "cache-miss" << std::setw(14) << "branch-miss";
+    }
+    out << "\n";
+
+    for (const auto& s : samples) {
+        std::string name = std::string(static_cast<std::size_t>(s.depth) * 2, ' ') + s.name;
+        out << std::left << std::setw(36) << name << std::right << std::setw(12)
+            << std::fixed << std::setprecision(3) << s.wallMs;
+        if (countersAvailable()) {
+            for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+                if (i == PERF_CACHE_MISSES) {
+                    // IPC插在instructions之后
+                    bool ok = s.counters.valid[PERF_CYCLES] && s.counters.valid[PERF_INSTRUCTIONS] &&
+                              s.counters.values[PERF_CYCLES] > 0;
+                    out << std::setw(7) << std::setprecision(2);
+                    if (ok) {
+                        out << static_cast<double>(s.counters.values[PERF_INSTRUCTIONS]) /
+                                   static_cast<double>(s.counters.values[PERF_CYCLES]);
+                    } else {
+                        out << "-";
+                    }
+                }
+                out << std::setw(14);
+                if (s.counters.valid[i]) out << s.counters.values[i];
+                else out << "-";
+            }
+        }
+        out << "\n";
+    }
+}
+
+void PhaseProfiler::writeJson(std::ostream& out) const {
+    out << "{\n  \"counters\": {\"requested\": " << (useCounters ? "true" : "false")
+        << ", \"available\": " << (countersAvailable() ? "true" : "false");
+    if (useCounters && !counters.available()) {
+        out << ", \"reason\": \"" << jsonEscape(counters.unavailableReason()) << "\"";
+    }
+    out << "},\n  \"phases\": [";
+
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        const auto& s = samples[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << jsonEscape(s.name) << "\", \"depth\": " << s.depth
+            << ", \"wall_ms\": " << std::fixed << std::setprecision(6) << s.wallMs;
+        for (int e = 0; e < PERF_EVENT_COUNT; ++e) {
+            if (s.counters.valid[e]) {
+                out << ", \"" << PerfCounterGroup::eventName(e) << "\": " << s.counters.values[e];
+            }
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "ir/irgen.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ==================== 硬件性能计数器 ====================
+//
+// 基于Linux perf_event_open的计数器组：cycles、instructions、cache-misses、branch-misses。
+// 内核不允许（perf_event_paranoid）、虚拟机无PMU或非Linux平台时，available()为false，
+// unavailableReason()给出原因，调用方只输出耗时。
+
+enum PerfEvent {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_CACHE_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_EVENT_COUNT
+};
+
+struct PerfCounterValues {
+    std::uint64_t values[PERF_EVENT_COUNT] = {};
+    bool valid[PERF_EVENT_COUNT] = {};
+};
+
+class PerfCounterGroup {
+private:
+    int fds[PERF_EVENT_COUNT];
+    int leaderFd = -1;
+    int memberIndex[PERF_EVENT_COUNT];   // 事件在组读取结果中的下标，-1表示未打开
+    int memberCount = 0;
+    std::string reason;
+
+public:
+    PerfCounterGroup();
+    ~PerfCounterGroup();
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    bool open();
+    bool available() const { return leaderFd >= 0; }
+    const std::string& unavailableReason() const { return reason; }
+
+    // 读取当前累计值（已按多路复用时间比例缩放）
+    PerfCounterValues read() const;
+
+    static const char* eventName(int event);
+};
+
+// ==================== 阶段剖析器 ====================
+//
+// 记录各编译阶段及各优化遍的耗时和计数器增量，阶段可以嵌套
+// （优化遍作为IRGenerator阶段的子阶段，通过IRPassListener接入）。
+
+class PhaseProfiler : public IRPassListener {
+public:
+    struct Sample {
+        std::string name;
+        int depth = 0;
+        double wallMs = 0.0;
+        PerfCounterValues counters;
+    };
+
+    // 析构时结束阶段，便于提前return的错误路径
+    class Scope {
+    private:
+        PhaseProfiler* profiler;
+    public:
+        Scope(PhaseProfiler* profiler, const std::string& name) : profiler(profiler) {
+            if (profiler) profiler->begin(name);
+        }
+        ~Scope() { if (profiler) profiler->end(); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    struct OpenPhase {
+        std::size_t sampleIndex;
+        std::uint64_t startNs;
+        PerfCounterValues startCounters;
+    };
+
+    bool useCounters;
+    PerfCounterGroup counters;
+    std::vector<Sample> samples;
+    std::vector<OpenPhase> open;
+
+public:
+    explicit PhaseProfiler(bool useCounters);
+
+    void begin(const std::string& name);
+    void end();
+
+    void beforePass(const std::string& passName,
+                    const std::vector<std::shared_ptr<IRInstr>>& instructions) override;
+    void afterPass(const std::string& passName,
+                   const std::vector<std::shared_ptr<IRInstr>>& instructions) override;
+
+    bool countersAvailable() const { return useCounters && counters.available(); }
+    const std::vector<Sample>& getSamples() const { return samples; }
+
+    void printReport(std::ostream& out) const;
+    void writeJson(std::ostream& out) const;
+};
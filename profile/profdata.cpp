@@ -0,0 +1,194 @@
+// profdata.cpp - 剖析文件读取与边计数恢复
+#include "profdata.h"
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+std::uint64_t readU64(const unsigned char* bytes) {
+    std::uint64_t value = 0;
+    for (int b = 7; b >= 0; --b) value = (value << 8) | bytes[b];
+    return value;
+}
+
+bool readEdgeSection(std::istream& in, ProfileData& data, std::string& error) {
+    std::string line;
+    int counterCount = 0;
+    ProfiledFunction* current = nullptr;
+    bool sawData = false;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string tag;
+        fields >> tag;
+        if (tag == "data") {
+            sawData = true;
+            break;
+        } else if (tag == "counters") {
+            fields >> counterCount;
+        } else if (tag == "function") {
+            data.functions.emplace_back();
+            current = &data.functions.back();
+            fields >> current->name;
+        } else if (tag == "b" && current) {
+            int id;
+            std::string name;
+            fields >> id >> name;
+            current->blocks.push_back(name);
+        } else if (tag == "e" && current) {
+            ProfiledEdge e;
+            std::string counter;
+            fields >> e.src >> e.dst >> counter;
+            if (counter != "-") e.counter = std::stoi(counter);
+            current->edges.push_back(e);
+        } else if (tag == "end") {
+            current = nullptr;
+        } else {
+            error = "malformed layout line: " + line;
+            return false;
+        }
+    }
+    if (!sawData) {
+        error = "truncated profile: missing counter data";
+        return false;
+    }
+
+    data.hasEdges = true;
+    data.counters.resize(counterCount);
+    for (int i = 0; i < counterCount; ++i) {
+        unsigned char bytes[8];
+        if (!in.read(reinterpret_cast<char*>(bytes), 8)) {
+            error = "truncated profile: expected " + std::to_string(counterCount) + " counters";
+            return false;
+        }
+        data.counters[i] = readU64(bytes);
+    }
+    return true;
+}
+
+bool readFunctionSection(std::istream& in, ProfileData& data, std::string& error) {
+    std::string line;
+    bool sawData = false;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string tag;
+        fields >> tag;
+        if (tag == "data") {
+            sawData = true;
+            break;
+        } else if (tag == "f") {
+            FunctionTiming timing;
+            int id;
+            fields >> id >> timing.name;
+            data.timings.push_back(timing);
+        } else if (tag != "functions") {
+            error = "malformed function table line: " + line;
+            return false;
+        }
+    }
+    if (!sawData) {
+        error = "truncated profile: missing function records";
+        return false;
+    }
+
+    data.hasTimings = true;
+    for (auto& timing : data.timings) {
+        unsigned char record[32];
+        if (!in.read(reinterpret_cast<char*>(record), sizeof(record))) {
+            error = "truncated profile: expected " + std::to_string(data.timings.size()) + " function records";
+            return false;
+        }
+        timing.calls = readU64(record);
+        timing.cycles = readU64(record + 8);
+    }
+    return true;
+}
+
+} // namespace
+
+// ==================== 读取 ====================
+
+bool ProfileData::read(const std::string& path, ProfileData& data, std::string& error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string header;
+    bool any = false;
+    while (std::getline(in, header)) {
+        bool ok;
+        if (header == "TOYCPROF edge 1") {
+            ok = readEdgeSection(in, data, error);
+        } else if (header == "TOYCPROF func 1") {
+            ok = readFunctionSection(in, data, error);
+        } else {
+            error = path + (any ? ": unknown profile section '" + header + "'" : " is not a ToyC profile");
+            return false;
+        }
+        if (!ok) return false;
+        any = true;
+    }
+    if (!any) {
+        error = path + " is empty";
+        return false;
+    }
+    return true;
+}
+
+// ==================== 计数恢复 ====================
+
+void ProfiledFunction::reconstruct(const std::vector<std::uint64_t>& counters) {
+    for (auto& e : edges) {
+        if (e.counter >= 0 && e.counter < static_cast<int>(counters.size())) {
+            e.known = true;
+            e.count = static_cast<std::int64_t>(counters[e.counter]);
+        }
+    }
+
+    int count = static_cast<int>(blocks.size());
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int v = 0; v < count; ++v) {
+            std::int64_t in = 0, out = 0;
+            int unknown = -1, unknownCount = 0;
+            bool unknownIsIn = false;
+            for (int i = 0; i < static_cast<int>(edges.size()); ++i) {
+                const ProfiledEdge& e = edges[i];
+                if (e.src == e.dst) continue;  // 自环两侧抵消
+                bool isIn = e.dst == v, isOut = e.src == v;
+                if (!isIn && !isOut) continue;
+                if (!e.known) {
+                    ++unknownCount;
+                    unknown = i;
+                    unknownIsIn = isIn;
+                } else if (isIn) {
+                    in += e.count;
+                } else {
+                    out += e.count;
+                }
+            }
+            if (unknownCount != 1) continue;
+            std::int64_t value = unknownIsIn ? out - in : in - out;
+            if (value < 0) {
+                consistent = false;
+                value = 0;
+            }
+            edges[unknown].count = value;
+            edges[unknown].known = true;
+            changed = true;
+        }
+    }
+    for (const auto& e : edges) {
+        if (!e.known) consistent = false;
+    }
+}
+
+std::int64_t ProfiledFunction::blockCount(int block) const {
+    std::int64_t sum = 0;
+    for (const auto& e : edges) {
+        if (e.dst == block) sum += e.count;
+    }
+    return sum;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ==================== 剖析文件读取 ====================
+//
+// 剖析文件由插桩程序在main返回前写出，由若干段组成，每段是文本描述（以"data"行
+// 结束）加小端二进制数据表：
+//   TOYCPROF edge 1  边剖析（-fprofile-generate，布局见ir/edgeprofile.cpp），
+//                    64位计数器只覆盖生成树之外的边，其余边和全部块的计数按
+//                    流量守恒（每个块流入=流出，含虚拟边exit->entry）逐个恢复
+//   TOYCPROF func 1  函数剖析（-finstrument-functions-lite），每函数32字节记录：
+//                    calls(8) cycles(8) depth(4) pad(4) start(8)
+// toyc_profdata和-ffunction-order=<file>共用这里的读取代码。
+
+struct ProfiledEdge {
+    int src = 0;
+    int dst = 0;
+    int counter = -1;
+    bool known = false;
+    std::int64_t count = 0;
+};
+
+struct ProfiledFunction {
+    std::string name;
+    std::vector<std::string> blocks;
+    std::vector<ProfiledEdge> edges;
+    bool consistent = true;
+
+    // 反复寻找只剩一条未知边的块，用流入=流出解出该边
+    void reconstruct(const std::vector<std::uint64_t>& counters);
+    std::int64_t blockCount(int block) const;
+};
+
+struct FunctionTiming {
+    std::string name;
+    std::uint64_t calls = 0;
+    std::uint64_t cycles = 0;
+};
+
+struct ProfileData {
+    bool hasEdges = false;
+    std::vector<ProfiledFunction> functions;
+    std::vector<std::uint64_t> counters;
+
+    bool hasTimings = false;
+    std::vector<FunctionTiming> timings;
+
+    // 失败时返回false并在error中给出原因
+    static bool read(const std::string& path, ProfileData& data, std::string& error);
+};
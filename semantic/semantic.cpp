@@ -2,11 +2,6 @@
 #include <iostream>
 #include <sstream>
 
-SemanticAnalyzer* analyzeHelper::semanticOwner = nullptr;
-
-void analyzeHelper::setSemanticOwner(SemanticAnalyzer& analyzer) {
-    semanticOwner = &analyzer;
-}
 
 void analyzeHelper::enterScope() {
     owner.getSymbolTables().push_back(std::unordered_map<std::string, Symbol>());
@@ -100,11 +95,6 @@ void analyzeHelper::error(const std::string &message, int line, int column) {
     if (reportedErrors.find(fullMessage) == reportedErrors.end()) {
         reportedErrors.insert(fullMessage);
         owner.errorMessages.push_back(fullMessage);
-        
-        if (semanticOwner) {
-            semanticOwner->success = false;
-            semanticOwner->errorMessages.push_back(fullMessage);
-        }
     }
 }
 
@@ -120,10 +110,6 @@ void analyzeHelper::warning(const std::string &message, int line, int column) {
     if (reportedWarnings.find(fullMessage) == reportedWarnings.end()) {
         reportedWarnings.insert(fullMessage);
         owner.warningMessages.push_back(fullMessage);
-        
-        if (semanticOwner) {
-            semanticOwner->warningMessages.push_back(fullMessage);
-        }
     }
 }
 
@@ -707,20 +693,28 @@ void analyzeVisitor::detectDeadCode() {
 
 bool SemanticAnalyzer::analyze(std::shared_ptr<CompUnit> ast) {
     clearMessages();
-    analyzeHelper::setSemanticOwner(*this);
+    // 本次分析新增的消息从visitor的累计列表中截取，不再经由全局指针回写
+    size_t errorStart = visitor.errorMessages.size();
+    size_t warningStart = visitor.warningMessages.size();
+    visitor.success = true;
     ast->accept(visitor);
+    success = visitor.success;
     
     if (success) {
         checkUnusedVariables();
         detectDeadCode();
     }
     
+    errorMessages.assign(visitor.errorMessages.begin() + errorStart, visitor.errorMessages.end());
+    warningMessages.assign(visitor.warningMessages.begin() + warningStart, visitor.warningMessages.end());
+    success = success && errorMessages.empty();
+    
     for (const auto& error : errorMessages) {
-        std::cerr << "Semantic error: " << error << std::endl;
+        *diagnostics << "Semantic error: " << error << std::endl;
     }
     
     for (const auto& warning : warningMessages) {
-        std::cerr << "Warning: " << warning << std::endl;
+        *diagnostics << "Warning: " << warning << std::endl;
     }
     
     return success;
@@ -5,6 +5,7 @@
 #include <vector>
 #include <set>
 #include <stdexcept>
+#include <iostream>
 #include "parser/ast.h"
 #include "infos.h"
 
@@ -14,7 +15,6 @@ class SemanticAnalyzer;
 class analyzeHelper {
 private:
     analyzeVisitor &owner;
-    static SemanticAnalyzer* semanticOwner;
     std::set<std::string> reportedErrors;
     std::set<std::string> reportedWarnings;
     int loopDepth = 0;
@@ -22,8 +22,6 @@ private:
 public:
     explicit analyzeHelper(analyzeVisitor &owner) : owner(owner) {}
     
-    static void setSemanticOwner(SemanticAnalyzer& analyzer);
-    
     void enterScope();
     void exitScope();
     
@@ -141,9 +139,10 @@ public:
 class SemanticAnalyzer {
 private:
     analyzeVisitor visitor;
+    std::ostream* diagnostics;
     
 public:
-    SemanticAnalyzer() : visitor() {}
+    explicit SemanticAnalyzer(std::ostream& diagnostics = std::cerr) : visitor(), diagnostics(&diagnostics) {}
     
     bool success = true;
     std::vector<std::string> errorMessages;
@@ -0,0 +1,423 @@
+// toyc_autotune.cpp - 离线调优-opt的优化流水线，生成ir/pipeline_presets.inc中的预设
+//
+// 1. 参照：每个语料程序不开优化编译一次，用IR解释器求出main的返回值；
+//    再用空流水线的-opt编译，记录静态代价（codegen/costmodel.h的加权周期）和编译耗时
+//    作为归一化基准，使两项比值只反映优化遍本身
+// 2. 评估：一个候选流水线（遍序列、重复次数、内联阈值）在全部语料上编译，
+//    IR解释结果与参照不同、解释出错或编译失败的候选不可行；
+//    目标 = 平均(代价/基准代价) + 耗时权重 * (总编译耗时/基准总编译耗时)
+// 3. 搜索：从"default"（不可行时从空流水线）出发做模拟退火，变异包括插入、删除、
+//    交换、移动一个遍以及调整内联阈值；同一个遍最多出现--max-repeat次
+// 4. 消融：对最优流水线逐个去掉每种遍，报告目标、代价和耗时的变化
+//
+// 用法:
+//   toyc_autotune [--name=NAME] [--out=FILE] [--iterations=N] [--time-weight=W] [--core=CORE]
+//                 [--max-repeat=N] [--seed=N] FILE...
+#include "codegen/costmodel.h"
+#include "ir/irgen.h"
+#include "libtoyc/toyc.h"
+#include "vm/bytecode.h"
+#include "vm/irinterp.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 解释执行的IR指令上限，防止错误的优化产生死循环
+const uint64_t kInstructionLimit = 200000000;
+
+// 每个程序编译几次取最短耗时，减少计时噪声
+const int kTimingRuns = 3;
+
+struct Program {
+    std::string path;
+    std::string source;
+    int expected = 0;
+    double baseCost = 0.0;
+    double baseMs = 0.0;
+};
+
+struct Evaluation {
+    bool feasible = false;
+    std::string failure;         // 不可行的原因
+    double costRatio = 0.0;      // 平均(代价/基准代价)
+    double timeRatio = 0.0;      // 总编译耗时/基准总编译耗时
+    double objective = std::numeric_limits<double>::infinity();
+};
+
+class Tuner {
+public:
+    Tuner(std::vector<Program> programs, const CoreModel& core, double timeWeight)
+        : programs(std::move(programs)), core(core), timeWeight(timeWeight) {}
+
+    bool prepare();
+    Evaluation evaluate(const OptPipeline& pipeline);
+    size_t evaluations() const { return cache.size(); }
+
+private:
+    std::vector<Program> programs;
+    const CoreModel& core;
+    double timeWeight;
+    double baseTotalMs = 0.0;
+    std::map<std::string, Evaluation> cache;
+    toyc::CompileOutput output;
+
+    // 编译并返回最短耗时（毫秒），失败返回负数
+    double compile(const Program& program, const toyc::CompileOptions& options);
+    double staticCost();
+};
+
+double Tuner::compile(const Program& program, const toyc::CompileOptions& options) {
+    double best = std::numeric_limits<double>::infinity();
+    for (int run = 0; run < kTimingRuns; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        bool ok = toyc::compile(program.source, options, output);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!ok) return -1.0;
+        best = std::min(best, ms);
+    }
+    return best;
+}
+
+double Tuner::staticCost() {
+    CostModel model(core);
+    model.analyze(output.assembly);
+    double cost = 0.0;
+    for (const auto& function : model.functions()) cost += static_cast<double>(function.weighted);
+    return std::max(cost, 1.0);
+}
+
+bool Tuner::prepare() {
+    toyc::CompileOptions reference;
+    OptPipeline empty;
+    toyc::CompileOptions baseline;
+    baseline.optimize = true;
+    baseline.pipeline = &empty;
+    std::vector<Program> usable;
+    for (auto& program : programs) {
+        reference.sourceName = program.path;
+        if (!toyc::compile(program.source, reference, output)) {
+            std::cerr << output.diagnostics << "Error: failed to compile " << program.path << std::endl;
+            return false;
+        }
+        try {
+            IRInterpreter interpreter(output.program);
+            interpreter.setInstructionLimit(kInstructionLimit);
+            program.expected = interpreter.run();
+        } catch (const VmError& e) {
+            std::cerr << "跳过" << program.path << "：未优化的程序无法解释执行（" << e.what() << "）\n";
+            continue;
+        }
+        baseline.sourceName = program.path;
+        double ms = compile(program, baseline);
+        if (ms < 0) {
+            std::cerr << output.diagnostics << "Error: failed to compile " << program.path << std::endl;
+            return false;
+        }
+        program.baseCost = staticCost();
+        program.baseMs = ms;
+        baseTotalMs += ms;
+        usable.push_back(std::move(program));
+    }
+    programs.swap(usable);
+    return !programs.empty();
+}
+
+Evaluation Tuner::evaluate(const OptPipeline& pipeline) {
+    std::string key = pipeline.passList() + "|" + std::to_string(pipeline.inlineMaxInstructions) + "|" +
+                      std::to_string(pipeline.inlineMaxCallSites);
+    auto cached = cache.find(key);
+    if (cached != cache.end()) return cached->second;
+
+    Evaluation result;
+    toyc::CompileOptions options;
+    options.optimize = true;
+    options.pipeline = &pipeline;
+    double totalMs = 0.0;
+    double costSum = 0.0;
+    for (const auto& program : programs) {
+        options.sourceName = program.path;
+        double ms = compile(program, options);
+        if (ms < 0) {
+            result.failure = program.path + ": 编译失败";
+            return cache[key] = result;
+        }
+        try {
+            IRInterpreter interpreter(output.program);
+            interpreter.setInstructionLimit(kInstructionLimit);
+            int value = interpreter.run();
+            if (value != program.expected) {
+                result.failure = program.path + ": 结果" + std::to_string(value) + "，应为" +
+                                 std::to_string(program.expected);
+                return cache[key] = result;
+            }
+        } catch (const VmError& e) {
+            result.failure = program.path + ": " + e.what();
+            return cache[key] = result;
+        }
+        totalMs += ms;
+        costSum += staticCost() / program.baseCost;
+    }
+    result.feasible = true;
+    result.costRatio = costSum / static_cast<double>(programs.size());
+    result.timeRatio = baseTotalMs > 0 ? totalMs / baseTotalMs : 1.0;
+    result.objective = result.costRatio + timeWeight * result.timeRatio;
+    return cache[key] = result;
+}
+
+// ==================== 搜索 ====================
+
+class Mutator {
+public:
+    Mutator(std::vector<std::string> passNames, int maxRepeat, std::mt19937& rng)
+        : passNames(std::move(passNames)), maxRepeat(maxRepeat), rng(rng) {}
+
+    OptPipeline mutate(const OptPipeline& pipeline);
+
+private:
+    std::vector<std::string> passNames;
+    int maxRepeat;
+    std::mt19937& rng;
+
+    OptPipeline mutateOnce(const OptPipeline& pipeline);
+    int pick(int n) { return std::uniform_int_distribution<int>(0, n - 1)(rng); }
+};
+
+// 重试到产生不同的流水线为止（例如空流水线只能插入）
+OptPipeline Mutator::mutate(const OptPipeline& pipeline) {
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        OptPipeline next = mutateOnce(pipeline);
+        if (next.passes != pipeline.passes || next.inlineMaxInstructions != pipeline.inlineMaxInstructions ||
+            next.inlineMaxCallSites != pipeline.inlineMaxCallSites) {
+            return next;
+        }
+    }
+    return pipeline;
+}
+
+OptPipeline Mutator::mutateOnce(const OptPipeline& pipeline) {
+    static const int kInlineSizes[] = {0, 2, 5, 8, 10, 15, 20, 30, 50};
+    OptPipeline next = pipeline;
+    auto& passes = next.passes;
+    int n = static_cast<int>(passes.size());
+    switch (pick(6)) {
+    case 0: {  // 插入
+        const std::string& pass = passNames[pick(static_cast<int>(passNames.size()))];
+        if (std::count(passes.begin(), passes.end(), pass) < maxRepeat) passes.insert(passes.begin() + pick(n + 1), pass);
+        break;
+    }
+    case 1:    // 删除
+        if (n > 0) passes.erase(passes.begin() + pick(n));
+        break;
+    case 2:    // 交换
+        if (n > 1) std::swap(passes[pick(n)], passes[pick(n)]);
+        break;
+    case 3:    // 移动
+        if (n > 1) {
+            int from = pick(n);
+            std::string pass = passes[from];
+            passes.erase(passes.begin() + from);
+            passes.insert(passes.begin() + pick(n), pass);
+        }
+        break;
+    case 4:
+        next.inlineMaxInstructions = kInlineSizes[pick(static_cast<int>(std::size(kInlineSizes)))];
+        break;
+    default:
+        next.inlineMaxCallSites = 1 + pick(4);
+        break;
+    }
+    return next;
+}
+
+void printEvaluation(std::ostream& out, const Evaluation& e) {
+    if (!e.feasible) {
+        out << "不可行（" << e.failure << "）";
+        return;
+    }
+    out << std::fixed << std::setprecision(4) << "目标 " << e.objective << "（代价 " << e.costRatio * 100
+        << "%，编译耗时 " << e.timeRatio * 100 << "%）";
+}
+
+// 更新预设文件中名为name的一行，没有时追加；文件不存在时写出完整的文件头
+bool writePreset(const std::string& path, const OptPipeline& pipeline, const std::string& comment) {
+    std::string line = "TOYC_PIPELINE_PRESET(\"" + pipeline.name + "\", \"" + pipeline.passList() + "\", " +
+                       std::to_string(pipeline.inlineMaxInstructions) + ", " +
+                       std::to_string(pipeline.inlineMaxCallSites) + ")  // " + comment;
+    if (path.empty()) {
+        std::cout << line << "\n";
+        return true;
+    }
+
+    std::vector<std::string> lines;
+    std::ifstream in(path);
+    if (in) {
+        for (std::string text; std::getline(in, text);) lines.push_back(text);
+    } else {
+        lines = {"// pipeline_presets.inc - 由toyc_autotune生成或更新，请勿手工修改", ""};
+    }
+    std::string prefix = "TOYC_PIPELINE_PRESET(\"" + pipeline.name + "\",";
+    auto it = std::find_if(lines.begin(), lines.end(), [&](const std::string& text) {
+        return text.rfind(prefix, 0) == 0;
+    });
+    if (it != lines.end()) *it = line;
+    else lines.push_back(line);
+
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: Cannot open file " << path << std::endl;
+        return false;
+    }
+    for (const auto& text : lines) out << text << "\n";
+    return true;
+}
+
+int usage() {
+    std::cerr << "用法: toyc_autotune [--name=NAME] [--out=FILE] [--iterations=N] [--time-weight=W] "
+                 "[--core=CORE] [--max-repeat=N] [--seed=N] FILE...\n"
+                 "  FILE为ToyC源文件（.tc），main的返回值用于检查优化的正确性\n";
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string name = "tuned";
+    std::string outFile;
+    int iterations = 300;
+    double timeWeight = 0.1;
+    std::string coreName = CoreModel::defaultModel().name;
+    int maxRepeat = 2;
+    unsigned seed = 20240611;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const char* prefix) { return arg.substr(std::string(prefix).size()); };
+        if (arg.rfind("--name=", 0) == 0) {
+            name = value("--name=");
+        } else if (arg.rfind("--out=", 0) == 0) {
+            outFile = value("--out=");
+        } else if (arg.rfind("--iterations=", 0) == 0) {
+            iterations = std::stoi(value("--iterations="));
+        } else if (arg.rfind("--time-weight=", 0) == 0) {
+            timeWeight = std::stod(value("--time-weight="));
+        } else if (arg.rfind("--core=", 0) == 0) {
+            coreName = value("--core=");
+        } else if (arg.rfind("--max-repeat=", 0) == 0) {
+            maxRepeat = std::stoi(value("--max-repeat="));
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            seed = static_cast<unsigned>(std::stoul(value("--seed=")));
+        } else if (arg.rfind("--", 0) == 0) {
+            return usage();
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    const CoreModel* core = CoreModel::find(coreName);
+    if (inputs.empty() || name.empty() || iterations < 0 || maxRepeat < 1 || !core) return usage();
+
+    std::vector<Program> programs;
+    for (const auto& input : inputs) {
+        std::ifstream file(input);
+        if (!file) {
+            std::cerr << "Error: Cannot open file " << input << std::endl;
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        programs.push_back({input, buffer.str()});
+    }
+
+    // ---------- 参照 ----------
+    Tuner tuner(std::move(programs), *core, timeWeight);
+    if (!tuner.prepare()) {
+        std::cerr << "Error: no usable program in the corpus" << std::endl;
+        return 1;
+    }
+
+    OptPipeline empty;
+    empty.name = name;
+    Evaluation emptyEval = tuner.evaluate(empty);
+    OptPipeline standard = OptPipeline::standard();
+    Evaluation standardEval = tuner.evaluate(standard);
+    std::cerr << "空流水线: ";
+    printEvaluation(std::cerr, emptyEval);
+    std::cerr << "\ndefault:  ";
+    printEvaluation(std::cerr, standardEval);
+    std::cerr << "\n";
+
+    // ---------- 模拟退火 ----------
+    auto startTime = std::chrono::steady_clock::now();
+    std::mt19937 rng(seed);
+    Mutator mutator(IRGenerator::passNames(), maxRepeat, rng);
+    OptPipeline current = standardEval.feasible ? standard : empty;
+    current.name = name;
+    Evaluation currentEval = standardEval.feasible ? standardEval : emptyEval;
+    OptPipeline best = current;
+    Evaluation bestEval = currentEval;
+    int infeasible = 0;
+    for (int iter = 0; iter < iterations; ++iter) {
+        double temperature = 0.02 * (1.0 - static_cast<double>(iter) / std::max(iterations, 1));
+        OptPipeline candidate = mutator.mutate(current);
+        Evaluation eval = tuner.evaluate(candidate);
+        if (!eval.feasible) {
+            ++infeasible;
+            continue;
+        }
+        double delta = eval.objective - currentEval.objective;
+        if (delta <= 0 || std::uniform_real_distribution<double>(0, 1)(rng) < std::exp(-delta / temperature)) {
+            current = candidate;
+            currentEval = eval;
+        }
+        if (eval.objective < bestEval.objective) {
+            best = candidate;
+            bestEval = eval;
+            std::cerr << "  [" << iter << "] ";
+            printEvaluation(std::cerr, eval);
+            std::cerr << "  " << best.passList() << " (" << best.inlineMaxInstructions << ", "
+                      << best.inlineMaxCallSites << ")\n";
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cerr << "评估" << tuner.evaluations() << "个流水线（" << infeasible << "次变异不可行），用时" << seconds
+              << "秒\n最优: ";
+    printEvaluation(std::cerr, bestEval);
+    std::cerr << "\n";
+
+    // ---------- 消融 ----------
+    std::cerr << "--- 消融：从最优流水线中去掉每种遍 ---\n";
+    std::vector<std::string> distinct;
+    for (const auto& pass : best.passes) {
+        if (std::find(distinct.begin(), distinct.end(), pass) == distinct.end()) distinct.push_back(pass);
+    }
+    for (const auto& pass : distinct) {
+        OptPipeline ablated = best;
+        ablated.passes.erase(std::remove(ablated.passes.begin(), ablated.passes.end(), pass), ablated.passes.end());
+        Evaluation eval = tuner.evaluate(ablated);
+        std::cerr << "  -" << std::left << std::setw(32) << pass << std::right;
+        if (!eval.feasible) {
+            std::cerr << "不可行（" << eval.failure << "）\n";
+            continue;
+        }
+        std::cerr << std::showpos << std::fixed << std::setprecision(4) << "目标 "
+                  << eval.objective - bestEval.objective << "  代价 " << (eval.costRatio - bestEval.costRatio) * 100
+                  << "%  编译耗时 " << (eval.timeRatio - bestEval.timeRatio) * 100 << "%" << std::noshowpos << "\n";
+    }
+
+    std::ostringstream comment;
+    comment << std::fixed << std::setprecision(4) << "objective " << bestEval.objective << ", cost "
+            << bestEval.costRatio * 100 << "%, compile time " << bestEval.timeRatio * 100 << "% ("
+            << core->name << ", time weight " << timeWeight << ")";
+    return writePreset(outFile, best, comment.str()) ? 0 : 1;
+}
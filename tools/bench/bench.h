@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// ==================== toyc_bench子命令 ====================
+//
+// 每个子命令接收去掉子命令名之后的参数，返回进程退出码。
+
+// 优化遍在合成CFG形状上的规模扩展测试
+int runPassScalingBench(const std::vector<std::string>& args);
+
+// 两个编译器构建或两组参数在同一语料上的A/B对比
+int runCompareBench(const std::vector<std::string>& args);
+
+// IR解释器、字节码VM与JIT的执行速度对比
+int runExecBench(const std::vector<std::string>& args);
+
+// 线性扫描与图着色寄存器分配器在大型合成函数上的耗时
+int runRegAllocBench(const std::vector<std::string>& args);
+
+// ==================== 公共辅助函数 ====================
+
+// 解析形如 --key=value 的参数，匹配时写入value并返回true
+bool parseKeyValue(const std::string& arg, const std::string& key, std::string& value);
+
+// 按逗号切分
+std::vector<std::string> splitList(const std::string& text);
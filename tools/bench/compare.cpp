@@ -0,0 +1,436 @@
+// compare.cpp - 两个编译器构建（或两组参数）的A/B基准对比
+//
+// 对同一语料交替执行A、B（每轮按ABBA顺序），对每个基准和指标报告中位数、
+// Hodges-Lehmann位移估计及其置信区间、Mann-Whitney U检验的双侧p值，
+// 并标记超过阈值且显著的回退。
+//
+// 指标（均为越小越好）：
+//   compile_ms   编译器进程的墙钟时间
+//   max_rss_kb   编译器进程的峰值常驻内存
+//   asm_instrs   生成汇编的指令条数（静态，无噪声）
+//
+// 用法:
+//   toyc_bench compare --a=COMPILER [--b=COMPILER] [选项] 语料文件或目录...
+//     --a-flags="..."      A的编译参数（空格分隔）
+//     --b-flags="..."      B的编译参数；省略--b时用同一编译器比较两组参数
+//     --reps=N             每个基准每个变体的重复次数（默认15）
+//     --threshold=P        回退阈值，百分比（默认5）
+//     --alpha=A            显著性水平（默认0.05）
+//     --markdown=FILE      输出Markdown报告（'-'为标准输出，默认'-'）
+//     --json=FILE          输出JSON报告
+// 存在显著回退时退出码为2。
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// ==================== 执行编译器 ====================
+
+struct Variant {
+    std::string name;
+    std::string compiler;
+    std::vector<std::string> flags;
+};
+
+struct RunMeasurement {
+    bool ok = false;
+    double wallMs = 0;
+    double maxRssKb = 0;
+    std::string output;
+};
+
+std::vector<std::string> splitWords(const std::string& text) {
+    std::vector<std::string> words;
+    std::istringstream in(text);
+    std::string w;
+    while (in >> w) words.push_back(w);
+    return words;
+}
+
+std::string readFile(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+RunMeasurement runCompiler(const Variant& variant, const std::string& input, const fs::path& outPath) {
+    RunMeasurement m;
+    auto start = std::chrono::steady_clock::now();
+
+    pid_t pid = fork();
+    if (pid < 0) return m;
+    if (pid == 0) {
+        int out = open(outPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int devnull = open("/dev/null", O_WRONLY);
+        if (out >= 0) dup2(out, STDOUT_FILENO);
+        if (devnull >= 0) dup2(devnull, STDERR_FILENO);
+
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(variant.compiler.c_str()));
+        for (const auto& f : variant.flags) argv.push_back(const_cast<char*>(f.c_str()));
+        argv.push_back(const_cast<char*>(input.c_str()));
+        argv.push_back(nullptr);
+        execv(variant.compiler.c_str(), argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage {};
+    while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {}
+    auto end = std::chrono::steady_clock::now();
+
+    m.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    m.wallMs = std::chrono::duration<double, std::milli>(end - start).count();
+    m.maxRssKb = static_cast<double>(usage.ru_maxrss);
+    m.output = readFile(outPath);
+    return m;
+}
+
+// 汇编指令条数：以制表符开头且不是汇编伪指令的行
+double countAsmInstructions(const std::string& asmText) {
+    std::istringstream in(asmText);
+    std::string line;
+    double count = 0;
+    while (std::getline(in, line)) {
+        if (line.size() > 1 && line[0] == '\t' && line[1] != '.') ++count;
+    }
+    return count;
+}
+
+// ==================== 统计 ====================
+
+double median(std::vector<double> v) {
+    if (v.empty()) return NAN;
+    std::sort(v.begin(), v.end());
+    std::size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+double normalQuantile(double p) {
+    // Acklam有理逼近，足够用于置信区间
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                               1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                               6.680131188771972e+01, -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                               -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                               3.754408661907416e+00};
+    double q, r;
+    if (p < 0.02425) {
+        q = std::sqrt(-2 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    if (p > 1 - 0.02425) {
+        q = std::sqrt(-2 * std::log(1 - p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    q = p - 0.5;
+    r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+struct Comparison {
+    double medianA = NAN, medianB = NAN;
+    double shift = NAN;             // Hodges-Lehmann估计的B-A位移
+    double ciLow = NAN, ciHigh = NAN;
+    double pValue = NAN;
+};
+
+// Mann-Whitney U检验（正态近似，含结校正）和Hodges-Lehmann位移置信区间
+Comparison compareSamples(const std::vector<double>& a, const std::vector<double>& b, double alpha) {
+    Comparison c;
+    c.medianA = median(a);
+    c.medianB = median(b);
+    std::size_t n1 = a.size(), n2 = b.size();
+    if (n1 == 0 || n2 == 0) return c;
+
+    // 秩和
+    std::vector<std::pair<double, int>> all;
+    for (double x : a) all.emplace_back(x, 0);
+    for (double x : b) all.emplace_back(x, 1);
+    std::sort(all.begin(), all.end());
+    double rankSumA = 0, tieTerm = 0;
+    for (std::size_t i = 0; i < all.size();) {
+        std::size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first) ++j;
+        double avgRank = (static_cast<double>(i + 1) + static_cast<double>(j)) / 2.0;
+        double t = static_cast<double>(j - i);
+        tieTerm += t * t * t - t;
+        for (std::size_t k = i; k < j; ++k) {
+            if (all[k].second == 0) rankSumA += avgRank;
+        }
+        i = j;
+    }
+    double dn1 = static_cast<double>(n1), dn2 = static_cast<double>(n2), n = dn1 + dn2;
+    double u = rankSumA - dn1 * (dn1 + 1) / 2.0;
+    double meanU = dn1 * dn2 / 2.0;
+    double varU = dn1 * dn2 / 12.0 * ((n + 1) - tieTerm / (n * (n - 1)));
+    if (varU > 0) {
+        double z = (std::fabs(u - meanU) - 0.5) / std::sqrt(varU);  // 连续性校正
+        c.pValue = std::min(1.0, std::erfc(std::max(0.0, z) / std::sqrt(2.0)));
+    } else {
+        c.pValue = 1.0;  // 所有值相同
+    }
+
+    // Hodges-Lehmann：所有成对差的中位数
+    std::vector<double> diffs;
+    diffs.reserve(n1 * n2);
+    for (double x : a) {
+        for (double y : b) diffs.push_back(y - x);
+    }
+    std::sort(diffs.begin(), diffs.end());
+    c.shift = median(diffs);
+
+    double zCrit = normalQuantile(1.0 - alpha / 2.0);
+    double k = std::floor(meanU - zCrit * std::sqrt(dn1 * dn2 * (n + 1) / 12.0));
+    std::size_t lo = static_cast<std::size_t>(std::max(0.0, k));
+    std::size_t hi = diffs.size() - 1 - std::min(lo, diffs.size() - 1);
+    if (lo > hi) std::swap(lo, hi);
+    c.ciLow = diffs[lo];
+    c.ciHigh = diffs[hi];
+    return c;
+}
+
+// ==================== 报告 ====================
+
+struct Row {
+    std::string benchmark;
+    std::string metric;
+    Comparison cmp;
+    std::string verdict;
+    std::size_t samples = 0;
+};
+
+double percentOf(double value, double base) {
+    return base != 0 ? value / base * 100.0 : NAN;
+}
+
+std::string formatPercent(double v) {
+    if (std::isnan(v)) return "n/a";
+    std::ostringstream out;
+    out << std::showpos << std::fixed << std::setprecision(2) << v << "%";
+    return out.str();
+}
+
+std::string formatNumber(double v) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(v == std::floor(v) ? 0 : 3) << v;
+    return out.str();
+}
+
+std::string jsonNumber(double v) {
+    if (std::isnan(v) || std::isinf(v)) return "null";
+    std::ostringstream out;
+    out << std::setprecision(10) << v;
+    return out.str();
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') out += '\\';
+        out += ch;
+    }
+    return out;
+}
+
+void writeMarkdown(std::ostream& out, const std::vector<Row>& rows, const Variant& a, const Variant& b,
+                   int reps, double threshold, double alpha) {
+    auto describe = [](const Variant& v) {
+        std::string s = "`" + v.compiler;
+        for (const auto& f : v.flags) s += " " + f;
+        return s + "`";
+    };
+    out << "## ToyC A/B comparison\n\n"
+        << "- A: " << describe(a) << "\n"
+        << "- B: " << describe(b) << "\n"
+        << "- " << reps << " interleaved repetitions per variant (ABBA order), "
+        << "regression threshold " << threshold << "%, alpha " << alpha << "\n"
+        << "- Δ is the Hodges-Lehmann estimate of B - A relative to the A median; "
+        << "CI is the " << (1 - alpha) * 100 << "% confidence interval; p from a two-sided Mann-Whitney U test\n\n"
+        << "| benchmark | metric | A median | B median | Δ | CI | p | verdict |\n"
+        << "|---|---|---:|---:|---:|---|---:|---|\n";
+    int regressions = 0, improvements = 0;
+    for (const auto& r : rows) {
+        double base = r.cmp.medianA;
+        out << "| " << r.benchmark << " | " << r.metric << " | " << formatNumber(r.cmp.medianA) << " | "
+            << formatNumber(r.cmp.medianB) << " | " << formatPercent(percentOf(r.cmp.shift, base)) << " | ["
+            << formatPercent(percentOf(r.cmp.ciLow, base)) << ", " << formatPercent(percentOf(r.cmp.ciHigh, base))
+            << "] | " << std::fixed << std::setprecision(4) << r.cmp.pValue << " | "
+            << (r.verdict == "regression" ? "**regression**" : r.verdict) << " |\n";
+        if (r.verdict == "regression") ++regressions;
+        if (r.verdict == "improvement") ++improvements;
+    }
+    out << "\n" << regressions << " regression(s), " << improvements << " improvement(s)\n";
+}
+
+void writeJson(std::ostream& out, const std::vector<Row>& rows, const Variant& a, const Variant& b,
+               int reps, double threshold, double alpha) {
+    auto variantJson = [](const Variant& v) {
+        std::string s = "{\"compiler\": \"" + jsonEscape(v.compiler) + "\", \"flags\": [";
+        for (std::size_t i = 0; i < v.flags.size(); ++i) {
+            s += (i ? ", \"" : "\"") + jsonEscape(v.flags[i]) + "\"";
+        }
+        return s + "]}";
+    };
+    out << "{\n  \"a\": " << variantJson(a) << ",\n  \"b\": " << variantJson(b)
+        << ",\n  \"reps\": " << reps << ", \"threshold_percent\": " << threshold << ", \"alpha\": " << alpha
+        << ",\n  \"results\": [";
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        const auto& r = rows[i];
+        double base = r.cmp.medianA;
+        out << (i ? ",\n" : "\n") << "    {\"benchmark\": \"" << jsonEscape(r.benchmark) << "\", \"metric\": \""
+            << r.metric << "\", \"samples\": " << r.samples
+            << ", \"median_a\": " << jsonNumber(r.cmp.medianA) << ", \"median_b\": " << jsonNumber(r.cmp.medianB)
+            << ", \"shift\": " << jsonNumber(r.cmp.shift)
+            << ", \"shift_percent\": " << jsonNumber(percentOf(r.cmp.shift, base))
+            << ", \"ci_percent\": [" << jsonNumber(percentOf(r.cmp.ciLow, base)) << ", "
+            << jsonNumber(percentOf(r.cmp.ciHigh, base)) << "]"
+            << ", \"p_value\": " << jsonNumber(r.cmp.pValue) << ", \"verdict\": \"" << r.verdict << "\"}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+} // namespace
+
+// ==================== 入口 ====================
+
+int runCompareBench(const std::vector<std::string>& args) {
+    Variant a{"A", "", {}}, b{"B", "", {}};
+    int reps = 15;
+    double threshold = 5.0, alpha = 0.05;
+    std::string markdownPath = "-", jsonPath;
+    std::vector<std::string> inputs;
+
+    for (const auto& arg : args) {
+        std::string v;
+        if (parseKeyValue(arg, "--a", v)) a.compiler = v;
+        else if (parseKeyValue(arg, "--b", v)) b.compiler = v;
+        else if (parseKeyValue(arg, "--a-flags", v)) a.flags = splitWords(v);
+        else if (parseKeyValue(arg, "--b-flags", v)) b.flags = splitWords(v);
+        else if (parseKeyValue(arg, "--reps", v)) reps = std::max(2, std::stoi(v));
+        else if (parseKeyValue(arg, "--threshold", v)) threshold = std::stod(v);
+        else if (parseKeyValue(arg, "--alpha", v)) alpha = std::stod(v);
+        else if (parseKeyValue(arg, "--markdown", v)) markdownPath = v;
+        else if (parseKeyValue(arg, "--json", v)) jsonPath = v;
+        else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            return 1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (a.compiler.empty()) {
+        std::cerr << "Error: --a=COMPILER is required" << std::endl;
+        return 1;
+    }
+    if (b.compiler.empty()) b.compiler = a.compiler;
+
+    std::vector<fs::path> corpus;
+    for (const auto& input : inputs) {
+        if (fs::is_directory(input)) {
+            for (const auto& entry : fs::recursive_directory_iterator(input)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".tc") corpus.push_back(entry.path());
+            }
+        } else {
+            corpus.push_back(input);
+        }
+    }
+    std::sort(corpus.begin(), corpus.end());
+    if (corpus.empty()) {
+        std::cerr << "Error: no benchmark inputs given" << std::endl;
+        return 1;
+    }
+
+    fs::path outPath = fs::temp_directory_path() / ("toyc_bench_compare_" + std::to_string(getpid()) + ".s");
+    const char* metrics[] = {"compile_ms", "max_rss_kb", "asm_instrs"};
+
+    // samples[基准][变体][指标]
+    std::map<std::string, std::vector<double>> samples[2][3];
+    std::set<std::string> failed;
+
+    for (int r = 0; r < reps; ++r) {
+        for (const auto& file : corpus) {
+            // ABBA交替，抵消系统状态随时间的漂移
+            int order[2] = {r % 2 == 0 ? 0 : 1, r % 2 == 0 ? 1 : 0};
+            for (int which : order) {
+                const Variant& v = which == 0 ? a : b;
+                RunMeasurement m = runCompiler(v, file.string(), outPath);
+                if (!m.ok) {
+                    failed.insert(file.string() + " (" + v.name + ")");
+                    continue;
+                }
+                samples[which][0][file.string()].push_back(m.wallMs);
+                samples[which][1][file.string()].push_back(m.maxRssKb);
+                samples[which][2][file.string()].push_back(countAsmInstructions(m.output));
+            }
+        }
+        std::cerr << "round " << (r + 1) << "/" << reps << " done\n";
+    }
+    fs::remove(outPath);
+
+    for (const auto& f : failed) {
+        std::cerr << "Warning: compilation failed: " << f << "\n";
+    }
+
+    std::vector<Row> rows;
+    bool anyRegression = false;
+    for (const auto& file : corpus) {
+        for (int m = 0; m < 3; ++m) {
+            const auto& sa = samples[0][m][file.string()];
+            const auto& sb = samples[1][m][file.string()];
+            if (sa.empty() || sb.empty()) continue;
+
+            Row row;
+            row.benchmark = file.filename().string();
+            row.metric = metrics[m];
+            row.samples = std::min(sa.size(), sb.size());
+            row.cmp = compareSamples(sa, sb, alpha);
+
+            double shiftPct = percentOf(row.cmp.shift, row.cmp.medianA);
+            bool significant = row.cmp.pValue < alpha || (m == 2 && row.cmp.shift != 0);  // 静态指标无噪声
+            if (significant && shiftPct > threshold) row.verdict = "regression";
+            else if (significant && shiftPct < -threshold) row.verdict = "improvement";
+            else if (significant && row.cmp.shift != 0) row.verdict = "changed";
+            else row.verdict = "same";
+            anyRegression = anyRegression || row.verdict == "regression";
+            rows.push_back(row);
+        }
+    }
+
+    if (!markdownPath.empty()) {
+        if (markdownPath == "-") {
+            writeMarkdown(std::cout, rows, a, b, reps, threshold, alpha);
+        } else {
+            std::ofstream out(markdownPath);
+            writeMarkdown(out, rows, a, b, reps, threshold, alpha);
+        }
+    }
+    if (!jsonPath.empty()) {
+        std::ofstream out(jsonPath);
+        writeJson(out, rows, a, b, reps, threshold, alpha);
+    }
+    return anyRegression ? 2 : 0;
+}
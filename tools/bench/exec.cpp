@@ -0,0 +1,223 @@
+// exec.cpp - 执行引擎基准：IR解释器 / 字节码VM / x86-64 JIT
+//
+// 在进程内把每个ToyC程序编译到IR，再分别用各执行引擎运行main，
+// 报告准备时间（降级/JIT编译）、运行时间中位数及相对第一个引擎的加速比，
+// 并检查各引擎返回值一致。
+//
+// 用法:
+//   toyc_bench exec [选项] 语料文件或目录...
+//     --engines=a,b,...    执行引擎（默认ir,vm,jit；不支持JIT的平台自动跳过jit）
+//     --reps=N             每个引擎的运行次数，取中位数（默认5）
+//     --opt                开启IR优化
+//     --stats              额外报告VM动态操作码总数和吞吐率
+// 引擎结果不一致时退出码为2。
+#include "bench.h"
+#include "jit/x86jit.h"
+#include "libtoyc/toyc.h"
+#include "vm/bytecode.h"
+#include "vm/irinterp.h"
+#include "vm/vm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double medianOf(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+bool compileToIR(const fs::path& path, bool optimize, std::vector<std::shared_ptr<IRInstr>>& program) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+
+    toyc::CompileOptions options;
+    options.optimize = optimize;
+    options.emitAssembly = false;
+    toyc::CompileOutput output;
+    if (!toyc::compile(buffer.str(), options, output)) return false;
+    program = std::move(output.program);
+    return true;
+}
+
+struct EngineResult {
+    bool ok = false;
+    std::string error;
+    double prepareMs = 0;
+    double runMs = 0;
+    int value = 0;
+};
+
+// prepare返回执行函数；各次运行互相独立
+EngineResult measure(const std::function<std::function<int()>()>& prepare, int reps) {
+    EngineResult r;
+    try {
+        auto start = Clock::now();
+        std::function<int()> execute = prepare();
+        r.prepareMs = elapsedMs(start);
+
+        std::vector<double> samples;
+        for (int i = 0; i < reps; ++i) {
+            start = Clock::now();
+            r.value = execute();
+            samples.push_back(elapsedMs(start));
+        }
+        r.runMs = medianOf(samples);
+        r.ok = true;
+    } catch (const std::exception& e) {
+        r.error = e.what();
+    }
+    return r;
+}
+
+} // namespace
+
+int runExecBench(const std::vector<std::string>& args) {
+    std::vector<std::string> engines = {"ir", "vm", "jit"};
+    int reps = 5;
+    bool optimize = false, stats = false;
+    std::vector<std::string> inputs;
+
+    for (const auto& arg : args) {
+        std::string v;
+        if (parseKeyValue(arg, "--engines", v)) engines = splitList(v);
+        else if (parseKeyValue(arg, "--reps", v)) reps = std::max(1, std::stoi(v));
+        else if (arg == "--opt") optimize = true;
+        else if (arg == "--stats") stats = true;
+        else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            return 1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    for (const auto& engine : engines) {
+        if (engine != "ir" && engine != "vm" && engine != "jit") {
+            std::cerr << "Error: unknown engine '" << engine << "'" << std::endl;
+            return 1;
+        }
+    }
+    if (!X86Jit::isSupported()) {
+        engines.erase(std::remove(engines.begin(), engines.end(), "jit"), engines.end());
+    }
+    if (engines.empty()) {
+        std::cerr << "Error: no execution engines selected" << std::endl;
+        return 1;
+    }
+
+    std::vector<fs::path> corpus;
+    for (const auto& input : inputs) {
+        if (fs::is_directory(input)) {
+            for (const auto& entry : fs::recursive_directory_iterator(input)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".tc") corpus.push_back(entry.path());
+            }
+        } else {
+            corpus.push_back(input);
+        }
+    }
+    std::sort(corpus.begin(), corpus.end());
+    if (corpus.empty()) {
+        std::cerr << "Error: no benchmark inputs given" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(28) << "benchmark" << std::setw(6) << "engine" << std::right
+              << std::setw(12) << "prepare ms" << std::setw(12) << "run ms" << std::setw(10) << "speedup"
+              << std::setw(14) << "result" << "\n";
+
+    bool mismatch = false;
+    for (const auto& file : corpus) {
+        std::vector<std::shared_ptr<IRInstr>> program;
+        if (!compileToIR(file, optimize, program)) {
+            std::cout << std::left << std::setw(28) << file.filename().string() << "compile failed\n";
+            continue;
+        }
+
+        std::vector<EngineResult> results;
+        std::unique_ptr<X86Jit> jit;
+        std::unique_ptr<VmModule> module;
+        std::unique_ptr<VirtualMachine> vm;
+        std::unique_ptr<IRInterpreter> interpreter;
+        for (const auto& engine : engines) {
+            if (engine == "ir") {
+                results.push_back(measure([&]() -> std::function<int()> {
+                    interpreter = std::make_unique<IRInterpreter>(program);
+                    return [&]() { return interpreter->run(); };
+                }, reps));
+            } else if (engine == "vm") {
+                results.push_back(measure([&]() -> std::function<int()> {
+                    module = std::make_unique<VmModule>(BytecodeCompiler::compile(program));
+                    vm = std::make_unique<VirtualMachine>(*module);
+                    return [&]() { return vm->run(); };
+                }, reps));
+            } else {
+                results.push_back(measure([&]() -> std::function<int()> {
+                    jit = std::make_unique<X86Jit>(program);
+                    jit->compile();
+                    return [&]() { return jit->run(); };
+                }, reps));
+            }
+        }
+
+        const EngineResult& baseline = results.front();
+        for (size_t e = 0; e < engines.size(); ++e) {
+            const EngineResult& r = results[e];
+            std::cout << std::left << std::setw(28) << (e == 0 ? file.filename().string() : "") << std::setw(6)
+                      << engines[e] << std::right;
+            if (!r.ok) {
+                std::cout << "  error: " << r.error << "\n";
+                continue;
+            }
+            std::cout << std::fixed << std::setprecision(3) << std::setw(12) << r.prepareMs << std::setw(12)
+                      << r.runMs << std::setw(10);
+            if (baseline.ok && r.runMs > 0) {
+                std::cout << std::setprecision(1) << baseline.runMs / r.runMs << "x";
+            } else {
+                std::cout << "-";
+            }
+            std::cout << std::setw(14) << r.value;
+            if (baseline.ok && r.value != baseline.value) {
+                std::cout << "  MISMATCH";
+                mismatch = true;
+            }
+            std::cout << "\n";
+        }
+
+        if (stats && vm) {
+            // 计数版本单独运行一次，不影响上面的计时
+            VirtualMachine counting(*module);
+            counting.setCountOps(true);
+            counting.run();
+            double runMs = 0;
+            for (size_t e = 0; e < engines.size(); ++e) {
+                if (engines[e] == "vm") runMs = results[e].runMs;
+            }
+            std::cout << std::left << std::setw(28) << "" << "vm ops " << counting.totalOps();
+            if (runMs > 0) {
+                std::cout << std::fixed << std::setprecision(1) << " ("
+                          << static_cast<double>(counting.totalOps()) / runMs / 1000.0 << " Mops/s)";
+            }
+            if (interpreter) std::cout << ", ir instrs " << interpreter->executedInstructions();
+            std::cout << "\n";
+        }
+    }
+    return mismatch ? 2 : 0;
+}
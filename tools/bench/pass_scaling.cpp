@@ -0,0 +1,434 @@
+// pass_scaling.cpp - 优化遍在合成CFG形状上的规模扩展测试
+//
+// 不经过前端，直接构造参数化形状的IR，逐个单独计时优化遍，
+// 记录耗时和峰值内存随规模的变化，并用双对数最小二乘拟合增长指数，
+// 以暴露二次及更高复杂度。
+//
+// 用法:
+//   toyc_bench passes [选项]
+//     --shapes=a,b,...     形状（默认全部）：straight, ifnest, seqloops, nestloops, diamond, temps
+//     --passes=a,b,...     优化遍（默认：constantPropagationCFG, copyPropagationCFG,
+//                          commonSubexpressionElimination, deadCodeElimination,
+//                          loopInvariantCodeMotion, controlFlowOptimization）
+//     --min-size=N         最小规模（默认16）
+//     --max-size=N         最大规模（默认1024），规模按2倍递增
+//     --reps=R             每个点重复次数，取中位数（默认5）
+//     --budget-ms=MS       某个点的中位耗时超过该值后，不再测更大规模（默认2000）
+//     --csv=FILE           输出原始数据CSV（默认不输出，'-'为标准输出）
+//     --gnuplot=FILE       输出gnuplot脚本（读取--csv指定的文件）
+#include "bench.h"
+#include "ir/irgen.h"
+#include "tools/common/alloc_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+
+namespace {
+
+// ==================== IR构造辅助 ====================
+
+class SyntheticIR {
+private:
+    std::vector<std::shared_ptr<IRInstr>> code;
+    std::map<std::string, std::shared_ptr<Operand>> vars;
+    int tempCount = 0;
+    int labelCount = 0;
+
+public:
+    std::shared_ptr<Operand> var(const std::string& name) {
+        auto& op = vars[name];
+        if (!op) op = std::make_shared<Operand>(OperandType::VARIABLE, name);
+        return op;
+    }
+    std::shared_ptr<Operand> temp() {
+        return std::make_shared<Operand>(OperandType::TEMP, "t" + std::to_string(tempCount++));
+    }
+    std::shared_ptr<Operand> constant(int v) { return std::make_shared<Operand>(v); }
+    std::string label() { return "L" + std::to_string(labelCount++); }
+    std::shared_ptr<Operand> labelRef(const std::string& name) {
+        return std::make_shared<Operand>(OperandType::LABEL, name);
+    }
+
+    std::shared_ptr<Operand> binary(OpCode op, std::shared_ptr<Operand> l, std::shared_ptr<Operand> r) {
+        auto t = temp();
+        code.push_back(std::make_shared<BinaryOpInstr>(op, t, l, r));
+        return t;
+    }
+    std::shared_ptr<Operand> unary(OpCode op, std::shared_ptr<Operand> operand) {
+        auto t = temp();
+        code.push_back(std::make_shared<UnaryOpInstr>(op, t, operand));
+        return t;
+    }
+    void assign(std::shared_ptr<Operand> dst, std::shared_ptr<Operand> src) {
+        code.push_back(std::make_shared<AssignInstr>(dst, src));
+    }
+    void place(const std::string& name) { code.push_back(std::make_shared<LabelInstr>(name)); }
+    void jump(const std::string& name) { code.push_back(std::make_shared<GotoInstr>(labelRef(name))); }
+    void branch(std::shared_ptr<Operand> cond, const std::string& name) {
+        code.push_back(std::make_shared<IfGotoInstr>(cond, labelRef(name)));
+    }
+
+    // 不透明的输入值，避免整个程序被常量传播折叠掉
+    std::shared_ptr<Operand> input() {
+        auto t = temp();
+        code.push_back(std::make_shared<CallInstr>(t, "input", 0));
+        return t;
+    }
+
+    void beginMain(int inputs) {
+        code.push_back(std::make_shared<FunctionBeginInstr>("main", "int"));
+        for (int i = 0; i < inputs; ++i) {
+            assign(var("x" + std::to_string(i)), input());
+        }
+    }
+    std::vector<std::shared_ptr<IRInstr>> endMain(std::shared_ptr<Operand> result) {
+        code.push_back(std::make_shared<ReturnInstr>(result));
+        code.push_back(std::make_shared<FunctionEndInstr>("main"));
+        return std::move(code);
+    }
+
+    // 按IRGenerator的方式降低while循环：goto cond; body: ...; cond: if c goto body
+    void loop(const std::shared_ptr<Operand>& counter, int trip, const std::function<void()>& body) {
+        std::string bodyLabel = label(), condLabel = label(), endLabel = label();
+        assign(counter, constant(0));
+        jump(condLabel);
+        place(bodyLabel);
+        body();
+        assign(counter, binary(OpCode::ADD, counter, constant(1)));
+        place(condLabel);
+        branch(binary(OpCode::LT, counter, constant(trip)), bodyLabel);
+        place(endLabel);
+    }
+};
+
+// ==================== 合成形状 ====================
+
+using ShapeBuilder = std::function<std::vector<std::shared_ptr<IRInstr>>(int)>;
+
+// 一个很长的基本块：包含可复制传播的拷贝、重复表达式和死代码
+std::vector<std::shared_ptr<IRInstr>> straightLine(int n) {
+    SyntheticIR ir;
+    ir.beginMain(4);
+    for (int i = 0; i < n; ++i) {
+        auto a = ir.var("x" + std::to_string(i % 4));
+        auto b = ir.var("x" + std::to_string((i + 1) % 4));
+        auto t1 = ir.binary(OpCode::ADD, a, b);
+        auto t2 = ir.binary(OpCode::ADD, a, b);             // 公共子表达式
+        auto copy = ir.var("v" + std::to_string(i % 8));
+        ir.assign(copy, t1);                                 // 拷贝
+        auto w = ir.binary(OpCode::MUL, copy, t2);
+        ir.binary(OpCode::SUB, w, ir.constant(i));           // 死代码
+        ir.assign(ir.var("x" + std::to_string((i + 2) % 4)), w);
+    }
+    return ir.endMain(ir.var("x0"));
+}
+
+// if嵌套深度为n
+std::vector<std::shared_ptr<IRInstr>> ifNest(int n) {
+    SyntheticIR ir;
+    ir.beginMain(2);
+    auto x0 = ir.var("x0"), x1 = ir.var("x1");
+    std::vector<std::string> elseLabels;
+    for (int i = 0; i < n; ++i) {
+        auto cond = ir.binary(OpCode::LT, x0, ir.constant(i));
+        std::string elseLabel = ir.label();
+        ir.branch(ir.unary(OpCode::NOT, cond), elseLabel);
+        ir.assign(x1, ir.binary(OpCode::ADD, x1, ir.constant(i)));
+        elseLabels.push_back(elseLabel);
+    }
+    for (auto it = elseLabels.rbegin(); it != elseLabels.rend(); ++it) {
+        ir.place(*it);
+        ir.assign(x1, ir.binary(OpCode::MUL, x1, ir.constant(3)));
+    }
+    return ir.endMain(x1);
+}
+
+// n个顺序循环，每个循环体含一个循环不变量
+std::vector<std::shared_ptr<IRInstr>> sequentialLoops(int n) {
+    SyntheticIR ir;
+    ir.beginMain(3);
+    auto x0 = ir.var("x0"), x1 = ir.var("x1"), x2 = ir.var("x2");
+    for (int i = 0; i < n; ++i) {
+        ir.loop(ir.var("i"), 100, [&] {
+            auto inv = ir.binary(OpCode::MUL, x0, ir.constant(i + 3));
+            ir.assign(x1, ir.binary(OpCode::ADD, x1, inv));
+            ir.assign(x2, ir.binary(OpCode::SUB, x2, x1));
+        });
+    }
+    return ir.endMain(x2);
+}
+
+// 循环嵌套深度为n
+std::vector<std::shared_ptr<IRInstr>> nestedLoops(int n) {
+    SyntheticIR ir;
+    ir.beginMain(3);
+    auto x0 = ir.var("x0"), x1 = ir.var("x1"), x2 = ir.var("x2");
+    std::function<void(int)> nest = [&](int depth) {
+        if (depth == n) {
+            auto inv = ir.binary(OpCode::ADD, x0, x1);
+            ir.assign(x2, ir.binary(OpCode::ADD, x2, inv));
+            return;
+        }
+        ir.loop(ir.var("i" + std::to_string(depth)), 4, [&] { nest(depth + 1); });
+    };
+    nest(0);
+    return ir.endMain(x2);
+}
+
+// n路分支汇合到同一个块（汇合块有n个前驱）
+std::vector<std::shared_ptr<IRInstr>> wideDiamond(int n) {
+    SyntheticIR ir;
+    ir.beginMain(2);
+    auto x0 = ir.var("x0"), x1 = ir.var("x1");
+    std::vector<std::string> cases;
+    for (int i = 0; i < n; ++i) {
+        cases.push_back(ir.label());
+        ir.branch(ir.binary(OpCode::EQ, x0, ir.constant(i)), cases.back());
+    }
+    std::string join = ir.label();
+    ir.assign(x1, ir.binary(OpCode::SUB, x1, ir.constant(1)));
+    ir.jump(join);
+    for (int i = 0; i < n; ++i) {
+        ir.place(cases[i]);
+        ir.assign(x1, ir.binary(OpCode::ADD, x1, ir.constant(i)));
+        ir.jump(join);
+    }
+    ir.place(join);
+    return ir.endMain(x1);
+}
+
+// n个同时存活的临时变量
+std::vector<std::shared_ptr<IRInstr>> manyTemps(int n) {
+    SyntheticIR ir;
+    ir.beginMain(1);
+    auto x0 = ir.var("x0");
+    std::vector<std::shared_ptr<Operand>> temps;
+    for (int i = 0; i < n; ++i) {
+        temps.push_back(ir.binary(OpCode::ADD, x0, ir.constant(i)));
+    }
+    auto sum = ir.var("s");
+    ir.assign(sum, ir.constant(0));
+    for (const auto& t : temps) {
+        ir.assign(sum, ir.binary(OpCode::ADD, sum, t));
+    }
+    return ir.endMain(sum);
+}
+
+const std::vector<std::pair<std::string, ShapeBuilder>>& allShapes() {
+    static const std::vector<std::pair<std::string, ShapeBuilder>> shapes = {
+        {"straight", straightLine},
+        {"ifnest", ifNest},
+        {"seqloops", sequentialLoops},
+        {"nestloops", nestedLoops},
+        {"diamond", wideDiamond},
+        {"temps", manyTemps},
+    };
+    return shapes;
+}
+
+// ==================== 测量与拟合 ====================
+
+struct Sample {
+    std::string shape;
+    std::string pass;
+    int size = 0;
+    std::size_t instructions = 0;
+    double medianNs = 0;
+    double minNs = 0;
+    std::uint64_t peakBytes = 0;
+    std::uint64_t allocs = 0;
+};
+
+double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    std::size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+// 双对数最小二乘斜率，即 y ~ x^k 中的k
+double fitExponent(const std::vector<std::pair<double, double>>& points) {
+    std::vector<std::pair<double, double>> logs;
+    for (const auto& [x, y] : points) {
+        if (x > 0 && y > 0) logs.emplace_back(std::log(x), std::log(y));
+    }
+    if (logs.size() < 2) return NAN;
+    double mx = 0, my = 0;
+    for (const auto& [x, y] : logs) { mx += x; my += y; }
+    mx /= logs.size();
+    my /= logs.size();
+    double sxy = 0, sxx = 0;
+    for (const auto& [x, y] : logs) {
+        sxy += (x - mx) * (y - my);
+        sxx += (x - mx) * (x - mx);
+    }
+    return sxx > 0 ? sxy / sxx : NAN;
+}
+
+Sample measure(const std::string& shape, const ShapeBuilder& build, const std::string& pass, int size, int reps) {
+    Sample sample;
+    sample.shape = shape;
+    sample.pass = pass;
+    sample.size = size;
+
+    std::vector<double> times;
+    for (int r = 0; r < reps; ++r) {
+        // 优化遍会修改IR，每次重复都重新构造
+        IRGenerator generator;
+        auto code = build(size);
+        sample.instructions = code.size();
+        generator.loadInstructions(code);
+        code.clear();
+
+        allocstats::Scope allocScope;
+        auto start = std::chrono::steady_clock::now();
+        try {
+            generator.runPass(pass);
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: " << pass << " threw on " << shape << "/" << size << ": " << e.what() << "\n";
+        }
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        sample.peakBytes = std::max(sample.peakBytes, allocScope.peakDelta());
+        sample.allocs = allocScope.allocations();
+    }
+    sample.medianNs = median(times);
+    sample.minNs = *std::min_element(times.begin(), times.end());
+    return sample;
+}
+
+void writeGnuplot(const std::string& path, const std::string& csvPath,
+                  const std::vector<std::string>& shapes, const std::vector<std::string>& passes) {
+    std::ofstream gp(path);
+    gp << "# 由 toyc_bench passes 生成：gnuplot " << path << "\n"
+       << "set datafile separator ','\n"
+       << "set logscale xy\n"
+       << "set key outside right\n"
+       << "set xlabel 'size'\n"
+       << "set terminal pngcairo size 1200,800\n";
+    for (const auto& shape : shapes) {
+        for (int metric = 0; metric < 2; ++metric) {
+            const char* column = metric == 0 ? "$6" : "$8";
+            const char* what = metric == 0 ? "time" : "memory";
+            gp << "set output '" << shape << "-" << what << ".png'\n"
+               << "set title '" << shape << ": " << what << " vs size'\n"
+               << "set ylabel '" << (metric == 0 ? "median ns" : "peak bytes") << "'\n"
+               << "plot ";
+            for (std::size_t i = 0; i < passes.size(); ++i) {
+                if (i) gp << ", \\\n     ";
+                gp << "'" << csvPath << "' using (strcol(1) eq '" << shape << "' && strcol(2) eq '"
+                   << passes[i] << "' ? $3 : 1/0):" << column << " with linespoints title '" << passes[i] << "'";
+            }
+            gp << "\n";
+        }
+    }
+}
+
+} // namespace
+
+// ==================== 入口 ====================
+
+int runPassScalingBench(const std::vector<std::string>& args) {
+    std::vector<std::string> shapes;
+    for (const auto& s : allShapes()) shapes.push_back(s.first);
+    std::vector<std::string> passes = {
+        "constantPropagationCFG", "copyPropagationCFG", "commonSubexpressionElimination",
+        "deadCodeElimination", "loopInvariantCodeMotion", "controlFlowOptimization"};
+    int minSize = 16, maxSize = 1024, reps = 5;
+    double budgetMs = 2000;
+    std::string csvPath, gnuplotPath;
+
+    for (const auto& arg : args) {
+        std::string v;
+        if (parseKeyValue(arg, "--shapes", v)) shapes = splitList(v);
+        else if (parseKeyValue(arg, "--passes", v)) passes = splitList(v);
+        else if (parseKeyValue(arg, "--min-size", v)) minSize = std::max(1, std::stoi(v));
+        else if (parseKeyValue(arg, "--max-size", v)) maxSize = std::stoi(v);
+        else if (parseKeyValue(arg, "--reps", v)) reps = std::max(1, std::stoi(v));
+        else if (parseKeyValue(arg, "--budget-ms", v)) budgetMs = std::stod(v);
+        else if (parseKeyValue(arg, "--csv", v)) csvPath = v;
+        else if (parseKeyValue(arg, "--gnuplot", v)) gnuplotPath = v;
+        else {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    auto knownPasses = IRGenerator::passNames();
+    for (const auto& pass : passes) {
+        if (std::find(knownPasses.begin(), knownPasses.end(), pass) == knownPasses.end()) {
+            std::cerr << "Error: unknown pass '" << pass << "'" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Sample> samples;
+    for (const auto& shapeName : shapes) {
+        auto it = std::find_if(allShapes().begin(), allShapes().end(),
+                               [&](const auto& s) { return s.first == shapeName; });
+        if (it == allShapes().end()) {
+            std::cerr << "Error: unknown shape '" << shapeName << "'" << std::endl;
+            return 1;
+        }
+        for (const auto& pass : passes) {
+            for (int size = minSize; size <= maxSize; size *= 2) {
+                Sample s = measure(shapeName, it->second, pass, size, reps);
+                samples.push_back(s);
+                std::cerr << shapeName << " " << pass << " n=" << size << ": "
+                          << std::fixed << std::setprecision(3) << s.medianNs / 1e6 << " ms\n";
+                if (s.medianNs / 1e6 > budgetMs) break;
+            }
+        }
+    }
+
+    if (!csvPath.empty()) {
+        std::ofstream file;
+        std::ostream* out = &std::cout;
+        if (csvPath != "-") {
+            file.open(csvPath);
+            out = &file;
+        }
+        *out << "shape,pass,size,instructions,reps,median_ns,min_ns,peak_bytes,allocs\n";
+        for (const auto& s : samples) {
+            *out << s.shape << "," << s.pass << "," << s.size << "," << s.instructions << "," << reps << ","
+                 << std::fixed << std::setprecision(0) << s.medianNs << "," << s.minNs << ","
+                 << s.peakBytes << "," << s.allocs << "\n";
+        }
+    }
+    if (!gnuplotPath.empty()) {
+        writeGnuplot(gnuplotPath, csvPath.empty() || csvPath == "-" ? "passes.csv" : csvPath, shapes, passes);
+    }
+
+    // 汇总：按指令数拟合的耗时/内存增长指数，>1.5视为超线性
+    std::cout << "\n" << std::left << std::setw(12) << "shape" << std::setw(34) << "pass"
+              << std::right << std::setw(10) << "max n" << std::setw(14) << "time ms"
+              << std::setw(12) << "time exp" << std::setw(12) << "mem exp" << "\n";
+    for (const auto& shape : shapes) {
+        for (const auto& pass : passes) {
+            std::vector<std::pair<double, double>> timePoints, memPoints;
+            const Sample* last = nullptr;
+            for (const auto& s : samples) {
+                if (s.shape != shape || s.pass != pass) continue;
+                timePoints.emplace_back(static_cast<double>(s.instructions), s.medianNs);
+                memPoints.emplace_back(static_cast<double>(s.instructions), static_cast<double>(s.peakBytes));
+                last = &s;
+            }
+            if (!last) continue;
+            double timeExp = fitExponent(timePoints);
+            double memExp = fitExponent(memPoints);
+            std::cout << std::left << std::setw(12) << shape << std::setw(34) << pass
+                      << std::right << std::setw(10) << last->size
+                      << std::setw(14) << std::fixed << std::setprecision(3) << last->medianNs / 1e6
+                      << std::setw(12) << std::setprecision(2) << timeExp
+                      << std::setw(12) << memExp
+                      << (timeExp > 1.5 || memExp > 1.5 ? "  <-- superlinear" : "") << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,242 @@
+// regalloc.cpp - 寄存器分配器在大型合成函数上的耗时测试
+//
+// 直接构造只含一个大函数的IR，分别计时线性扫描与图着色分配器，
+// 记录耗时、峰值内存和分配到寄存器的变量数，并按临时变量数拟合增长指数。
+//
+// 用法:
+//   toyc_bench regalloc [选项]
+//     --shapes=a,b,...     形状（默认全部）：chain, window, clique
+//     --allocators=a,b     分配器（默认全部）：linear, graph
+//     --min-size=N         最小临时变量数（默认64）
+//     --max-size=N         最大临时变量数（默认4096），规模按2倍递增
+//     --reps=R             每个点重复次数，取中位数（默认3）
+//     --budget-ms=MS       某个点的中位耗时超过该值后，不再测更大规模（默认2000）
+#include "bench.h"
+#include "codegen/codegen.h"
+#include "tools/common/alloc_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+// ==================== 合成函数 ====================
+
+using FunctionBuilder = std::function<std::vector<std::shared_ptr<IRInstr>>(int)>;
+
+std::shared_ptr<Operand> tempOperand(int i) {
+    return std::make_shared<Operand>(OperandType::TEMP, "t" + std::to_string(i));
+}
+
+// n个临时变量，第i个在定义后第span条指令处最后一次使用：
+// 同时存活的变量约为span个，干涉图每个结点的度约为2*span
+std::vector<std::shared_ptr<IRInstr>> slidingWindow(int n, int span) {
+    std::vector<std::shared_ptr<IRInstr>> code;
+    code.push_back(std::make_shared<FunctionBeginInstr>("main", "int"));
+    auto x = std::make_shared<Operand>(OperandType::VARIABLE, "x");
+    code.push_back(std::make_shared<CallInstr>(x, "input", 0));
+    for (int i = 0; i < n; ++i) {
+        auto left = i >= span ? tempOperand(i - span) : x;
+        code.push_back(std::make_shared<BinaryOpInstr>(OpCode::ADD, tempOperand(i), left,
+                                                       std::make_shared<Operand>(i)));
+    }
+    code.push_back(std::make_shared<ReturnInstr>(tempOperand(n - 1)));
+    code.push_back(std::make_shared<FunctionEndInstr>("main"));
+    return code;
+}
+
+// n个临时变量先全部定义、再依次累加：在中点同时存活，干涉图是完全图
+std::vector<std::shared_ptr<IRInstr>> allLive(int n) {
+    std::vector<std::shared_ptr<IRInstr>> code;
+    code.push_back(std::make_shared<FunctionBeginInstr>("main", "int"));
+    auto x = std::make_shared<Operand>(OperandType::VARIABLE, "x");
+    code.push_back(std::make_shared<CallInstr>(x, "input", 0));
+    for (int i = 0; i < n; ++i) {
+        code.push_back(std::make_shared<BinaryOpInstr>(OpCode::ADD, tempOperand(i), x,
+                                                       std::make_shared<Operand>(i)));
+    }
+    std::shared_ptr<Operand> sum = x;
+    for (int i = 0; i < n; ++i) {
+        auto next = tempOperand(n + i);
+        code.push_back(std::make_shared<BinaryOpInstr>(OpCode::ADD, next, sum, tempOperand(i)));
+        sum = next;
+    }
+    code.push_back(std::make_shared<ReturnInstr>(sum));
+    code.push_back(std::make_shared<FunctionEndInstr>("main"));
+    return code;
+}
+
+const std::vector<std::pair<std::string, FunctionBuilder>>& allShapes() {
+    static const std::vector<std::pair<std::string, FunctionBuilder>> shapes = {
+        {"chain", [](int n) { return slidingWindow(n, 1); }},       // 生存期首尾相接
+        {"window", [](int n) { return slidingWindow(n, 32); }},     // 度有界的大函数
+        {"clique", allLive},                                         // 全部同时存活
+    };
+    return shapes;
+}
+
+std::unique_ptr<RegisterAllocator> makeAllocator(const std::string& name) {
+    if (name == "linear") return std::make_unique<LinearScanRegisterAllocator>();
+    if (name == "graph") return std::make_unique<GraphColoringRegisterAllocator>();
+    return nullptr;
+}
+
+// 与CodeGenerator一致的可分配寄存器
+std::vector<Register> allocatableRegisters() {
+    std::vector<Register> regs;
+    for (const char* name : {"t0", "t1", "t2", "t3", "t4", "t5", "t6"}) {
+        regs.push_back({name, true, false, true, false, "", false});
+    }
+    for (const char* name : {"s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"}) {
+        regs.push_back({name, false, true, true, false, "", false});
+    }
+    for (const char* name : {"a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7"}) {
+        regs.push_back({name, true, false, true, false, "", false});
+    }
+    return regs;
+}
+
+// ==================== 测量与拟合 ====================
+
+struct Sample {
+    std::string shape;
+    std::string allocator;
+    int size = 0;
+    double medianNs = 0;
+    std::uint64_t peakBytes = 0;
+    std::size_t allocated = 0;
+};
+
+double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    std::size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+// 双对数最小二乘斜率，即 y ~ x^k 中的k
+double fitExponent(const std::vector<std::pair<double, double>>& points) {
+    std::vector<std::pair<double, double>> logs;
+    for (const auto& [x, y] : points) {
+        if (x > 0 && y > 0) logs.emplace_back(std::log(x), std::log(y));
+    }
+    if (logs.size() < 2) return NAN;
+    double mx = 0, my = 0;
+    for (const auto& [x, y] : logs) { mx += x; my += y; }
+    mx /= logs.size();
+    my /= logs.size();
+    double sxy = 0, sxx = 0;
+    for (const auto& [x, y] : logs) {
+        sxy += (x - mx) * (y - my);
+        sxx += (x - mx) * (x - mx);
+    }
+    return sxx > 0 ? sxy / sxx : NAN;
+}
+
+Sample measure(const std::string& shape, const FunctionBuilder& build, const std::string& allocator,
+               int size, int reps) {
+    Sample sample;
+    sample.shape = shape;
+    sample.allocator = allocator;
+    sample.size = size;
+
+    // 分配器不修改IR，所有重复共用同一份
+    auto code = build(size);
+    auto regs = allocatableRegisters();
+    std::vector<double> times;
+    for (int r = 0; r < reps; ++r) {
+        auto instance = makeAllocator(allocator);
+        allocstats::Scope allocScope;
+        auto start = std::chrono::steady_clock::now();
+        auto allocation = instance->allocate(code, regs);
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        sample.peakBytes = std::max(sample.peakBytes, allocScope.peakDelta());
+        sample.allocated = allocation.size();
+    }
+    sample.medianNs = median(times);
+    return sample;
+}
+
+} // namespace
+
+// ==================== 入口 ====================
+
+int runRegAllocBench(const std::vector<std::string>& args) {
+    std::vector<std::string> shapes;
+    for (const auto& s : allShapes()) shapes.push_back(s.first);
+    std::vector<std::string> allocators = {"linear", "graph"};
+    int minSize = 64, maxSize = 4096, reps = 3;
+    double budgetMs = 2000;
+
+    for (const auto& arg : args) {
+        std::string v;
+        if (parseKeyValue(arg, "--shapes", v)) shapes = splitList(v);
+        else if (parseKeyValue(arg, "--allocators", v)) allocators = splitList(v);
+        else if (parseKeyValue(arg, "--min-size", v)) minSize = std::max(1, std::stoi(v));
+        else if (parseKeyValue(arg, "--max-size", v)) maxSize = std::stoi(v);
+        else if (parseKeyValue(arg, "--reps", v)) reps = std::max(1, std::stoi(v));
+        else if (parseKeyValue(arg, "--budget-ms", v)) budgetMs = std::stod(v);
+        else {
+            std::cerr << "Error: unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    for (const auto& allocator : allocators) {
+        if (!makeAllocator(allocator)) {
+            std::cerr << "Error: unknown allocator '" << allocator << "'" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Sample> samples;
+    for (const auto& shapeName : shapes) {
+        auto it = std::find_if(allShapes().begin(), allShapes().end(),
+                               [&](const auto& s) { return s.first == shapeName; });
+        if (it == allShapes().end()) {
+            std::cerr << "Error: unknown shape '" << shapeName << "'" << std::endl;
+            return 1;
+        }
+        for (const auto& allocator : allocators) {
+            for (int size = minSize; size <= maxSize; size *= 2) {
+                Sample s = measure(shapeName, it->second, allocator, size, reps);
+                samples.push_back(s);
+                std::cerr << shapeName << " " << allocator << " n=" << size << ": "
+                          << std::fixed << std::setprecision(3) << s.medianNs / 1e6 << " ms\n";
+                if (s.medianNs / 1e6 > budgetMs) break;
+            }
+        }
+    }
+
+    // 汇总：按临时变量数拟合的耗时/内存增长指数
+    std::cout << "\n" << std::left << std::setw(10) << "shape" << std::setw(12) << "allocator"
+              << std::right << std::setw(10) << "max n" << std::setw(14) << "time ms"
+              << std::setw(14) << "peak KiB" << std::setw(12) << "in regs"
+              << std::setw(12) << "time exp" << std::setw(12) << "mem exp" << "\n";
+    for (const auto& shape : shapes) {
+        for (const auto& allocator : allocators) {
+            std::vector<std::pair<double, double>> timePoints, memPoints;
+            const Sample* last = nullptr;
+            for (const auto& s : samples) {
+                if (s.shape != shape || s.allocator != allocator) continue;
+                timePoints.emplace_back(static_cast<double>(s.size), s.medianNs);
+                memPoints.emplace_back(static_cast<double>(s.size), static_cast<double>(s.peakBytes));
+                last = &s;
+            }
+            if (!last) continue;
+            std::cout << std::left << std::setw(10) << shape << std::setw(12) << allocator
+                      << std::right << std::setw(10) << last->size
+                      << std::setw(14) << std::fixed << std::setprecision(3) << last->medianNs / 1e6
+                      << std::setw(14) << std::setprecision(1) << last->peakBytes / 1024.0
+                      << std::setw(12) << last->allocated
+                      << std::setw(12) << std::setprecision(2) << fitExponent(timePoints)
+                      << std::setw(12) << fitExponent(memPoints) << "\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+// toyc_bench.cpp - ToyC编译器基准测试工具入口
+//
+// 用法:
+//   toyc_bench passes [选项]    优化遍规模扩展测试（见pass_scaling.cpp）
+//   toyc_bench compare [选项]   A/B对比与显著性检验（见compare.cpp）
+//   toyc_bench exec [选项]      执行引擎速度对比（见exec.cpp）
+//   toyc_bench regalloc [选项]  寄存器分配耗时测试（见regalloc.cpp）
+#include "bench.h"
+#include <iostream>
+#include <sstream>
+
+bool parseKeyValue(const std::string& arg, const std::string& key, std::string& value) {
+    std::string prefix = key + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) return false;
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+static void printUsage() {
+    std::cerr << "Usage: toyc_bench <command> [options]\n"
+              << "Commands:\n"
+              << "  passes    time individual optimization passes on synthetic CFG shapes\n"
+              << "  compare   A/B compare two compilers or flag sets over a corpus\n"
+              << "  exec      time the IR interpreter, bytecode VM and JIT on a corpus\n"
+              << "  regalloc  time the register allocators on large synthetic functions\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    std::string command = argv[1];
+    std::vector<std::string> args(argv + 2, argv + argc);
+
+    if (command == "passes") {
+        return runPassScalingBench(args);
+    }
+    if (command == "compare") {
+        return runCompareBench(args);
+    }
+    if (command == "exec") {
+        return runExecBench(args);
+    }
+    if (command == "regalloc") {
+        return runRegAllocBench(args);
+    }
+
+    std::cerr << "Error: unknown command '" << command << "'" << std::endl;
+    printUsage();
+    return 1;
+}
@@ -0,0 +1,32 @@
+// alloc_stats.cpp - 替换全局operator new/delete以统计内存分配
+#include "alloc_stats.h"
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+
+namespace allocstats {
+    std::uint64_t allocCount = 0;
+    std::int64_t liveBytes = 0;
+    std::int64_t peakBytes = 0;
+}
+
+void* operator new(std::size_t size) {
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    ++allocstats::allocCount;
+    allocstats::liveBytes += static_cast<std::int64_t>(malloc_usable_size(p));
+    if (allocstats::liveBytes > allocstats::peakBytes) {
+        allocstats::peakBytes = allocstats::liveBytes;
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    allocstats::liveBytes -= static_cast<std::int64_t>(malloc_usable_size(p));
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+
+// ==================== 内存分配统计 ====================
+//
+// 工具程序链接alloc_stats.cpp后，全局operator new/delete被替换，
+// 统计分配次数和当前存活字节数（按malloc_usable_size计）。
+// 数组版本和带大小的delete默认转发到被替换的版本。
+
+namespace allocstats {
+
+extern std::uint64_t allocCount;
+extern std::int64_t liveBytes;
+extern std::int64_t peakBytes;
+
+// 一段代码的分配统计：构造时开始计数，之后随时读取增量
+class Scope {
+private:
+    std::uint64_t allocsBefore;
+    std::int64_t liveBefore;
+
+public:
+    Scope() : allocsBefore(allocCount), liveBefore(liveBytes) {
+        peakBytes = liveBytes;
+    }
+
+    std::uint64_t allocations() const { return allocCount - allocsBefore; }
+    std::uint64_t peakDelta() const {
+        return peakBytes > liveBefore ? static_cast<std::uint64_t>(peakBytes - liveBefore) : 0;
+    }
+};
+
+} // namespace allocstats
@@ -0,0 +1,882 @@
+// toyc_fuzz.cpp - 最坏编译时间模糊测试器
+//
+// 对ToyC程序做词法单元级变异，以“每输入字节的耗时/分配次数/峰值内存”为目标，
+// 为每个编译阶段（Parser、SemanticAnalyzer、IRGenerator及其各优化遍、各寄存器分配器、
+// CodeGenerator）保存最坏输入，作为编译时间回归基准。
+//
+// 每个输入在fork出的子进程中编译，超时（SIGALRM）和崩溃不会影响模糊测试器本身。
+// 若编译器核心以-fsanitize-coverage=trace-pc构建（CMake自动检测），
+// 还会用边覆盖率引导语料库的扩充。
+//
+// 用法:
+//   toyc_fuzz [选项] [语料文件或目录...]
+//     -runs=N             最多执行N个输入（默认10000）
+//     -max-total-time=S   最长运行S秒（默认0，不限）
+//     -timeout=MS         单个输入的超时时间（默认2000）
+//     -rss-limit-mb=M     子进程地址空间上限（默认2048）
+//     -out=DIR            输出目录（默认fuzz-out）
+//     -seed=N             随机种子
+//     -min-len=B          参与最坏值比较的最小输入字节数（默认64）
+//     -max-len=B          变异后输入的最大字节数（默认8192）
+//     -confirm=K          刷新最坏值前重复测量次数，耗时取最小值（默认3）
+//     -minimize=0|1       结束时最小化各最坏输入（默认1）
+//     -minimize-runs=N    每个最坏输入的最小化尝试次数上限（默认300）
+//     -minimize-tolerance=F  最小化时允许的每字节代价下降比例（默认0.1）
+
+#include "lexer/lexer.h"
+#include "parser/parser.h"
+#include "semantic/semantic.h"
+#include "ir/irgen.h"
+#include "codegen/codegen.h"
+#include "tools/common/alloc_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// ==================== 进程间共享状态 ====================
+
+static constexpr int kMaxPhases = 64;
+static constexpr std::size_t kCoverageMapSize = 1 << 16;
+
+enum PhaseStatus : std::int32_t {
+    PHASE_RUNNING = 0,
+    PHASE_OK = 1,
+    PHASE_FAILED = 2,     // 阶段正常结束但报告错误（如语法错误），后续阶段不再执行
+    PHASE_EXCEPTION = 3,  // 阶段抛出异常
+};
+
+struct PhaseRecord {
+    char phase[48];
+    std::int32_t status;
+    std::uint64_t wallNs;
+    std::uint64_t allocs;
+    std::uint64_t peakBytes;
+};
+
+struct SharedState {
+    std::uint32_t recordCount;
+    PhaseRecord records[kMaxPhases];
+    std::uint8_t coverage[kCoverageMapSize];
+};
+
+static SharedState* shared = nullptr;
+
+#ifdef TOYC_FUZZ_COVERAGE
+// 编译器核心以-fsanitize-coverage=trace-pc构建时，每条边调用一次
+extern "C" void __sanitizer_cov_trace_pc() {
+    if (!shared) return;
+    auto pc = reinterpret_cast<std::uintptr_t>(__builtin_return_address(0));
+    std::uint8_t& counter = shared->coverage[(pc ^ (pc >> 15)) & (kCoverageMapSize - 1)];
+    if (counter != 0xff) ++counter;
+}
+#endif
+
+// ==================== 子进程：分阶段编译并测量 ====================
+
+template <typename Fn>
+static bool measurePhase(const std::string& phase, Fn&& fn) {
+    if (shared->recordCount >= kMaxPhases) return false;
+    PhaseRecord& rec = shared->records[shared->recordCount++];
+    std::memset(&rec, 0, sizeof(rec));
+    std::strncpy(rec.phase, phase.c_str(), sizeof(rec.phase) - 1);
+    rec.status = PHASE_RUNNING;
+
+    allocstats::Scope allocScope;
+    auto start = std::chrono::steady_clock::now();
+
+    bool ok = false;
+    try {
+        ok = fn();
+        rec.status = ok ? PHASE_OK : PHASE_FAILED;
+    } catch (...) {
+        rec.status = PHASE_EXCEPTION;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    rec.wallNs = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    rec.allocs = allocScope.allocations();
+    rec.peakBytes = allocScope.peakDelta();
+    return ok;
+}
+
+static std::vector<Register> allocatableRegisters() {
+    std::vector<Register> regs;
+    for (const char* name : {"t0", "t1", "t2", "t3", "t4", "t5", "t6"}) {
+        regs.push_back({name, true, false, true, false, "", false});
+    }
+    for (const char* name : {"s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"}) {
+        regs.push_back({name, false, true, true, false, "", false});
+    }
+    for (const char* name : {"a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7"}) {
+        regs.push_back({name, true, false, true, false, "", false});
+    }
+    return regs;
+}
+
+static void compileInChild(const std::string& source) {
+    std::vector<Token> tokens;
+    std::shared_ptr<CompUnit> ast;
+
+    if (!measurePhase("Parser", [&] {
+            Lexer lexer(source);
+            tokens = lexer.tokenize();
+            Parser parser(tokens);
+            ast = parser.parse();
+            return ast && !parser.hasError();
+        })) return;
+
+    if (!measurePhase("SemanticAnalyzer", [&] {
+            SemanticAnalyzer analyzer;
+            return analyzer.analyze(ast);
+        })) return;
+
+    IRGenerator irGenerator;
+    if (!measurePhase("IRGenerator", [&] {
+            irGenerator.generate(ast);
+            return true;
+        })) return;
+
+    for (const auto& pass : IRGenerator::passNames()) {
+        if (!measurePhase(pass, [&] { return irGenerator.runPass(pass); })) return;
+    }
+
+    const auto& instructions = irGenerator.getInstructions();
+    const auto regs = allocatableRegisters();
+
+    measurePhase("LinearScanRegisterAllocator", [&] {
+        LinearScanRegisterAllocator allocator;
+        allocator.allocate(instructions, regs);
+        return true;
+    });
+    measurePhase("GraphColoringRegisterAllocator", [&] {
+        GraphColoringRegisterAllocator allocator;
+        allocator.allocate(instructions, regs);
+        return true;
+    });
+    measurePhase("CodeGenerator", [&] {
+        std::stringstream out;
+        CodeGenerator generator(out, instructions);
+        generator.generate();
+        return true;
+    });
+}
+
+// ==================== 父进程：执行一个输入 ====================
+
+struct PhaseCost {
+    std::string phase;
+    std::uint64_t wallNs = 0;
+    std::uint64_t allocs = 0;
+    std::uint64_t peakBytes = 0;
+    bool timedOut = false;
+};
+
+enum class RunOutcome { OK, TIMEOUT, CRASH };
+
+struct RunResult {
+    RunOutcome outcome = RunOutcome::OK;
+    int signal = 0;
+    std::vector<PhaseCost> phases;
+};
+
+struct FuzzOptions {
+    long long runs = 10000;
+    long long maxTotalSeconds = 0;
+    int timeoutMs = 2000;
+    long long rssLimitMb = 2048;
+    std::string outDir = "fuzz-out";
+    std::uint64_t seed = 0;
+    std::size_t minLen = 64;
+    std::size_t maxLen = 8192;
+    int confirm = 3;
+    bool minimize = true;
+    int minimizeRuns = 300;
+    double minimizeTolerance = 0.1;
+    std::vector<std::string> inputs;
+};
+
+static FuzzOptions options;
+
+static RunResult runOnce(const std::string& source) {
+    shared->recordCount = 0;
+    std::memset(shared->coverage, 0, sizeof(shared->coverage));
+
+    RunResult result;
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::perror("fork");
+        std::exit(1);
+    }
+
+    if (pid == 0) {
+        // 子进程：屏蔽编译器的调试输出，设置超时和内存上限
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+        }
+        struct rlimit limit;
+        limit.rlim_cur = limit.rlim_max = static_cast<rlim_t>(options.rssLimitMb) << 20;
+        setrlimit(RLIMIT_AS, &limit);
+
+        struct itimerval timer {};
+        timer.it_value.tv_sec = options.timeoutMs / 1000;
+        timer.it_value.tv_usec = (options.timeoutMs % 1000) * 1000;
+        setitimer(ITIMER_REAL, &timer, nullptr);
+
+        compileInChild(source);
+        _exit(0);
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+
+    if (WIFSIGNALED(status)) {
+        result.signal = WTERMSIG(status);
+        result.outcome = result.signal == SIGALRM ? RunOutcome::TIMEOUT : RunOutcome::CRASH;
+    }
+
+    for (std::uint32_t i = 0; i < shared->recordCount && i < kMaxPhases; ++i) {
+        const PhaseRecord& rec = shared->records[i];
+        PhaseCost cost;
+        cost.phase = rec.phase;
+        if (rec.status == PHASE_RUNNING) {
+            // 子进程在该阶段被杀死：超时按超时时长计，崩溃不计入
+            if (result.outcome != RunOutcome::TIMEOUT) continue;
+            cost.wallNs = static_cast<std::uint64_t>(options.timeoutMs) * 1000000ull;
+            cost.timedOut = true;
+        } else {
+            cost.wallNs = rec.wallNs;
+            cost.allocs = rec.allocs;
+            cost.peakBytes = rec.peakBytes;
+        }
+        result.phases.push_back(cost);
+    }
+    return result;
+}
+
+// ==================== 词法单元级变异 ====================
+
+static std::vector<std::string> tokenize(const std::string& source) {
+    std::vector<std::string> tokens;
+    std::size_t i = 0;
+    while (i < source.size()) {
+        char c = source[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else if (c == '/' && i + 1 < source.size() && source[i + 1] == '/') {
+            while (i < source.size() && source[i] != '\n') ++i;
+        } else if (c == '/' && i + 1 < source.size() && source[i + 1] == '*') {
+            std::size_t end = source.find("*/", i + 2);
+            i = end == std::string::npos ? source.size() : end + 2;
+        } else if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+            std::size_t start = i;
+            while (i < source.size() &&
+                   (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_')) ++i;
+            tokens.push_back(source.substr(start, i - start));
+        } else {
+            std::string two = source.substr(i, 2);
+            if (two == "<=" || two == ">=" || two == "==" || two == "!=" ||
+                two == "&&" || two == "||") {
+                tokens.push_back(two);
+                i += 2;
+            } else {
+                tokens.push_back(std::string(1, c));
+                ++i;
+            }
+        }
+    }
+    return tokens;
+}
+
+static std::string detokenize(const std::vector<std::string>& tokens) {
+    std::string out;
+    int indent = 0;
+    bool lineStart = true;
+    for (const auto& tok : tokens) {
+        if (tok == "}") indent = std::max(0, indent - 1);
+        if (lineStart) {
+            out.append(static_cast<std::size_t>(indent) * 4, ' ');
+        } else {
+            out += ' ';
+        }
+        out += tok;
+        lineStart = false;
+        if (tok == "{") ++indent;
+        if (tok == ";" || tok == "{" || tok == "}") {
+            out += '\n';
+            lineStart = true;
+        }
+    }
+    return out;
+}
+
+static bool isIdentifier(const std::string& tok) {
+    static const std::set<std::string> keywords = {
+        "int", "void", "if", "else", "while", "break", "continue", "return"};
+    return !tok.empty() && (std::isalpha(static_cast<unsigned char>(tok[0])) || tok[0] == '_') &&
+           !keywords.count(tok);
+}
+
+static bool isNumber(const std::string& tok) {
+    return !tok.empty() && std::isdigit(static_cast<unsigned char>(tok[0]));
+}
+
+static bool isBinaryOperator(const std::string& tok) {
+    static const std::set<std::string> ops = {
+        "+", "-", "*", "/", "%", "<", ">", "<=", ">=", "==", "!=", "&&", "||"};
+    return ops.count(tok) > 0;
+}
+
+class Mutator {
+private:
+    std::mt19937_64& rng;
+    const std::vector<std::string>& corpus;
+
+    std::size_t pick(std::size_t n) {
+        return std::uniform_int_distribution<std::size_t>(0, n - 1)(rng);
+    }
+
+    // 随机选一条以';'结尾的语句，返回[begin, end)
+    bool pickStatement(const std::vector<std::string>& t, std::size_t& begin, std::size_t& end) {
+        std::vector<std::size_t> semis;
+        for (std::size_t i = 0; i < t.size(); ++i) {
+            if (t[i] == ";") semis.push_back(i);
+        }
+        if (semis.empty()) return false;
+        end = semis[pick(semis.size())] + 1;
+        begin = end - 1;
+        while (begin > 0 && t[begin - 1] != ";" && t[begin - 1] != "{" && t[begin - 1] != "}") {
+            --begin;
+        }
+        return begin < end;
+    }
+
+    // 随机选一个配对的{...}块
+    bool pickBlock(const std::vector<std::string>& t, std::size_t& begin, std::size_t& end) {
+        std::vector<std::size_t> opens;
+        for (std::size_t i = 0; i < t.size(); ++i) {
+            if (t[i] == "{") opens.push_back(i);
+        }
+        if (opens.empty()) return false;
+        begin = opens[pick(opens.size())];
+        int depth = 0;
+        for (std::size_t i = begin; i < t.size(); ++i) {
+            if (t[i] == "{") ++depth;
+            if (t[i] == "}" && --depth == 0) {
+                end = i + 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string randomIdentifier(const std::vector<std::string>& t) {
+        std::vector<std::string> ids;
+        for (const auto& tok : t) {
+            if (isIdentifier(tok)) ids.push_back(tok);
+        }
+        if (ids.empty()) return "x";
+        return ids[pick(ids.size())];
+    }
+
+    std::string randomNumber() {
+        static const char* interesting[] = {"0", "1", "2", "7", "10", "100", "255", "65536", "2147483647"};
+        return interesting[pick(sizeof(interesting) / sizeof(interesting[0]))];
+    }
+
+    std::string randomOperator() {
+        static const char* ops[] = {"+", "-", "*", "/", "%", "<", ">", "<=", ">=", "==", "!=", "&&", "||"};
+        return ops[pick(sizeof(ops) / sizeof(ops[0]))];
+    }
+
+    std::string randomAtom(const std::vector<std::string>& t) {
+        return pick(2) ? randomIdentifier(t) : randomNumber();
+    }
+
+public:
+    Mutator(std::mt19937_64& rng, const std::vector<std::string>& corpus) : rng(rng), corpus(corpus) {}
+
+    std::string mutate(const std::string& source) {
+        auto t = tokenize(source);
+        int rounds = 1 + static_cast<int>(pick(4));
+        for (int r = 0; r < rounds; ++r) {
+            mutateOnce(t);
+        }
+        return detokenize(t);
+    }
+
+    void mutateOnce(std::vector<std::string>& t) {
+        std::size_t begin = 0, end = 0;
+        switch (pick(9)) {
+            case 0:  // 复制一条语句
+                if (pickStatement(t, begin, end)) {
+                    std::vector<std::string> stmt(t.begin() + begin, t.begin() + end);
+                    t.insert(t.begin() + end, stmt.begin(), stmt.end());
+                }
+                break;
+            case 1:  // 用while/if包裹一条语句，加深嵌套
+                if (pickStatement(t, begin, end)) {
+                    std::vector<std::string> head = {pick(2) ? "while" : "if", "(",
+                                                     randomAtom(t), randomOperator(), randomAtom(t), ")", "{"};
+                    t.insert(t.begin() + end, "}");
+                    t.insert(t.begin() + begin, head.begin(), head.end());
+                }
+                break;
+            case 2: {  // 把一个操作数展开为(x op y)，加深表达式
+                std::vector<std::size_t> atoms;
+                for (std::size_t i = 1; i < t.size(); ++i) {
+                    bool exprContext = t[i - 1] == "=" || t[i - 1] == "(" || t[i - 1] == "return" ||
+                                       t[i - 1] == "," || isBinaryOperator(t[i - 1]);
+                    if (exprContext && (isIdentifier(t[i]) || isNumber(t[i])) &&
+                        (i + 1 >= t.size() || t[i + 1] != "(")) {
+                        atoms.push_back(i);
+                    }
+                }
+                if (!atoms.empty()) {
+                    std::size_t i = atoms[pick(atoms.size())];
+                    std::string atom = t[i];
+                    std::vector<std::string> repl = {"(", atom, randomOperator(),
+                                                     pick(2) ? atom : randomAtom(t), ")"};
+                    t.erase(t.begin() + i);
+                    t.insert(t.begin() + i, repl.begin(), repl.end());
+                }
+                break;
+            }
+            case 3: {  // 替换一个词法单元
+                if (t.empty()) break;
+                std::size_t i = pick(t.size());
+                if (isIdentifier(t[i])) t[i] = randomIdentifier(t);
+                else if (isNumber(t[i])) t[i] = randomNumber();
+                else if (isBinaryOperator(t[i])) t[i] = randomOperator();
+                break;
+            }
+            case 4: {  // 删除一小段
+                if (t.empty()) break;
+                std::size_t i = pick(t.size());
+                std::size_t n = std::min(t.size() - i, 1 + pick(8));
+                t.erase(t.begin() + i, t.begin() + i + n);
+                break;
+            }
+            case 5: {  // 从另一个语料拼接一条语句
+                if (corpus.empty() || t.empty()) break;
+                auto other = tokenize(corpus[pick(corpus.size())]);
+                if (pickStatement(other, begin, end)) {
+                    std::size_t at = 0;
+                    std::size_t dummyBegin = 0;
+                    if (!pickStatement(t, dummyBegin, at)) at = t.size();
+                    t.insert(t.begin() + at, other.begin() + begin, other.begin() + end);
+                }
+                break;
+            }
+            case 6:  // 复制一个块
+                if (pickBlock(t, begin, end)) {
+                    std::vector<std::string> block(t.begin() + begin, t.begin() + end);
+                    t.insert(t.begin() + end, block.begin(), block.end());
+                }
+                break;
+            case 7: {  // 复制一个函数并改名，增加函数数量
+                std::vector<std::size_t> starts;
+                for (std::size_t i = 0; i + 2 < t.size(); ++i) {
+                    if ((t[i] == "int" || t[i] == "void") && isIdentifier(t[i + 1]) && t[i + 2] == "(" &&
+                        (i == 0 || t[i - 1] == "}")) {
+                        starts.push_back(i);
+                    }
+                }
+                if (starts.empty()) break;
+                std::size_t s = starts[pick(starts.size())];
+                std::size_t open = s;
+                while (open < t.size() && t[open] != "{") ++open;
+                if (open >= t.size()) break;
+                int depth = 0;
+                for (std::size_t i = open; i < t.size(); ++i) {
+                    if (t[i] == "{") ++depth;
+                    if (t[i] == "}" && --depth == 0) {
+                        std::vector<std::string> func(t.begin() + s, t.begin() + i + 1);
+                        func[1] += "_" + std::to_string(pick(1000));
+                        t.insert(t.begin() + s, func.begin(), func.end());
+                        break;
+                    }
+                }
+                break;
+            }
+            default: {  // 插入一个新的局部变量声明及其使用
+                if (pickStatement(t, begin, end)) {
+                    std::string name = "v" + std::to_string(pick(100));
+                    std::vector<std::string> decl = {"int", name, "=", randomAtom(t), randomOperator(),
+                                                      randomAtom(t), ";", name, "=", name, "+", "1", ";"};
+                    t.insert(t.begin() + end, decl.begin(), decl.end());
+                }
+                break;
+            }
+        }
+    }
+};
+
+// ==================== 最坏值记录 ====================
+
+static const char* kMetrics[] = {"wall", "allocs", "peak"};
+
+static double metricValue(const PhaseCost& cost, int metric) {
+    switch (metric) {
+        case 0: return static_cast<double>(cost.wallNs);
+        case 1: return static_cast<double>(cost.allocs);
+        default: return static_cast<double>(cost.peakBytes);
+    }
+}
+
+struct WorstEntry {
+    std::string source;
+    PhaseCost cost;
+    double perByte = 0.0;
+    long long foundAtRun = 0;
+    std::size_t originalBytes = 0;
+};
+
+// 对同一输入重复测量，耗时取最小值以抑制噪声；分配和内存取首次结果
+static bool measureStable(const std::string& source, const std::string& phase, PhaseCost& out) {
+    bool found = false;
+    for (int k = 0; k < std::max(1, options.confirm); ++k) {
+        RunResult r = runOnce(source);
+        auto it = std::find_if(r.phases.begin(), r.phases.end(),
+                               [&](const PhaseCost& c) { return c.phase == phase; });
+        if (it == r.phases.end()) return false;
+        if (!found) {
+            out = *it;
+            found = true;
+        } else {
+            out.wallNs = std::min(out.wallNs, it->wallNs);
+        }
+        if (it->timedOut) break;  // 超时无需重复
+    }
+    return found;
+}
+
+static std::string safeName(const std::string& phase) {
+    std::string s = phase;
+    for (char& c : s) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') c = '_';
+    }
+    return s;
+}
+
+static void writeFile(const fs::path& path, const std::string& content) {
+    std::ofstream out(path, std::ios::binary);
+    out << content;
+}
+
+static void saveWorst(const std::string& phase, int metric, const WorstEntry& entry, bool minimized) {
+    fs::path dir = fs::path(options.outDir) / "worst";
+    fs::create_directories(dir);
+    std::string base = safeName(phase) + "." + kMetrics[metric];
+    writeFile(dir / (base + ".tc"), entry.source);
+
+    std::ostringstream meta;
+    meta << "phase: " << phase << "\n"
+         << "metric: " << kMetrics[metric] << "_per_byte\n"
+         << "input_bytes: " << entry.source.size() << "\n"
+         << "wall_ns: " << entry.cost.wallNs << "\n"
+         << "allocs: " << entry.cost.allocs << "\n"
+         << "peak_bytes: " << entry.cost.peakBytes << "\n"
+         << "cost_per_byte: " << std::setprecision(6) << entry.perByte << "\n"
+         << "status: " << (entry.cost.timedOut ? "timeout" : "ok") << "\n"
+         << "found_at_run: " << entry.foundAtRun << "\n"
+         << "minimized: " << (minimized ? "yes" : "no");
+    if (minimized) meta << " (from " << entry.originalBytes << " bytes)";
+    meta << "\n";
+    writeFile(dir / (base + ".meta"), meta.str());
+}
+
+// ==================== 最小化 ====================
+//
+// 按词法单元做delta调试：从大到小尝试删除连续片段，
+// 只要目标阶段仍被执行且每字节代价不低于原值的(1 - tolerance)倍就接受删除。
+
+static WorstEntry minimizeEntry(const std::string& phase, int metric, const WorstEntry& entry) {
+    WorstEntry best = entry;
+    best.originalBytes = entry.source.size();
+    double target = entry.perByte * (1.0 - options.minimizeTolerance);
+
+    auto tokens = tokenize(entry.source);
+    int budget = options.minimizeRuns;
+
+    for (std::size_t chunk = std::max<std::size_t>(1, tokens.size() / 2); chunk >= 1 && budget > 0; chunk /= 2) {
+        bool progress = true;
+        while (progress && budget > 0) {
+            progress = false;
+            for (std::size_t i = 0; i + chunk <= tokens.size() && budget > 0;) {
+                std::vector<std::string> candidate(tokens.begin(), tokens.begin() + i);
+                candidate.insert(candidate.end(), tokens.begin() + i + chunk, tokens.end());
+                std::string source = detokenize(candidate);
+                --budget;
+
+                PhaseCost cost;
+                if (source.size() >= options.minLen && measureStable(source, phase, cost)) {
+                    double perByte = metricValue(cost, metric) / static_cast<double>(source.size());
+                    if (perByte >= target) {
+                        tokens.swap(candidate);
+                        best.source = source;
+                        best.cost = cost;
+                        best.perByte = perByte;
+                        progress = true;
+                        continue;  // 在同一位置继续尝试
+                    }
+                }
+                i += chunk;
+            }
+        }
+        if (chunk == 1) break;
+    }
+    return best;
+}
+
+// ==================== 语料库 ====================
+
+static const char* kBuiltinSeeds[] = {
+    "int main() { return 0; }\n",
+    "int add(int a, int b) { return a + b; }\n"
+    "int main() { int s = 0; int i = 0; while (i < 10) { s = s + add(i, 3); i = i + 1; } return s; }\n",
+    "int fib(int n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+    "int main() { return fib(10); }\n",
+    "int main() { int a = 1; int b = 2; int c = a * b + a / b - a % b;\n"
+    "  if (a < b && b > c || !a) { c = c + 1; } else { c = c - 1; }\n"
+    "  while (c > 0) { c = c - 1; if (c == 3) break; if (c == 5) continue; } return c; }\n",
+    "void f(int x) { return; }\n"
+    "int g(int a, int b, int c, int d, int e, int f2, int g2, int h, int i) { return a + i; }\n"
+    "int main() { f(1); return g(1, 2, 3, 4, 5, 6, 7, 8, 9); }\n",
+};
+
+static void loadInputs(std::vector<std::string>& corpus) {
+    for (const auto& input : options.inputs) {
+        std::vector<fs::path> files;
+        if (fs::is_directory(input)) {
+            for (const auto& entry : fs::recursive_directory_iterator(input)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".tc") files.push_back(entry.path());
+            }
+        } else {
+            files.push_back(input);
+        }
+        for (const auto& file : files) {
+            std::ifstream in(file, std::ios::binary);
+            if (!in) {
+                std::cerr << "Warning: cannot read " << file << std::endl;
+                continue;
+            }
+            std::stringstream buffer;
+            buffer << in.rdbuf();
+            corpus.push_back(detokenize(tokenize(buffer.str())));
+        }
+    }
+    if (corpus.empty()) {
+        for (const char* seed : kBuiltinSeeds) {
+            corpus.push_back(detokenize(tokenize(seed)));
+        }
+    }
+}
+
+// AFL风格的命中次数分桶
+static std::uint8_t bucketOf(std::uint8_t count) {
+    if (count == 0) return 0;
+    if (count <= 3) return static_cast<std::uint8_t>(1u << (count - 1));
+    if (count <= 7) return 8;
+    if (count <= 15) return 16;
+    if (count <= 31) return 32;
+    if (count <= 127) return 64;
+    return 128;
+}
+
+// ==================== 主程序 ====================
+
+static bool parseOption(const std::string& arg) {
+    auto value = [&](const char* key) -> const char* {
+        std::size_t n = std::strlen(key);
+        return arg.compare(0, n, key) == 0 ? arg.c_str() + n : nullptr;
+    };
+    const char* v = nullptr;
+    if ((v = value("-runs="))) options.runs = std::atoll(v);
+    else if ((v = value("-max-total-time="))) options.maxTotalSeconds = std::atoll(v);
+    else if ((v = value("-timeout="))) options.timeoutMs = std::max(1, std::atoi(v));
+    else if ((v = value("-rss-limit-mb="))) options.rssLimitMb = std::atoll(v);
+    else if ((v = value("-out="))) options.outDir = v;
+    else if ((v = value("-seed="))) options.seed = std::strtoull(v, nullptr, 10);
+    else if ((v = value("-min-len="))) options.minLen = std::strtoull(v, nullptr, 10);
+    else if ((v = value("-max-len="))) options.maxLen = std::strtoull(v, nullptr, 10);
+    else if ((v = value("-confirm="))) options.confirm = std::max(1, std::atoi(v));
+    else if ((v = value("-minimize="))) options.minimize = std::atoi(v) != 0;
+    else if ((v = value("-minimize-runs="))) options.minimizeRuns = std::atoi(v);
+    else if ((v = value("-minimize-tolerance="))) options.minimizeTolerance = std::atof(v);
+    else if (!arg.empty() && arg[0] == '-') return false;
+    else options.inputs.push_back(arg);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    options.seed = static_cast<std::uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    for (int i = 1; i < argc; ++i) {
+        if (!parseOption(argv[i])) {
+            std::cerr << "Error: unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    void* mem = mmap(nullptr, sizeof(SharedState), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        std::perror("mmap");
+        return 1;
+    }
+    shared = static_cast<SharedState*>(mem);
+
+    fs::create_directories(fs::path(options.outDir) / "corpus");
+    fs::create_directories(fs::path(options.outDir) / "crashes");
+
+    std::vector<std::string> corpus;
+    loadInputs(corpus);
+
+    std::mt19937_64 rng(options.seed);
+    Mutator mutator(rng, corpus);
+    std::vector<std::uint8_t> globalCoverage(kCoverageMapSize, 0);
+    std::map<std::pair<std::string, int>, WorstEntry> worst;
+
+    std::cerr << "toyc_fuzz: seed " << options.seed << ", " << corpus.size() << " seed inputs"
+#ifdef TOYC_FUZZ_COVERAGE
+              << ", coverage enabled"
+#else
+              << ", coverage unavailable (cost-guided only)"
+#endif
+              << std::endl;
+
+    auto startTime = std::chrono::steady_clock::now();
+    long long crashes = 0, timeouts = 0;
+
+    for (long long run = 0; run < options.runs; ++run) {
+        if (options.maxTotalSeconds > 0 &&
+            std::chrono::steady_clock::now() - startTime > std::chrono::seconds(options.maxTotalSeconds)) {
+            break;
+        }
+
+        // 先执行种子，之后对随机语料变异
+        std::string source;
+        if (run < static_cast<long long>(corpus.size())) {
+            source = corpus[run];
+        } else {
+            std::size_t idx = std::uniform_int_distribution<std::size_t>(0, corpus.size() - 1)(rng);
+            source = mutator.mutate(corpus[idx]);
+        }
+        if (source.empty() || source.size() > options.maxLen) continue;
+
+        RunResult result = runOnce(source);
+
+        if (result.outcome == RunOutcome::CRASH) {
+            ++crashes;
+            std::ostringstream name;
+            name << "crash-sig" << result.signal << "-" << std::hash<std::string>()(source) << ".tc";
+            writeFile(fs::path(options.outDir) / "crashes" / name.str(), source);
+        } else if (result.outcome == RunOutcome::TIMEOUT) {
+            ++timeouts;
+        }
+
+        // 覆盖率：出现新的(边, 命中次数桶)就加入语料库
+        bool newCoverage = false;
+        for (std::size_t i = 0; i < kCoverageMapSize; ++i) {
+            std::uint8_t bucket = bucketOf(shared->coverage[i]);
+            if (bucket & ~globalCoverage[i]) {
+                globalCoverage[i] |= bucket;
+                newCoverage = true;
+            }
+        }
+
+        // 代价：刷新各阶段各指标的每字节最坏值
+        bool newWorst = false;
+        if (source.size() >= options.minLen) {
+            for (const auto& cost : result.phases) {
+                for (int m = 0; m < 3; ++m) {
+                    double perByte = metricValue(cost, m) / static_cast<double>(source.size());
+                    auto key = std::make_pair(cost.phase, m);
+                    auto it = worst.find(key);
+                    if (it != worst.end() && perByte <= it->second.perByte) continue;
+
+                    // 耗时噪声大，重复测量确认
+                    PhaseCost confirmed = cost;
+                    if (m == 0 && !cost.timedOut && !measureStable(source, cost.phase, confirmed)) continue;
+                    perByte = metricValue(confirmed, m) / static_cast<double>(source.size());
+                    if (it != worst.end() && perByte <= it->second.perByte) continue;
+
+                    WorstEntry entry;
+                    entry.source = source;
+                    entry.cost = confirmed;
+                    entry.perByte = perByte;
+                    entry.foundAtRun = run;
+                    entry.originalBytes = source.size();
+                    worst[key] = entry;
+                    saveWorst(cost.phase, m, entry, false);
+                    newWorst = true;
+                }
+            }
+        }
+
+        if ((newCoverage || newWorst) && run >= static_cast<long long>(corpus.size())) {
+            corpus.push_back(source);
+            std::ostringstream name;
+            name << std::hex << std::hash<std::string>()(source) << ".tc";
+            writeFile(fs::path(options.outDir) / "corpus" / name.str(), source);
+        }
+
+        if ((run + 1) % 1000 == 0) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now() - startTime).count();
+            std::cerr << "#" << (run + 1) << " corpus: " << corpus.size() << " worst: " << worst.size()
+                      << " timeouts: " << timeouts << " crashes: " << crashes
+                      << " elapsed: " << elapsed << "s" << std::endl;
+        }
+    }
+
+    if (options.minimize) {
+        for (auto& [key, entry] : worst) {
+            WorstEntry minimized = minimizeEntry(key.first, key.second, entry);
+            if (minimized.source.size() < entry.source.size()) {
+                writeFile(fs::path(options.outDir) / "worst" /
+                          (safeName(key.first) + "." + kMetrics[key.second] + ".orig.tc"), entry.source);
+                saveWorst(key.first, key.second, minimized, true);
+                entry = minimized;
+            }
+        }
+    }
+
+    std::cerr << "\nWorst inputs per phase (cost per input byte):\n";
+    for (const auto& [key, entry] : worst) {
+        std::cerr << "  " << std::left << std::setw(34) << key.first << std::setw(7) << kMetrics[key.second]
+                  << std::right << std::setw(14) << std::fixed << std::setprecision(2) << entry.perByte
+                  << "  (" << entry.source.size() << " bytes"
+                  << (entry.cost.timedOut ? ", timeout" : "") << ")\n";
+    }
+    std::cerr << "Results written to " << options.outDir << "/worst" << std::endl;
+
+    munmap(mem, sizeof(SharedState));
+    return crashes > 0 ? 2 : 0;
+}
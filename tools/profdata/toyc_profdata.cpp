@@ -0,0 +1,136 @@
+// toyc_profdata.cpp - 读取-fprofile-generate产生的剖析文件
+//
+// 文件格式和计数恢复见profile/profdata.h。
+//
+// 用法:
+//   toyc_profdata show [--edges] [--function=NAME] FILE   块/边计数
+//   toyc_profdata functions [--sort=cycles|calls|name] FILE  函数调用次数与包含cycle
+#include "profile/profdata.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// ==================== 输出 ====================
+
+void showFunction(const ProfiledFunction& fn, bool showEdges) {
+    int exit = static_cast<int>(fn.blocks.size()) - 1;
+    std::cout << "function " << fn.name << ": " << fn.blockCount(exit) << " call(s)";
+    if (!fn.consistent) std::cout << "  [inconsistent profile]";
+    std::cout << "\n";
+
+    for (int b = 0; b < exit; ++b) {
+        std::cout << "  " << std::left << std::setw(24) << fn.blocks[b] << std::right << std::setw(14)
+                  << fn.blockCount(b) << "\n";
+    }
+    if (!showEdges) return;
+
+    std::cout << "  edges:\n";
+    for (const auto& e : fn.edges) {
+        std::string name = fn.blocks[e.src] + " -> " + fn.blocks[e.dst];
+        std::cout << "    " << std::left << std::setw(32) << name << std::right << std::setw(14);
+        if (e.known) std::cout << e.count;
+        else std::cout << "?";
+        std::cout << (e.counter >= 0 ? "  (counted)" : "  (derived)") << "\n";
+    }
+}
+
+// 按包含cycle排序；百分比相对main（程序总时间）
+void showTimings(std::vector<FunctionTiming> timings, const std::string& sortKey) {
+    std::uint64_t total = 0;
+    for (const auto& t : timings) {
+        if (t.name == "main") total = t.cycles;
+    }
+    std::sort(timings.begin(), timings.end(), [&](const FunctionTiming& a, const FunctionTiming& b) {
+        if (sortKey == "name") return a.name < b.name;
+        if (sortKey == "calls") return a.calls != b.calls ? a.calls > b.calls : a.name < b.name;
+        return a.cycles != b.cycles ? a.cycles > b.cycles : a.name < b.name;
+    });
+
+    std::cout << std::left << std::setw(24) << "function" << std::right << std::setw(14) << "calls"
+              << std::setw(18) << "incl. cycles" << std::setw(14) << "cycles/call" << std::setw(9) << "% main"
+              << "\n";
+    for (const auto& t : timings) {
+        std::cout << std::left << std::setw(24) << t.name << std::right << std::setw(14) << t.calls
+                  << std::setw(18) << t.cycles << std::setw(14);
+        if (t.calls) std::cout << t.cycles / t.calls;
+        else std::cout << "-";
+        std::cout << std::setw(9);
+        if (total) {
+            std::cout << std::fixed << std::setprecision(1)
+                      << 100.0 * static_cast<double>(t.cycles) / static_cast<double>(total);
+        } else {
+            std::cout << "-";
+        }
+        std::cout << "\n";
+    }
+}
+
+void printUsage() {
+    std::cerr << "Usage: toyc_profdata show [--edges] [--function=NAME] FILE\n"
+              << "       toyc_profdata functions [--sort=cycles|calls|name] FILE\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage();
+        return 1;
+    }
+    std::string command = argv[1];
+    if (command != "show" && command != "functions") {
+        printUsage();
+        return 1;
+    }
+
+    bool showEdges = false;
+    std::string onlyFunction, sortKey = "cycles", path;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--edges") {
+            showEdges = true;
+        } else if (arg.rfind("--function=", 0) == 0) {
+            onlyFunction = arg.substr(std::string("--function=").size());
+        } else if (arg.rfind("--sort=", 0) == 0) {
+            sortKey = arg.substr(std::string("--sort=").size());
+        } else {
+            path = arg;
+        }
+    }
+    if (path.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    ProfileData data;
+    std::string error;
+    if (!ProfileData::read(path, data, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+
+    if (command == "functions") {
+        if (!data.hasTimings) {
+            std::cerr << "Error: " << path << " has no function records (compile with -finstrument-functions-lite)"
+                      << std::endl;
+            return 1;
+        }
+        showTimings(data.timings, sortKey);
+        return 0;
+    }
+
+    if (!data.hasEdges) {
+        std::cerr << "Error: " << path << " has no edge counters (compile with -fprofile-generate)" << std::endl;
+        return 1;
+    }
+    for (auto& fn : data.functions) {
+        if (!onlyFunction.empty() && fn.name != onlyFunction) continue;
+        fn.reconstruct(data.counters);
+        showFunction(fn, showEdges);
+    }
+    return 0;
+}
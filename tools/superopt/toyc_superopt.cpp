@@ -0,0 +1,913 @@
+// toyc_superopt.cpp - 离线超级优化器，生成codegen/peephole_rules.inc
+//
+// 1. 挖掘：编译语料（.tc在进程内用libtoyc编译，关闭窥孔优化；.s直接读取），
+//    在基本块内取长度2..max-len的指令窗口（只含整数运算、li和条件分支，分支只能是最后一条，
+//    后面的指令都要读取窗口内前面指令的结果），寄存器抽象为$N、立即数抽象为#N、标签为@L
+// 2. 搜索：对每种出现过的窗口，按代价从低到高穷举长度1..max-candidate-len的候选序列，
+//    候选只能写源窗口写过的寄存器，立即数取自#N、-#N、#N±1、log2(#N)和0/±1
+// 3. 验证：非分支窗口只要求最后一条指令的目的寄存器相等，其他被写的寄存器记为dead
+//    （由重写器在使用规则时检查窗口后确实不活跃）；分支窗口要求跳转与否相同，被写的寄存器都是dead。
+//    先用少量随机输入筛选，再用随机输入和边界值的组合逐一比较（RISC-V除法语义）
+// 4. 立即数符号化后找不到更好序列时，把立即数换成语料中观察到的具体值再搜索一次
+//
+// 不建模访存指令和调用：窗口中出现lw/sw/call等指令时不挖掘。
+//
+// 用法:
+//   toyc_superopt [--out=FILE] [--max-len=N] [--max-candidate-len=N] [--tests=N] [--min-count=N] FILE...
+#include "codegen/peephole.h"
+#include "libtoyc/toyc.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// ==================== 指令模型 ====================
+
+enum class Form {
+    RRR,  // op rd, rs1, rs2
+    RRI,  // op rd, rs1, imm
+    RI,   // li rd, imm
+    RR,   // op rd, rs1
+    BRR,  // op rs1, rs2, label
+    BR    // op rs1, label
+};
+
+struct OpInfo {
+    const char* name;
+    Form form;
+    int cost;
+};
+
+enum Op {
+    ADD, SUB, MUL, DIV, DIVU, REM, REMU, SLT, SLTU, AND, OR, XOR, SLL, SRL, SRA,
+    ADDI, SLTI, SLTIU, ANDI, ORI, XORI, SLLI, SRLI, SRAI,
+    LI,
+    MV, NEG, NOT, SEQZ, SNEZ, SLTZ, SGTZ,
+    BEQ, BNE, BLT, BGE, BLTU, BGEU,
+    BEQZ, BNEZ, BLEZ, BGEZ, BLTZ, BGTZ,
+    OP_COUNT
+};
+
+const OpInfo kOps[OP_COUNT] = {
+    {"add", Form::RRR, 1}, {"sub", Form::RRR, 1}, {"mul", Form::RRR, 3}, {"div", Form::RRR, 20},
+    {"divu", Form::RRR, 20}, {"rem", Form::RRR, 20}, {"remu", Form::RRR, 20}, {"slt", Form::RRR, 1},
+    {"sltu", Form::RRR, 1}, {"and", Form::RRR, 1}, {"or", Form::RRR, 1}, {"xor", Form::RRR, 1},
+    {"sll", Form::RRR, 1}, {"srl", Form::RRR, 1}, {"sra", Form::RRR, 1},
+    {"addi", Form::RRI, 1}, {"slti", Form::RRI, 1}, {"sltiu", Form::RRI, 1}, {"andi", Form::RRI, 1},
+    {"ori", Form::RRI, 1}, {"xori", Form::RRI, 1}, {"slli", Form::RRI, 1}, {"srli", Form::RRI, 1},
+    {"srai", Form::RRI, 1},
+    {"li", Form::RI, 1},
+    {"mv", Form::RR, 1}, {"neg", Form::RR, 1}, {"not", Form::RR, 1}, {"seqz", Form::RR, 1},
+    {"snez", Form::RR, 1}, {"sltz", Form::RR, 1}, {"sgtz", Form::RR, 1},
+    {"beq", Form::BRR, 1}, {"bne", Form::BRR, 1}, {"blt", Form::BRR, 1}, {"bge", Form::BRR, 1},
+    {"bltu", Form::BRR, 1}, {"bgeu", Form::BRR, 1},
+    {"beqz", Form::BR, 1}, {"bnez", Form::BR, 1}, {"blez", Form::BR, 1}, {"bgez", Form::BR, 1},
+    {"bltz", Form::BR, 1}, {"bgtz", Form::BR, 1},
+};
+
+bool isBranch(int op) { return kOps[op].form == Form::BRR || kOps[op].form == Form::BR; }
+bool hasImmediate(int op) { return kOps[op].form == Form::RRI || kOps[op].form == Form::RI; }
+
+int findOp(const std::string& name) {
+    for (int op = 0; op < OP_COUNT; ++op) {
+        if (name == kOps[op].name) return op;
+    }
+    return -1;
+}
+
+// 立即数字段的取值范围
+void immediateRange(int op, long long& lo, long long& hi) {
+    if (op == SLLI || op == SRLI || op == SRAI) {
+        lo = 0;
+        hi = 31;
+    } else if (op == LI) {
+        lo = INT32_MIN;
+        hi = INT32_MAX;
+    } else {
+        lo = -2048;
+        hi = 2047;
+    }
+}
+
+constexpr int kZero = -1;  // zero寄存器
+
+// 立即数表达式，变量是窗口中的第var个立即数
+struct Imm {
+    enum Kind { LITERAL, VAR, NEG, PLUS1, MINUS1, LOG2 };
+    Kind kind = LITERAL;
+    int var = 0;
+    long long value = 0;
+
+    bool eval(const std::vector<long long>& imms, long long& out) const {
+        switch (kind) {
+            case LITERAL: out = value; return true;
+            case VAR: out = imms[var]; return true;
+            case NEG: out = -imms[var]; return true;
+            case PLUS1: out = imms[var] + 1; return true;
+            case MINUS1: out = imms[var] - 1; return true;
+            case LOG2: {
+                long long v = imms[var];
+                if (v <= 0 || (v & (v - 1)) != 0) return false;
+                out = 0;
+                while ((1LL << out) < v) ++out;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string toString() const {
+        std::string name = "#" + std::to_string(var);
+        switch (kind) {
+            case LITERAL: return std::to_string(value);
+            case VAR: return name;
+            case NEG: return "-" + name;
+            case PLUS1: return name + "+1";
+            case MINUS1: return name + "-1";
+            case LOG2: return "log2(" + name + ")";
+        }
+        return "";
+    }
+};
+
+struct Instr {
+    int op = ADD;
+    int rd = kZero;
+    int rs1 = kZero;
+    int rs2 = kZero;
+    Imm imm;
+
+    std::vector<int> reads() const {
+        switch (kOps[op].form) {
+            case Form::RRR: case Form::BRR: return {rs1, rs2};
+            case Form::RRI: case Form::RR: case Form::BR: return {rs1};
+            case Form::RI: return {};
+        }
+        return {};
+    }
+    bool writes() const { return !isBranch(op); }
+
+    std::string toString() const {
+        auto reg = [](int r) { return r == kZero ? std::string("zero") : "$" + std::to_string(r); };
+        std::string text = kOps[op].name;
+        switch (kOps[op].form) {
+            case Form::RRR: return text + " " + reg(rd) + ", " + reg(rs1) + ", " + reg(rs2);
+            case Form::RRI: return text + " " + reg(rd) + ", " + reg(rs1) + ", " + imm.toString();
+            case Form::RI: return text + " " + reg(rd) + ", " + imm.toString();
+            case Form::RR: return text + " " + reg(rd) + ", " + reg(rs1);
+            case Form::BRR: return text + " " + reg(rs1) + ", " + reg(rs2) + ", @L";
+            case Form::BR: return text + " " + reg(rs1) + ", @L";
+        }
+        return text;
+    }
+};
+
+std::string joinSequence(const std::vector<Instr>& seq) {
+    std::string text;
+    for (const auto& instr : seq) text += (text.empty() ? "" : "; ") + instr.toString();
+    return text;
+}
+
+int sequenceCost(const std::vector<Instr>& seq) {
+    int cost = 0;
+    for (const auto& instr : seq) cost += kOps[instr.op].cost;
+    return cost;
+}
+
+// ==================== 解释执行 ====================
+
+uint32_t aluResult(int op, uint32_t a, uint32_t b) {
+    int32_t sa = static_cast<int32_t>(a);
+    int32_t sb = static_cast<int32_t>(b);
+    switch (op) {
+        case ADD: case ADDI: return a + b;
+        case SUB: return a - b;
+        case MUL: return a * b;
+        case DIV:
+            if (b == 0) return UINT32_MAX;
+            if (sa == INT32_MIN && sb == -1) return a;
+            return static_cast<uint32_t>(sa / sb);
+        case DIVU: return b == 0 ? UINT32_MAX : a / b;
+        case REM:
+            if (b == 0) return a;
+            if (sa == INT32_MIN && sb == -1) return 0;
+            return static_cast<uint32_t>(sa % sb);
+        case REMU: return b == 0 ? a : a % b;
+        case SLT: case SLTI: return sa < sb;
+        case SLTU: case SLTIU: return a < b;
+        case AND: case ANDI: return a & b;
+        case OR: case ORI: return a | b;
+        case XOR: case XORI: return a ^ b;
+        case SLL: case SLLI: return a << (b & 31);
+        case SRL: case SRLI: return a >> (b & 31);
+        case SRA: case SRAI: return static_cast<uint32_t>(sa >> (b & 31));
+        case LI: return b;
+        case MV: return a;
+        case NEG: return 0u - a;
+        case NOT: return ~a;
+        case SEQZ: return a == 0;
+        case SNEZ: return a != 0;
+        case SLTZ: return sa < 0;
+        case SGTZ: return sa > 0;
+        default: return 0;
+    }
+}
+
+bool branchTaken(int op, uint32_t a, uint32_t b) {
+    int32_t sa = static_cast<int32_t>(a);
+    int32_t sb = static_cast<int32_t>(b);
+    switch (op) {
+        case BEQ: return a == b;
+        case BNE: return a != b;
+        case BLT: return sa < sb;
+        case BGE: return sa >= sb;
+        case BLTU: return a < b;
+        case BGEU: return a >= b;
+        case BEQZ: return a == 0;
+        case BNEZ: return a != 0;
+        case BLEZ: return sa <= 0;
+        case BGEZ: return sa >= 0;
+        case BLTZ: return sa < 0;
+        case BGTZ: return sa > 0;
+        default: return false;
+    }
+}
+
+// 执行一条指令；立即数表达式无定义或超出字段范围时返回false（规则在此输入上不适用）
+bool step(const Instr& instr, std::vector<uint32_t>& regs, const std::vector<long long>& imms, bool& taken) {
+    auto read = [&](int r) { return r == kZero ? 0u : regs[r]; };
+    uint32_t a = read(instr.rs1);
+    uint32_t b = read(instr.rs2);
+    if (hasImmediate(instr.op)) {
+        long long value, lo, hi;
+        if (!instr.imm.eval(imms, value)) return false;
+        immediateRange(instr.op, lo, hi);
+        if (value < lo || value > hi) return false;
+        b = static_cast<uint32_t>(value);
+    }
+    if (isBranch(instr.op)) {
+        taken = branchTaken(instr.op, a, kOps[instr.op].form == Form::BR ? 0 : b);
+    } else if (instr.rd != kZero) {
+        regs[instr.rd] = aluResult(instr.op, a, b);
+    }
+    return true;
+}
+
+struct Outcome {
+    uint32_t value = 0;
+    bool taken = false;
+};
+
+bool run(const std::vector<Instr>& seq, std::vector<uint32_t> regs, const std::vector<long long>& imms,
+         int liveOut, Outcome& out) {
+    bool taken = false;
+    for (const auto& instr : seq) {
+        if (!step(instr, regs, imms, taken)) return false;
+    }
+    out.taken = taken;
+    out.value = liveOut == kZero ? 0 : regs[liveOut];
+    return true;
+}
+
+// ==================== 窗口挖掘 ====================
+
+struct Pattern {
+    std::vector<Instr> seq;
+    int regCount = 0;
+    int immCount = 0;
+    int count = 0;
+    std::map<std::vector<long long>, int> observedImms;  // 具体立即数 -> 出现次数
+};
+
+bool isRegisterOperand(const std::string& text) {
+    if (text.empty()) return false;
+    static const std::set<std::string> names = [] {
+        std::set<std::string> s = {"zero", "ra", "sp", "gp", "tp", "fp"};
+        for (int i = 0; i <= 6; ++i) s.insert("t" + std::to_string(i));
+        for (int i = 0; i <= 11; ++i) s.insert("s" + std::to_string(i));
+        for (int i = 0; i <= 7; ++i) s.insert("a" + std::to_string(i));
+        return s;
+    }();
+    return names.count(text) > 0;
+}
+
+bool parseInteger(const std::string& text, long long& value) {
+    if (text.empty()) return false;
+    size_t i = (text[0] == '-') ? 1 : 0;
+    if (i == text.size() || text.size() > 12) return false;
+    for (size_t j = i; j < text.size(); ++j) {
+        if (text[j] < '0' || text[j] > '9') return false;
+    }
+    value = std::stoll(text);
+    return true;
+}
+
+// 把一段具体指令抽象为模式；不支持的指令或操作数返回false
+bool abstractWindow(const std::vector<AsmInstr>& window, std::vector<Instr>& seq, std::vector<long long>& imms,
+                    int& regCount) {
+    std::map<std::string, int> regs;
+    std::string label;
+    seq.clear();
+    imms.clear();
+    auto reg = [&](const std::string& name, int& out) {
+        if (!isRegisterOperand(name)) return false;
+        if (name == "zero") {
+            out = kZero;
+        } else {
+            auto it = regs.emplace(name, static_cast<int>(regs.size())).first;
+            out = it->second;
+        }
+        return true;
+    };
+    auto imm = [&](const std::string& text, Imm& out) {
+        long long value;
+        if (!parseInteger(text, value)) return false;
+        out.kind = Imm::VAR;
+        out.var = static_cast<int>(imms.size());
+        imms.push_back(value);
+        return true;
+    };
+
+    for (size_t k = 0; k < window.size(); ++k) {
+        const AsmInstr& asmInstr = window[k];
+        int op = findOp(asmInstr.mnemonic);
+        if (op < 0 || (isBranch(op) && k + 1 != window.size())) return false;
+        const auto& ops = asmInstr.operands;
+        Instr instr;
+        instr.op = op;
+        bool ok = false;
+        switch (kOps[op].form) {
+            case Form::RRR:
+                ok = ops.size() == 3 && reg(ops[0], instr.rd) && reg(ops[1], instr.rs1) && reg(ops[2], instr.rs2);
+                break;
+            case Form::RRI:
+                ok = ops.size() == 3 && reg(ops[0], instr.rd) && reg(ops[1], instr.rs1) && imm(ops[2], instr.imm);
+                break;
+            case Form::RI:
+                ok = ops.size() == 2 && reg(ops[0], instr.rd) && imm(ops[1], instr.imm);
+                break;
+            case Form::RR:
+                ok = ops.size() == 2 && reg(ops[0], instr.rd) && reg(ops[1], instr.rs1);
+                break;
+            case Form::BRR:
+                ok = ops.size() == 3 && reg(ops[0], instr.rs1) && reg(ops[1], instr.rs2) && !isRegisterOperand(ops[2]);
+                break;
+            case Form::BR:
+                ok = ops.size() == 2 && reg(ops[0], instr.rs1) && !isRegisterOperand(ops[1]);
+                break;
+        }
+        if (!ok || (instr.writes() && instr.rd == kZero)) return false;
+        seq.push_back(instr);
+    }
+    regCount = static_cast<int>(regs.size());
+
+    // 数据流连通：除第一条外，每条指令都读取窗口内之前写过的寄存器
+    std::set<int> written;
+    for (size_t k = 0; k < seq.size(); ++k) {
+        if (k > 0) {
+            auto reads = seq[k].reads();
+            if (std::none_of(reads.begin(), reads.end(), [&](int r) { return r != kZero && written.count(r); })) {
+                return false;
+            }
+        }
+        if (seq[k].writes()) written.insert(seq[k].rd);
+    }
+    return true;
+}
+
+void mineAssembly(const std::string& assembly, size_t maxLen, std::map<std::string, Pattern>& patterns) {
+    std::vector<std::vector<AsmInstr>> blocks(1);
+    std::istringstream in(assembly);
+    std::string text;
+    while (std::getline(in, text)) {
+        if (text.empty()) continue;
+        AsmLine line = AsmLine::classify(text);
+        if (line.kind == AsmLine::Kind::COMMENT) continue;
+        AsmInstr instr;
+        if (line.kind != AsmLine::Kind::INSTRUCTION || !AsmInstr::parse(line.text, instr)) {
+            blocks.emplace_back();
+            continue;
+        }
+        blocks.back().push_back(instr);
+    }
+
+    for (const auto& block : blocks) {
+        for (size_t start = 0; start < block.size(); ++start) {
+            for (size_t len = 2; len <= maxLen && start + len <= block.size(); ++len) {
+                std::vector<AsmInstr> window(block.begin() + start, block.begin() + start + len);
+                std::vector<Instr> seq;
+                std::vector<long long> imms;
+                int regCount = 0;
+                if (!abstractWindow(window, seq, imms, regCount)) continue;
+                Pattern& pattern = patterns[joinSequence(seq)];
+                pattern.seq = seq;
+                pattern.regCount = regCount;
+                pattern.immCount = static_cast<int>(imms.size());
+                ++pattern.count;
+                ++pattern.observedImms[imms];
+            }
+        }
+    }
+}
+
+// ==================== 等价性检查 ====================
+
+struct TestVector {
+    std::vector<uint32_t> regs;
+    std::vector<long long> imms;
+};
+
+class Verifier {
+public:
+    Verifier(const std::vector<Instr>& source, int regCount, int immCount, int tests, std::mt19937& rng)
+        : source(source), regCount(regCount), immCount(immCount) {
+        branch = isBranch(source.back().op);
+        liveOut = branch ? kZero : source.back().rd;
+
+        // 源窗口中每个立即数变量所在字段的取值范围
+        immLo.assign(immCount, INT32_MIN);
+        immHi.assign(immCount, INT32_MAX);
+        for (const auto& instr : source) {
+            if (!hasImmediate(instr.op) || instr.imm.kind != Imm::VAR) continue;
+            long long lo, hi;
+            immediateRange(instr.op, lo, hi);
+            immLo[instr.imm.var] = std::max(immLo[instr.imm.var], lo);
+            immHi[instr.imm.var] = std::min(immHi[instr.imm.var], hi);
+        }
+
+        for (int i = 0; i < 16; ++i) addVector(randomVector(rng), quick, quickOut);
+        for (int i = 0; i < tests; ++i) addVector(randomVector(rng), full, fullOut);
+        addBoundaryVectors(rng);
+    }
+
+    bool isBranchWindow() const { return branch; }
+    int liveOutRegister() const { return liveOut; }
+
+    // 返回在多少个输入上适用；有输入结果不同返回-1
+    int check(const std::vector<Instr>& candidate, bool thorough) const {
+        const auto& vectors = thorough ? full : quick;
+        const auto& expected = thorough ? fullOut : quickOut;
+        int applicable = 0;
+        for (size_t i = 0; i < vectors.size(); ++i) {
+            Outcome out;
+            if (!run(candidate, vectors[i].regs, vectors[i].imms, liveOut, out)) continue;
+            bool same = branch ? out.taken == expected[i].taken : out.value == expected[i].value;
+            if (!same) return -1;
+            ++applicable;
+        }
+        return applicable;
+    }
+
+    size_t fullSize() const { return full.size(); }
+
+private:
+    const std::vector<Instr>& source;
+    int regCount;
+    int immCount;
+    bool branch = false;
+    int liveOut = kZero;
+    std::vector<long long> immLo, immHi;
+    std::vector<TestVector> quick, full;
+    std::vector<Outcome> quickOut, fullOut;
+
+    void addVector(TestVector vector, std::vector<TestVector>& into, std::vector<Outcome>& outcomes) {
+        Outcome out;
+        if (!run(source, vector.regs, vector.imms, liveOut, out)) return;
+        into.push_back(std::move(vector));
+        outcomes.push_back(out);
+    }
+
+    uint32_t randomRegister(std::mt19937& rng) const {
+        switch (rng() % 4) {
+            case 0: return static_cast<uint32_t>(static_cast<int>(rng() % 33) - 16);
+            case 1: return 1u << (rng() % 32);
+            default: return rng();
+        }
+    }
+
+    // 偏向小数值和2的幂，使-#N、log2(#N)等表达式在足够多的输入上适用
+    long long randomImmediate(int var, std::mt19937& rng) const {
+        long long lo = immLo[var], hi = immHi[var];
+        long long value;
+        switch (rng() % 5) {
+            case 0: value = static_cast<int>(rng() % 33) - 16; break;
+            case 1: value = 1LL << (rng() % 31); break;
+            case 2: value = -(1LL << (rng() % 31)); break;
+            case 3: value = static_cast<int>(rng() % 4096) - 2048; break;
+            default: value = static_cast<int32_t>(rng()); break;
+        }
+        if (value < lo || value > hi) value = lo + static_cast<long long>(rng() % static_cast<uint64_t>(hi - lo + 1));
+        return value;
+    }
+
+    TestVector randomVector(std::mt19937& rng) const {
+        TestVector v;
+        for (int r = 0; r < regCount; ++r) v.regs.push_back(randomRegister(rng));
+        for (int i = 0; i < immCount; ++i) v.imms.push_back(randomImmediate(i, rng));
+        return v;
+    }
+
+    // 边界值的组合：变量不多时全部组合，否则随机抽取
+    void addBoundaryVectors(std::mt19937& rng) {
+        const std::vector<long long> special = {0, 1, -1, 2, -2, 3, 31, 32, 2047, -2048, 2048,
+                                                INT32_MAX, INT32_MIN, INT32_MIN + 1, 0x55555555};
+        std::vector<std::vector<long long>> choices;
+        for (int r = 0; r < regCount; ++r) choices.push_back(special);
+        for (int i = 0; i < immCount; ++i) {
+            std::vector<long long> values;
+            for (long long v : special) {
+                if (v >= immLo[i] && v <= immHi[i]) values.push_back(v);
+            }
+            choices.push_back(values);
+        }
+        double combinations = 1;
+        for (const auto& c : choices) combinations *= static_cast<double>(c.size());
+
+        auto make = [&](const std::vector<size_t>& index) {
+            TestVector v;
+            for (int r = 0; r < regCount; ++r) v.regs.push_back(static_cast<uint32_t>(choices[r][index[r]]));
+            for (int i = 0; i < immCount; ++i) v.imms.push_back(choices[regCount + i][index[regCount + i]]);
+            addVector(std::move(v), full, fullOut);
+        };
+        std::vector<size_t> index(choices.size(), 0);
+        if (combinations <= 60000) {
+            while (true) {
+                make(index);
+                size_t k = 0;
+                while (k < index.size() && ++index[k] == choices[k].size()) index[k++] = 0;
+                if (k == index.size()) break;
+            }
+        } else {
+            for (int n = 0; n < 60000; ++n) {
+                for (size_t k = 0; k < index.size(); ++k) index[k] = rng() % choices[k].size();
+                make(index);
+            }
+        }
+    }
+};
+
+// ==================== 候选搜索 ====================
+
+struct Result {
+    std::vector<Instr> replacement;
+    std::vector<int> dead;
+};
+
+class Searcher {
+public:
+    Searcher(const Pattern& pattern, int tests, int maxCandidateLength, std::mt19937& rng)
+        : pattern(pattern), verifier(pattern.seq, pattern.regCount, pattern.immCount, tests, rng),
+          maxCandidateLength(maxCandidateLength) {
+        sourceCost = sequenceCost(pattern.seq);
+        for (const auto& instr : pattern.seq) {
+            if (instr.writes()) writes.insert(instr.rd);
+        }
+        buildPools();
+    }
+
+    bool search(Result& result) {
+        std::vector<std::vector<Instr>> found;
+        int bestCost = sourceCost;
+        auto consider = [&](std::vector<Instr> candidate) {
+            int cost = sequenceCost(candidate);
+            if (cost >= bestCost + (found.empty() ? 0 : 1)) return;
+            int quickApplicable = verifier.check(candidate, false);
+            if (quickApplicable < 3) return;
+            int applicable = verifier.check(candidate, true);
+            if (applicable < static_cast<int>(verifier.fullSize() / 20) || applicable < 8) return;
+            if (cost < bestCost) {
+                found.clear();
+                bestCost = cost;
+            }
+            found.push_back(std::move(candidate));
+        };
+
+        bool branch = verifier.isBranchWindow();
+        int liveOut = verifier.liveOutRegister();
+        if (branch) {
+            for (const auto& b : branches) consider({b});
+        } else {
+            for (const auto& s : singles) {
+                if (s.rd == liveOut) consider({s});
+            }
+        }
+        if (maxCandidateLength >= 2 && found.empty()) {
+            for (const auto& first : singles) {
+                if (kOps[first.op].cost + 1 >= sourceCost) continue;
+                const auto& seconds = branch ? branches : singles;
+                for (const auto& second : seconds) {
+                    if (!branch && second.rd != liveOut) continue;
+                    auto reads = second.reads();
+                    if (std::find(reads.begin(), reads.end(), first.rd) == reads.end()) continue;
+                    consider({first, second});
+                }
+            }
+        }
+        if (found.empty()) return false;
+
+        // 同代价的候选中选适用于最多观察到的立即数组合的，其次选指令少的
+        auto coverage = [&](const std::vector<Instr>& candidate) {
+            int covered = 0;
+            for (const auto& entry : pattern.observedImms) {
+                if (applies(candidate, entry.first)) covered += entry.second;
+            }
+            return covered;
+        };
+        auto best = std::max_element(found.begin(), found.end(), [&](const auto& a, const auto& b) {
+            int ca = coverage(a), cb = coverage(b);
+            if (ca != cb) return ca < cb;
+            return a.size() > b.size();
+        });
+        if (coverage(*best) == 0) return false;
+
+        result.replacement = *best;
+        result.dead.clear();
+        for (int r : writes) {
+            if (r != liveOut) result.dead.push_back(r);
+        }
+        return true;
+    }
+
+    static bool applies(const std::vector<Instr>& candidate, const std::vector<long long>& imms) {
+        for (const auto& instr : candidate) {
+            if (!hasImmediate(instr.op)) continue;
+            long long value, lo, hi;
+            immediateRange(instr.op, lo, hi);
+            if (!instr.imm.eval(imms, value) || value < lo || value > hi) return false;
+        }
+        return true;
+    }
+
+private:
+    const Pattern& pattern;
+    Verifier verifier;
+    int maxCandidateLength;
+    int sourceCost = 0;
+    std::set<int> writes;
+    std::vector<Instr> singles;
+    std::vector<Instr> branches;
+
+    void buildPools() {
+        std::vector<int> sources = {kZero};
+        for (int r = 0; r < pattern.regCount; ++r) sources.push_back(r);
+
+        std::vector<Imm> immPool;
+        for (long long literal : {0LL, 1LL, -1LL}) {
+            Imm imm;
+            imm.value = literal;
+            immPool.push_back(imm);
+        }
+        for (int var = 0; var < pattern.immCount; ++var) {
+            for (auto kind : {Imm::VAR, Imm::NEG, Imm::PLUS1, Imm::MINUS1, Imm::LOG2}) {
+                Imm imm;
+                imm.kind = kind;
+                imm.var = var;
+                immPool.push_back(imm);
+            }
+        }
+
+        for (int op = 0; op < OP_COUNT; ++op) {
+            if (kOps[op].cost >= sourceCost) continue;
+            Instr instr;
+            instr.op = op;
+            switch (kOps[op].form) {
+                case Form::RRR:
+                    for (int rd : writes) for (int a : sources) for (int b : sources) {
+                        instr.rd = rd;
+                        instr.rs1 = a;
+                        instr.rs2 = b;
+                        singles.push_back(instr);
+                    }
+                    break;
+                case Form::RRI:
+                    for (int rd : writes) for (int a : sources) for (const auto& imm : immPool) {
+                        instr.rd = rd;
+                        instr.rs1 = a;
+                        instr.imm = imm;
+                        singles.push_back(instr);
+                    }
+                    break;
+                case Form::RI:
+                    for (int rd : writes) for (const auto& imm : immPool) {
+                        instr.rd = rd;
+                        instr.imm = imm;
+                        singles.push_back(instr);
+                    }
+                    break;
+                case Form::RR:
+                    for (int rd : writes) for (int a : sources) {
+                        instr.rd = rd;
+                        instr.rs1 = a;
+                        singles.push_back(instr);
+                    }
+                    break;
+                case Form::BRR:
+                    for (int a : sources) for (int b : sources) {
+                        instr.rs1 = a;
+                        instr.rs2 = b;
+                        branches.push_back(instr);
+                    }
+                    break;
+                case Form::BR:
+                    for (int a : sources) {
+                        instr.rs1 = a;
+                        branches.push_back(instr);
+                    }
+                    break;
+            }
+        }
+    }
+};
+
+// 把第var个立即数变量换成具体值
+Pattern concretize(const Pattern& pattern, const std::vector<long long>& imms) {
+    Pattern result = pattern;
+    for (auto& instr : result.seq) {
+        if (hasImmediate(instr.op) && instr.imm.kind == Imm::VAR) {
+            instr.imm.value = imms[instr.imm.var];
+            instr.imm.kind = Imm::LITERAL;
+        }
+    }
+    result.immCount = 0;
+    result.count = pattern.observedImms.at(imms);
+    result.observedImms.clear();
+    result.observedImms[{}] = result.count;
+    return result;
+}
+
+struct Rule {
+    std::string pattern;
+    std::string replacement;
+    std::string dead;
+    int costBefore = 0;
+    int costAfter = 0;
+    int count = 0;
+};
+
+Rule makeRule(const Pattern& pattern, const Result& result, int count) {
+    Rule rule;
+    rule.pattern = joinSequence(pattern.seq);
+    rule.replacement = joinSequence(result.replacement);
+    for (int r : result.dead) rule.dead += (rule.dead.empty() ? "$" : ", $") + std::to_string(r);
+    rule.costBefore = sequenceCost(pattern.seq);
+    rule.costAfter = sequenceCost(result.replacement);
+    rule.count = count;
+    return rule;
+}
+
+int usage() {
+    std::cerr << "用法: toyc_superopt [--out=FILE] [--max-len=N] [--max-candidate-len=N] [--tests=N] "
+                 "[--min-count=N] FILE...\n"
+                 "  FILE为ToyC源文件（.tc）或汇编文件（.s）\n";
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string outFile;
+    size_t maxLen = 3;
+    int maxCandidateLength = 2;
+    int tests = 1000;
+    int minCount = 1;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&](const char* prefix) { return arg.substr(std::string(prefix).size()); };
+        if (arg.rfind("--out=", 0) == 0) {
+            outFile = value("--out=");
+        } else if (arg.rfind("--max-len=", 0) == 0) {
+            maxLen = std::stoul(value("--max-len="));
+        } else if (arg.rfind("--max-candidate-len=", 0) == 0) {
+            maxCandidateLength = std::stoi(value("--max-candidate-len="));
+        } else if (arg.rfind("--tests=", 0) == 0) {
+            tests = std::stoi(value("--tests="));
+        } else if (arg.rfind("--min-count=", 0) == 0) {
+            minCount = std::stoi(value("--min-count="));
+        } else if (arg.rfind("--", 0) == 0) {
+            return usage();
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty() || maxLen < 2 || maxCandidateLength < 1 || maxCandidateLength > 2) return usage();
+
+    // ---------- 挖掘 ----------
+    std::map<std::string, Pattern> patterns;
+    toyc::CompileOptions options;
+    options.peephole = false;
+    toyc::CompileOutput compiled;
+    for (const auto& input : inputs) {
+        std::ifstream file(input);
+        if (!file) {
+            std::cerr << "Error: Cannot open file " << input << std::endl;
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        if (input.size() > 2 && input.compare(input.size() - 2, 2, ".s") == 0) {
+            mineAssembly(buffer.str(), maxLen, patterns);
+            continue;
+        }
+        options.sourceName = input;
+        compiled.clear();
+        if (!toyc::compile(buffer.str(), options, compiled)) {
+            std::cerr << compiled.diagnostics << "Error: failed to compile " << input << std::endl;
+            return 1;
+        }
+        mineAssembly(compiled.assembly, maxLen, patterns);
+    }
+
+    std::vector<const Pattern*> ordered;
+    for (const auto& entry : patterns) {
+        if (entry.second.count >= minCount) ordered.push_back(&entry.second);
+    }
+    std::stable_sort(ordered.begin(), ordered.end(), [](const Pattern* a, const Pattern* b) {
+        return a->count > b->count;
+    });
+    std::cerr << "挖掘到" << patterns.size() << "种窗口，搜索其中出现至少" << minCount << "次的"
+              << ordered.size() << "种\n";
+
+    // ---------- 搜索 ----------
+    auto startTime = std::chrono::steady_clock::now();
+    std::mt19937 rng(20240611);
+    std::vector<Rule> rules;
+    std::set<std::string> emitted;
+    auto addRule = [&](const Rule& rule) {
+        if (!emitted.insert(rule.pattern).second) return;
+        rules.push_back(rule);
+        std::cerr << "  " << rule.pattern << "  =>  " << rule.replacement << "  (dead: "
+                  << (rule.dead.empty() ? "-" : rule.dead) << ", " << rule.costBefore << " -> "
+                  << rule.costAfter << ", " << rule.count << "x)\n";
+    };
+
+    for (const Pattern* pattern : ordered) {
+        Result result;
+        Searcher searcher(*pattern, tests, maxCandidateLength, rng);
+        bool symbolic = searcher.search(result);
+        if (symbolic) {
+            int covered = 0;
+            for (const auto& entry : pattern->observedImms) {
+                if (Searcher::applies(result.replacement, entry.first)) covered += entry.second;
+            }
+            addRule(makeRule(*pattern, result, covered));
+        }
+
+        // 符号化规则覆盖不到的具体立即数组合，按出现次数取前几种单独搜索
+        if (pattern->immCount == 0) continue;
+        std::vector<std::pair<int, std::vector<long long>>> uncovered;
+        for (const auto& entry : pattern->observedImms) {
+            if (symbolic && Searcher::applies(result.replacement, entry.first)) continue;
+            uncovered.push_back({entry.second, entry.first});
+        }
+        std::stable_sort(uncovered.begin(), uncovered.end(), [](const auto& a, const auto& b) {
+            return a.first > b.first;
+        });
+        for (size_t k = 0; k < uncovered.size() && k < 8; ++k) {
+            if (uncovered[k].first < minCount) break;
+            Pattern concrete = concretize(*pattern, uncovered[k].second);
+            Result concreteResult;
+            Searcher concreteSearcher(concrete, tests, maxCandidateLength, rng);
+            if (concreteSearcher.search(concreteResult)) addRule(makeRule(concrete, concreteResult, concrete.count));
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cerr << "生成" << rules.size() << "条规则，搜索用时" << seconds << "秒\n";
+
+    // ---------- 输出 ----------
+    std::stable_sort(rules.begin(), rules.end(), [](const Rule& a, const Rule& b) { return a.count > b.count; });
+    std::ostringstream text;
+    text << "// peephole_rules.inc - 由toyc_superopt生成，请勿手工修改\n"
+            "//\n"
+            "// 重新生成: toyc_superopt --out=codegen/peephole_rules.inc [选项] 语料.tc...\n"
+            "//   （或配置TOYC_SUPEROPT_CORPUS后执行make update_peephole_rules）\n"
+            "// TOYC_PEEPHOLE_RULE(模式, 替换, 窗口后必须不活跃的寄存器, 原代价, 新代价)\n"
+            "// 代价: 整数运算、li、分支为1，mul为3，div/rem为20\n\n";
+    for (const auto& rule : rules) {
+        text << "TOYC_PEEPHOLE_RULE(\"" << rule.pattern << "\", \"" << rule.replacement << "\", \"" << rule.dead
+             << "\", " << rule.costBefore << ", " << rule.costAfter << ")  // seen " << rule.count << "x\n";
+    }
+
+    if (outFile.empty()) {
+        std::cout << text.str();
+    } else {
+        std::ofstream out(outFile);
+        if (!out) {
+            std::cerr << "Error: Cannot open file " << outFile << std::endl;
+            return 1;
+        }
+        out << text.str();
+    }
+    return 0;
+}
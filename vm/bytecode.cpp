@@ -0,0 +1,436 @@
+// bytecode.cpp - IR到寄存器式字节码的降级
+#include "bytecode.h"
+#include <iomanip>
+#include <map>
+
+const char* vmOpName(VmOp op) {
+    static const char* const names[] = {
+#define TOYC_VM_NAME(name) #name,
+        TOYC_VM_OPS(TOYC_VM_NAME)
+#undef TOYC_VM_NAME
+    };
+    return names[static_cast<size_t>(op)];
+}
+
+int VmModule::findFunction(const std::string& name) const {
+    for (size_t i = 0; i < functions.size(); ++i) {
+        if (functions[i].name == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void VmModule::dump(std::ostream& out) const {
+    for (const auto& fn : functions) {
+        out << "function " << fn.name << " params " << fn.paramCount << " frame " << fn.frameSize << "\n";
+        auto slot = [&](int32_t s) {
+            if (s >= fn.constBase && s < fn.frameSize) return "#" + std::to_string(fn.constants[s - fn.constBase]);
+            if (s >= 0 && s < static_cast<int32_t>(fn.slotNames.size())) return fn.slotNames[s];
+            return "?" + std::to_string(s);
+        };
+        for (size_t pc = 0; pc < fn.code.size(); ++pc) {
+            const VmInstr& in = fn.code[pc];
+            out << std::setw(6) << pc << "  " << std::left << std::setw(6) << vmOpName(in.op) << std::right;
+            auto target = [&](int32_t off) { return std::to_string(static_cast<int64_t>(pc) + off); };
+            switch (in.op) {
+                case VmOp::MOV: case VmOp::NEG: case VmOp::NOT:
+                    out << slot(in.a) << ", " << slot(in.b); break;
+                case VmOp::LOADI: out << slot(in.a) << ", " << in.b; break;
+                case VmOp::ADDI: out << slot(in.a) << ", " << slot(in.b) << ", " << in.c; break;
+                case VmOp::JMP: out << "-> " << target(in.a); break;
+                case VmOp::JNZ: case VmOp::JZ: out << slot(in.a) << " -> " << target(in.b); break;
+                case VmOp::BLT: case VmOp::BGT: case VmOp::BLE: case VmOp::BGE: case VmOp::BEQ: case VmOp::BNE:
+                    out << slot(in.a) << ", " << slot(in.b) << " -> " << target(in.c); break;
+                case VmOp::BLTI: case VmOp::BGTI: case VmOp::BLEI: case VmOp::BGEI: case VmOp::BEQI: case VmOp::BNEI:
+                    out << slot(in.a) << ", " << in.b << " -> " << target(in.c); break;
+                case VmOp::CALL: {
+                    const VmFunction& callee = functions[in.b];
+                    out << slot(in.a) << ", " << callee.name << "(";
+                    for (int k = 0; k < callee.paramCount; ++k) out << (k ? ", " : "") << slot(argSlots[in.c + k]);
+                    out << ")";
+                    break;
+                }
+                case VmOp::RET: out << slot(in.a); break;
+                case VmOp::RETI: out << in.a; break;
+                default: out << slot(in.a) << ", " << slot(in.b) << ", " << slot(in.c); break;
+            }
+            out << "\n";
+        }
+    }
+}
+
+namespace {
+
+// ==================== 单个函数降级 ====================
+
+bool isCompare(OpCode op) {
+    return op == OpCode::LT || op == OpCode::GT || op == OpCode::LE ||
+           op == OpCode::GE || op == OpCode::EQ || op == OpCode::NE;
+}
+
+OpCode invertCompare(OpCode op) {
+    switch (op) {
+        case OpCode::LT: return OpCode::GE;
+        case OpCode::GE: return OpCode::LT;
+        case OpCode::GT: return OpCode::LE;
+        case OpCode::LE: return OpCode::GT;
+        case OpCode::EQ: return OpCode::NE;
+        default: return OpCode::EQ;
+    }
+}
+
+// 交换比较两侧：a cc b 等价于 b swap(cc) a
+OpCode swapCompare(OpCode op) {
+    switch (op) {
+        case OpCode::LT: return OpCode::GT;
+        case OpCode::GT: return OpCode::LT;
+        case OpCode::LE: return OpCode::GE;
+        case OpCode::GE: return OpCode::LE;
+        default: return op;
+    }
+}
+
+VmOp branchOp(OpCode cc, bool immediate) {
+    switch (cc) {
+        case OpCode::LT: return immediate ? VmOp::BLTI : VmOp::BLT;
+        case OpCode::GT: return immediate ? VmOp::BGTI : VmOp::BGT;
+        case OpCode::LE: return immediate ? VmOp::BLEI : VmOp::BLE;
+        case OpCode::GE: return immediate ? VmOp::BGEI : VmOp::BGE;
+        case OpCode::EQ: return immediate ? VmOp::BEQI : VmOp::BEQ;
+        default: return immediate ? VmOp::BNEI : VmOp::BNE;
+    }
+}
+
+VmOp binaryOp(OpCode op) {
+    switch (op) {
+        case OpCode::ADD: return VmOp::ADD;
+        case OpCode::SUB: return VmOp::SUB;
+        case OpCode::MUL: return VmOp::MUL;
+        case OpCode::DIV: return VmOp::DIV;
+        case OpCode::MOD: return VmOp::MOD;
+        case OpCode::LT: return VmOp::LT;
+        case OpCode::GT: return VmOp::GT;
+        case OpCode::LE: return VmOp::LE;
+        case OpCode::GE: return VmOp::GE;
+        case OpCode::EQ: return VmOp::EQ;
+        case OpCode::NE: return VmOp::NE;
+        case OpCode::AND: return VmOp::AND;
+        default: return VmOp::OR;
+    }
+}
+
+bool isConstant(const std::shared_ptr<Operand>& op) {
+    return op && op->type == OperandType::CONSTANT;
+}
+
+// IR中同名操作数可能是不同的Operand对象（例如--ir-in读入的IR），按名字比较
+bool sameOperand(const std::shared_ptr<Operand>& a, const std::shared_ptr<Operand>& b) {
+    return a && b && isProcessableReg(*a) && isProcessableReg(*b) && a->name == b->name;
+}
+
+struct JumpFixup {
+    size_t at;
+    int32_t VmInstr::*field;
+    std::string label;
+};
+
+class FunctionLowering {
+public:
+    FunctionLowering(const FunctionBeginInstr& begin, const std::vector<std::shared_ptr<IRInstr>>& body,
+                     const std::map<std::string, int>& functionIndex, VmModule& module, VmFunction& fn)
+        : begin(begin), body(body), functionIndex(functionIndex), module(module), fn(fn) {}
+
+    void lower() {
+        assignSlots();
+        for (size_t i = 0; i < body.size(); ++i) i = lowerInstr(i);
+        // 落到函数结尾（void函数或缺少return）时返回0
+        emit({VmOp::RETI, 0, 0, 0});
+
+        for (const auto& fixup : fixups) {
+            auto it = labelPos.find(fixup.label);
+            if (it == labelPos.end()) {
+                throw VmError("function '" + begin.funcName + "' jumps to undefined label '" + fixup.label + "'");
+            }
+            fn.code[fixup.at].*fixup.field =
+                static_cast<int32_t>(static_cast<int64_t>(it->second) - static_cast<int64_t>(fixup.at));
+        }
+        fn.frameSize = fn.constBase + static_cast<int>(fn.constants.size());
+    }
+
+private:
+    const FunctionBeginInstr& begin;
+    const std::vector<std::shared_ptr<IRInstr>>& body;
+    const std::map<std::string, int>& functionIndex;
+    VmModule& module;
+    VmFunction& fn;
+
+    std::map<std::string, int> slots;
+    std::map<int32_t, int> constSlots;
+    std::map<std::string, int> useCounts;
+    std::map<std::string, size_t> labelPos;
+    std::vector<JumpFixup> fixups;
+    std::vector<std::shared_ptr<Operand>> pendingArgs;
+    int discardSlot = 0;
+
+    // ---------- 槽位 ----------
+
+    void addSlot(const std::string& name) {
+        if (slots.count(name)) return;
+        slots[name] = static_cast<int>(fn.slotNames.size());
+        fn.slotNames.push_back(name);
+    }
+
+    // 形参占前paramCount个槽，其余变量与临时量按首次出现顺序排列，最后是常量槽
+    void assignSlots() {
+        for (const auto& name : begin.paramNames) addSlot(name);
+        for (const auto& instr : body) {
+            for (const auto& name : instr->getDefRegisters()) addSlot(name);
+            for (const auto& name : instr->getUseRegisters()) {
+                addSlot(name);
+                ++useCounts[name];
+            }
+        }
+        discardSlot = static_cast<int>(fn.slotNames.size());
+        fn.slotNames.push_back("$discard");
+        fn.paramCount = static_cast<int>(begin.paramNames.size());
+        fn.constBase = static_cast<int>(fn.slotNames.size());
+    }
+
+    int32_t slotOf(const std::shared_ptr<Operand>& op) {
+        if (isConstant(op)) {
+            auto it = constSlots.find(op->value);
+            if (it != constSlots.end()) return it->second;
+            int slot = fn.constBase + static_cast<int>(fn.constants.size());
+            fn.constants.push_back(op->value);
+            constSlots[op->value] = slot;
+            return slot;
+        }
+        if (!op) throw VmError("function '" + begin.funcName + "' uses a missing operand");
+        auto it = slots.find(op->name);
+        if (it == slots.end()) {
+            throw VmError("function '" + begin.funcName + "' uses unknown operand '" + op->name + "'");
+        }
+        return it->second;
+    }
+
+    // ---------- 融合判定 ----------
+
+    // op是只被body[next]使用一次的临时量
+    bool usedOnlyBy(const std::shared_ptr<Operand>& op, size_t next) {
+        if (!op || op->type != OperandType::TEMP || next >= body.size()) return false;
+        auto it = useCounts.find(op->name);
+        if (it == useCounts.end() || it->second != 1) return false;
+        for (const auto& name : body[next]->getUseRegisters()) {
+            if (name == op->name) return true;
+        }
+        return false;
+    }
+
+    // 结果临时量紧接着被复制给变量时直接写入该变量，返回目标槽位并推进i
+    int32_t resultSlot(const std::shared_ptr<Operand>& result, size_t& i) {
+        if (!result) return discardSlot;
+        if (i + 1 < body.size()) {
+            auto copy = std::dynamic_pointer_cast<AssignInstr>(body[i + 1]);
+            if (copy && sameOperand(copy->source, result) && usedOnlyBy(result, i + 1) && isProcessableReg(*copy->target)) {
+                ++i;
+                return slotOf(copy->target);
+            }
+        }
+        return slotOf(result);
+    }
+
+    // ---------- 发射 ----------
+
+    void emit(const VmInstr& instr) { fn.code.push_back(instr); }
+
+    void emitJump(VmInstr instr, int32_t VmInstr::*field, const std::string& label) {
+        fixups.push_back({fn.code.size(), field, label});
+        emit(instr);
+    }
+
+    void emitBranch(OpCode cc, const std::shared_ptr<Operand>& left, const std::shared_ptr<Operand>& right,
+                    const std::string& label) {
+        if (isConstant(left) && isConstant(right)) {
+            if (evalBinaryOp(cc, left->value, right->value)) emitJump({VmOp::JMP, 0, 0, 0}, &VmInstr::a, label);
+        } else if (isConstant(right)) {
+            emitJump({branchOp(cc, true), slotOf(left), right->value, 0}, &VmInstr::c, label);
+        } else if (isConstant(left)) {
+            emitJump({branchOp(swapCompare(cc), true), slotOf(right), left->value, 0}, &VmInstr::c, label);
+        } else {
+            emitJump({branchOp(cc, false), slotOf(left), slotOf(right), 0}, &VmInstr::c, label);
+        }
+    }
+
+    // 翻译body[i]（可能连同其后被融合的指令），返回最后处理的下标
+    size_t lowerInstr(size_t i) {
+        const auto& instr = body[i];
+        switch (instr->opcode) {
+            case OpCode::ADD: case OpCode::SUB: case OpCode::MUL: case OpCode::DIV: case OpCode::MOD:
+            case OpCode::LT: case OpCode::GT: case OpCode::LE: case OpCode::GE: case OpCode::EQ: case OpCode::NE:
+            case OpCode::AND: case OpCode::OR:
+                return lowerBinary(*std::static_pointer_cast<BinaryOpInstr>(instr), i);
+            case OpCode::NEG: case OpCode::NOT:
+                return lowerUnary(*std::static_pointer_cast<UnaryOpInstr>(instr), i);
+            case OpCode::ASSIGN: {
+                auto& assign = *std::static_pointer_cast<AssignInstr>(instr);
+                int32_t target = slotOf(assign.target);
+                if (isConstant(assign.source)) {
+                    emit({VmOp::LOADI, target, assign.source->value, 0});
+                } else {
+                    int32_t source = slotOf(assign.source);
+                    if (source != target) emit({VmOp::MOV, target, source, 0});
+                }
+                return i;
+            }
+            case OpCode::GOTO:
+                emitJump({VmOp::JMP, 0, 0, 0}, &VmInstr::a, std::static_pointer_cast<GotoInstr>(instr)->target->name);
+                return i;
+            case OpCode::IF_GOTO: {
+                auto& branch = *std::static_pointer_cast<IfGotoInstr>(instr);
+                if (isConstant(branch.condition)) {
+                    if (branch.condition->value) emitJump({VmOp::JMP, 0, 0, 0}, &VmInstr::a, branch.target->name);
+                } else {
+                    emitJump({VmOp::JNZ, slotOf(branch.condition), 0, 0}, &VmInstr::b, branch.target->name);
+                }
+                return i;
+            }
+            case OpCode::PARAM:
+                pendingArgs.push_back(std::static_pointer_cast<ParamInstr>(instr)->param);
+                return i;
+            case OpCode::CALL:
+                return lowerCall(*std::static_pointer_cast<CallInstr>(instr), i);
+            case OpCode::RETURN: {
+                auto& ret = *std::static_pointer_cast<ReturnInstr>(instr);
+                if (!ret.value) emit({VmOp::RETI, 0, 0, 0});
+                else if (isConstant(ret.value)) emit({VmOp::RETI, ret.value->value, 0, 0});
+                else emit({VmOp::RET, slotOf(ret.value), 0, 0});
+                return i;
+            }
+            case OpCode::LABEL:
+                labelPos[std::static_pointer_cast<LabelInstr>(instr)->label] = fn.code.size();
+                return i;
+            case OpCode::PROFILE_COUNT:
+                return i;  // 剖析插桩只对生成的汇编有意义
+            default:
+                throw VmError("unsupported instruction in function '" + begin.funcName + "': " + instr->toString());
+        }
+    }
+
+    size_t lowerBinary(const BinaryOpInstr& bin, size_t i) {
+        if (isCompare(bin.opcode) && i + 1 < body.size()) {
+            // t = a cc b; if t goto L
+            auto branch = std::dynamic_pointer_cast<IfGotoInstr>(body[i + 1]);
+            if (branch && sameOperand(branch->condition, bin.result) && usedOnlyBy(bin.result, i + 1)) {
+                emitBranch(bin.opcode, bin.left, bin.right, branch->target->name);
+                return i + 1;
+            }
+            // t = a cc b; u = !t; if u goto L
+            auto negate = std::dynamic_pointer_cast<UnaryOpInstr>(body[i + 1]);
+            if (negate && negate->opcode == OpCode::NOT && sameOperand(negate->operand, bin.result) &&
+                usedOnlyBy(bin.result, i + 1) && i + 2 < body.size()) {
+                branch = std::dynamic_pointer_cast<IfGotoInstr>(body[i + 2]);
+                if (branch && sameOperand(branch->condition, negate->result) && usedOnlyBy(negate->result, i + 2)) {
+                    emitBranch(invertCompare(bin.opcode), bin.left, bin.right, branch->target->name);
+                    return i + 2;
+                }
+            }
+        }
+
+        int32_t dest = resultSlot(bin.result, i);
+        if (isConstant(bin.left) && isConstant(bin.right)) {
+            emit({VmOp::LOADI, dest, evalBinaryOp(bin.opcode, bin.left->value, bin.right->value), 0});
+        } else if (bin.opcode == OpCode::ADD && isConstant(bin.right)) {
+            emit({VmOp::ADDI, dest, slotOf(bin.left), bin.right->value});
+        } else if (bin.opcode == OpCode::ADD && isConstant(bin.left)) {
+            emit({VmOp::ADDI, dest, slotOf(bin.right), bin.left->value});
+        } else if (bin.opcode == OpCode::SUB && isConstant(bin.right)) {
+            emit({VmOp::ADDI, dest, slotOf(bin.left), wrapSub(0, bin.right->value)});
+        } else {
+            emit({binaryOp(bin.opcode), dest, slotOf(bin.left), slotOf(bin.right)});
+        }
+        return i;
+    }
+
+    size_t lowerUnary(const UnaryOpInstr& un, size_t i) {
+        // t = !x; if t goto L -> JZ x, L
+        if (un.opcode == OpCode::NOT && !isConstant(un.operand) && i + 1 < body.size()) {
+            auto branch = std::dynamic_pointer_cast<IfGotoInstr>(body[i + 1]);
+            if (branch && sameOperand(branch->condition, un.result) && usedOnlyBy(un.result, i + 1)) {
+                emitJump({VmOp::JZ, slotOf(un.operand), 0, 0}, &VmInstr::b, branch->target->name);
+                return i + 1;
+            }
+        }
+
+        int32_t dest = resultSlot(un.result, i);
+        if (isConstant(un.operand)) {
+            int32_t value = un.opcode == OpCode::NEG ? wrapSub(0, un.operand->value) : !un.operand->value;
+            emit({VmOp::LOADI, dest, value, 0});
+        } else {
+            emit({un.opcode == OpCode::NEG ? VmOp::NEG : VmOp::NOT, dest, slotOf(un.operand), 0});
+        }
+        return i;
+    }
+
+    size_t lowerCall(const CallInstr& call, size_t i) {
+        auto callee = functionIndex.find(call.funcName);
+        if (callee == functionIndex.end()) {
+            throw VmError("call to undefined function '" + call.funcName + "'");
+        }
+        size_t argc = static_cast<size_t>(std::max(call.paramCount, 0));
+        size_t expected = module.functions[callee->second].paramCount;
+        if (argc != expected) {
+            throw VmError("call to '" + call.funcName + "' passes " + std::to_string(argc) +
+                          " arguments, expected " + std::to_string(expected));
+        }
+
+        std::vector<std::shared_ptr<Operand>> args = call.params;
+        if (args.empty() && argc > 0) {
+            if (pendingArgs.size() < argc) {
+                throw VmError("call to '" + call.funcName + "' is missing param instructions");
+            }
+            args.assign(pendingArgs.end() - argc, pendingArgs.end());
+        }
+        if (pendingArgs.size() >= argc) pendingArgs.erase(pendingArgs.end() - argc, pendingArgs.end());
+
+        int32_t argStart = static_cast<int32_t>(module.argSlots.size());
+        for (const auto& arg : args) module.argSlots.push_back(slotOf(arg));
+        int32_t dest = resultSlot(call.result, i);
+        emit({VmOp::CALL, dest, callee->second, argStart});
+        return i;
+    }
+};
+
+} // namespace
+
+// ==================== 模块降级入口 ====================
+
+VmModule BytecodeCompiler::compile(const std::vector<std::shared_ptr<IRInstr>>& instructions) {
+    VmModule module;
+    std::map<std::string, int> functionIndex;
+    std::vector<std::pair<size_t, size_t>> ranges;
+
+    // 先登记全部函数，调用点据此解析被调函数和形参个数
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto begin = std::dynamic_pointer_cast<FunctionBeginInstr>(instructions[i]);
+        if (!begin) continue;
+        size_t end = i + 1;
+        while (end < instructions.size() && instructions[end]->opcode != OpCode::FUNCTION_END) ++end;
+        if (functionIndex.count(begin->funcName)) {
+            throw VmError("function '" + begin->funcName + "' is defined more than once");
+        }
+        functionIndex[begin->funcName] = static_cast<int>(module.functions.size());
+        module.functions.emplace_back();
+        module.functions.back().name = begin->funcName;
+        module.functions.back().paramCount = static_cast<int>(begin->paramNames.size());
+        ranges.emplace_back(i, end);
+        i = end;
+    }
+
+    for (size_t f = 0; f < ranges.size(); ++f) {
+        auto [beginIndex, endIndex] = ranges[f];
+        auto begin = std::static_pointer_cast<FunctionBeginInstr>(instructions[beginIndex]);
+        std::vector<std::shared_ptr<IRInstr>> body(instructions.begin() + beginIndex + 1,
+                                                   instructions.begin() + endIndex);
+        FunctionLowering(*begin, body, functionIndex, module, module.functions[f]).lower();
+    }
+    return module;
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "ir/ir.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// ==================== VM错误 ====================
+
+class VmError : public std::runtime_error {
+public:
+    explicit VmError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// ==================== 运算语义 ====================
+//
+// 与RV32目标一致：32位补码回绕，除零与INT_MIN/-1不陷入
+// （x/0 = -1，x%0 = x，INT_MIN/-1 = INT_MIN，INT_MIN%-1 = 0）。
+// IR解释器与字节码VM共用，保证两者结果与生成的汇编一致。
+
+inline int32_t wrapAdd(int32_t a, int32_t b) {
+    return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b));
+}
+inline int32_t wrapSub(int32_t a, int32_t b) {
+    return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b));
+}
+inline int32_t wrapMul(int32_t a, int32_t b) {
+    return static_cast<int32_t>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b));
+}
+inline int32_t riscvDiv(int32_t a, int32_t b) {
+    if (b == 0) return -1;
+    if (b == -1) return wrapSub(0, a);
+    return a / b;
+}
+inline int32_t riscvRem(int32_t a, int32_t b) {
+    if (b == 0) return a;
+    if (b == -1) return 0;
+    return a % b;
+}
+
+// 二元IR运算求值（AND/OR为逻辑运算，结果为0或1）
+inline int32_t evalBinaryOp(OpCode op, int32_t a, int32_t b) {
+    switch (op) {
+        case OpCode::ADD: return wrapAdd(a, b);
+        case OpCode::SUB: return wrapSub(a, b);
+        case OpCode::MUL: return wrapMul(a, b);
+        case OpCode::DIV: return riscvDiv(a, b);
+        case OpCode::MOD: return riscvRem(a, b);
+        case OpCode::LT: return a < b;
+        case OpCode::GT: return a > b;
+        case OpCode::LE: return a <= b;
+        case OpCode::GE: return a >= b;
+        case OpCode::EQ: return a == b;
+        case OpCode::NE: return a != b;
+        case OpCode::AND: return a && b;
+        case OpCode::OR: return a || b;
+        default: return 0;
+    }
+}
+
+// ==================== 字节码指令 ====================
+//
+// 寄存器式字节码：操作数是当前帧内的槽位下标（形参、变量、临时量、常量各占一个槽）。
+// 跳转目标是相对当前指令的偏移。带I后缀的指令把c（或b）当作立即数。
+//
+//   MOV a, b          a = b
+//   LOADI a, imm      a = imm
+//   ADD..OR a, b, c   a = b op c（AND/OR为逻辑与/或）
+//   ADDI a, b, imm    a = b + imm           （x + 常量 / x - 常量）
+//   NEG/NOT a, b      a = -b / a = !b
+//   JMP off           跳转
+//   JNZ/JZ a, off     a非零/为零时跳转
+//   Bcc a, b, off     比较后跳转（t = a cc b; if t goto L 融合）
+//   BccI a, imm, off  与立即数比较后跳转
+//   CALL a, f, args   a = f(args)，实参槽位列表在VmModule::argSlots[args..]
+//   RET a / RETI imm  返回
+#define TOYC_VM_OPS(X) \
+    X(MOV) X(LOADI) \
+    X(ADD) X(SUB) X(MUL) X(DIV) X(MOD) \
+    X(LT) X(GT) X(LE) X(GE) X(EQ) X(NE) X(AND) X(OR) \
+    X(ADDI) X(NEG) X(NOT) \
+    X(JMP) X(JNZ) X(JZ) \
+    X(BLT) X(BGT) X(BLE) X(BGE) X(BEQ) X(BNE) \
+    X(BLTI) X(BGTI) X(BLEI) X(BGEI) X(BEQI) X(BNEI) \
+    X(CALL) X(RET) X(RETI)
+
+enum class VmOp : uint8_t {
+#define TOYC_VM_ENUM(name) name,
+    TOYC_VM_OPS(TOYC_VM_ENUM)
+#undef TOYC_VM_ENUM
+};
+
+constexpr size_t kVmOpCount = 0
+#define TOYC_VM_COUNT(name) + 1
+    TOYC_VM_OPS(TOYC_VM_COUNT)
+#undef TOYC_VM_COUNT
+    ;
+
+const char* vmOpName(VmOp op);
+
+struct VmInstr {
+    VmOp op;
+    int32_t a = 0;
+    int32_t b = 0;
+    int32_t c = 0;
+};
+
+// ==================== 字节码模块 ====================
+
+struct VmFunction {
+    std::string name;
+    int paramCount = 0;
+    int frameSize = 0;               // 槽位总数：[形参][变量与临时量][常量]
+    int constBase = 0;               // 常量槽起始下标，调用时从constants复制
+    std::vector<int32_t> constants;
+    std::vector<std::string> slotNames;
+    std::vector<VmInstr> code;
+};
+
+struct VmModule {
+    std::vector<VmFunction> functions;
+    std::vector<int32_t> argSlots;   // 各调用点的实参槽位，CALL的c指向起点
+
+    int findFunction(const std::string& name) const;
+    void dump(std::ostream& out) const;
+};
+
+// ==================== IR到字节码的降级 ====================
+//
+// 按函数逐条翻译优化后的IR，同时做以下融合：
+// - t = a cc b; if t goto L         -> Bcc a, b, L
+// - t = a cc b; u = !t; if u goto L -> B(反cc) a, b, L
+// - t = a op b; x = t               -> 直接写入x
+// - param ...; t = call f, N        -> 一条CALL（实参在调用时按槽位读取）
+// 被融合的临时量必须只在紧随其后的那条指令中使用一次。
+class BytecodeCompiler {
+public:
+    static VmModule compile(const std::vector<std::shared_ptr<IRInstr>>& instructions);
+};
@@ -0,0 +1,122 @@
+// irinterp.cpp - 直接遍历IR的参照解释器
+#include "irinterp.h"
+#include "bytecode.h"
+#include <algorithm>
+
+namespace {
+
+// 递归深度上限，避免宿主栈溢出
+const int kMaxCallDepth = 5000;
+
+} // namespace
+
+IRInterpreter::IRInterpreter(const std::vector<std::shared_ptr<IRInstr>>& instructions)
+    : instructions(instructions) {
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        auto begin = std::dynamic_pointer_cast<FunctionBeginInstr>(instructions[i]);
+        if (!begin) continue;
+        FunctionInfo info;
+        info.begin = begin;
+        info.first = i + 1;
+        size_t end = i + 1;
+        while (end < instructions.size() && instructions[end]->opcode != OpCode::FUNCTION_END) {
+            if (auto label = std::dynamic_pointer_cast<LabelInstr>(instructions[end])) {
+                info.labels[label->label] = end;
+            }
+            ++end;
+        }
+        info.end = end;
+        functions[begin->funcName] = std::move(info);
+        i = end;
+    }
+}
+
+int IRInterpreter::run(const std::string& entry) {
+    auto it = functions.find(entry);
+    if (it == functions.end()) {
+        throw VmError("no function named '" + entry + "'");
+    }
+    if (!it->second.begin->paramNames.empty()) {
+        throw VmError("entry function '" + entry + "' must not take parameters");
+    }
+    executed = 0;
+    depth = 0;
+    return call(it->second, {});
+}
+
+int32_t IRInterpreter::call(const FunctionInfo& fn, const std::vector<int32_t>& args) {
+    const std::string& name = fn.begin->funcName;
+    if (++depth > kMaxCallDepth) {
+        throw VmError("stack overflow in '" + name + "' (call depth " + std::to_string(depth) + ")");
+    }
+
+    std::map<std::string, int32_t> env;
+    for (size_t i = 0; i < fn.begin->paramNames.size(); ++i) env[fn.begin->paramNames[i]] = args[i];
+    std::vector<std::shared_ptr<Operand>> pendingArgs;
+
+    auto value = [&](const std::shared_ptr<Operand>& op) -> int32_t {
+        if (!op) return 0;
+        if (op->type == OperandType::CONSTANT) return op->value;
+        return env[op->name];
+    };
+    auto jump = [&](const std::shared_ptr<Operand>& target) {
+        auto label = fn.labels.find(target->name);
+        if (label == fn.labels.end()) {
+            throw VmError("function '" + name + "' jumps to undefined label '" + target->name + "'");
+        }
+        return label->second;
+    };
+
+    size_t pc = fn.first;
+    while (pc < fn.end) {
+        const auto& instr = instructions[pc++];
+        if (++executed > instructionLimit && instructionLimit > 0) {
+            throw VmError("instruction limit exceeded (" + std::to_string(instructionLimit) + ")");
+        }
+        if (auto bin = std::dynamic_pointer_cast<BinaryOpInstr>(instr)) {
+            env[bin->result->name] = evalBinaryOp(bin->opcode, value(bin->left), value(bin->right));
+        } else if (auto un = std::dynamic_pointer_cast<UnaryOpInstr>(instr)) {
+            int32_t v = value(un->operand);
+            env[un->result->name] = un->opcode == OpCode::NEG ? wrapSub(0, v) : !v;
+        } else if (auto assign = std::dynamic_pointer_cast<AssignInstr>(instr)) {
+            env[assign->target->name] = value(assign->source);
+        } else if (auto jumpInstr = std::dynamic_pointer_cast<GotoInstr>(instr)) {
+            pc = jump(jumpInstr->target);
+        } else if (auto branch = std::dynamic_pointer_cast<IfGotoInstr>(instr)) {
+            if (value(branch->condition)) pc = jump(branch->target);
+        } else if (auto param = std::dynamic_pointer_cast<ParamInstr>(instr)) {
+            pendingArgs.push_back(param->param);
+        } else if (auto callInstr = std::dynamic_pointer_cast<CallInstr>(instr)) {
+            auto callee = functions.find(callInstr->funcName);
+            if (callee == functions.end()) {
+                throw VmError("call to undefined function '" + callInstr->funcName + "'");
+            }
+            size_t argc = static_cast<size_t>(std::max(callInstr->paramCount, 0));
+            if (argc != callee->second.begin->paramNames.size()) {
+                throw VmError("call to '" + callInstr->funcName + "' passes " + std::to_string(argc) +
+                              " arguments, expected " + std::to_string(callee->second.begin->paramNames.size()));
+            }
+            std::vector<std::shared_ptr<Operand>> argOps = callInstr->params;
+            if (argOps.empty() && argc > 0) {
+                if (pendingArgs.size() < argc) {
+                    throw VmError("call to '" + callInstr->funcName + "' is missing param instructions");
+                }
+                argOps.assign(pendingArgs.end() - argc, pendingArgs.end());
+            }
+            if (pendingArgs.size() >= argc) pendingArgs.erase(pendingArgs.end() - argc, pendingArgs.end());
+
+            std::vector<int32_t> argValues;
+            for (const auto& arg : argOps) argValues.push_back(value(arg));
+            int32_t result = call(callee->second, argValues);
+            if (callInstr->result) env[callInstr->result->name] = result;
+        } else if (auto ret = std::dynamic_pointer_cast<ReturnInstr>(instr)) {
+            --depth;
+            return value(ret->value);
+        } else if (instr->opcode != OpCode::LABEL && instr->opcode != OpCode::PROFILE_COUNT) {
+            throw VmError("unsupported instruction in function '" + name + "': " + instr->toString());
+        }
+    }
+    // 落到函数结尾（void函数或缺少return）时返回0
+    --depth;
+    return 0;
+}
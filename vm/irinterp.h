@@ -0,0 +1,40 @@
+#pragma once
+#include "ir/ir.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ==================== IR解释器（--run=ir） ====================
+//
+// 直接遍历std::shared_ptr<IRInstr>执行，变量按名字存放在每帧的map中。
+// 不追求速度，作为字节码VM与JIT的参照实现（语义与RV32目标一致，见vm/bytecode.h）。
+class IRInterpreter {
+public:
+    explicit IRInterpreter(const std::vector<std::shared_ptr<IRInstr>>& instructions);
+
+    // 调用无参函数entry（默认main）并返回其结果，失败时抛出VmError
+    int run(const std::string& entry = "main");
+
+    uint64_t executedInstructions() const { return executed; }
+
+    // 执行的IR指令数超过limit时抛出VmError（0表示不限制），用于运行可能不终止的程序
+    void setInstructionLimit(uint64_t limit) { instructionLimit = limit; }
+
+private:
+    struct FunctionInfo {
+        std::shared_ptr<FunctionBeginInstr> begin;
+        size_t first = 0;   // 函数体第一条指令
+        size_t end = 0;     // function end的下标
+        std::map<std::string, size_t> labels;
+    };
+
+    const std::vector<std::shared_ptr<IRInstr>>& instructions;
+    std::map<std::string, FunctionInfo> functions;
+    uint64_t executed = 0;
+    uint64_t instructionLimit = 0;
+    int depth = 0;
+
+    int32_t call(const FunctionInfo& fn, const std::vector<int32_t>& args);
+};
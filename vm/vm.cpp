@@ -0,0 +1,231 @@
+// vm.cpp - 字节码解释循环
+#include "vm.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+
+#if defined(__GNUC__)
+#define TOYC_VM_THREADED 1
+#endif
+
+VirtualMachine::VirtualMachine(const VmModule& module, size_t stackSlots)
+    : module(module), stack(new int32_t[stackSlots]), stackSlots(stackSlots) {}
+
+int VirtualMachine::run(const std::string& entry) {
+    int function = module.findFunction(entry);
+    if (function < 0) {
+        throw VmError("no function named '" + entry + "'");
+    }
+    if (module.functions[function].paramCount != 0) {
+        throw VmError("entry function '" + entry + "' must not take parameters");
+    }
+    return countOps ? execute<true>(function) : execute<false>(function);
+}
+
+uint64_t VirtualMachine::totalOps() const {
+    uint64_t total = 0;
+    for (uint64_t c : counts) total += c;
+    return total;
+}
+
+void VirtualMachine::printOpCounts(std::ostream& out) const {
+    uint64_t total = totalOps();
+    std::vector<size_t> order;
+    for (size_t op = 0; op < kVmOpCount; ++op) {
+        if (counts[op]) order.push_back(op);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return counts[a] > counts[b]; });
+
+    out << "===== VM动态操作码计数 =====\n";
+    out << std::left << std::setw(8) << "op" << std::right << std::setw(16) << "count" << std::setw(9) << "%"
+        << "\n";
+    for (size_t op : order) {
+        out << std::left << std::setw(8) << vmOpName(static_cast<VmOp>(op)) << std::right << std::setw(16)
+            << counts[op] << std::setw(9) << std::fixed << std::setprecision(1)
+            << 100.0 * static_cast<double>(counts[op]) / static_cast<double>(total) << "\n";
+    }
+    out << std::left << std::setw(8) << "total" << std::right << std::setw(16) << total << "\n";
+}
+
+// ==================== 解释循环 ====================
+
+namespace {
+
+struct CallFrame {
+    const VmInstr* returnPc;
+    int32_t* base;
+    int32_t dest;
+    const VmFunction* function;
+};
+
+} // namespace
+
+template <bool CountOps>
+int32_t VirtualMachine::execute(int entry) {
+    const VmFunction* fn = &module.functions[entry];
+    const int32_t* argSlots = module.argSlots.data();
+    int32_t* const stackEnd = stack.get() + stackSlots;
+    int32_t* base = stack.get();
+    std::vector<CallFrame> frames;
+    frames.reserve(256);
+
+    // 建立新帧：实参之后的变量清零，常量槽从模板复制
+    auto enterFrame = [&](int32_t* frame, const VmFunction& callee) {
+        if (frame + callee.frameSize > stackEnd) {
+            throw VmError("stack overflow in '" + callee.name + "' (call depth " + std::to_string(frames.size()) + ")");
+        }
+        std::fill(frame + callee.paramCount, frame + callee.constBase, 0);
+        if (!callee.constants.empty()) {
+            std::memcpy(frame + callee.constBase, callee.constants.data(), callee.constants.size() * sizeof(int32_t));
+        }
+    };
+    enterFrame(base, *fn);
+    const VmInstr* pc = fn->code.data();
+
+#ifdef TOYC_VM_THREADED
+    static const void* const dispatch[] = {
+#define TOYC_VM_LABEL(name) &&op_##name,
+        TOYC_VM_OPS(TOYC_VM_LABEL)
+#undef TOYC_VM_LABEL
+    };
+#define VM_CASE(name) op_##name:
+#define VM_DISPATCH()                                                            \
+    do {                                                                         \
+        if constexpr (CountOps) ++counts[static_cast<size_t>(pc->op)];           \
+        goto *dispatch[static_cast<size_t>(pc->op)];                             \
+    } while (0)
+    VM_DISPATCH();
+#else
+#define VM_CASE(name) case VmOp::name:
+#define VM_DISPATCH() continue
+    for (;;) {
+        if constexpr (CountOps) ++counts[static_cast<size_t>(pc->op)];
+        switch (pc->op) {
+#endif
+
+#define VM_BINARY(name, expr)                                                    \
+    VM_CASE(name) {                                                              \
+        int32_t x = base[pc->b], y = base[pc->c];                                \
+        base[pc->a] = (expr);                                                    \
+        ++pc;                                                                    \
+        VM_DISPATCH();                                                           \
+    }
+#define VM_BRANCH(name, cmp)                                                     \
+    VM_CASE(name) {                                                              \
+        pc += (base[pc->a] cmp base[pc->b]) ? pc->c : 1;                         \
+        VM_DISPATCH();                                                           \
+    }
+#define VM_BRANCH_IMM(name, cmp)                                                 \
+    VM_CASE(name) {                                                              \
+        pc += (base[pc->a] cmp pc->b) ? pc->c : 1;                               \
+        VM_DISPATCH();                                                           \
+    }
+
+    VM_CASE(MOV) {
+        base[pc->a] = base[pc->b];
+        ++pc;
+        VM_DISPATCH();
+    }
+    VM_CASE(LOADI) {
+        base[pc->a] = pc->b;
+        ++pc;
+        VM_DISPATCH();
+    }
+    VM_BINARY(ADD, wrapAdd(x, y))
+    VM_BINARY(SUB, wrapSub(x, y))
+    VM_BINARY(MUL, wrapMul(x, y))
+    VM_BINARY(DIV, riscvDiv(x, y))
+    VM_BINARY(MOD, riscvRem(x, y))
+    VM_BINARY(LT, x < y)
+    VM_BINARY(GT, x > y)
+    VM_BINARY(LE, x <= y)
+    VM_BINARY(GE, x >= y)
+    VM_BINARY(EQ, x == y)
+    VM_BINARY(NE, x != y)
+    VM_BINARY(AND, x && y)
+    VM_BINARY(OR, x || y)
+    VM_CASE(ADDI) {
+        base[pc->a] = wrapAdd(base[pc->b], pc->c);
+        ++pc;
+        VM_DISPATCH();
+    }
+    VM_CASE(NEG) {
+        base[pc->a] = wrapSub(0, base[pc->b]);
+        ++pc;
+        VM_DISPATCH();
+    }
+    VM_CASE(NOT) {
+        base[pc->a] = !base[pc->b];
+        ++pc;
+        VM_DISPATCH();
+    }
+    VM_CASE(JMP) {
+        pc += pc->a;
+        VM_DISPATCH();
+    }
+    VM_CASE(JNZ) {
+        pc += base[pc->a] ? pc->b : 1;
+        VM_DISPATCH();
+    }
+    VM_CASE(JZ) {
+        pc += base[pc->a] ? 1 : pc->b;
+        VM_DISPATCH();
+    }
+    VM_BRANCH(BLT, <)
+    VM_BRANCH(BGT, >)
+    VM_BRANCH(BLE, <=)
+    VM_BRANCH(BGE, >=)
+    VM_BRANCH(BEQ, ==)
+    VM_BRANCH(BNE, !=)
+    VM_BRANCH_IMM(BLTI, <)
+    VM_BRANCH_IMM(BGTI, >)
+    VM_BRANCH_IMM(BLEI, <=)
+    VM_BRANCH_IMM(BGEI, >=)
+    VM_BRANCH_IMM(BEQI, ==)
+    VM_BRANCH_IMM(BNEI, !=)
+    VM_CASE(CALL) {
+        const VmFunction& callee = module.functions[pc->b];
+        int32_t* frame = base + fn->frameSize;
+        enterFrame(frame, callee);
+        const int32_t* args = argSlots + pc->c;
+        for (int k = 0; k < callee.paramCount; ++k) frame[k] = base[args[k]];
+        frames.push_back({pc + 1, base, pc->a, fn});
+        base = frame;
+        fn = &callee;
+        pc = callee.code.data();
+        VM_DISPATCH();
+    }
+    VM_CASE(RET) {
+        int32_t value = base[pc->a];
+        if (frames.empty()) return value;
+        const CallFrame& caller = frames.back();
+        pc = caller.returnPc;
+        base = caller.base;
+        fn = caller.function;
+        base[caller.dest] = value;
+        frames.pop_back();
+        VM_DISPATCH();
+    }
+    VM_CASE(RETI) {
+        int32_t value = pc->a;
+        if (frames.empty()) return value;
+        const CallFrame& caller = frames.back();
+        pc = caller.returnPc;
+        base = caller.base;
+        fn = caller.function;
+        base[caller.dest] = value;
+        frames.pop_back();
+        VM_DISPATCH();
+    }
+
+#ifndef TOYC_VM_THREADED
+        }
+    }
+#endif
+
+#undef VM_BRANCH_IMM
+#undef VM_BRANCH
+#undef VM_BINARY
+#undef VM_DISPATCH
+#undef VM_CASE
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "bytecode.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ==================== 字节码虚拟机（--run=vm） ====================
+//
+// 执行BytecodeCompiler产生的寄存器式字节码，不依赖RISC-V工具链，在任何平台上可用。
+// GCC/Clang下解释循环用computed goto做线索化分派（每个处理程序末尾各自跳转），
+// 其他编译器退化为switch循环。
+//
+// - 所有帧在一块连续的槽位栈上依次排开，调用时把实参和常量复制到新帧
+// - 开启计数后统计每种操作码的动态执行次数（计数版本与快速版本是两份独立的循环）
+class VirtualMachine {
+public:
+    explicit VirtualMachine(const VmModule& module, size_t stackSlots = 1 << 22);
+
+    void setCountOps(bool enabled) { countOps = enabled; }
+
+    // 调用无参函数entry（默认main）并返回其结果，失败时抛出VmError
+    int run(const std::string& entry = "main");
+
+    const std::array<uint64_t, kVmOpCount>& opCounts() const { return counts; }
+    uint64_t totalOps() const;
+    void printOpCounts(std::ostream& out) const;
+
+private:
+    const VmModule& module;
+    std::unique_ptr<int32_t[]> stack;   // 不做清零，按需缺页
+    size_t stackSlots;
+    bool countOps = false;
+    std::array<uint64_t, kVmOpCount> counts{};
+
+    template <bool CountOps>
+    int32_t execute(int function);
+};